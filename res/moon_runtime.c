@@ -0,0 +1,49 @@
+/*
+ * Runtime for programs compiled to x86-64 by X86Backend: cc program.s moon_runtime.c -o program
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* stack frames, objects and arrays, addressed by offsets like the memory of the Moon machine */
+#define MOON_MEMORY_SIZE (16 * 1024 * 1024)
+
+unsigned char moon_memory[MOON_MEMORY_SIZE];
+const int moon_memory_size = MOON_MEMORY_SIZE;
+
+int moon_main(void);
+
+/* reads a line and the integer at its start, like getstr and strint do */
+int moon_get(void)
+{
+    char line[64];
+
+    if (fgets(line, sizeof(line), stdin) == NULL) {
+        return 0;
+    }
+
+    return (int) strtol(line, NULL, 10);
+}
+
+void moon_put(int value)
+{
+    printf("%d\n", value);
+}
+
+/* dividing by zero traps, what was written so far still goes out */
+static void moon_division_by_zero(int signal)
+{
+    (void) signal;
+    fflush(stdout);
+    fputs("division by zero\n", stderr);
+    _Exit(1);
+}
+
+int main(void)
+{
+    signal(SIGFPE, moon_division_by_zero);
+    moon_main();
+    fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,265 @@
+#include "ProgramGenerator.h"
+
+#include <algorithm>
+
+namespace moonshine { namespace benchmark {
+
+namespace {
+
+// locals and array sizes every function has, loops run over the array indices
+const char* const LOCALS[] = {"a", "b", "t"};
+const unsigned int SIZE = 4;
+
+std::string className(const unsigned int& c)
+{
+    return "C" + std::to_string(c);
+}
+
+std::string functionName(const unsigned int& c, const unsigned int& f)
+{
+    return "f" + std::to_string(c) + "_" + std::to_string(f);
+}
+
+}
+
+ProgramGenerator::ProgramGenerator(const Options& options)
+    : options_(options), random_(options.seed)
+{
+    options_.depth = std::max(options_.depth, 1u);
+}
+
+void ProgramGenerator::generate(std::ostream& s)
+{
+    for (unsigned int c = 0; c < options_.classes; ++c) {
+        classDecl(s, c);
+    }
+
+    for (unsigned int c = 0; c < options_.classes; ++c) {
+        for (unsigned int f = 0; f < options_.functions; ++f) {
+            funcDef(s, c, f);
+        }
+    }
+
+    program(s);
+}
+
+void ProgramGenerator::classDecl(std::ostream& s, const unsigned int& c)
+{
+    s << "class " << className(c);
+
+    // the first class of every chain has no parent
+    if (c % options_.depth != 0) {
+        s << " : " << className(c - 1);
+    }
+
+    s << " {\n";
+    s << "    int m" << c << ";\n";
+    s << "    int v" << c << "[" << SIZE << "];\n";
+
+    for (unsigned int f = 0; f < options_.functions; ++f) {
+        s << "    int " << functionName(c, f) << "(int p, int q);\n";
+    }
+
+    s << "};\n\n";
+}
+
+void ProgramGenerator::funcDef(std::ostream& s, const unsigned int& c, const unsigned int& f)
+{
+    class_ = c;
+    function_ = f;
+    loops_ = 0;
+
+    s << "int " << className(c) << "::" << functionName(c, f) << "(int p, int q) {\n";
+
+    for (const auto& local : LOCALS) {
+        s << "    int " << local << ";\n";
+    }
+
+    s << "    int w[" << SIZE << "];\n";
+
+    // every local is set before it is used
+    for (const auto& local : LOCALS) {
+        auto value = operand();
+        s << "    " << local << " = " << value << ";\n";
+    }
+
+    unsigned int budget = options_.statements;
+    block(s, budget, options_.nesting, "    ");
+
+    auto result = expression(2);
+    s << "    return (" << result << ");\n";
+    s << "};\n\n";
+}
+
+void ProgramGenerator::program(std::ostream& s)
+{
+    s << "program {\n";
+
+    for (unsigned int c = 0; c < options_.classes; ++c) {
+        s << "    " << className(c) << " o" << c << ";\n";
+    }
+
+    s << "    int r;\n";
+    s << "    r = 0;\n";
+
+    for (unsigned int c = 0; c < options_.classes; ++c) {
+        for (unsigned int f = 0; f < options_.functions; ++f) {
+            auto p = pick(100);
+            auto q = pick(100);
+            s << "    r = r + o" << c << "." << functionName(c, f) << "(" << p << ", " << q << ");\n";
+        }
+    }
+
+    s << "    put(r);\n";
+    s << "};\n";
+}
+
+void ProgramGenerator::block(std::ostream& s, unsigned int& budget, const unsigned int& nesting, const std::string& indent)
+{
+    while (budget > 0) {
+        statement(s, budget, nesting, indent);
+    }
+}
+
+void ProgramGenerator::statement(std::ostream& s, unsigned int& budget, const unsigned int& nesting, const std::string& indent)
+{
+    --budget;
+
+    // compound statements take a share of what is left for their blocks
+    bool compound = nesting > 0 && budget > 0;
+    auto share = compound ? 1 + pick(std::min(budget, 2 * SIZE)) : 0;
+
+    // every choice is drawn in its own statement, the order of evaluation within an expression isn't fixed
+    switch (pick(compound ? 8 : 6)) {
+        case 0:
+        case 1:
+        case 2: {
+            auto target = variable();
+            auto value = expression(2);
+            s << indent << target << " = " << value << ";\n";
+            break;
+        }
+        case 3: {
+            auto target = LOCALS[pick(3)];
+
+            // only functions defined before, so that nothing recurses
+            if (function_ == 0) {
+                auto value = expression(2);
+                s << indent << target << " = " << value << ";\n";
+                break;
+            }
+
+            auto callee = functionName(class_, pick(function_));
+            auto first = expression(1);
+            auto second = expression(1);
+            s << indent << target << " = " << callee << "(" << first << ", " << second << ");\n";
+            break;
+        }
+        case 4: {
+            auto value = expression(2);
+            s << indent << "put(" << value << ");\n";
+            break;
+        }
+        case 5:
+            s << indent << "get(" << LOCALS[pick(3)] << ");\n";
+            break;
+        case 6: {
+            budget -= share;
+            auto thenShare = share / 2;
+            auto elseShare = share - thenShare;
+            auto test = condition();
+
+            s << indent << "if (" << test << ") then {\n";
+            block(s, thenShare, nesting - 1, indent + "    ");
+            s << indent << "} else {\n";
+            block(s, elseShare, nesting - 1, indent + "    ");
+            s << indent << "};\n";
+            break;
+        }
+        case 7: {
+            budget -= share;
+            auto i = "i" + std::to_string(loops_++);
+            auto step = expression(1);
+
+            s << indent << "for (int " << i << " = 0; " << i << " < " << SIZE << "; " << i << " = " << i << " + 1) {\n";
+            s << indent << "    w[" << i << "] = w[" << i << "] + " << step << ";\n";
+            block(s, share, nesting - 1, indent + "    ");
+            s << indent << "};\n";
+            break;
+        }
+    }
+}
+
+std::string ProgramGenerator::expression(const unsigned int& depth)
+{
+    if (depth == 0) {
+        return operand();
+    }
+
+    auto choice = pick(5);
+
+    if (choice == 4) {
+        return operand();
+    }
+
+    auto left = expression(depth - 1);
+
+    switch (choice) {
+        case 0:
+            return left + " + " + expression(depth - 1);
+        case 1:
+            return left + " - " + expression(depth - 1);
+        case 2:
+            return left + " * " + operand();
+        default:
+            // never by zero
+            return "(" + left + ") / " + std::to_string(1 + pick(9));
+    }
+}
+
+std::string ProgramGenerator::operand()
+{
+    switch (pick(6)) {
+        case 0:
+            return std::to_string(pick(100));
+        case 1:
+            return pick(2) == 0 ? "p" : "q";
+        case 2:
+            return "w[" + std::to_string(pick(SIZE)) + "]";
+        case 3:
+            // a member of the class or of one of its parents
+            return "m" + std::to_string(class_ - pick(class_ % options_.depth + 1));
+        default:
+            return LOCALS[pick(3)];
+    }
+}
+
+std::string ProgramGenerator::condition()
+{
+    static const char* const OPERATORS[] = {"==", "<>", "<", "<=", ">", ">="};
+
+    auto left = expression(1);
+    auto op = OPERATORS[pick(6)];
+    return left + " " + op + " " + expression(1);
+}
+
+std::string ProgramGenerator::variable()
+{
+    switch (pick(5)) {
+        case 0:
+            return "m" + std::to_string(class_ - pick(class_ % options_.depth + 1));
+        case 1:
+            return "v" + std::to_string(class_) + "[" + std::to_string(pick(SIZE)) + "]";
+        case 2:
+            return "w[" + std::to_string(pick(SIZE)) + "]";
+        default:
+            return LOCALS[pick(3)];
+    }
+}
+
+unsigned int ProgramGenerator::pick(const unsigned int& n)
+{
+    return static_cast<unsigned int>(random_() % n);
+}
+
+}}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <random>
+#include <string>
+
+namespace moonshine { namespace benchmark {
+
+/**
+ * Writes synthetic programs of a tunable size, which pass every semantic check.
+ *
+ * Classes are laid out in inheritance chains of the given depth, each with members, an array and member
+ * functions. Function bodies are made of assignments, calls to the class' other functions, get and put, and
+ * if and for statements holding nested blocks up to the given nesting. The program body creates an object of
+ * every class and calls each of its functions.
+ *
+ * The same options always give the same program, on any platform.
+ */
+class ProgramGenerator
+{
+public:
+    struct Options
+    {
+        unsigned int classes = 20;
+        unsigned int depth = 4;
+        unsigned int functions = 5;
+
+        // statements per function body, counting the ones nested in if and for statements
+        unsigned int statements = 20;
+        unsigned int nesting = 2;
+
+        std::uint32_t seed = 1;
+    };
+
+    explicit ProgramGenerator(const Options& options);
+
+    void generate(std::ostream& s);
+private:
+    Options options_;
+    std::mt19937 random_;
+
+    // per function state
+    unsigned int class_ = 0;
+    unsigned int function_ = 0;
+    unsigned int loops_ = 0;
+
+    void classDecl(std::ostream& s, const unsigned int& c);
+    void funcDef(std::ostream& s, const unsigned int& c, const unsigned int& f);
+    void program(std::ostream& s);
+
+    // writes statements until the budget is used up
+    void block(std::ostream& s, unsigned int& budget, const unsigned int& nesting, const std::string& indent);
+    void statement(std::ostream& s, unsigned int& budget, const unsigned int& nesting, const std::string& indent);
+
+    std::string expression(const unsigned int& depth);
+    std::string operand();
+    std::string condition();
+    std::string variable();
+
+    // uniform in [0, n), the same everywhere unlike the standard distributions
+    unsigned int pick(const unsigned int& n);
+};
+
+}}
@@ -0,0 +1,376 @@
+#include "ProgramGenerator.h"
+
+#include <moonshine/lexer/Lexer.h>
+#include <moonshine/lexer/Token.h>
+#include <moonshine/syntax/Grammar.h>
+#include <moonshine/syntax/Parser.h>
+#include <moonshine/semantic/SemanticError.h>
+#include <moonshine/semantic/InheritanceResolverVisitor.h>
+#include <moonshine/semantic/SymbolTableCreatorVisitor.h>
+#include <moonshine/semantic/SymbolTableClassDeclLinkerVisitor.h>
+#include <moonshine/semantic/SymbolTableLinkerVisitor.h>
+#include <moonshine/semantic/ShadowedSymbolCheckerVisitor.h>
+#include <moonshine/semantic/TypeCheckerVisitor.h>
+#include <moonshine/code/MemorySizeComputerVisitor.h>
+#include <moonshine/code/MoonBackend.h>
+#include <moonshine/code/PeepholeOptimizer.h>
+#include <moonshine/code/X86Backend.h>
+#include <moonshine/ir/IRBuilderVisitor.h>
+#include <moonshine/ir/Inliner.h>
+#include <moonshine/ir/TailCallElimination.h>
+#include <moonshine/ir/ConstantPropagation.h>
+#include <moonshine/ir/DeadCodeElimination.h>
+#include <moonshine/ir/DeadFunctionElimination.h>
+#include <moonshine/ir/RegisterCallingConvention.h>
+#include <moonshine/ir/StrengthReduction.h>
+#include <moonshine/ir/AddressFolding.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+using namespace moonshine;
+
+namespace {
+
+// what a compilation went through
+struct Counts
+{
+    std::size_t bytes = 0;
+    std::size_t lines = 0;
+    std::size_t tokens = 0;
+    std::size_t nodes = 0;
+    std::size_t instructions = 0;
+    std::size_t errors = 0;
+};
+
+struct Phase
+{
+    std::string name;
+    double seconds;
+};
+
+template <typename F>
+double measure(F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// in KiB, 0 where it isn't known
+long peakMemory()
+{
+#if defined(__APPLE__)
+    rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss / 1024 : 0;
+#elif defined(__unix__)
+    rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+#else
+    return 0;
+#endif
+}
+
+// compiles the source through the same phases as the driver, timing each of them
+std::vector<Phase> compile(const std::string& source, Counts& counts)
+{
+    std::vector<Phase> phases;
+    std::ostringstream discard;
+
+    auto phase = [&phases](const std::string& name, const double& seconds) {
+        phases.push_back({name, seconds});
+    };
+
+    std::unique_ptr<syntax::Grammar> grammar;
+    phase("grammar", measure([&]() {
+        grammar.reset(new syntax::Grammar("grammar.txt", "table.json", "first.txt", "follow.txt"));
+    }));
+
+    std::unique_ptr<Lexer> lex;
+    phase("lexer tables", measure([&]() { lex.reset(new Lexer()); }));
+
+    // the parser pulls its tokens from the lexer, so lexing is timed on its own first, and taken out of parsing
+    counts.tokens = 0;
+    auto lexing = measure([&]() {
+        std::istringstream input(source);
+        lex->startLexing(&input, nullptr);
+
+        for (std::unique_ptr<Token> token(lex->getNextToken()); token; token.reset(lex->getNextToken())) {
+            ++counts.tokens;
+        }
+    });
+    phase("lexing", lexing);
+
+    std::unique_ptr<ast::Node> astRoot;
+    std::istringstream input(source);
+    Lexer parseLex;
+    syntax::Parser parser(*grammar);
+    parseLex.startLexing(&input, nullptr);
+
+    auto parsing = measure([&]() { astRoot = parser.parse(&parseLex, nullptr); });
+    phase("parsing", std::max(parsing - lexing, 0.0));
+
+    if (!astRoot || !parseLex.getErrors().empty() || !parser.getErrors().empty()) {
+        counts.errors = parseLex.getErrors().size() + parser.getErrors().size() + 1;
+        return phases;
+    }
+
+    counts.nodes = astRoot->nodeCount();
+
+    std::vector<semantic::SemanticError> errors;
+
+    auto visit = [&](const std::string& name, Visitor* visitor) {
+        std::unique_ptr<Visitor> v(visitor);
+        v->setErrorContainer(&errors);
+        phase(name, measure([&]() { astRoot->accept(v.get()); }));
+    };
+
+    visit("symbol tables", new semantic::SymbolTableCreatorVisitor());
+    visit("class declarations", new semantic::SymbolTableClassDeclLinkerVisitor());
+    visit("symbol linking", new semantic::SymbolTableLinkerVisitor());
+    visit("inheritance", new semantic::InheritanceResolverVisitor());
+    visit("shadowed symbols", new semantic::ShadowedSymbolCheckerVisitor());
+    visit("type checking", new semantic::TypeCheckerVisitor());
+
+    counts.errors = std::count_if(errors.begin(), errors.end(), [](const semantic::SemanticError& e) {
+        return e.level == semantic::SemanticErrorLevel::ERROR;
+    });
+
+    if (counts.errors > 0) {
+        return phases;
+    }
+
+    ir::Program program;
+    visit("memory sizes", new code::MemorySizeComputerVisitor());
+    visit("ir", new ir::IRBuilderVisitor(program));
+
+    phase("inlining", measure([&]() { ir::Inliner(16).run(program); }));
+    phase("tail calls", measure([&]() { ir::TailCallElimination().run(program); }));
+    phase("constant propagation", measure([&]() {
+        ir::ConstantPropagation().run(program);
+        ir::StrengthReduction().run(program);
+        ir::ConstantPropagation().run(program);
+    }));
+    phase("address folding", measure([&]() { ir::AddressFolding().run(program); }));
+    phase("dead code", measure([&]() {
+        ir::DeadCodeElimination().run(program);
+        ir::DeadFunctionElimination().run(program);
+    }));
+    phase("register calls", measure([&]() { ir::RegisterCallingConvention().run(program); }));
+
+    code::MoonCode moonCode;
+    phase("moon backend", measure([&]() { code::MoonBackend(moonCode).emit(program); }));
+    phase("peephole", measure([&]() { code::PeepholeOptimizer(8).optimize(moonCode); }));
+    phase("x86 backend", measure([&]() { code::X86Backend(discard).emit(program); }));
+
+    counts.instructions = moonCode.text().size();
+
+    return phases;
+}
+
+std::string quote(const std::string& value)
+{
+    std::string quoted = "\"";
+
+    for (const auto& c : value) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+
+        quoted += c;
+    }
+
+    return quoted + '"';
+}
+
+}
+
+int main(int argc, const char** argv)
+{
+    // benchmark [--classes N] [--depth N] [--functions N] [--statements N] [--nesting N] [--seed N]
+    //           [--input program.txt] [--repeat N] [--json] [--emit]
+    //   --classes ... --seed  the shape of the generated program
+    //   --input   compile this program instead of a generated one
+    //   --repeat  compile this many times, keeping the fastest time of every phase
+    //   --json    print the results as JSON, to keep track of them across builds
+    //   --emit    print the generated program instead of compiling it
+
+    const char* usage = " [--classes N] [--depth N] [--functions N] [--statements N] [--nesting N] [--seed N]"
+                        " [--input program.txt] [--repeat N] [--json] [--emit]";
+
+    benchmark::ProgramGenerator::Options options;
+    std::string inputPath;
+    unsigned int repeat = 3;
+    bool json = false;
+    bool emit = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (option == "--json") {
+            json = true;
+        } else if (option == "--emit") {
+            emit = true;
+        } else if (option == "--input" && hasValue) {
+            inputPath = argv[++i];
+        } else if (hasValue && (option == "--classes" || option == "--depth" || option == "--functions" ||
+                                option == "--statements" || option == "--nesting" || option == "--seed" ||
+                                option == "--repeat")) {
+            auto value = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+
+            if (option == "--classes") {
+                options.classes = value;
+            } else if (option == "--depth") {
+                options.depth = value;
+            } else if (option == "--functions") {
+                options.functions = value;
+            } else if (option == "--statements") {
+                options.statements = value;
+            } else if (option == "--nesting") {
+                options.nesting = value;
+            } else if (option == "--seed") {
+                options.seed = value;
+            } else {
+                repeat = std::max(value, 1u);
+            }
+        } else {
+            std::cerr << "usage: " << argv[0] << usage << std::endl;
+            return 2;
+        }
+    }
+
+    std::string source;
+
+    if (inputPath.empty()) {
+        std::ostringstream s;
+        benchmark::ProgramGenerator(options).generate(s);
+        source = s.str();
+    } else {
+        std::ifstream file(inputPath);
+
+        if (!file) {
+            std::cerr << "cannot open " << inputPath << std::endl;
+            return 2;
+        }
+
+        std::ostringstream s;
+        s << file.rdbuf();
+        source = s.str();
+    }
+
+    if (emit) {
+        std::cout << source;
+        return 0;
+    }
+
+    Counts counts;
+    counts.bytes = source.size();
+    counts.lines = std::count(source.begin(), source.end(), '\n');
+
+    std::vector<Phase> best;
+
+    for (unsigned int run = 0; run < repeat; ++run) {
+        auto phases = compile(source, counts);
+
+        if (counts.errors > 0) {
+            std::cerr << "the program has " << counts.errors << " errors, run the driver on it for details" << std::endl;
+            return 1;
+        }
+
+        if (best.empty()) {
+            best = phases;
+        }
+
+        for (std::size_t k = 0; k < phases.size(); ++k) {
+            best[k].seconds = std::min(best[k].seconds, phases[k].seconds);
+        }
+    }
+
+    double total = 0;
+
+    for (const auto& phase : best) {
+        total += phase.seconds;
+    }
+
+    // lexing makes the tokens and parsing the nodes, without the other phases
+    double lexing = 0;
+    double parsing = 0;
+
+    for (const auto& phase : best) {
+        if (phase.name == "lexing") {
+            lexing = phase.seconds;
+        } else if (phase.name == "parsing") {
+            parsing = phase.seconds;
+        }
+    }
+
+    auto tokensPerSecond = lexing > 0 ? counts.tokens / lexing : 0;
+    auto nodesPerSecond = parsing > 0 ? counts.nodes / parsing : 0;
+    auto memory = peakMemory();
+
+    if (json) {
+        auto& s = std::cout;
+        s << std::setprecision(9);
+        s << "{\n";
+        s << "  \"program\": {";
+
+        if (inputPath.empty()) {
+            s << "\"classes\": " << options.classes << ", \"depth\": " << options.depth
+              << ", \"functions\": " << options.functions << ", \"statements\": " << options.statements
+              << ", \"nesting\": " << options.nesting << ", \"seed\": " << options.seed << ", ";
+        } else {
+            s << "\"input\": " << quote(inputPath) << ", ";
+        }
+
+        s << "\"bytes\": " << counts.bytes << ", \"lines\": " << counts.lines << ", \"tokens\": " << counts.tokens
+          << ", \"nodes\": " << counts.nodes << ", \"instructions\": " << counts.instructions << "},\n";
+        s << "  \"repeat\": " << repeat << ",\n";
+        s << "  \"phases\": {\n";
+
+        for (std::size_t k = 0; k < best.size(); ++k) {
+            s << "    " << quote(best[k].name) << ": " << best[k].seconds << (k + 1 < best.size() ? ",\n" : "\n");
+        }
+
+        s << "  },\n";
+        s << "  \"total_seconds\": " << total << ",\n";
+        s << "  \"tokens_per_second\": " << tokensPerSecond << ",\n";
+        s << "  \"nodes_per_second\": " << nodesPerSecond << ",\n";
+        s << "  \"peak_rss_kib\": " << memory << "\n";
+        s << "}" << std::endl;
+        return 0;
+    }
+
+    auto& s = std::cout;
+    s << counts.bytes << " bytes, " << counts.lines << " lines, " << counts.tokens << " tokens, " << counts.nodes
+      << " nodes, " << counts.instructions << " instructions; fastest of " << repeat << " runs" << std::endl;
+    s << std::endl;
+    s << std::fixed << std::setprecision(3);
+
+    for (const auto& phase : best) {
+        s << std::left << std::setw(24) << phase.name << std::right << std::setw(12) << phase.seconds * 1000 << " ms"
+          << std::setw(8) << std::setprecision(1) << (total > 0 ? 100 * phase.seconds / total : 0) << " %"
+          << std::setprecision(3) << std::endl;
+    }
+
+    s << std::left << std::setw(24) << "total" << std::right << std::setw(12) << total * 1000 << " ms" << std::endl;
+    s << std::endl;
+    s << std::setprecision(0);
+    s << "tokens/s: " << tokensPerSecond << std::endl;
+    s << "nodes/s:  " << nodesPerSecond << std::endl;
+    s << "peak RSS: " << memory << " KiB" << std::endl;
+
+    return 0;
+}
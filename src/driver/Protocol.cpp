@@ -0,0 +1,172 @@
+#include "Protocol.h"
+
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+// <name> <size>
+void parseHeader(const std::string& header, std::string& name, std::size_t& size)
+{
+    std::istringstream ss(header);
+
+    if (!(ss >> name >> size)) {
+        throw std::logic_error("Protocol::parseHeader: Malformed section header \"" + header + "\"");
+    }
+}
+
+void readContent(std::istream& input, const std::string& name, std::size_t size, std::string& content)
+{
+    content.resize(size);
+
+    if (size > 0 && !input.read(&content[0], size)) {
+        throw std::logic_error("Protocol::readContent: Section " + name + " ended early");
+    }
+}
+
+// <name> <size>, then size bytes of content
+bool readSection(std::istream& input, std::string& name, std::string& content)
+{
+    std::string header;
+    std::size_t size = 0;
+
+    if (!std::getline(input, header)) {
+        return false;
+    }
+
+    parseHeader(header, name, size);
+    readContent(input, name, size, content);
+    return true;
+}
+
+void writeSection(std::ostream& output, const std::string& name, const std::string& content)
+{
+    output << name << ' ' << content.size() << '\n' << content;
+}
+
+}
+
+void Request::write(std::ostream& output) const
+{
+    if (command != "compile") {
+        output << command << '\n' << std::flush;
+        return;
+    }
+
+    output << command << ' ' << arguments.size() << '\n';
+
+    for (const auto& a : arguments) {
+        output << a << '\n';
+    }
+
+    if (!path.empty()) {
+        output << "file " << path << '\n';
+    } else {
+        writeSection(output, "source", source);
+    }
+
+    output << std::flush;
+}
+
+bool Request::read(std::istream& input)
+{
+    std::string header;
+
+    // blank lines between requests are allowed, for typing them by hand
+    while (header.empty()) {
+        if (!std::getline(input, header)) {
+            return false;
+        }
+    }
+
+    std::istringstream ss(header);
+    std::size_t count = 0;
+    ss >> command;
+    arguments.clear();
+    path.clear();
+    source.clear();
+
+    if (command == "quit" || command == "shutdown") {
+        return true;
+    }
+
+    if (command != "compile" || !(ss >> count)) {
+        throw std::logic_error("Request::read: Malformed request \"" + header + "\"");
+    }
+
+    arguments.resize(count);
+
+    for (auto& a : arguments) {
+        if (!std::getline(input, a)) {
+            throw std::logic_error("Request::read: Request ended early");
+        }
+    }
+
+    if (!std::getline(input, header)) {
+        throw std::logic_error("Request::read: Request ended early");
+    }
+
+    if (header.compare(0, 5, "file ") == 0) {
+        path = header.substr(5);
+        return true;
+    }
+
+    std::string name;
+    std::size_t size = 0;
+    parseHeader(header, name, size);
+
+    if (name != "source") {
+        throw std::logic_error("Request::read: Malformed request \"" + header + "\"");
+    }
+
+    readContent(input, name, size, source);
+    return true;
+}
+
+const std::string* Response::section(const std::string& name) const
+{
+    for (const auto& s : sections) {
+        if (s.first == name) {
+            return &s.second;
+        }
+    }
+
+    return nullptr;
+}
+
+void Response::write(std::ostream& output) const
+{
+    output << status << ' ' << sections.size() << '\n';
+
+    for (const auto& s : sections) {
+        writeSection(output, s.first, s.second);
+    }
+
+    output << std::flush;
+}
+
+bool Response::read(std::istream& input)
+{
+    std::string header;
+
+    if (!std::getline(input, header)) {
+        return false;
+    }
+
+    std::istringstream ss(header);
+    std::size_t count = 0;
+
+    if (!(ss >> status >> count)) {
+        throw std::logic_error("Response::read: Malformed response \"" + header + "\"");
+    }
+
+    sections.resize(count);
+
+    for (auto& s : sections) {
+        if (!readSection(input, s.first, s.second)) {
+            throw std::logic_error("Response::read: Response ended early");
+        }
+    }
+
+    return true;
+}
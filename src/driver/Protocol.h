@@ -0,0 +1,53 @@
+#pragma once
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * What clients and the compilation server say to each other, one request and its response after the other:
+ *
+ *   compile <argument count>          the options, one per line, as CommandLine::parse takes them
+ *   <argument>...
+ *   file <path>                       compile the file at the path on the server
+ *   source <size>                     or compile the source that follows
+ *   <source>
+ *
+ *   <status> <section count>          ok, errors, failed (no AST) or invalid (the request)
+ *   <name> <size>                     output (the program), an artifact by option name, diagnostics or stats
+ *   <content>...
+ *
+ * A client ends its session with quit, and stops the server with shutdown.
+ */
+
+// a compile request, or a quit or shutdown command
+struct Request
+{
+    std::string command = "compile";
+    std::vector<std::string> arguments;
+
+    // the file to compile on the server, or the source to compile when there is no path
+    std::string path;
+    std::string source;
+
+    void write(std::ostream& output) const;
+
+    // false at the end of the input
+    bool read(std::istream& input);
+};
+
+struct Response
+{
+    std::string status;
+    std::vector<std::pair<std::string, std::string>> sections;
+
+    // nullptr when there is no such section
+    const std::string* section(const std::string& name) const;
+
+    void write(std::ostream& output) const;
+
+    // false at the end of the input
+    bool read(std::istream& input);
+};
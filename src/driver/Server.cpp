@@ -0,0 +1,168 @@
+#include "Server.h"
+
+#include "Socket.h"
+
+#include <moonshine/CommandLine.h>
+#include <moonshine/Statistics.h>
+
+#include <csignal>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace moonshine;
+
+namespace {
+
+Response invalid(const std::string& message)
+{
+    Response response;
+    response.status = "invalid";
+    response.sections.emplace_back("diagnostics", message + "\n");
+    return response;
+}
+
+}
+
+Server::Server(Compiler& compiler, Cache* objectCache)
+    : compiler_(compiler), objectCache_(objectCache)
+{}
+
+bool Server::serve(std::istream& input, std::ostream& output)
+{
+    Request request;
+
+    while (true) {
+        try {
+            if (!request.read(input) || request.command == "quit") {
+                return true;
+            } else if (request.command == "shutdown") {
+                return false;
+            }
+        } catch (const std::logic_error& e) {
+            // the rest of the input can't be told apart from the request anymore
+            invalid(e.what()).write(output);
+            return true;
+        }
+
+        compile(request).write(output);
+
+        if (!output) {
+            return true;
+        }
+    }
+}
+
+bool Server::listen(const std::string& path)
+{
+    int s = SocketStream::listen(path);
+
+    if (s < 0) {
+        return false;
+    }
+
+    // a client going away halfway through its response ends its session, not the server
+    std::signal(SIGPIPE, SIG_IGN);
+
+    for (bool running = true; running; ) {
+        int connection = ::accept(s, nullptr, nullptr);
+
+        if (connection < 0) {
+            continue;
+        }
+
+        SocketStream stream(connection);
+        running = serve(stream, stream);
+    }
+
+    ::close(s);
+    ::unlink(path.c_str());
+    return true;
+}
+
+Response Server::compile(const Request& request)
+{
+    CommandLine commandLine;
+
+    if (!commandLine.parse(request.arguments)) {
+        return invalid("invalid option " + commandLine.error);
+    }
+
+    // the outputs go back to the client, which has its own paths for them
+    if (commandLine.run || commandLine.serve || !commandLine.connect.empty() || !commandLine.input.empty()) {
+        return invalid("only compilation options can be given to the server");
+    }
+
+    commandLine.options.objectCache = objectCache_;
+
+    std::ifstream file;
+    std::istringstream source(request.source);
+
+    if (!request.path.empty()) {
+        file.open(request.path);
+
+        if (!file) {
+            return invalid("cannot open " + request.path);
+        }
+    }
+
+    // artifacts by option name
+    std::map<std::string, std::ostringstream> artifacts;
+    auto output = [&](const CommandLine::Artifact& artifact) -> std::ostream* {
+        return artifact.enabled ? &artifacts[artifact.option] : nullptr;
+    };
+
+    commandLine.program.enable("");
+
+    Compiler::Outputs outputs;
+    outputs.program = output(commandLine.program);
+    outputs.tokens = output(commandLine.tokens);
+    outputs.derivation = output(commandLine.derivation);
+    outputs.ast = output(commandLine.ast);
+    outputs.table = output(commandLine.table);
+    outputs.ir = output(commandLine.ir);
+    outputs.peephole = output(commandLine.peephole);
+    outputs.native = output(commandLine.native);
+
+    std::unique_ptr<Statistics> stats(commandLine.stats ? new Statistics() : nullptr);
+    Response response;
+
+    try {
+        auto result = compiler_.compile(request.path.empty() ? static_cast<std::istream&>(source) : file,
+                                        commandLine.options, outputs, stats.get());
+        response.status = result.generated ? "ok" : result.parsed ? "errors" : "failed";
+
+        std::ostringstream diagnostics;
+
+        for (const auto& e : result.diagnostics) {
+            diagnostics << e.message << std::endl;
+        }
+
+        response.sections.emplace_back("diagnostics", diagnostics.str());
+    } catch (const std::exception& e) {
+        return invalid(e.what());
+    }
+
+    for (const auto& a : artifacts) {
+        response.sections.emplace_back(a.first, a.second.str());
+    }
+
+    if (stats) {
+        std::ostringstream ss;
+
+        if (commandLine.statsJson) {
+            stats->printJson(ss);
+        } else {
+            stats->print(ss);
+        }
+
+        response.sections.emplace_back("stats", ss.str());
+    }
+
+    return response;
+}
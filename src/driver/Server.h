@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Protocol.h"
+
+#include <moonshine/Compiler.h>
+
+#include <istream>
+#include <ostream>
+#include <string>
+
+/**
+ * Compiles programs for clients with one compiler, so that the lexer tables and the grammar are built once
+ * for every program instead of once per program. Requests are answered one after the other.
+ */
+class Server
+{
+public:
+    // functions are generated through the object cache, when given
+    explicit Server(moonshine::Compiler& compiler, moonshine::Cache* objectCache = nullptr);
+
+    // answers the requests on input until it ends or quit; false when a client asked for shutdown
+    bool serve(std::istream& input, std::ostream& output);
+
+    // serves the connections to a Unix socket at the path one after the other until shutdown, false when the
+    // socket can't be made
+    bool listen(const std::string& path);
+
+    Response compile(const Request& request);
+private:
+    moonshine::Compiler& compiler_;
+    moonshine::Cache* objectCache_;
+};
@@ -0,0 +1,135 @@
+#include "Socket.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// false when the path doesn't fit in a socket address
+bool address(const std::string& path, sockaddr_un& addr)
+{
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+
+    std::strcpy(addr.sun_path, path.c_str());
+    return true;
+}
+
+}
+
+SocketStream::SocketStream(int socket)
+    : std::iostream(&buffer_), buffer_(socket)
+{}
+
+SocketStream::~SocketStream()
+{
+    buffer_.pubsync();
+}
+
+int SocketStream::connect(const std::string& path)
+{
+    sockaddr_un addr;
+
+    if (!address(path, addr)) {
+        return -1;
+    }
+
+    int s = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (s >= 0 && ::connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        ::close(s);
+        return -1;
+    }
+
+    return s;
+}
+
+int SocketStream::listen(const std::string& path)
+{
+    sockaddr_un addr;
+
+    if (!address(path, addr)) {
+        return -1;
+    }
+
+    int s = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(path.c_str());
+
+    if (s >= 0 && (::bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(s, 16) < 0)) {
+        ::close(s);
+        return -1;
+    }
+
+    return s;
+}
+
+SocketStream::Buffer::Buffer(int socket)
+    : socket_(socket)
+{
+    setg(input_, input_, input_);
+    setp(output_, output_ + sizeof(output_));
+}
+
+SocketStream::Buffer::~Buffer()
+{
+    ::close(socket_);
+}
+
+int SocketStream::Buffer::underflow()
+{
+    ssize_t n;
+
+    do {
+        n = ::read(socket_, input_, sizeof(input_));
+    } while (n < 0 && errno == EINTR);
+
+    if (n <= 0) {
+        return traits_type::eof();
+    }
+
+    setg(input_, input_, input_ + n);
+    return traits_type::to_int_type(input_[0]);
+}
+
+int SocketStream::Buffer::overflow(int c)
+{
+    if (sync() < 0) {
+        return traits_type::eof();
+    }
+
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+
+    return traits_type::not_eof(c);
+}
+
+int SocketStream::Buffer::sync()
+{
+    const char* p = pbase();
+
+    while (p < pptr()) {
+        ssize_t n = ::write(socket_, p, pptr() - p);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            return -1;
+        }
+
+        p += n;
+    }
+
+    setp(output_, output_ + sizeof(output_));
+    return 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+/**
+ * A stream over a connected Unix socket, which it closes when destroyed.
+ */
+class SocketStream : public std::iostream
+{
+public:
+    explicit SocketStream(int socket);
+    ~SocketStream();
+
+    // -1 when there is no server at the path, with errno set
+    static int connect(const std::string& path);
+
+    // a socket listening at the path, replacing whatever is there, or -1 with errno set
+    static int listen(const std::string& path);
+private:
+    class Buffer : public std::streambuf
+    {
+    public:
+        explicit Buffer(int socket);
+        ~Buffer();
+    protected:
+        int underflow() override;
+        int overflow(int c) override;
+        int sync() override;
+    private:
+        int socket_;
+        char input_[4096];
+        char output_[4096];
+    };
+
+    Buffer buffer_;
+};
@@ -1,30 +1,275 @@
-#include <moonshine/lexer/Lexer.h>
-#include <moonshine/lexer/Token.h>
-#include <moonshine/lexer/TokenType.h>
-#include <moonshine/syntax/Grammar.h>
-#include <moonshine/syntax/Parser.h>
-#include <moonshine/semantic/SemanticError.h>
-#include <moonshine/semantic/InheritanceResolverVisitor.h>
-#include <moonshine/semantic/SymbolTableCreatorVisitor.h>
-#include <moonshine/semantic/SymbolTableClassDeclLinkerVisitor.h>
-#include <moonshine/semantic/SymbolTableLinkerVisitor.h>
-#include <moonshine/semantic/ShadowedSymbolCheckerVisitor.h>
-#include <moonshine/semantic/TypeCheckerVisitor.h>
-#include <moonshine/code/MemorySizeComputerVisitor.h>
-#include <moonshine/code/StackCodeGeneratorVisitor.h>
+#include "Protocol.h"
+#include "Server.h"
+#include "Socket.h"
+
+#include <moonshine/Cache.h>
+#include <moonshine/CommandLine.h>
+#include <moonshine/Compiler.h>
+#include <moonshine/Statistics.h>
+#include <moonshine/vm/Assembler.h>
+#include <moonshine/vm/Machine.h>
 
 #include <iostream>
-#include <algorithm>
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <cerrno>
+#include <cstdlib>
+#include <cstdint>
 #include <cstring>
+#include <map>
 #include <memory>
+#include <new>
+#include <stdexcept>
 #include <vector>
-#include <istream>
+
+#include <sys/stat.h>
 
 using namespace moonshine;
 
+// counts allocations for the statistics, which costs a relaxed atomic load per allocation without them; main()
+// tells the statistics so with Statistics::countAllocations()
+void* operator new(std::size_t size)
+{
+    Statistics::allocation(size);
+
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+const char* const USAGE = R"(usage: driver [options] program.txt
+       driver --server[=SOCKET]
+
+Compiles a program to Moon assembly, written to program.m. Files named - are stdin and stdout.
+
+output:
+  -o FILE, --output=FILE  write the Moon program to FILE
+  --tokens[=FILE]         write the tokens (tokens.txt)
+  --derivation[=FILE]     write the derivation of the parse (derivation.txt), which is slow
+  --ast[=FILE]            write the AST as graphviz (ast.dot), which is slow
+  --table[=FILE]          write the symbol tables (table.txt)
+  --ir[=FILE]             write the three-address code (program.ir)
+  --peephole[=FILE]       write what the peephole optimizer changed (peephole.txt)
+  --native[=FILE]         write x86-64 assembly (program.s): cc program.s moon_runtime.c -o program
+  --all                   write every output to its file
+
+compilation:
+  --threads[=N]           check function bodies on a pool of N threads, or one per core
+  --stack-code            generate code straight from the AST, without the IR
+  -O0                     keep the IR as built
+  --inline=N              inline calls to functions of up to N instructions, 0 disables (16)
+  --no-register-calls     pass everything in the stack frame, like the Moon util library does
+  --peephole-window=N     look N instructions ahead in the peephole optimizer, 0 disables (8)
+
+  --run                   run the program on the Moon VM instead of writing it, unless -o is given
+  --stats                 print the time and allocations of every phase and what they made to stderr
+  --stats-json            the same as JSON
+  --cache[=DIR]           reuse the outputs of compiling the same source with the same options, kept in DIR
+                          (.moonshine-cache)
+  --object-cache[=DIR]    reuse the code of the functions whose IR is the same as in an earlier compile, kept in
+                          DIR (.moonshine-objects)
+  --cache-size=MB         keep up to MB megabytes in each cache, the least recently used go first (64)
+  -h, --help              print this
+
+server:
+  --server[=SOCKET]       compile the requests on stdin, or on a Unix socket, with the tables built once
+  --connect=SOCKET        compile on the server at SOCKET, writing its outputs here
+)";
+
+// nullptr when the artifact is disabled or its file can't be written
+std::ostream* open(const CommandLine::Artifact& artifact, std::ofstream& file)
+{
+    if (!artifact.enabled) {
+        return nullptr;
+    }
+
+    if (artifact.path == "-") {
+        return &std::cout;
+    }
+
+    file.open(artifact.path, std::ios::trunc);
+
+    if (!file) {
+        std::cerr << "cannot write " << artifact.path << std::endl;
+        return nullptr;
+    }
+
+    return &file;
+}
+
+// whether the artifact went to a file of its own, rather than stdout or a device like /dev/null
+bool savedToFile(const CommandLine::Artifact& artifact)
+{
+    struct stat st;
+    return artifact.enabled && artifact.path != "-" && ::stat(artifact.path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+bool readInput(const std::string& path, std::string& source)
+{
+    std::ifstream file;
+
+    if (path != "-") {
+        file.open(path);
+
+        if (!file) {
+            std::cerr << "cannot open " << path << std::endl;
+            return false;
+        }
+    }
+
+    std::ostringstream ss;
+    ss << (path == "-" ? std::cin.rdbuf() : file.rdbuf());
+    source = ss.str();
+    return true;
+}
+
+// the build of the running driver, which the outputs it caches depend on as well
+std::string build(const char* driver)
+{
+    struct stat st;
+
+    if (::stat("/proc/self/exe", &st) != 0 && ::stat(driver, &st) != 0) {
+        return "";
+    }
+
+    return "driver " + std::to_string(st.st_size) + " " + std::to_string(st.st_mtime) + "\n";
+}
+
+// everything else the outputs of compiling the source depend on, in full
+std::string cacheKey(const CommandLine& commandLine, const std::string& source)
+{
+    std::ostringstream key;
+    auto add = [&key](const std::string& name, const std::string& content) {
+        key << name << ' ' << content.size() << '\n' << content;
+    };
+
+    for (const auto& arg : commandLine.requestArguments()) {
+        if (arg.compare(0, 7, "--stats") != 0) {
+            add("option", arg);
+        }
+    }
+
+    for (const auto& resource : Compiler::resources()) {
+        std::ifstream file(resource, std::ios::binary);
+        std::ostringstream content;
+        content << file.rdbuf();
+        add(resource, content.str());
+    }
+
+    add("source", source);
+    return key.str();
+}
+
+// the status, diagnostics and artifacts of a compile, by option name, for the cache
+Cache::Entry compileEntry(Compiler& compiler, const CommandLine& commandLine, const std::string& source,
+                          Statistics* stats)
+{
+    Cache::Entry entry;
+    std::map<std::string, std::ostringstream> artifacts;
+    auto output = [&](const CommandLine::Artifact& artifact) -> std::ostream* {
+        return artifact.enabled ? &artifacts[artifact.option] : nullptr;
+    };
+
+    // the program is kept even when it isn't written, for run mode to find it on a hit
+    Compiler::Outputs outputs;
+    outputs.program = &artifacts[commandLine.program.option];
+    outputs.tokens = output(commandLine.tokens);
+    outputs.derivation = output(commandLine.derivation);
+    outputs.ast = output(commandLine.ast);
+    outputs.table = output(commandLine.table);
+    outputs.ir = output(commandLine.ir);
+    outputs.peephole = output(commandLine.peephole);
+    outputs.native = output(commandLine.native);
+
+    std::istringstream input(source);
+    auto result = compiler.compile(input, commandLine.options, outputs, stats);
+
+    for (const auto& a : artifacts) {
+        entry[a.first] = a.second.str();
+    }
+
+    entry["status"] = result.generated ? "ok" : result.parsed ? "errors" : "failed";
+    entry["diagnostics"] = Cache::writeDiagnostics(result.diagnostics);
+    return entry;
+}
+
+// sends the source to the server and writes what comes back where the command line says
+int compileOnServer(CommandLine& commandLine, std::ostream& messageOutput)
+{
+    Request request;
+    request.arguments = commandLine.requestArguments();
+
+    if (!readInput(commandLine.input, request.source)) {
+        return 2;
+    }
+
+    int socket = SocketStream::connect(commandLine.connect);
+
+    if (socket < 0) {
+        std::cerr << "cannot connect to " << commandLine.connect << ": " << std::strerror(errno) << std::endl;
+        return 2;
+    }
+
+    SocketStream stream(socket);
+    Response response;
+    request.write(stream);
+
+    try {
+        if (!response.read(stream)) {
+            std::cerr << "no response from " << commandLine.connect << std::endl;
+            return 2;
+        }
+    } catch (const std::logic_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+
+    Request quit;
+    quit.command = "quit";
+    quit.write(stream);
+
+    auto artifacts = commandLine.artifacts();
+    artifacts.push_back(&commandLine.program);
+
+    for (auto a : artifacts) {
+        auto content = response.section(a->option);
+        std::ofstream file;
+        std::ostream* output = content ? open(*a, file) : nullptr;
+
+        if (output) {
+            *output << *content << std::flush;
+        }
+    }
+
+    if (response.status == "ok" && savedToFile(commandLine.program)) {
+        messageOutput << "Code saved to " << commandLine.program.path << "." << std::endl;
+    } else if (response.status == "errors") {
+        messageOutput << "Code generation was surpressed because errors were found." << std::endl;
+    }
+
+    if (auto diagnostics = response.section("diagnostics")) {
+        std::cerr << *diagnostics;
+    }
+
+    if (auto stats = response.section("stats")) {
+        std::cerr << *stats;
+    }
+
+    return response.status == "invalid" ? 2 : response.status == "failed";
+}
+
+}
+
 int main(int argc, const char** argv)
 {
 
@@ -32,135 +277,205 @@ int main(int argc, const char** argv)
      * CONFIGURATION
      */
 
-    // input
+    Statistics::countAllocations();
 
-    std::ifstream inputStream(argv[1]); // use sample file for lexing
-    //std::istringstream inputStream("program { int a; float b; };"); // use string for lexing
-    //std::istream& inputStream = std::cin; // use cin for lexing
+    CommandLine commandLine;
 
-    // derivation output (A2)
+    if (!commandLine.parse(std::vector<std::string>(argv + 1, argv + argc))) {
+        std::cerr << "driver: invalid option " << commandLine.error << std::endl << std::endl << USAGE;
+        return 2;
+    }
 
-    std::ofstream tokenOutput("tokens.txt", std::ios::trunc); // use file
-    //std::ofstream tokenOutput = &std::cout; // use stdout
-    //std::ofstream tokenOutput; // disable output
+    if (commandLine.help) {
+        std::cout << USAGE;
+        return 0;
+    }
 
+    // function code reused from earlier compiles
+    std::unique_ptr<Cache> objects;
 
-    std::ofstream derivationOutput("derivation.txt", std::ios::trunc); // use file
-    //std::ofstream derivationOutput = &std::cout; // use stdout
-    //std::ofstream derivationOutput; // disable output
+    if (!commandLine.objectCache.empty()) {
+        objects.reset(new Cache(commandLine.objectCache, static_cast<std::uint64_t>(commandLine.cacheSize) << 20,
+                                build(argv[0])));
+        commandLine.options.objectCache = objects.get();
+    }
 
-    // AST graphviz output
+    // the tables are built once, then every request is compiled with them
+    if (commandLine.serve) {
+        Compiler compiler;
+        Server server(compiler, objects.get());
 
-    std::ofstream astOutput("ast.dot", std::ios::trunc); // use file
-    //std::ofstream astOutput; // disable output
+        if (commandLine.socket.empty()) {
+            server.serve(std::cin, std::cout);
+        } else if (!server.listen(commandLine.socket)) {
+            std::cerr << "cannot listen on " << commandLine.socket << ": " << std::strerror(errno) << std::endl;
+            return 2;
+        }
 
-    // symbol table output
+        return 0;
+    }
 
-    std::ofstream tableOutput("table.txt", std::ios::trunc); // use file
-    //std::ostream& tableOutput = std::cout; // use stdout
-    //std::ofstream tableOutput; // disable output
+    if (commandLine.input.empty() || (commandLine.run && !commandLine.connect.empty())) {
+        std::cerr << USAGE;
+        return 2;
+    }
 
     // semantic error output
+    std::ostream& errorOutput = std::cerr;
+
+    // compile and run on the Moon VM in this process, with console i/o on stdin and stdout
+    bool run = commandLine.run;
 
-    //std::ofstream& errorOutput = tableOutput; // use file
-    //std::ostream& errorOutput = std::cout; // use stdout
-    std::ostream& errorOutput = std::cerr; // use stderr
-    //std::ofstream errorOutput; // disable output
+    // time and allocations of every phase, and counts of what they made, printed to stderr when done
+    std::unique_ptr<Statistics> stats(commandLine.stats ? new Statistics() : nullptr);
 
-    // program output
+    // the program is always written, except when it is run
+    if (!run) {
+        commandLine.program.enable("");
+    }
+
+    // whether code was saved, on stderr when stdout has the program or its output
+    std::ostream& messageOutput = run || commandLine.program.path == "-" ? std::cerr : std::cout;
+
+    if (!commandLine.connect.empty()) {
+        return compileOnServer(commandLine, messageOutput);
+    }
+
+    std::ifstream inputFile;
+
+    if (commandLine.input != "-") {
+        inputFile.open(commandLine.input);
+
+        if (!inputFile) {
+            std::cerr << "cannot open " << commandLine.input << std::endl;
+            return 2;
+        }
+    }
 
-    std::ofstream programOutput("program.m", std::ios::trunc); // use file
-    //std::ostream& programOutput = std::cout;  // use stdout
-    //std::ofstream programOutput; // disable output
+    std::istream& inputStream = commandLine.input == "-" ? std::cin : inputFile;
+
+    // run mode writes the program once it is whole, since the stack code generator streams its data
+    std::ofstream files[8];
+    Compiler::Outputs outputs;
+    auto programOutput = open(commandLine.program, files[0]);
+    outputs.program = run ? nullptr : programOutput;
+    outputs.tokens = open(commandLine.tokens, files[1]);
+    outputs.derivation = open(commandLine.derivation, files[2]);
+    outputs.ast = open(commandLine.ast, files[3]);
+    outputs.table = open(commandLine.table, files[4]);
+    outputs.ir = open(commandLine.ir, files[5]);
+    outputs.peephole = open(commandLine.peephole, files[6]);
+    outputs.native = open(commandLine.native, files[7]);
 
     /*
      * DRIVER
      */
 
-    std::vector<Error> errors;
+    Compiler::Result result;
+
+    if (commandLine.cache.empty()) {
+        Compiler compiler(stats.get());
+        result = compiler.compile(inputStream, commandLine.options, outputs, stats.get());
+    } else {
+        Cache cache(commandLine.cache, static_cast<std::uint64_t>(commandLine.cacheSize) << 20, build(argv[0]));
+        std::ostringstream source;
+        source << inputStream.rdbuf();
+
+        auto key = cacheKey(commandLine, source.str());
+        Cache::Entry entry;
+        bool hit;
+        {
+            Statistics::Phase phase(stats.get(), "cache lookup");
+            hit = cache.load(key, entry);
+        }
 
-    Lexer lex;
-    syntax::Grammar grammar("grammar.txt", "table.json", "first.txt", "follow.txt");
-    syntax::Parser parser(grammar);
-    //parser.setAnsi(false); // set to true for color output
+        // the tables are only built on a miss
+        if (!hit) {
+            Compiler compiler(stats.get());
+            entry = compileEntry(compiler, commandLine, source.str(), stats.get());
 
-    lex.startLexing(&inputStream, &tokenOutput);
+            Statistics::Phase phase(stats.get(), "cache store");
+            cache.store(key, entry);
+        }
 
-    std::unique_ptr<ast::Node> astRoot;
-    astRoot = parser.parse(&lex, &derivationOutput); // disable output
+        if (stats) {
+            stats->count("cache hits", hit);
+        }
 
-    // output lexer errors
-    for (const auto& e : lex.getErrors()) {
-        std::ostringstream ss;
-        e.print(ss);
-        errors.emplace_back(e.position, ss.str());
-    }
+        const auto& status = entry["status"];
+        result.parsed = status != "failed";
+        result.generated = status == "ok";
 
-    // output parser errors
-    for (const auto& e : parser.getErrors()) {
-        std::ostringstream ss;
-        e.print(ss);
-        errors.emplace_back(e.token ? e.token->position : 0, ss.str());
-    }
+        result.diagnostics = Cache::readDiagnostics(entry["diagnostics"]);
 
-    if (astRoot) {
-        std::vector<semantic::SemanticError> semanticErrors;
-        std::vector<std::unique_ptr<Visitor>> visitors;
-        visitors.emplace_back(new semantic::SymbolTableCreatorVisitor());
-        visitors.emplace_back(new semantic::SymbolTableClassDeclLinkerVisitor());
-        visitors.emplace_back(new semantic::SymbolTableLinkerVisitor());
-        visitors.emplace_back(new semantic::InheritanceResolverVisitor());
-        visitors.emplace_back(new semantic::ShadowedSymbolCheckerVisitor());
-        visitors.emplace_back(new semantic::TypeCheckerVisitor());
+        auto artifacts = commandLine.artifacts();
+        std::ostream* artifactOutputs[] = {outputs.tokens, outputs.derivation, outputs.ast, outputs.table,
+                                           outputs.ir, outputs.peephole, outputs.native};
 
-        // run semantic check visitors
-        for (auto& v : visitors) {
-            v->setErrorContainer(&semanticErrors);
-            astRoot->accept(v.get());
+        for (std::size_t i = 0; i < artifacts.size(); ++i) {
+            if (artifactOutputs[i]) {
+                *artifactOutputs[i] << entry[artifacts[i]->option];
+            }
         }
 
-        visitors.clear();
+        const auto& program = entry[commandLine.program.option];
 
-        std::ostringstream dataStream;
+        if (outputs.program) {
+            *outputs.program << program;
+        }
 
-        if (errors.empty() && std::find_if(semanticErrors.begin(), semanticErrors.end(),
-                         [](const semantic::SemanticError& e) { return e.level == semantic::SemanticErrorLevel::ERROR; }) == semanticErrors.end()) {
-            visitors.emplace_back(new code::MemorySizeComputerVisitor());
-            visitors.emplace_back(new code::StackCodeGeneratorVisitor(dataStream, programOutput));
-            std::cout << "Code saved to program.m." << std::endl;
-        } else {
-            std::cout << "Code generation was surpressed because errors were found." << std::endl;
+        if (run && result.generated) {
+            std::istringstream text(program);
+            result.code = code::MoonCode::parse(text);
         }
+    }
+
+    const auto& moonCode = result.code;
+
+    if (result.generated && programOutput && savedToFile(commandLine.program)) {
+        messageOutput << "Code saved to " << commandLine.program.path << "." << std::endl;
+    } else if (result.parsed && !result.generated) {
+        messageOutput << "Code generation was surpressed because errors were found." << std::endl;
+    }
+
+    for (const auto& e : result.diagnostics) {
+        errorOutput << e.message << std::endl;
+    }
 
-        // run code generation visitors
-        for (auto& v : visitors) {
-            v->setErrorContainer(&semanticErrors);
-            astRoot->accept(v.get());
+    int status = !result.parsed;
+
+    if (run && !result.generated) {
+        status = 1;
+    } else if (run) {
+        if (programOutput) {
+            moonCode.printText(*programOutput);
+            *programOutput << std::endl;
+            moonCode.printData(*programOutput);
         }
 
-        programOutput << std::endl << dataStream.str();
+        Statistics::Phase phase(stats.get(), "running");
 
-        // print symbol tables
-        astRoot->symbolTable()->print(tableOutput, "");
+        // the assembled instructions are decoded once more into the machine's own compact form
+        vm::Machine machine(vm::Assembler().assemble(moonCode), std::cin, std::cout);
 
-        // output semantic errors
-        for (const auto& e : semanticErrors) {
-            std::ostringstream ss;
-            e.print(ss);
-            errors.emplace_back(e.token ? e.token->position : 0, ss.str());
+        try {
+            machine.run();
+        } catch (const vm::RuntimeError& e) {
+            std::cout << std::flush;
+            errorOutput << commandLine.input << ": " << e.what() << std::endl;
+            status = 1;
         }
 
-        // print the AST tree graphviz output
-        astRoot->graphviz(astOutput);
+        std::cout << std::flush;
     }
 
-    std::sort(errors.begin(), errors.end(), [](const Error& a, const Error& b) {
-        return a.position < b.position;
-    });
-
-    for (const auto& e : errors) {
-        errorOutput << e.message << std::endl;
+    if (stats) {
+        if (commandLine.statsJson) {
+            stats->printJson(std::cerr);
+        } else {
+            stats->print(std::cerr);
+        }
     }
 
-    return astRoot == nullptr;
+    return status;
 }
@@ -0,0 +1,217 @@
+#include "moonshine/Cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+namespace moonshine {
+
+namespace {
+
+// the name of the key section, which can't be an artifact
+const char* const KEY = "";
+
+// nanoseconds since the epoch, for ordering entries by use
+std::uint64_t modified(const struct stat& st)
+{
+#ifdef __APPLE__
+    const auto& t = st.st_mtimespec;
+#else
+    const auto& t = st.st_mtim;
+#endif
+    return static_cast<std::uint64_t>(t.tv_sec) * 1000000000 + t.tv_nsec;
+}
+
+void writeSection(std::ostream& output, const std::string& name, const std::string& content)
+{
+    output << name.size() << ' ' << content.size() << '\n' << name << content;
+}
+
+// <name size> <content size>, then the name and the content
+bool readSection(std::istream& input, std::string& name, std::string& content)
+{
+    std::size_t nameSize = 0;
+    std::size_t contentSize = 0;
+
+    if (!(input >> nameSize >> contentSize) || input.get() != '\n') {
+        return false;
+    }
+
+    name.resize(nameSize);
+    content.resize(contentSize);
+
+    return (nameSize == 0 || input.read(&name[0], nameSize))
+        && (contentSize == 0 || input.read(&content[0], contentSize));
+}
+
+}
+
+Cache::Cache(const std::string& directory, std::uint64_t capacity, const std::string& salt)
+    : directory_(directory), capacity_(capacity), salt_(salt)
+{
+    ::mkdir(directory_.c_str(), 0777);
+}
+
+Cache::~Cache()
+{
+    if (written_ > 0) {
+        evict();
+    }
+}
+
+bool Cache::load(const std::string& key, Entry& entry)
+{
+    auto file = path(key);
+    std::ifstream input(file, std::ios::binary);
+    std::string name, content;
+
+    // a different key with the same hash is a miss
+    if (!input || !readSection(input, name, content) || name != KEY || content != salt_ + key) {
+        return false;
+    }
+
+    entry.clear();
+
+    while (readSection(input, name, content)) {
+        entry[name] = content;
+    }
+
+    if (!input.eof()) {
+        return false;
+    }
+
+    // now
+    ::utime(file.c_str(), nullptr);
+    return true;
+}
+
+bool Cache::store(const std::string& key, const Entry& entry)
+{
+    auto file = path(key);
+    auto temporary = file + "." + std::to_string(::getpid());
+
+    {
+        std::ofstream output(temporary, std::ios::binary | std::ios::trunc);
+        writeSection(output, KEY, salt_ + key);
+
+        for (const auto& artifact : entry) {
+            writeSection(output, artifact.first, artifact.second);
+        }
+
+        if (!output.flush()) {
+            std::remove(temporary.c_str());
+            return false;
+        }
+
+        written_ += output.tellp();
+    }
+
+    if (std::rename(temporary.c_str(), file.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    if (written_ > capacity_ / 16) {
+        evict();
+    }
+
+    return true;
+}
+
+std::string Cache::hash(const std::string& text)
+{
+    std::uint64_t h = 14695981039346656037ull;
+
+    for (unsigned char c : text) {
+        h = (h ^ c) * 1099511628211ull;
+    }
+
+    char digits[17];
+    std::snprintf(digits, sizeof(digits), "%016llx", static_cast<unsigned long long>(h));
+    return digits;
+}
+
+std::string Cache::writeDiagnostics(const std::vector<Error>& diagnostics)
+{
+    std::ostringstream text;
+
+    for (const auto& e : diagnostics) {
+        text << e.position << ' ' << e.message << '\n';
+    }
+
+    return text.str();
+}
+
+std::vector<Error> Cache::readDiagnostics(const std::string& text)
+{
+    std::vector<Error> diagnostics;
+    std::istringstream lines(text);
+
+    for (std::string line; std::getline(lines, line); ) {
+        auto space = line.find(' ');
+
+        if (space == std::string::npos || space == 0 || line.find_first_not_of("0123456789") != space) {
+            throw std::logic_error("Cache::readDiagnostics: A diagnostic has no position");
+        }
+
+        diagnostics.emplace_back(std::stoul(line.substr(0, space)), line.substr(space + 1));
+    }
+
+    return diagnostics;
+}
+
+std::string Cache::path(const std::string& key) const
+{
+    return directory_ + "/" + hash(salt_ + key);
+}
+
+void Cache::evict()
+{
+    DIR* dir = ::opendir(directory_.c_str());
+
+    if (!dir) {
+        return;
+    }
+
+    // (last use, size, path) of every entry
+    std::vector<std::pair<std::uint64_t, std::pair<std::uint64_t, std::string>>> entries;
+    std::uint64_t total = 0;
+
+    while (auto e = ::readdir(dir)) {
+        std::string name = e->d_name;
+        struct stat st;
+
+        // entries are named by their hash only, which leaves out . and .. and the temporary files
+        if (name.size() != 16 || ::stat((directory_ + "/" + name).c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+
+        entries.emplace_back(modified(st), std::make_pair(st.st_size, directory_ + "/" + name));
+        total += st.st_size;
+    }
+
+    ::closedir(dir);
+    written_ = 0;
+    std::sort(entries.begin(), entries.end());
+
+    for (const auto& e : entries) {
+        if (total <= capacity_) {
+            break;
+        }
+
+        if (std::remove(e.second.second.c_str()) == 0) {
+            total -= e.second.first;
+        }
+    }
+}
+
+}
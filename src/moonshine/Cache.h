@@ -0,0 +1,59 @@
+#pragma once
+
+#include "moonshine/Error.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace moonshine {
+
+/**
+ * Compilation outputs on the local disk, addressed by everything they were made from: the key holds the
+ * source, the options and whatever else the compiler read, in full, after a salt for what is the same for
+ * every entry, like the build of the compiler. Entries are files named by a hash of their key, which they
+ * keep to tell collisions from hits.
+ *
+ * When the entries take more than the capacity, the least recently used are removed; their modification
+ * time is when they were last used. The directory is looked over once a sixteenth of the capacity has been
+ * written, and when the cache is destroyed. Entries are written to a temporary file first and renamed, so that
+ * compilers sharing the directory never see half of one.
+ */
+class Cache
+{
+public:
+    // artifacts by name
+    typedef std::map<std::string, std::string> Entry;
+
+    // the directory is made when missing
+    Cache(const std::string& directory, std::uint64_t capacity, const std::string& salt = "");
+    ~Cache();
+
+    // false on a miss; a hit counts as a use
+    bool load(const std::string& key, Entry& entry);
+
+    // false when the entry can't be written, which is no reason not to go on without it
+    bool store(const std::string& key, const Entry& entry);
+
+    // 64-bit FNV-1a, as 16 hex digits
+    static std::string hash(const std::string& text);
+
+    // diagnostics as an entry keeps them, one a line after its position, so that a hit sorts like a miss
+    static std::string writeDiagnostics(const std::vector<Error>& diagnostics);
+    static std::vector<Error> readDiagnostics(const std::string& text);
+
+    const std::string& directory() const { return directory_; }
+private:
+    std::string directory_;
+    std::uint64_t capacity_;
+    std::string salt_;
+
+    // bytes stored since the last eviction
+    std::uint64_t written_ = 0;
+
+    std::string path(const std::string& key) const;
+    void evict();
+};
+
+}
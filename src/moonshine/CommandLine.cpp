@@ -0,0 +1,157 @@
+#include "moonshine/CommandLine.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <limits>
+#include <thread>
+
+namespace moonshine {
+
+namespace {
+
+// digits only, so neither signs nor spaces, and no more than an unsigned int holds
+bool parseCount(const std::string& value, unsigned int& count)
+{
+    if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+
+    errno = 0;
+    auto parsed = std::strtoull(value.c_str(), nullptr, 10);
+
+    if (errno == ERANGE || parsed > std::numeric_limits<unsigned int>::max()) {
+        return false;
+    }
+
+    count = static_cast<unsigned int>(parsed);
+    return true;
+}
+
+}
+
+void CommandLine::Artifact::enable(const std::string& path_)
+{
+    enabled = true;
+
+    if (!path_.empty()) {
+        path = path_;
+    }
+}
+
+bool CommandLine::parse(const std::vector<std::string>& args)
+{
+    auto all = artifacts();
+
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        const auto& arg = args[i];
+
+        // --option=value
+        auto equals = arg.find('=');
+        auto option = arg.substr(0, equals);
+        auto value = equals == std::string::npos ? std::string() : arg.substr(equals + 1);
+        bool valid = true;
+
+        auto artifact = std::find_if(all.begin(), all.end(), [&option](const Artifact* a) {
+            return option == "--" + a->option;
+        });
+
+        if (arg == "-h" || arg == "--help") {
+            help = true;
+        } else if (artifact != all.end()) {
+            (*artifact)->enable(value);
+        } else if (arg == "--all") {
+            for (auto a : all) {
+                a->enable("");
+            }
+        } else if (arg == "-o" && i + 1 < args.size()) {
+            program.enable(args[++i]);
+        } else if (option == "--output" && !value.empty()) {
+            program.enable(value);
+        } else if (option == "--threads") {
+            valid = value.empty() ? (options.checkThreads = std::thread::hardware_concurrency()) > 0
+                                  : parseCount(value, options.checkThreads);
+        } else if (arg == "--stack-code") {
+            options.generateIR = false;
+        } else if (arg == "-O0") {
+            options.optimizeIR = false;
+        } else if (option == "--inline") {
+            valid = parseCount(value, options.inlineSize);
+        } else if (arg == "--no-register-calls") {
+            options.registerCalls = false;
+        } else if (option == "--peephole-window") {
+            valid = parseCount(value, options.peepholeWindow);
+        } else if (arg == "--run") {
+            run = true;
+        } else if (arg == "--stats" || arg == "--stats-json") {
+            stats = true;
+            statsJson = arg == "--stats-json";
+        } else if (option == "--cache") {
+            cache = value.empty() ? ".moonshine-cache" : value;
+        } else if (option == "--object-cache") {
+            objectCache = value.empty() ? ".moonshine-objects" : value;
+        } else if (option == "--cache-size") {
+            valid = parseCount(value, cacheSize);
+        } else if (option == "--server") {
+            serve = true;
+            socket = value;
+        } else if (option == "--connect" && !value.empty()) {
+            connect = value;
+        } else if ((arg == "-" || arg[0] != '-') && input.empty()) {
+            input = arg;
+        } else {
+            valid = false;
+        }
+
+        if (!valid) {
+            error = arg;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::vector<CommandLine::Artifact*> CommandLine::artifacts()
+{
+    return {&tokens, &derivation, &ast, &table, &ir, &peephole, &native};
+}
+
+std::vector<std::string> CommandLine::requestArguments() const
+{
+    std::vector<std::string> args;
+
+    for (auto a : const_cast<CommandLine*>(this)->artifacts()) {
+        if (a->enabled) {
+            args.push_back("--" + a->option);
+        }
+    }
+
+    if (options.checkThreads > 0) {
+        args.push_back("--threads=" + std::to_string(options.checkThreads));
+    }
+
+    if (!options.generateIR) {
+        args.push_back("--stack-code");
+    }
+
+    if (!options.optimizeIR) {
+        args.push_back("-O0");
+    }
+
+    args.push_back("--inline=" + std::to_string(options.inlineSize));
+
+    if (!options.registerCalls) {
+        args.push_back("--no-register-calls");
+    }
+
+    args.push_back("--peephole-window=" + std::to_string(options.peepholeWindow));
+
+    if (stats) {
+        args.push_back(statsJson ? "--stats-json" : "--stats");
+    }
+
+    return args;
+}
+
+}
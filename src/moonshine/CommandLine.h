@@ -0,0 +1,73 @@
+#pragma once
+
+#include "moonshine/Compiler.h"
+
+#include <string>
+#include <vector>
+
+namespace moonshine {
+
+/**
+ * The options of a compilation, from the command line or from a request to a server.
+ */
+struct CommandLine
+{
+    // an output, written to its path when enabled; - is stdout
+    struct Artifact
+    {
+        Artifact(const std::string& option_, const std::string& path_)
+            : option(option_), path(path_)
+        {}
+
+        std::string option;
+        std::string path;
+        bool enabled = false;
+
+        void enable(const std::string& path_);
+    };
+
+    Artifact program{"output", "program.m"};
+    Artifact tokens{"tokens", "tokens.txt"};
+    Artifact derivation{"derivation", "derivation.txt"};
+    Artifact ast{"ast", "ast.dot"};
+    Artifact table{"table", "table.txt"};
+    Artifact ir{"ir", "program.ir"};
+    Artifact peephole{"peephole", "peephole.txt"};
+    Artifact native{"native", "program.s"};
+
+    Compiler::Options options;
+
+    bool help = false;
+    bool run = false;
+    bool stats = false;
+    bool statsJson = false;
+
+    // reuse the outputs of earlier compiles of the same source with the same options, kept in this directory
+    // up to cacheSize megabytes, when it isn't empty
+    std::string cache;
+    unsigned int cacheSize = 64;
+
+    // generate each function through a cache of their code in this directory, when it isn't empty
+    std::string objectCache;
+
+    // serve requests on stdin and stdout, or on a Unix socket at the path when it isn't empty
+    bool serve = false;
+    std::string socket;
+
+    // compile on the server listening at this path
+    std::string connect;
+
+    std::string input;
+
+    // false for an invalid option, which is kept in error
+    bool parse(const std::vector<std::string>& args);
+    std::string error;
+
+    // every artifact but the program
+    std::vector<Artifact*> artifacts();
+
+    // what a server needs to know to compile with these options, for parse on its side
+    std::vector<std::string> requestArguments() const;
+};
+
+}
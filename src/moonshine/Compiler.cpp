@@ -0,0 +1,300 @@
+#include "moonshine/Compiler.h"
+
+#include "moonshine/Visitor.h"
+#include "moonshine/semantic/SemanticError.h"
+#include "moonshine/semantic/InheritanceResolverVisitor.h"
+#include "moonshine/semantic/SymbolTableCreatorVisitor.h"
+#include "moonshine/semantic/SymbolTableClassDeclLinkerVisitor.h"
+#include "moonshine/semantic/SymbolTableLinkerVisitor.h"
+#include "moonshine/semantic/ShadowedSymbolCheckerVisitor.h"
+#include "moonshine/semantic/TypeCheckerVisitor.h"
+#include "moonshine/semantic/ParallelFunctionChecker.h"
+#include "moonshine/code/MemorySizeComputerVisitor.h"
+#include "moonshine/code/StackCodeGeneratorVisitor.h"
+#include "moonshine/code/MoonBackend.h"
+#include "moonshine/code/IncrementalBackend.h"
+#include "moonshine/code/PeepholeOptimizer.h"
+#include "moonshine/code/X86Backend.h"
+#include "moonshine/ir/IRBuilderVisitor.h"
+#include "moonshine/ir/Inliner.h"
+#include "moonshine/ir/TailCallElimination.h"
+#include "moonshine/ir/ConstantPropagation.h"
+#include "moonshine/ir/DeadCodeElimination.h"
+#include "moonshine/ir/DeadFunctionElimination.h"
+#include "moonshine/ir/RegisterCallingConvention.h"
+#include "moonshine/ir/StrengthReduction.h"
+#include "moonshine/ir/AddressFolding.h"
+
+#include <algorithm>
+#include <sstream>
+#include <utility>
+
+namespace moonshine {
+
+Compiler::Compiler(Statistics* statistics)
+{
+    {
+        Statistics::Phase phase(statistics, "lexer tables");
+        lexer_.reset(new Lexer());
+    }
+
+    Statistics::Phase phase(statistics, "grammar");
+    const auto& files = resources();
+    grammar_.reset(new syntax::Grammar(files[0].c_str(), files[1].c_str(), files[2].c_str(), files[3].c_str()));
+    parser_.reset(new syntax::Parser(*grammar_));
+}
+
+const std::vector<std::string>& Compiler::resources()
+{
+    static const std::vector<std::string> files = {"grammar.txt", "table.json", "first.txt", "follow.txt"};
+    return files;
+}
+
+Compiler::Result Compiler::compile(std::istream& source, const Options& options, const Outputs& outputs,
+                                   Statistics* statistics)
+{
+    Result result;
+    auto& errors = result.diagnostics;
+    auto& moonCode = result.code;
+
+    lexer_->startLexing(&source, outputs.tokens);
+
+    // tokens are lexed as the parser asks for them
+    std::unique_ptr<ast::Node> astRoot;
+    {
+        Statistics::Phase phase(statistics, "lexing and parsing");
+        astRoot = parser_->parse(lexer_.get(), outputs.derivation);
+    }
+
+    if (statistics) {
+        statistics->count("tokens", lexer_->tokenCount());
+        statistics->count("ast nodes", astRoot ? astRoot->nodeCount() : 0);
+    }
+
+    // output lexer errors
+    for (const auto& e : lexer_->getErrors()) {
+        std::ostringstream ss;
+        e.print(ss);
+        errors.emplace_back(e.position, ss.str());
+    }
+
+    // output parser errors
+    for (const auto& e : parser_->getErrors()) {
+        std::ostringstream ss;
+        e.print(ss);
+        errors.emplace_back(e.token ? e.token->position : 0, ss.str());
+    }
+
+    result.parsed = astRoot != nullptr;
+
+    if (astRoot) {
+        std::vector<semantic::SemanticError> semanticErrors;
+
+        // visitors with their phase names
+        std::vector<std::pair<const char*, std::unique_ptr<Visitor>>> visitors;
+        auto addVisitor = [&visitors](const char* name, Visitor* visitor) {
+            visitors.emplace_back(name, std::unique_ptr<Visitor>(visitor));
+        };
+
+        addVisitor("symbol tables", new semantic::SymbolTableCreatorVisitor());
+        addVisitor("class declarations", new semantic::SymbolTableClassDeclLinkerVisitor());
+        addVisitor("symbol linking", new semantic::SymbolTableLinkerVisitor());
+        addVisitor("inheritance", new semantic::InheritanceResolverVisitor());
+
+        if (options.checkThreads == 0) {
+            addVisitor("shadowed symbols", new semantic::ShadowedSymbolCheckerVisitor());
+            addVisitor("type checking", new semantic::TypeCheckerVisitor());
+        }
+
+        // run semantic check visitors
+        for (auto& v : visitors) {
+            Statistics::Phase phase(statistics, v.first);
+            v.second->setErrorContainer(&semanticErrors);
+            astRoot->accept(v.second.get());
+        }
+
+        // once the tables are linked, function bodies can be checked independently
+        if (options.checkThreads > 0) {
+            Statistics::Phase phase(statistics, "function checks");
+            semantic::ParallelFunctionChecker checker(options.checkThreads);
+            checker.addVisitor([]() { return std::unique_ptr<Visitor>(new semantic::ShadowedSymbolCheckerVisitor()); });
+            checker.addVisitor([]() { return std::unique_ptr<Visitor>(new semantic::TypeCheckerVisitor()); });
+            checker.check(astRoot.get(), semanticErrors);
+        }
+
+        visitors.clear();
+
+        if (statistics) {
+            statistics->count("symbol tables", astRoot->symbolTable()->arena().tableCount());
+            statistics->count("symbol table entries", astRoot->symbolTable()->arena().entryCount());
+        }
+
+        // the stack code generator's data goes straight to the program, ahead of the text, which the peephole
+        // optimizer needs whole; without a program output it is kept with the code
+        std::ostringstream dataBuffer;
+        std::ostream& dataStream = outputs.program ? *outputs.program : dataBuffer;
+        std::ostringstream textStream;
+        ir::Program irProgram;
+        result.generated = errors.empty() && std::find_if(semanticErrors.begin(), semanticErrors.end(),
+                         [](const semantic::SemanticError& e) { return e.level == semantic::SemanticErrorLevel::ERROR; }) == semanticErrors.end();
+
+        if (result.generated) {
+            addVisitor("memory sizes", new code::MemorySizeComputerVisitor());
+
+            if (options.generateIR) {
+                addVisitor("ir", new ir::IRBuilderVisitor(irProgram));
+            } else {
+                addVisitor("stack code", new code::StackCodeGeneratorVisitor(dataStream, textStream));
+            }
+        }
+
+        // run code generation visitors
+        for (auto& v : visitors) {
+            Statistics::Phase phase(statistics, v.first);
+            v.second->setErrorContainer(&semanticErrors);
+            astRoot->accept(v.second.get());
+        }
+
+        if (result.generated && !options.generateIR && outputs.program) {
+            code::MoonInstruction("align", {}).print(*outputs.program);
+        }
+
+        if (result.generated) {
+            code::PeepholeOptimizer optimizer(options.peepholeWindow);
+
+            if (options.generateIR) {
+                if (statistics) {
+                    statistics->count("ir instructions", irProgram.instructionCount());
+                }
+
+                if (options.optimizeIR) {
+                    Statistics::Phase phase(statistics, "ir optimization");
+
+                    if (options.inlineSize > 0) {
+                        Statistics::Phase pass(statistics, "inlining");
+                        ir::Inliner(options.inlineSize).run(irProgram);
+                    }
+
+                    {
+                        Statistics::Phase pass(statistics, "tail calls");
+                        ir::TailCallElimination().run(irProgram);
+                    }
+
+                    {
+                        Statistics::Phase pass(statistics, "constant propagation");
+                        ir::ConstantPropagation().run(irProgram);
+                        ir::StrengthReduction().run(irProgram);
+                        ir::ConstantPropagation().run(irProgram);
+                    }
+
+                    {
+                        Statistics::Phase pass(statistics, "address folding");
+                        ir::AddressFolding().run(irProgram);
+                    }
+
+                    {
+                        Statistics::Phase pass(statistics, "dead code");
+                        ir::DeadCodeElimination().run(irProgram);
+                        ir::DeadFunctionElimination().run(irProgram);
+                    }
+                }
+
+                if (options.registerCalls) {
+                    Statistics::Phase phase(statistics, "register calls");
+                    ir::RegisterCallingConvention().run(irProgram);
+                }
+
+                if (statistics) {
+                    statistics->count("optimized ir instructions", irProgram.instructionCount());
+                }
+
+                // lower the IR to moon code, and to x86-64
+                if (outputs.ir) {
+                    irProgram.print(*outputs.ir);
+                }
+
+                if (options.objectCache) {
+                    // fragments are peephole optimized on their own
+                    Statistics::Phase phase(statistics, "moon backend");
+                    code::IncrementalBackend backend(moonCode, *options.objectCache, optimizer);
+                    backend.emit(irProgram);
+
+                    if (statistics) {
+                        statistics->count("functions reused", backend.reused());
+                        statistics->count("functions generated", backend.generated());
+                    }
+                } else {
+                    Statistics::Phase phase(statistics, "moon backend");
+                    code::MoonBackend(moonCode).emit(irProgram);
+                }
+
+                if (outputs.native) {
+                    Statistics::Phase phase(statistics, "x86 backend");
+                    code::X86Backend(*outputs.native).emit(irProgram);
+                }
+            } else {
+                std::istringstream text(textStream.str());
+                moonCode = code::MoonCode::parse(text);
+            }
+
+            if (!options.generateIR || !options.objectCache) {
+                Statistics::Phase phase(statistics, "peephole");
+                optimizer.optimize(moonCode);
+            }
+
+            if (outputs.peephole) {
+                optimizer.printHits(*outputs.peephole);
+            }
+
+            if (statistics) {
+                statistics->count("moon instructions", std::count_if(moonCode.text().begin(), moonCode.text().end(),
+                    [](const code::MoonInstruction& i) { return !i.op.empty() && !i.isDirective(); }));
+            }
+
+            // the stack code generator writes its data as text
+            if (!outputs.program) {
+                std::istringstream data(dataBuffer.str());
+                const auto lines = code::MoonCode::parse(data).text();
+                moonCode.data().insert(moonCode.data().end(), lines.begin(), lines.end());
+            }
+        }
+
+        Statistics::Phase outputPhase(statistics, "output");
+
+        if (outputs.program) {
+            moonCode.printText(*outputs.program);
+            *outputs.program << std::endl;
+            moonCode.printData(*outputs.program);
+        }
+
+        // print symbol tables
+        if (outputs.table) {
+            astRoot->symbolTable()->print(*outputs.table, "");
+        }
+
+        // output semantic errors
+        for (const auto& e : semanticErrors) {
+            std::ostringstream ss;
+            e.print(ss);
+            errors.emplace_back(e.token ? e.token->position : 0, ss.str());
+        }
+
+        // print the AST tree graphviz output
+        if (outputs.ast) {
+            astRoot->graphviz(*outputs.ast);
+        }
+    }
+
+    // diagnostics at the same position keep the order in which they were found
+    std::stable_sort(errors.begin(), errors.end(), [](const Error& a, const Error& b) {
+        return a.position < b.position;
+    });
+
+    if (statistics) {
+        statistics->count("diagnostics", errors.size());
+    }
+
+    return result;
+}
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "moonshine/Cache.h"
+#include "moonshine/Error.h"
+#include "moonshine/Statistics.h"
+#include "moonshine/code/MoonCode.h"
+#include "moonshine/lexer/Lexer.h"
+#include "moonshine/syntax/Grammar.h"
+#include "moonshine/syntax/Parser.h"
+
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace moonshine {
+
+/**
+ * Compiles programs from source to Moon assembly, through every phase: lexing and parsing, the semantic
+ * checks, code generation through the IR or straight from the AST, and peephole optimization.
+ *
+ * The lexer tables and the grammar (grammar.txt, table.json, first.txt and follow.txt in the working
+ * directory) are built once when the compiler is made, and shared by every program it compiles after.
+ */
+class Compiler
+{
+public:
+    struct Options
+    {
+        // function bodies are checked on this thread, or on a pool of this many threads
+        unsigned int checkThreads = 0;
+
+        // generate code through the three-address IR, or straight from the AST
+        bool generateIR = true;
+
+        // inline, eliminate tail calls, fold constants and addresses, reduce loop addressing and drop dead code
+        // and functions in the IR; calls to functions of up to inlineSize instructions are inlined
+        bool optimizeIR = true;
+        unsigned int inlineSize = 16;
+
+        // pass the first scalar arguments and scalar results of functions in registers, or everything in the
+        // stack frame like the Moon util library does
+        bool registerCalls = true;
+
+        // how many instructions the peephole optimizer looks ahead, 0 disables it
+        unsigned int peepholeWindow = 8;
+
+        // generate the code of each function through this cache, so that only the functions whose IR changed
+        // since an earlier compile are generated again; the stack code generator ignores it
+        Cache* objectCache = nullptr;
+    };
+
+    // where each output goes, nullptr for the ones that aren't wanted
+    struct Outputs
+    {
+        std::ostream* program = nullptr;
+        std::ostream* tokens = nullptr;
+        std::ostream* derivation = nullptr;
+        std::ostream* ast = nullptr;
+        std::ostream* table = nullptr;
+        std::ostream* ir = nullptr;
+        std::ostream* peephole = nullptr;
+        std::ostream* native = nullptr;
+    };
+
+    struct Result
+    {
+        // an AST was built, and code was generated from it when no errors were found
+        bool parsed = false;
+        bool generated = false;
+
+        // errors and warnings of every phase, in the order of their position in the source
+        std::vector<Error> diagnostics;
+
+        // the generated program, whole when there is no program output: the data of the stack code generator
+        // goes straight to it
+        code::MoonCode code;
+    };
+
+    // building the tables is timed into the statistics, when given
+    explicit Compiler(Statistics* statistics = nullptr);
+
+    Result compile(std::istream& source, const Options& options, const Outputs& outputs,
+                   Statistics* statistics = nullptr);
+
+    // the files the tables are built from, in the working directory
+    static const std::vector<std::string>& resources();
+private:
+    std::unique_ptr<Lexer> lexer_;
+    std::unique_ptr<syntax::Grammar> grammar_;
+    std::unique_ptr<syntax::Parser> parser_;
+};
+
+}
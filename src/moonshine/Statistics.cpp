@@ -0,0 +1,181 @@
+#include "moonshine/Statistics.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <iomanip>
+
+namespace moonshine {
+
+std::atomic<bool> Statistics::counting_(false);
+std::atomic<unsigned int> Statistics::recording_(0);
+std::atomic<std::uint64_t> Statistics::allocations_(0);
+std::atomic<std::uint64_t> Statistics::bytes_(0);
+
+Statistics::Phase::Phase(Statistics* statistics, const char* name)
+    : statistics_(statistics)
+{
+    if (!statistics_) {
+        return;
+    }
+
+    record_ = statistics_->phases_.size();
+    statistics_->phases_.push_back({name, statistics_->depth_++, 0, 0, 0});
+
+    startAllocations_ = allocations_.load(std::memory_order_relaxed);
+    startBytes_ = bytes_.load(std::memory_order_relaxed);
+    start_ = std::chrono::steady_clock::now();
+}
+
+Statistics::Phase::~Phase()
+{
+    stop();
+}
+
+void Statistics::Phase::stop()
+{
+    if (!statistics_) {
+        return;
+    }
+
+    auto& record = statistics_->phases_[record_];
+    record.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    record.allocations = allocations_.load(std::memory_order_relaxed) - startAllocations_;
+    record.bytes = bytes_.load(std::memory_order_relaxed) - startBytes_;
+
+    --statistics_->depth_;
+    statistics_ = nullptr;
+}
+
+Statistics::Statistics()
+{
+    ++recording_;
+}
+
+Statistics::~Statistics()
+{
+    --recording_;
+}
+
+void Statistics::count(const std::string& name, const std::uint64_t& value)
+{
+    auto it = std::find_if(counts_.begin(), counts_.end(), [&name](const std::pair<std::string, std::uint64_t>& c) {
+        return c.first == name;
+    });
+
+    if (it == counts_.end()) {
+        counts_.emplace_back(name, value);
+    } else {
+        it->second += value;
+    }
+}
+
+const std::vector<Statistics::Record>& Statistics::phases() const
+{
+    return phases_;
+}
+
+const std::vector<std::pair<std::string, std::uint64_t>>& Statistics::counts() const
+{
+    return counts_;
+}
+
+double Statistics::seconds() const
+{
+    double seconds = 0;
+
+    for (const auto& record : phases_) {
+        if (record.depth == 0) {
+            seconds += record.seconds;
+        }
+    }
+
+    return seconds;
+}
+
+void Statistics::print(std::ostream& s) const
+{
+    auto flags = s.flags();
+    auto precision = s.precision();
+    bool allocations = countsAllocations();
+
+    s << std::left << std::setw(32) << "phase" << std::right << std::setw(12) << "ms";
+
+    if (allocations) {
+        s << std::setw(14) << "allocations" << std::setw(14) << "bytes";
+    }
+
+    s << std::endl;
+    s << std::fixed << std::setprecision(3);
+
+    for (const auto& record : phases_) {
+        s << std::left << std::setw(32) << (std::string(2 * record.depth, ' ') + record.name) << std::right
+          << std::setw(12) << record.seconds * 1000;
+
+        if (allocations) {
+            s << std::setw(14) << record.allocations << std::setw(14) << record.bytes;
+        }
+
+        s << std::endl;
+    }
+
+    s << std::left << std::setw(32) << "total" << std::right << std::setw(12) << seconds() * 1000 << std::endl;
+
+    if (!counts_.empty()) {
+        s << std::endl;
+    }
+
+    for (const auto& count : counts_) {
+        s << std::left << std::setw(32) << count.first << std::right << std::setw(12) << count.second << std::endl;
+    }
+
+    s.flags(flags);
+    s.precision(precision);
+}
+
+void Statistics::printJson(std::ostream& s) const
+{
+    nlohmann::json json;
+    json["phases"] = nlohmann::json::array();
+    json["seconds"] = seconds();
+    json["counts"] = nlohmann::json::object();
+
+    for (const auto& record : phases_) {
+        nlohmann::json phase = {{"name", record.name}, {"depth", record.depth}, {"seconds", record.seconds}};
+
+        if (countsAllocations()) {
+            phase["allocations"] = record.allocations;
+            phase["bytes"] = record.bytes;
+        }
+
+        json["phases"].push_back(phase);
+    }
+
+    for (const auto& count : counts_) {
+        json["counts"][count.first] = count.second;
+    }
+
+    s << json.dump() << std::endl;
+}
+
+void Statistics::allocation(const std::size_t& size)
+{
+    if (recording_.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+
+    allocations_.fetch_add(1, std::memory_order_relaxed);
+    bytes_.fetch_add(size, std::memory_order_relaxed);
+}
+
+void Statistics::countAllocations()
+{
+    counting_ = true;
+}
+
+bool Statistics::countsAllocations()
+{
+    return counting_.load(std::memory_order_relaxed);
+}
+
+}
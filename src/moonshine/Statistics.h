@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace moonshine {
+
+/**
+ * Compile time statistics: how long each phase of a compilation took and how much it allocated, and counts
+ * of what the phases produced, like tokens, AST nodes, symbol table entries or instructions.
+ *
+ * A phase is timed by a Statistics::Phase that lives as long as the phase does. Phases may nest, and are
+ * listed in the order they started. Statistics are optional wherever they are taken: a Phase given no
+ * Statistics does nothing, so compiling without them costs a pointer check per phase.
+ *
+ * Allocations are only counted by a program that replaces the global operator new with one calling
+ * allocation(), which counts while some Statistics exists, and that calls countAllocations() before taking
+ * any. The driver does both. Elsewhere nothing is counted, and print() and printJson() leave allocations and
+ * bytes out rather than reporting none.
+ */
+class Statistics
+{
+public:
+    struct Record
+    {
+        std::string name;
+        unsigned int depth;
+        double seconds;
+        std::uint64_t allocations;
+        std::uint64_t bytes;
+    };
+
+    class Phase
+    {
+    public:
+        Phase(Statistics* statistics, const char* name);
+        ~Phase();
+
+        // before the end of the scope, for phases that make something the rest of the scope uses
+        void stop();
+
+        Phase(const Phase&) = delete;
+        Phase& operator=(const Phase&) = delete;
+    private:
+        Statistics* statistics_;
+        std::size_t record_ = 0;
+        std::chrono::steady_clock::time_point start_;
+        std::uint64_t startAllocations_ = 0;
+        std::uint64_t startBytes_ = 0;
+    };
+
+    Statistics();
+    ~Statistics();
+
+    Statistics(const Statistics&) = delete;
+    Statistics& operator=(const Statistics&) = delete;
+
+    // adds to a count, which is listed in the order it was first counted
+    void count(const std::string& name, const std::uint64_t& value);
+
+    const std::vector<Record>& phases() const;
+    const std::vector<std::pair<std::string, std::uint64_t>>& counts() const;
+
+    // of the outermost phases
+    double seconds() const;
+
+    void print(std::ostream& s) const;
+    void printJson(std::ostream& s) const;
+
+    // for operator new, from any thread
+    static void allocation(const std::size_t& size);
+
+    // tells that operator new calls allocation()
+    static void countAllocations();
+    static bool countsAllocations();
+private:
+    static std::atomic<bool> counting_;
+    static std::atomic<unsigned int> recording_;
+    static std::atomic<std::uint64_t> allocations_;
+    static std::atomic<std::uint64_t> bytes_;
+
+    std::vector<Record> phases_;
+    std::vector<std::pair<std::string, std::uint64_t>> counts_;
+    unsigned int depth_ = 0;
+};
+
+}
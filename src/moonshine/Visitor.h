@@ -24,11 +24,13 @@ public:
 
     #define AST(NAME) virtual void visit(ast::NAME* node) { if (order() == VisitorOrder::NONE) next(node); }
     #define AST_LEAF(NAME) virtual void visit(ast::NAME* node) { if (order() == VisitorOrder::NONE) next(node); }
+    #define AST_ROOT(NAME) AST(NAME)
 
     #include "moonshine/syntax/ast_nodes.h"
 
     #undef AST
     #undef AST_LEAF
+    #undef AST_ROOT
 
     void setErrorContainer(std::vector<semantic::SemanticError>* errors);
 
@@ -0,0 +1,131 @@
+#include "moonshine/code/IncrementalBackend.h"
+
+#include "moonshine/code/MoonBackend.h"
+
+#include <cctype>
+#include <sstream>
+
+namespace moonshine { namespace code {
+
+using namespace ir;
+
+IncrementalBackend::IncrementalBackend(MoonCode& code, Cache& cache, PeepholeOptimizer& optimizer)
+    : code_(code), cache_(cache), optimizer_(optimizer)
+{
+}
+
+void IncrementalBackend::emit(const Program& program)
+{
+    for (const auto& function : program.functions()) {
+        link(fragment(*function));
+    }
+
+    MoonBackend(code_).emitData();
+}
+
+unsigned int IncrementalBackend::reused() const
+{
+    return reused_;
+}
+
+unsigned int IncrementalBackend::generated() const
+{
+    return generated_;
+}
+
+std::string IncrementalBackend::fragment(const Function& function)
+{
+    // block labels by index, and back
+    std::map<std::string, std::string> local;
+    std::map<std::string, std::string> labels;
+    const auto& blocks = function.blocks();
+
+    for (std::size_t i = 0; i < blocks.size(); ++i) {
+        auto name = "@" + std::to_string(i);
+        local[blocks[i]->label()] = name;
+        labels[name] = blocks[i]->label();
+    }
+
+    std::ostringstream ir;
+    ir << "peephole " << optimizer_.window() << std::endl;
+    function.print(ir);
+    auto key = rename(ir.str(), local);
+
+    Cache::Entry entry;
+
+    if (cache_.load(key, entry)) {
+        ++reused_;
+        return rename(entry["code"], labels);
+    }
+
+    MoonCode code;
+    MoonBackend(code).emit(function);
+    optimizer_.optimize(code);
+    ++generated_;
+
+    std::ostringstream text;
+    code.printText(text);
+    cache_.store(key, {{"code", rename(text.str(), local)}});
+    return text.str();
+}
+
+void IncrementalBackend::link(const std::string& fragment)
+{
+    std::istringstream s(fragment);
+    auto lines = MoonCode::parse(s).text();
+    auto& text = code_.text();
+
+    // the peephole optimizer's jump to next rule, across fragments: a function ending in a jump to the one after
+    auto last = text.rbegin();
+
+    while (last != text.rend() && last->isComment()) {
+        ++last;
+    }
+
+    if (last != text.rend() && (last->op == "j" || last->op == "bz" || last->op == "bnz")) {
+        for (const auto& line : lines) {
+            if (line.label == last->operands.back()) {
+                text.erase(std::next(last).base());
+                break;
+            }
+
+            // a run of labels all name the same instruction
+            if (!line.isComment() && (line.label.empty() || !line.op.empty())) {
+                break;
+            }
+        }
+    }
+
+    text.insert(text.end(), lines.begin(), lines.end());
+}
+
+std::string IncrementalBackend::rename(const std::string& text, const std::map<std::string, std::string>& names)
+{
+    std::string renamed;
+    renamed.reserve(text.size());
+
+    auto isWord = [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '@';
+    };
+
+    for (std::size_t i = 0; i < text.size(); ) {
+        if (!isWord(text[i])) {
+            renamed += text[i++];
+            continue;
+        }
+
+        auto start = i;
+
+        while (i < text.size() && isWord(text[i])) {
+            ++i;
+        }
+
+        auto word = text.substr(start, i - start);
+        auto name = names.find(word);
+        renamed += name != names.end() ? name->second : word;
+    }
+
+    return renamed;
+}
+
+}}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "moonshine/Cache.h"
+#include "moonshine/ir/Program.h"
+#include "moonshine/code/MoonCode.h"
+#include "moonshine/code/PeepholeOptimizer.h"
+
+#include <map>
+#include <string>
+
+namespace moonshine { namespace code {
+
+/**
+ * Generates Moon assembly one function at a time, reusing the code of functions whose IR hasn't changed
+ * since an earlier compile, then links the fragments into one program.
+ *
+ * A fragment is the peephole optimized code of one function, found in the cache by the function's final IR:
+ * its body after inlining and the calling convention, and its frame layout, which holds the offsets of the
+ * symbol tables it uses. Block labels are numbered over the whole program, so fragments name them by their
+ * index in the function (@0, @1, ...) and linking gives them back the labels of this compile. This way an
+ * edit to one function leaves the fragments of the others as they were.
+ */
+class IncrementalBackend
+{
+public:
+    IncrementalBackend(MoonCode& code, Cache& cache, PeepholeOptimizer& optimizer);
+
+    void emit(const ir::Program& program);
+
+    unsigned int reused() const;
+    unsigned int generated() const;
+private:
+    MoonCode& code_;
+    Cache& cache_;
+    PeepholeOptimizer& optimizer_;
+    unsigned int reused_ = 0;
+    unsigned int generated_ = 0;
+
+    // the fragment of the function, with labels as in this compile
+    std::string fragment(const ir::Function& function);
+
+    void link(const std::string& fragment);
+
+    // renames every whole word of the text that is in the names
+    static std::string rename(const std::string& text, const std::map<std::string, std::string>& names);
+};
+
+}}
@@ -0,0 +1,244 @@
+#include "moonshine/code/LinearScanAllocator.h"
+
+#include "moonshine/ir/Liveness.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <list>
+#include <stdexcept>
+
+namespace moonshine { namespace code {
+
+using namespace ir;
+
+LinearScanAllocator::LinearScanAllocator(const std::vector<std::string>& registers)
+    : registers_(registers)
+{
+}
+
+void LinearScanAllocator::allocate(const Function& function)
+{
+    auto count = function.registerCount();
+    const auto& blocks = function.blocks();
+
+    Liveness liveness(function);
+
+    assignment_.assign(count, -1);
+    slots_.assign(count, -1);
+    slotCount_ = 0;
+    saved_.clear();
+
+    // a block is in a loop when it sits between a loop header and a block branching back to it
+    std::unordered_map<const BasicBlock*, int> layout;
+    std::vector<int> depth(blocks.size(), 0);
+
+    for (std::vector<int>::size_type b = 0; b < blocks.size(); ++b) {
+        layout[blocks[b].get()] = static_cast<int>(b);
+    }
+
+    for (std::vector<int>::size_type b = 0; b < blocks.size(); ++b) {
+        for (auto successor : blocks[b]->successors()) {
+            auto header = layout[successor];
+
+            if (header <= static_cast<int>(b)) {
+                for (auto i = header; i <= static_cast<int>(b); ++i) {
+                    ++depth[i];
+                }
+            }
+        }
+    }
+
+    // number instructions in layout order, uses at even and definitions at odd positions,
+    // so an instruction can reuse the register of an operand it reads for the last time
+    std::vector<Interval> intervals(count);
+
+    for (int v = 0; v < count; ++v) {
+        intervals[v] = {v, INT_MAX, -1, 0};
+    }
+
+    auto extend = [&intervals](const int& v, const int& position) {
+        intervals[v].start = std::min(intervals[v].start, position);
+        intervals[v].end = std::max(intervals[v].end, position);
+    };
+
+    int index = 0;
+
+    for (std::vector<int>::size_type b = 0; b < blocks.size(); ++b) {
+        auto block = blocks[b].get();
+        auto first = index;
+        auto last = index + static_cast<int>(block->instructions().size()) - 1;
+        double weight = std::pow(10.0, std::min(depth[b], 6));
+
+        const auto& in = liveness.liveIn(block);
+        const auto& out = liveness.liveOut(block);
+
+        for (int v = 0; v < count; ++v) {
+            if (in[v]) {
+                extend(v, 2 * first);
+            }
+
+            if (out[v]) {
+                extend(v, 2 * last + 1);
+            }
+        }
+
+        for (const auto& instruction : block->instructions()) {
+            for (auto v : instruction.uses()) {
+                extend(v, 2 * index);
+                intervals[v].weight += weight;
+            }
+
+            if (instruction.def() >= 0) {
+                extend(instruction.def(), 2 * index + 1);
+                intervals[instruction.def()].weight += weight;
+            }
+
+            ++index;
+        }
+
+        // find what is live after each call
+        auto live = out;
+
+        for (auto i = block->instructions().rbegin(); i != block->instructions().rend(); ++i) {
+            if (i->def() >= 0) {
+                live[i->def()] = false;
+            }
+
+            if (isCall(*i)) {
+                auto& saved = saved_[&*i];
+
+                for (int v = 0; v < count; ++v) {
+                    if (live[v]) {
+                        saved.push_back(v);
+                    }
+                }
+            }
+
+            for (auto v : i->uses()) {
+                live[v] = true;
+            }
+        }
+    }
+
+    // scan the intervals by increasing start
+    std::vector<Interval> sorted;
+
+    for (const auto& interval : intervals) {
+        if (interval.end >= 0) {
+            sorted.push_back(interval);
+        }
+    }
+
+    std::sort(sorted.begin(), sorted.end(), [](const Interval& a, const Interval& b) {
+        return a.start < b.start || (a.start == b.start && a.reg < b.reg);
+    });
+
+    auto density = [](const Interval& i) {
+        return i.weight / (i.end - i.start + 1);
+    };
+
+    std::list<Interval> active;
+    std::vector<int> free;
+
+    for (auto r = static_cast<int>(registers_.size()) - 1; r >= 0; --r) {
+        free.push_back(r);
+    }
+
+    for (const auto& current : sorted) {
+        // release the registers of intervals that ended
+        for (auto it = active.begin(); it != active.end();) {
+            if (it->end < current.start) {
+                free.push_back(assignment_[it->reg]);
+                it = active.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        if (!free.empty()) {
+            assignment_[current.reg] = free.back();
+            free.pop_back();
+            active.push_back(current);
+            continue;
+        }
+
+        // spill whichever of the active intervals and the current one is used the least
+        auto victim = std::min_element(active.begin(), active.end(), [&density](const Interval& a, const Interval& b) {
+            return density(a) < density(b);
+        });
+
+        if (victim != active.end() && density(*victim) < density(current)) {
+            assignment_[current.reg] = assignment_[victim->reg];
+            assignment_[victim->reg] = -1;
+            active.erase(victim);
+            active.push_back(current);
+        }
+    }
+
+    // spilled registers live in their slot, saved ones only go there during calls; slots are numbered in the
+    // order of the calls, so that the same function always gets the same code
+    for (const auto& block : blocks) {
+        for (const auto& instruction : block->instructions()) {
+            auto it = saved_.find(&instruction);
+
+            if (it == saved_.end()) {
+                continue;
+            }
+
+            auto& saved = it->second;
+            saved.erase(std::remove_if(saved.begin(), saved.end(), [this](const int& v) {
+                return !inRegister(v);
+            }), saved.end());
+
+            for (auto v : saved) {
+                if (slots_[v] < 0) {
+                    slots_[v] = slotCount_++;
+                }
+            }
+        }
+    }
+
+    for (int v = 0; v < count; ++v) {
+        if (!inRegister(v) && slots_[v] < 0 && intervals[v].end >= 0) {
+            slots_[v] = slotCount_++;
+        }
+    }
+}
+
+bool LinearScanAllocator::inRegister(const int& reg) const
+{
+    return assignment_[reg] >= 0;
+}
+
+const std::string& LinearScanAllocator::location(const int& reg) const
+{
+    if (!inRegister(reg)) {
+        throw std::logic_error("LinearScanAllocator::location: Virtual register was spilled");
+    }
+
+    return registers_[assignment_[reg]];
+}
+
+int LinearScanAllocator::slot(const int& reg) const
+{
+    return slots_[reg];
+}
+
+int LinearScanAllocator::slotCount() const
+{
+    return slotCount_;
+}
+
+const std::vector<int>& LinearScanAllocator::savedAcross(const Instruction* instruction) const
+{
+    auto it = saved_.find(instruction);
+    return it != saved_.end() ? it->second : none_;
+}
+
+bool LinearScanAllocator::isCall(const Instruction& instruction)
+{
+    return instruction.op == Opcode::CALL || instruction.op == Opcode::READ || instruction.op == Opcode::WRITE;
+}
+
+}}
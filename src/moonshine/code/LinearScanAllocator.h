@@ -0,0 +1,53 @@
+#pragma once
+
+#include "moonshine/ir/Function.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace moonshine { namespace code {
+
+/**
+ * Assigns machine registers to the virtual registers of a function by linear scan over their live intervals.
+ *
+ * When more intervals are live than there are registers, the one with the lowest use density (weighted by
+ * loop depth) is spilled to a stack slot. Calls clobber every register, so registers live across a call are
+ * saved to a slot before it and restored after it.
+ */
+class LinearScanAllocator
+{
+public:
+    explicit LinearScanAllocator(const std::vector<std::string>& registers);
+
+    void allocate(const ir::Function& function);
+
+    bool inRegister(const int& reg) const;
+    const std::string& location(const int& reg) const;
+
+    // stack slot of a spilled or saved virtual register, numbered from 0
+    int slot(const int& reg) const;
+    int slotCount() const;
+
+    // virtual registers in machine registers which have to survive the given call
+    const std::vector<int>& savedAcross(const ir::Instruction* instruction) const;
+private:
+    struct Interval
+    {
+        int reg;
+        int start;
+        int end;
+        double weight;
+    };
+
+    std::vector<std::string> registers_;
+    std::vector<int> assignment_;
+    std::vector<int> slots_;
+    int slotCount_ = 0;
+    std::unordered_map<const ir::Instruction*, std::vector<int>> saved_;
+    std::vector<int> none_;
+
+    static bool isCall(const ir::Instruction& instruction);
+};
+
+}}
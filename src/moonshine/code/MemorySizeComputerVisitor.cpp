@@ -1,4 +1,5 @@
 #include "moonshine/code/MemorySizeComputerVisitor.h"
+#include "moonshine/code/TemporarySlotAllocator.h"
 
 #include "moonshine/lexer/TokenType.h"
 #include "moonshine/semantic/Type.h"
@@ -26,6 +27,10 @@ void MemorySizeComputerVisitor::visit(ast::prog* node)
         entry->second->setOffset(programEntry->size());
     }
 
+    // temporaries go after the named entries, sharing slots between statements
+    TemporarySlotAllocator temporaries(programTable);
+    programEntry->setSize(programEntry->size() + temporaries.allocate(node->child(2), programEntry->size()));
+
     programTable->setSize(programEntry->size());
 }
 
@@ -35,22 +40,23 @@ void MemorySizeComputerVisitor::visit(ast::varDecl* node)
 
     auto entry = node->symbolTableEntry();
     auto table = entry->parentTable();
-    auto type = dynamic_cast<VariableType*>(entry->type());
+    auto type = dynamic_cast<const VariableType*>(entry->type());
 
     int size = 0;
 
     if (type->type == Type::CLASS) {
         // ignore varDecl within classes, those are dealt with in the classList visitor
         if (!dynamic_cast<ast::membList*>(node->parent())) {
-            std::shared_ptr<SymbolTableEntry> classEntry = (*table)[type->className];
+            auto classEntry = (*table)[type->className];
             size = classEntry->size();
         }
     } else {
         size = getPrimitiveSize(type->type);
+    }
 
-        for (const auto& i : type->indices) {
-            size *= i;
-        }
+    // arrays hold one element per cell
+    for (const auto& i : type->indices) {
+        size *= i;
     }
 
     entry->setSize(size);
@@ -62,19 +68,19 @@ void MemorySizeComputerVisitor::visit(ast::fparam* node)
 
     auto entry = node->symbolTableEntry();
     auto table = entry->parentTable();
-    auto type = dynamic_cast<VariableType*>(entry->type());
+    auto type = dynamic_cast<const VariableType*>(entry->type());
 
     int size = 0;
 
     if (type->type == Type::CLASS) {
-        std::shared_ptr<SymbolTableEntry> classEntry = (*table)[type->className];
+        auto classEntry = (*table)[type->className];
         size = classEntry->size();
     } else {
         size = getPrimitiveSize(type->type);
+    }
 
-        for (const auto& i : type->indices) {
-            size *= i;
-        }
+    for (const auto& i : type->indices) {
+        size *= i;
     }
 
     entry->setSize(size);
@@ -94,7 +100,7 @@ void MemorySizeComputerVisitor::visit(ast::classList* node)
         bool done = true;
 
         for (auto it = table->begin(); it != table->end(); ++it) {
-            std::shared_ptr<SymbolTableEntry> classEntry = it->second;
+            auto classEntry = it->second;
 
             if (classEntry->kind() != SymbolTableEntryKind::CLASS) {
                 continue;
@@ -114,16 +120,22 @@ void MemorySizeComputerVisitor::visit(ast::classList* node)
                     continue;
                 }
 
-                auto type = dynamic_cast<VariableType*>(entry.second->type());
+                auto type = dynamic_cast<const VariableType*>(entry.second->type());
 
                 if (type->type != Type::CLASS) {
                     // for non-class members, we already have the size
                     size += entry.second->size();
                     entry.second->setOffset(size);
                 } else if (sizes.find(type->className) != sizes.end()) {
-                    // for class members, add the size if we already know it
-                    size += sizes[type->className];
-                    entry.second->setSize(sizes[type->className]);
+                    // for class members, add the size if we already know it, once per cell of arrays
+                    int memberSize = sizes[type->className];
+
+                    for (const auto& i : type->indices) {
+                        memberSize *= i;
+                    }
+
+                    size += memberSize;
+                    entry.second->setSize(memberSize);
                     entry.second->setOffset(size);
                 } else {
                     // this is an unprocessed entry
@@ -149,7 +161,7 @@ void MemorySizeComputerVisitor::visit(ast::classList* node)
     // calculate sizes of class entries w/ inheritance
 
     for (auto it = table->begin(); it != table->end(); ++it) {
-        std::shared_ptr<SymbolTableEntry> classEntry = it->second;
+        auto classEntry = it->second;
 
         if (classEntry->kind() != SymbolTableEntryKind::CLASS) {
             continue;
@@ -166,16 +178,16 @@ void MemorySizeComputerVisitor::visit(ast::funcDef* node)
     Visitor::visit(node);
 
     auto table = node->symbolTable();
-    auto type = dynamic_cast<FunctionType*>(node->symbolTableEntry()->type());
+    auto type = dynamic_cast<const FunctionType*>(node->symbolTableEntry()->type());
 
     // stack frame contains the return value at the bottom of the stack
     int returnSize = 0;
 
-    if (type->returnType.type == Type::CLASS) {
-        auto classEntry = (*table)[type->returnType.className];
+    if (type->returnType->type == Type::CLASS) {
+        auto classEntry = (*table)[type->returnType->className];
         returnSize = classEntry->size();
     } else {
-        returnSize = getPrimitiveSize(type->returnType.type);
+        returnSize = getPrimitiveSize(type->returnType->type);
     }
 
     table->setSize(table->size() + returnSize);
@@ -187,6 +199,9 @@ void MemorySizeComputerVisitor::visit(ast::funcDef* node)
         table->setSize(table->size() + entry->second->size());
         entry->second->setOffset(table->size());
     }
+
+    TemporarySlotAllocator temporaries(table);
+    table->setSize(table->size() + temporaries.allocate(node, table->size()));
 }
 
 void MemorySizeComputerVisitor::visit(ast::forStat* node)
@@ -195,19 +210,19 @@ void MemorySizeComputerVisitor::visit(ast::forStat* node)
 
     auto table = node->symbolTable();
     auto forVarDeclEntry = (*table)[dynamic_cast<ast::id*>(node->child(1))->token()->value];
-    auto type = dynamic_cast<VariableType*>(forVarDeclEntry->type());
+    auto type = dynamic_cast<const VariableType*>(forVarDeclEntry->type());
 
     int size = 0;
 
     if (type->type == Type::CLASS) {
-        std::shared_ptr<SymbolTableEntry> classEntry = (*table)[type->className];
+        auto classEntry = (*table)[type->className];
         size = classEntry->size();
     } else {
         size = getPrimitiveSize(type->type);
+    }
 
-        for (const auto& i : type->indices) {
-            size *= i;
-        }
+    for (const auto& i : type->indices) {
+        size *= i;
     }
 
     forVarDeclEntry->setSize(size);
@@ -217,6 +232,9 @@ void MemorySizeComputerVisitor::visit(ast::forStat* node)
         entry->second->setOffset(table->size());
     }
 
+    TemporarySlotAllocator temporaries(table);
+    table->setSize(table->size() + temporaries.allocate(node, table->size()));
+
     node->symbolTableEntry()->setSize(table->size());
 }
 
@@ -243,7 +261,25 @@ void MemorySizeComputerVisitor::visit(ast::relOp* node)
     Visitor::visit(node);
 
     if (node->symbolTableEntry()) {
-        node->symbolTableEntry()->setSize(getPrimitiveSize(dynamic_cast<VariableType*>(node->symbolTableEntry()->type())->type));
+        node->symbolTableEntry()->setSize(getPrimitiveSize(dynamic_cast<const VariableType*>(node->symbolTableEntry()->type())->type));
+    }
+}
+
+void MemorySizeComputerVisitor::visit(ast::sign* node)
+{
+    Visitor::visit(node);
+
+    if (node->symbolTableEntry()) {
+        node->symbolTableEntry()->setSize(getPrimitiveSize(node->type()->type));
+    }
+}
+
+void MemorySizeComputerVisitor::visit(ast::notFactor* node)
+{
+    Visitor::visit(node);
+
+    if (node->symbolTableEntry()) {
+        node->symbolTableEntry()->setSize(getPrimitiveSize(Type::INT));
     }
 }
 
@@ -290,7 +326,7 @@ void MemorySizeComputerVisitor::visit(ast::aParams* node)
     }
 
     auto table = node->closestSymbolTable();
-    auto type = dynamic_cast<VariableType*>(node->symbolTableEntry()->type());
+    auto type = dynamic_cast<const VariableType*>(node->symbolTableEntry()->type());
 
     int returnSize = 0;
 
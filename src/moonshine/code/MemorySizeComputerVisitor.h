@@ -18,6 +18,8 @@ public:
     void visit(ast::addOp* node) override;
     void visit(ast::multOp* node) override;
     void visit(ast::relOp* node) override;
+    void visit(ast::sign* node) override;
+    void visit(ast::notFactor* node) override;
     void visit(ast::num* node) override;
     void visit(ast::var* node) override;
     void visit(ast::aParams* node) override;
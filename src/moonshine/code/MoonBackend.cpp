@@ -0,0 +1,480 @@
+#include "moonshine/code/MoonBackend.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+namespace moonshine { namespace code {
+
+using namespace ir;
+
+MoonBackend::MoonBackend(MoonCode& code)
+    : code_(code), allocator_({"r4", "r5", "r6", "r7", "r8", "r9", "r10", "r11", "r12"})
+{
+}
+
+void MoonBackend::emit(const Program& program)
+{
+    for (const auto& function : program.functions()) {
+        emit(*function);
+    }
+
+    emitData();
+}
+
+void MoonBackend::emitData()
+{
+    auto& data = code_.data();
+
+    data.push_back(MoonInstruction::makeComment("% buffer space used for console output"));
+    data.emplace_back("res", std::vector<std::string>{"20"});
+    data.back().label = "buf";
+    data.emplace_back("db", std::vector<std::string>{"13", "10", "0"});
+    data.back().label = "cr";
+}
+
+void MoonBackend::emit(const Function& function)
+{
+    function_ = &function;
+    allocate(function);
+
+    if (function.isProgram()) {
+        text("entry", {});
+        text("addi", {SP, ZR, "topaddr"});
+        comment("%% program body begin");
+    } else {
+        // copy the jumping-back address value in the function's stack frame
+        label(function.label(), "% funcDef: " + function.label());
+        access("sw", JL, function.returnAddressOffset(), SP);
+        comment("%% function body begin");
+    }
+
+    const auto& blocks = function.blocks();
+
+    for (auto it = blocks.begin(); it != blocks.end(); ++it) {
+        const BasicBlock* next = it + 1 != blocks.end() ? (it + 1)->get() : nullptr;
+
+        if (it != blocks.begin()) {
+            label((*it)->label(), "% " + (*it)->label());
+        }
+
+        for (const auto& instruction : (*it)->instructions()) {
+            emit(instruction, next);
+        }
+    }
+
+    comment(function.isProgram() ? "%% program body end" : "%% function body end");
+}
+
+void MoonBackend::emit(const Instruction& i, const BasicBlock* next)
+{
+    if (!i.comment.empty()) {
+        comment("% " + i.comment);
+    }
+
+    switch (i.op) {
+        case Opcode::ADD:
+        case Opcode::SUB:
+        case Opcode::MUL:
+        case Opcode::DIV:
+        case Opcode::AND:
+        case Opcode::OR:
+        case Opcode::CEQ:
+        case Opcode::CNE:
+        case Opcode::CLT:
+        case Opcode::CLE:
+        case Opcode::CGT:
+        case Opcode::CGE: {
+            auto a = i.a;
+            auto b = i.b;
+
+            // only the right hand side can be an immediate
+            if (a.isImmediate() && b.isRegister() && isCommutative(i.op)) {
+                std::swap(a, b);
+            }
+
+            auto ra = use(a, "r1");
+            auto rd = def(i.dst, "r3");
+
+            if (b.isImmediate() && MoonInstruction::fitsImmediate(b.value)) {
+                text(std::string(mnemonic(i.op)) + 'i', {rd, ra, std::to_string(b.value)});
+            } else {
+                auto rb = use(b, "r2");
+                text(mnemonic(i.op), {rd, ra, rb});
+            }
+
+            commit(i.dst, rd);
+            break;
+        }
+        case Opcode::NOT: {
+            auto ra = use(i.a, "r1");
+            auto rd = def(i.dst, "r3");
+            text("not", {rd, ra});
+            commit(i.dst, rd);
+            break;
+        }
+        case Opcode::MOVE: {
+            auto rd = def(i.dst, "r3");
+
+            if (i.a.isImmediate()) {
+                load(rd, i.a.value);
+            } else {
+                auto ra = use(i.a, "r1");
+                text("add", {rd, ra, ZR});
+            }
+
+            commit(i.dst, rd);
+            break;
+        }
+        case Opcode::ADDRESS: {
+            int offset = 0;
+            auto base = address(i.address, "r2", offset);
+            auto rd = def(i.dst, "r3");
+
+            if (MoonInstruction::fitsImmediate(offset)) {
+                text("addi", {rd, base, std::to_string(offset)});
+            } else if (rd == base) {
+                step(rd, offset);
+            } else {
+                load(rd, offset);
+                text("add", {rd, rd, base});
+            }
+
+            commit(i.dst, rd);
+            break;
+        }
+        case Opcode::LOAD: {
+            int offset = 0;
+            auto base = address(i.address, "r2", offset);
+            auto rd = def(i.dst, "r3");
+            access("lw", rd, offset, base);
+            commit(i.dst, rd);
+            break;
+        }
+        case Opcode::STORE: {
+            int offset = 0;
+            auto ra = use(i.a, "r1");
+            auto base = address(i.address, "r2", offset);
+
+            // the base may have to move to reach the address, so it can't also be the value
+            if (ra == base && !MoonInstruction::fitsImmediate(offset)) {
+                text("add", {"r1", ra, ZR});
+                ra = "r1";
+            }
+
+            access("sw", ra, offset, base);
+            break;
+        }
+        case Opcode::PARAM: {
+            // parameters are taken out of the argument registers before anything else uses them
+            const auto& arg = ARGS.at(i.a.value);
+            auto rd = def(i.dst, arg);
+            if (rd != arg) {
+                text("add", {rd, arg, ZR});
+            }
+            commit(i.dst, rd);
+            break;
+        }
+        case Opcode::CALL: {
+            save(i);
+
+            if (i.arguments.size() > ARGS.size()) {
+                throw std::logic_error("MoonBackend::emit: Too many arguments passed in registers");
+            }
+
+            // each argument only goes through its own register, so they can't overwrite each other
+            for (std::size_t k = 0; k < i.arguments.size(); ++k) {
+                auto ra = use(i.arguments[k], ARGS[k]);
+                if (ra != ARGS[k]) {
+                    text("add", {ARGS[k], ra, ZR});
+                }
+            }
+
+            // make the stack frame pointer point to the called function's stack frame and back
+            step(SP, -frameSize_);
+            text("jl", {JL, i.callee});
+            step(SP, frameSize_);
+
+            restore(i);
+
+            if (i.dst.isRegister()) {
+                auto rd = def(i.dst, RV);
+                if (rd != RV) {
+                    text("add", {rd, RV, ZR});
+                }
+                commit(i.dst, rd);
+            }
+            break;
+        }
+        case Opcode::READ: {
+            save(i);
+
+            step(SP, -frameSize_);
+
+            // read into the buffer, then convert it to an int in r13
+            text("addi", {"r1", ZR, "buf"});
+            text("sw", {MoonInstruction::memory(-8, SP), "r1"});
+            text("jl", {JL, "getstr"});
+            text("jl", {JL, "strint"});
+
+            step(SP, frameSize_);
+
+            restore(i);
+
+            auto rd = def(i.dst, RV);
+            if (rd != RV) {
+                text("add", {rd, RV, ZR});
+            }
+            commit(i.dst, rd);
+            break;
+        }
+        case Opcode::WRITE: {
+            save(i);
+
+            auto ra = use(i.a, "r1");
+
+            step(SP, -frameSize_);
+
+            // convert the int to a string in the buffer, print it and a newline
+            text("sw", {MoonInstruction::memory(-8, SP), ra});
+            text("addi", {"r1", ZR, "buf"});
+            text("sw", {MoonInstruction::memory(-12, SP), "r1"});
+            text("jl", {JL, "intstr"});
+            text("sw", {MoonInstruction::memory(-8, SP), RV});
+            text("jl", {JL, "putstr"});
+            text("addi", {"r1", ZR, "cr"});
+            text("sw", {MoonInstruction::memory(-8, SP), "r1"});
+            text("jl", {JL, "putstr"});
+
+            step(SP, frameSize_);
+
+            restore(i);
+            break;
+        }
+        case Opcode::JUMP:
+            if (i.targets[0] != next) {
+                text("j", {i.targets[0]->label()});
+            }
+            break;
+        case Opcode::BRANCH: {
+            auto ra = use(i.a, "r1");
+
+            if (i.targets[1] == next) {
+                text("bnz", {ra, i.targets[0]->label()});
+            } else if (i.targets[0] == next) {
+                text("bz", {ra, i.targets[1]->label()});
+            } else {
+                text("bnz", {ra, i.targets[0]->label()});
+                text("j", {i.targets[1]->label()});
+            }
+            break;
+        }
+        case Opcode::RETURN:
+            if (!i.a.isNone()) {
+                auto ra = use(i.a, RV);
+                if (ra != RV) {
+                    text("add", {RV, ra, ZR});
+                }
+            }
+
+            // copy back the jumping-back address into r15 and jump back to the calling function
+            access("lw", JL, function_->returnAddressOffset(), SP);
+            text("jr", {JL});
+            break;
+        case Opcode::HALT:
+            text("hlt", {});
+            break;
+        case Opcode::TAILCALL:
+            // the called function reuses this frame and returns to our caller with its jumping-back address
+            access("lw", JL, function_->returnAddressOffset(), SP);
+            text("j", {i.callee});
+            break;
+    }
+}
+
+void MoonBackend::allocate(const Function& function)
+{
+    allocator_.allocate(function);
+
+    // spill slots go right after the symbol table frame
+    frameSize_ = function.frameSize() + 4 * allocator_.slotCount();
+}
+
+int MoonBackend::slotOffset(const int& reg) const
+{
+    return -(function_->frameSize() + 4 * (allocator_.slot(reg) + 1));
+}
+
+void MoonBackend::save(const Instruction& instruction)
+{
+    for (auto v : allocator_.savedAcross(&instruction)) {
+        access("sw", allocator_.location(v), slotOffset(v), SP);
+    }
+}
+
+void MoonBackend::restore(const Instruction& instruction)
+{
+    for (auto v : allocator_.savedAcross(&instruction)) {
+        access("lw", allocator_.location(v), slotOffset(v), SP);
+    }
+}
+
+std::string MoonBackend::use(const Operand& operand, const std::string& scratch)
+{
+    if (operand.isImmediate()) {
+        if (operand.value == 0) {
+            return ZR;
+        }
+
+        load(scratch, operand.value);
+        return scratch;
+    }
+
+    if (!operand.isRegister()) {
+        throw std::logic_error("MoonBackend::use: Operand has no value");
+    }
+
+    if (allocator_.inRegister(operand.value)) {
+        return allocator_.location(operand.value);
+    }
+
+    access("lw", scratch, slotOffset(operand.value), SP);
+    return scratch;
+}
+
+std::string MoonBackend::def(const Operand& operand, const std::string& scratch)
+{
+    if (!operand.isRegister()) {
+        throw std::logic_error("MoonBackend::def: Operand is not a register");
+    }
+
+    return allocator_.inRegister(operand.value) ? allocator_.location(operand.value) : scratch;
+}
+
+void MoonBackend::commit(const Operand& operand, const std::string& reg)
+{
+    if (!allocator_.inRegister(operand.value)) {
+        access("sw", reg, slotOffset(operand.value), SP);
+    }
+}
+
+std::string MoonBackend::address(const Address& address, const std::string& scratch, int& offset)
+{
+    switch (address.base) {
+        case Address::Base::FRAME:
+            offset = address.offset;
+            return SP;
+        case Address::Base::OUTGOING:
+            offset = address.offset - frameSize_;
+            return SP;
+        case Address::Base::REGISTER:
+            offset = address.offset;
+            return use(Operand::reg(address.reg), scratch);
+    }
+
+    throw std::logic_error("MoonBackend::address: Invalid address base");
+}
+
+void MoonBackend::load(const std::string& reg, const int& value)
+{
+    if (MoonInstruction::fitsImmediate(value)) {
+        text("addi", {reg, ZR, std::to_string(value)});
+        return;
+    }
+
+    // the upper half shifted into place, plus the lower half; both are signed and the arithmetic wraps
+    auto low = static_cast<std::int16_t>(value & 0xffff);
+    auto high = static_cast<std::int16_t>((static_cast<std::int64_t>(value) - low) >> 16);
+
+    text("addi", {reg, ZR, std::to_string(high)});
+    text("sl", {reg, reg, "16"});
+
+    if (low != 0) {
+        text("addi", {reg, reg, std::to_string(low)});
+    }
+}
+
+void MoonBackend::step(const std::string& reg, int delta)
+{
+    do {
+        auto k = std::max(-32768, std::min(32767, delta));
+        text("addi", {reg, reg, std::to_string(k)});
+        delta -= k;
+    } while (delta != 0);
+}
+
+void MoonBackend::access(const std::string& op, const std::string& reg, const int& offset, const std::string& base)
+{
+    if (MoonInstruction::fitsImmediate(offset)) {
+        text(op, op == "sw" ? std::vector<std::string>{MoonInstruction::memory(offset, base), reg}
+                            : std::vector<std::string>{reg, MoonInstruction::memory(offset, base)});
+        return;
+    }
+
+    if (base == ZR || (op == "sw" && reg == base)) {
+        throw std::logic_error("MoonBackend::access: Offset out of range for base " + base);
+    }
+
+    // move the base as close as we can and back, unless what we load replaces it anyway
+    auto near = offset < 0 ? -32768 : 32767;
+    step(base, offset - near);
+    access(op, reg, near, base);
+
+    if (op == "sw" || reg != base) {
+        step(base, near - offset);
+    }
+}
+
+const char* MoonBackend::mnemonic(const Opcode& op)
+{
+    switch (op) {
+        case Opcode::ADD: return "add";
+        case Opcode::SUB: return "sub";
+        case Opcode::MUL: return "mul";
+        case Opcode::DIV: return "div";
+        case Opcode::AND: return "and";
+        case Opcode::OR: return "or";
+        case Opcode::CEQ: return "ceq";
+        case Opcode::CNE: return "cne";
+        case Opcode::CLT: return "clt";
+        case Opcode::CLE: return "cle";
+        case Opcode::CGT: return "cgt";
+        case Opcode::CGE: return "cge";
+        default:
+            throw std::logic_error("MoonBackend::mnemonic: Not a binary operation");
+    }
+}
+
+bool MoonBackend::isCommutative(const Opcode& op)
+{
+    switch (op) {
+        case Opcode::ADD:
+        case Opcode::MUL:
+        case Opcode::AND:
+        case Opcode::OR:
+        case Opcode::CEQ:
+        case Opcode::CNE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void MoonBackend::text(const std::string& op, const std::vector<std::string>& operands)
+{
+    code_.text().emplace_back(op, operands);
+}
+
+void MoonBackend::label(const std::string& label, const std::string& comment)
+{
+    code_.text().push_back(MoonInstruction::makeComment(comment));
+    code_.text().back().label = label;
+}
+
+void MoonBackend::comment(const std::string& comment)
+{
+    code_.text().push_back(MoonInstruction::makeComment(comment));
+}
+
+}}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "moonshine/ir/Program.h"
+#include "moonshine/code/LinearScanAllocator.h"
+#include "moonshine/code/MoonCode.h"
+
+#include <string>
+#include <vector>
+
+namespace moonshine { namespace code {
+
+/**
+ * Generates Moon assembly from three-address code.
+ *
+ * Virtual registers are assigned to r4-r12 by a LinearScanAllocator. Spilled ones get a slot in a spill area
+ * placed below the function's symbol table frame and go through the scratch registers r1-r3. Calls move the
+ * stack frame pointer past the spill area. Arguments passed in registers (see RegisterCallingConvention) go in
+ * r1-r3 right before the call, and results passed in registers come back in r13.
+ *
+ * Values and offsets that don't fit the 16 bit K field of an instruction are built up in a register, or
+ * reached by moving the base register there and back, since the scratch registers may all hold arguments.
+ */
+class MoonBackend
+{
+public:
+    explicit MoonBackend(MoonCode& code);
+
+    void emit(const ir::Program& program);
+
+    // one function at a time, then the data every function shares
+    void emit(const ir::Function& function);
+    void emitData();
+private:
+    const std::string ZR = "r0";
+    const std::string RV = "r13";
+    const std::string SP = "r14";
+    const std::string JL = "r15";
+
+    // registers holding arguments passed in registers, the result comes back in RV
+    const std::vector<std::string> ARGS = {"r1", "r2", "r3"};
+
+    MoonCode& code_;
+
+    LinearScanAllocator allocator_;
+
+    // per function state
+    const ir::Function* function_ = nullptr;
+    int frameSize_ = 0;
+
+    void emit(const ir::Instruction& instruction, const ir::BasicBlock* next);
+
+    void allocate(const ir::Function& function);
+    int slotOffset(const int& reg) const;
+    void save(const ir::Instruction& instruction);
+    void restore(const ir::Instruction& instruction);
+
+    // operands and addresses
+    std::string use(const ir::Operand& operand, const std::string& scratch);
+    std::string def(const ir::Operand& operand, const std::string& scratch);
+    void commit(const ir::Operand& operand, const std::string& reg);
+    std::string address(const ir::Address& address, const std::string& scratch, int& offset);
+
+    // whatever the size of the value, offset or step
+    void load(const std::string& reg, const int& value);
+    void step(const std::string& reg, int delta);
+    void access(const std::string& op, const std::string& reg, const int& offset, const std::string& base);
+
+    static const char* mnemonic(const ir::Opcode& op);
+    static bool isCommutative(const ir::Opcode& op);
+
+    void text(const std::string& op, const std::vector<std::string>& operands);
+    void label(const std::string& label, const std::string& comment);
+    void comment(const std::string& comment);
+};
+
+}}
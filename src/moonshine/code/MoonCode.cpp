@@ -0,0 +1,407 @@
+#include "moonshine/code/MoonCode.h"
+
+#include <cctype>
+#include <iomanip>
+#include <unordered_map>
+
+namespace moonshine { namespace code {
+
+namespace {
+
+enum class Format
+{
+    NONE,       // hlt
+    R,          // add r1,r2,r3
+    I,          // addi r1,r2,K
+    RR,         // not r1,r2 / jlr r1,r2
+    LOAD,       // lw r1,K(r2)
+    STORE,      // sw K(r2),r1
+    READ,       // jr r1 / putc r1
+    WRITE,      // getc r1
+    BRANCH,     // bz r1,K
+    LINK,       // jl r1,K
+    K,          // j K
+};
+
+const std::unordered_map<std::string, Format>& formats()
+{
+    static const std::unordered_map<std::string, Format> table = {
+        {"add", Format::R}, {"sub", Format::R}, {"mul", Format::R}, {"div", Format::R}, {"mod", Format::R},
+        {"and", Format::R}, {"or", Format::R}, {"ceq", Format::R}, {"cne", Format::R}, {"clt", Format::R},
+        {"cle", Format::R}, {"cgt", Format::R}, {"cge", Format::R},
+        {"addi", Format::I}, {"subi", Format::I}, {"muli", Format::I}, {"divi", Format::I}, {"modi", Format::I},
+        {"andi", Format::I}, {"ori", Format::I}, {"ceqi", Format::I}, {"cnei", Format::I}, {"clti", Format::I},
+        {"clei", Format::I}, {"cgti", Format::I}, {"cgei", Format::I}, {"sl", Format::I}, {"sr", Format::I},
+        {"not", Format::RR}, {"jlr", Format::RR},
+        {"lw", Format::LOAD}, {"lb", Format::LOAD},
+        {"sw", Format::STORE}, {"sb", Format::STORE},
+        {"jr", Format::READ}, {"putc", Format::READ},
+        {"getc", Format::WRITE},
+        {"bz", Format::BRANCH}, {"bnz", Format::BRANCH},
+        {"jl", Format::LINK},
+        {"j", Format::K},
+        {"nop", Format::NONE}, {"hlt", Format::NONE},
+    };
+
+    return table;
+}
+
+bool isDirectiveWord(const std::string& word)
+{
+    return word == "entry" || word == "align" || word == "org" || word == "dw" || word == "db" || word == "res";
+}
+
+std::string trim(const std::string& s)
+{
+    auto b = s.find_first_not_of(" \t\r");
+
+    if (b == std::string::npos) {
+        return "";
+    }
+
+    return s.substr(b, s.find_last_not_of(" \t\r") - b + 1);
+}
+
+const int labelWidth = 15;
+
+}
+
+MoonInstruction::MoonInstruction(const std::string& op, const std::vector<std::string>& operands)
+    : op(op), operands(operands)
+{
+}
+
+MoonInstruction MoonInstruction::makeComment(const std::string& comment)
+{
+    MoonInstruction i;
+    i.comment = comment;
+    return i;
+}
+
+bool MoonInstruction::isComment() const
+{
+    return op.empty() && label.empty();
+}
+
+bool MoonInstruction::isDirective() const
+{
+    return isDirectiveWord(op);
+}
+
+std::vector<std::string> MoonInstruction::reads() const
+{
+    auto format = formats().find(op);
+
+    if (format == formats().end() || operands.empty()) {
+        return {};
+    }
+
+    int offset;
+    std::string base;
+
+    switch (format->second) {
+        case Format::R:
+            return {operands[1], operands[2]};
+        case Format::I:
+        case Format::RR:
+            return {operands[1]};
+        case Format::LOAD:
+            return parseMemory(operands[1], offset, base) ? std::vector<std::string>{base} : std::vector<std::string>{};
+        case Format::STORE:
+            return parseMemory(operands[0], offset, base) ? std::vector<std::string>{base, operands[1]} : std::vector<std::string>{operands[1]};
+        case Format::READ:
+        case Format::BRANCH:
+            return {operands[0]};
+        default:
+            return {};
+    }
+}
+
+std::vector<std::string> MoonInstruction::writes() const
+{
+    auto format = formats().find(op);
+
+    if (format == formats().end() || operands.empty()) {
+        return {};
+    }
+
+    switch (format->second) {
+        case Format::R:
+        case Format::I:
+        case Format::RR:
+        case Format::LOAD:
+        case Format::WRITE:
+        case Format::LINK:
+            return {operands[0]};
+        default:
+            return {};
+    }
+}
+
+bool MoonInstruction::replaceReads(const std::string& from, const std::string& to)
+{
+    auto format = formats().find(op);
+
+    if (format == formats().end() || operands.empty()) {
+        return false;
+    }
+
+    bool replaced = false;
+
+    auto replace = [&from, &to, &replaced](std::string& operand) {
+        if (operand == from) {
+            operand = to;
+            replaced = true;
+        }
+    };
+
+    auto replaceBase = [&from, &to, &replaced](std::string& operand) {
+        auto open = operand.find('(');
+
+        if (open != std::string::npos && operand.back() == ')' && operand.substr(open + 1, operand.size() - open - 2) == from) {
+            operand = operand.substr(0, open + 1) + to + ')';
+            replaced = true;
+        }
+    };
+
+    switch (format->second) {
+        case Format::R:
+            replace(operands[1]);
+            replace(operands[2]);
+            break;
+        case Format::I:
+        case Format::RR:
+            replace(operands[1]);
+            break;
+        case Format::LOAD:
+            replaceBase(operands[1]);
+            break;
+        case Format::STORE:
+            replaceBase(operands[0]);
+            replace(operands[1]);
+            break;
+        case Format::READ:
+        case Format::BRANCH:
+            replace(operands[0]);
+            break;
+        default:
+            break;
+    }
+
+    return replaced;
+}
+
+bool MoonInstruction::isControl() const
+{
+    return op == "j" || op == "jl" || op == "jr" || op == "jlr" || op == "bz" || op == "bnz" || op == "hlt";
+}
+
+void MoonInstruction::print(std::ostream& s) const
+{
+    if (label.empty()) {
+        s << std::string(labelWidth, ' ');
+    } else {
+        s << std::left << std::setw(labelWidth) << (' ' + label + ' ');
+    }
+
+    if (!op.empty()) {
+        s << op;
+
+        for (std::vector<std::string>::size_type i = 0; i < operands.size(); ++i) {
+            s << (i == 0 ? ' ' : ',') << operands[i];
+        }
+
+        if (!comment.empty()) {
+            s << ' ';
+        }
+    }
+
+    s << comment << std::endl;
+}
+
+MoonInstruction MoonInstruction::parse(const std::string& line)
+{
+    MoonInstruction instruction;
+
+    // everything after a % that isn't in a string is a comment
+    std::string code;
+    bool quoted = false;
+
+    for (std::string::size_type i = 0; i < line.size(); ++i) {
+        if (line[i] == '"') {
+            quoted = !quoted;
+        } else if (line[i] == '%' && !quoted) {
+            instruction.comment = trim(line.substr(i));
+            break;
+        }
+
+        code += line[i];
+    }
+
+    std::string::size_type pos = 0;
+
+    auto word = [&code, &pos]() {
+        while (pos < code.size() && std::isspace(static_cast<unsigned char>(code[pos]))) {
+            ++pos;
+        }
+
+        auto begin = pos;
+
+        while (pos < code.size() && !std::isspace(static_cast<unsigned char>(code[pos]))) {
+            ++pos;
+        }
+
+        return code.substr(begin, pos - begin);
+    };
+
+    // a line may start with a label, which is anything that isn't an instruction
+    auto first = word();
+
+    if (first.empty()) {
+        return instruction;
+    }
+
+    if (isMnemonic(first)) {
+        instruction.op = first;
+    } else {
+        instruction.label = first;
+        instruction.op = word();
+    }
+
+    auto rest = trim(code.substr(pos));
+    std::string operand;
+    quoted = false;
+
+    for (auto c : rest) {
+        if (c == '"') {
+            quoted = !quoted;
+        }
+
+        if (c == ',' && !quoted) {
+            instruction.operands.push_back(trim(operand));
+            operand.clear();
+        } else {
+            operand += c;
+        }
+    }
+
+    if (!rest.empty()) {
+        instruction.operands.push_back(trim(operand));
+    }
+
+    return instruction;
+}
+
+bool MoonInstruction::isMnemonic(const std::string& word)
+{
+    return formats().count(word) || isDirectiveWord(word);
+}
+
+bool MoonInstruction::isRegister(const std::string& operand)
+{
+    if (operand.size() < 2 || operand.size() > 3 || operand[0] != 'r') {
+        return false;
+    }
+
+    for (std::string::size_type i = 1; i < operand.size(); ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(operand[i]))) {
+            return false;
+        }
+    }
+
+    return std::stoi(operand.substr(1)) < 16;
+}
+
+bool MoonInstruction::parseMemory(const std::string& operand, int& offset, std::string& base)
+{
+    auto open = operand.find('(');
+
+    if (open == std::string::npos || operand.back() != ')') {
+        return false;
+    }
+
+    base = operand.substr(open + 1, operand.size() - open - 2);
+    return isRegister(base) && parseInt(operand.substr(0, open), offset);
+}
+
+std::string MoonInstruction::memory(const int& offset, const std::string& base)
+{
+    return std::to_string(offset) + '(' + base + ')';
+}
+
+bool MoonInstruction::parseInt(const std::string& operand, int& value)
+{
+    if (operand.empty()) {
+        return false;
+    }
+
+    std::string::size_type i = operand[0] == '-' || operand[0] == '+' ? 1 : 0;
+
+    if (i == operand.size()) {
+        return false;
+    }
+
+    for (; i < operand.size(); ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(operand[i]))) {
+            return false;
+        }
+    }
+
+    value = std::stoi(operand);
+    return true;
+}
+
+bool MoonInstruction::fitsImmediate(const long long& value)
+{
+    return value >= -32768 && value <= 32767;
+}
+
+std::vector<MoonInstruction>& MoonCode::text()
+{
+    return text_;
+}
+
+const std::vector<MoonInstruction>& MoonCode::text() const
+{
+    return text_;
+}
+
+std::vector<MoonInstruction>& MoonCode::data()
+{
+    return data_;
+}
+
+const std::vector<MoonInstruction>& MoonCode::data() const
+{
+    return data_;
+}
+
+void MoonCode::printText(std::ostream& s) const
+{
+    for (const auto& instruction : text_) {
+        instruction.print(s);
+    }
+}
+
+void MoonCode::printData(std::ostream& s) const
+{
+    for (const auto& instruction : data_) {
+        instruction.print(s);
+    }
+}
+
+MoonCode MoonCode::parse(std::istream& s)
+{
+    MoonCode code;
+    std::string line;
+
+    while (std::getline(s, line)) {
+        if (!trim(line).empty()) {
+            code.text_.push_back(MoonInstruction::parse(line));
+        }
+    }
+
+    return code;
+}
+
+}}
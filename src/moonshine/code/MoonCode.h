@@ -0,0 +1,83 @@
+#pragma once
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace moonshine { namespace code {
+
+/**
+ * One line of Moon assembly: an optional label, an instruction or directive with its operands, and an
+ * optional comment. Lines with neither an instruction nor a label only carry a comment.
+ *
+ * Operands are kept as written ("r1", "-8(r14)", "topaddr"), with helpers to look into them.
+ */
+struct MoonInstruction
+{
+    std::string label;
+    std::string op;
+    std::vector<std::string> operands;
+
+    // including the leading %
+    std::string comment;
+
+    MoonInstruction() = default;
+    MoonInstruction(const std::string& op, const std::vector<std::string>& operands);
+
+    static MoonInstruction makeComment(const std::string& comment);
+
+    bool isComment() const;
+    bool isDirective() const;
+
+    // registers this instruction reads and writes
+    std::vector<std::string> reads() const;
+    std::vector<std::string> writes() const;
+
+    // renames a register everywhere this instruction reads it; true if it did
+    bool replaceReads(const std::string& from, const std::string& to);
+
+    // whether control may leave this instruction other than by falling through to the next one
+    bool isControl() const;
+
+    void print(std::ostream& s) const;
+
+    static MoonInstruction parse(const std::string& line);
+    static bool isMnemonic(const std::string& word);
+
+    // "r3" -> true
+    static bool isRegister(const std::string& operand);
+
+    // "-8(r14)" -> -8, "r14"; false for symbolic offsets
+    static bool parseMemory(const std::string& operand, int& offset, std::string& base);
+    static std::string memory(const int& offset, const std::string& base);
+
+    // "-8" -> -8; false for symbols
+    static bool parseInt(const std::string& operand, int& value);
+
+    // whether a value fits the K field of an instruction, which is 16 bit signed
+    static bool fitsImmediate(const long long& value);
+};
+
+/**
+ * The text and data sections of a Moon program as lists of instructions.
+ */
+class MoonCode
+{
+public:
+    std::vector<MoonInstruction>& text();
+    const std::vector<MoonInstruction>& text() const;
+    std::vector<MoonInstruction>& data();
+    const std::vector<MoonInstruction>& data() const;
+
+    void printText(std::ostream& s) const;
+    void printData(std::ostream& s) const;
+
+    // reads assembly text (the text section of the result), skipping blank lines
+    static MoonCode parse(std::istream& s);
+private:
+    std::vector<MoonInstruction> text_;
+    std::vector<MoonInstruction> data_;
+};
+
+}}
@@ -0,0 +1,513 @@
+#include "moonshine/code/PeepholeOptimizer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <utility>
+
+namespace moonshine { namespace code {
+
+PeepholeOptimizer::PeepholeOptimizer(const unsigned int& window)
+    : window_(window)
+{
+    for (const auto& rule : {"self move", "jump to next", "redundant load", "redundant store", "stack adjustment",
+                             "copy propagation", "immediate chain", "immediate fold", "dead definition"}) {
+        hits_[rule] = 0;
+    }
+}
+
+void PeepholeOptimizer::optimize(MoonCode& code)
+{
+    if (window_ == 0) {
+        return;
+    }
+
+    while (pass(code.text())) {
+    }
+}
+
+unsigned int PeepholeOptimizer::window() const
+{
+    return window_;
+}
+
+const std::map<std::string, unsigned int>& PeepholeOptimizer::hits() const
+{
+    return hits_;
+}
+
+void PeepholeOptimizer::printHits(std::ostream& s) const
+{
+    for (const auto& rule : hits_) {
+        s << std::left << std::setw(20) << rule.first << rule.second << std::endl;
+    }
+}
+
+bool PeepholeOptimizer::pass(Instructions& text)
+{
+    bool changed = false;
+    removed_.assign(text.size(), false);
+
+    for (Index i = 0; i < text.size(); ++i) {
+        if (removed_[i] || text[i].operands.empty() || text[i].isDirective()) {
+            continue;
+        }
+
+        // one rewrite per instruction and pass, the next pass picks up what it enables
+        if (selfMove(text, i) || jumpToNext(text, i) || redundantMemory(text, i) || stackAdjustment(text, i) || forward(text, i)) {
+            changed = true;
+        }
+    }
+
+    Index kept = 0;
+
+    for (Index i = 0; i < text.size(); ++i) {
+        if (!removed_[i]) {
+            if (kept != i) {
+                text[kept] = std::move(text[i]);
+            }
+
+            ++kept;
+        }
+    }
+
+    text.resize(kept);
+
+    return changed;
+}
+
+/*
+ * add rX,rX,r0 / addi rX,rX,0
+ */
+bool PeepholeOptimizer::selfMove(Instructions& text, const Index& i)
+{
+    const auto& in = text[i];
+    int value;
+
+    bool self = ((in.op == "add" || in.op == "sub") && in.operands[0] == in.operands[1] && in.operands[2] == ZR)
+                || (in.op == "add" && in.operands[0] == in.operands[2] && in.operands[1] == ZR)
+                || ((in.op == "addi" || in.op == "subi") && in.operands[0] == in.operands[1]
+                    && MoonInstruction::parseInt(in.operands[2], value) && value == 0);
+
+    if (!self) {
+        return false;
+    }
+
+    remove(text, i);
+    hit("self move");
+    return true;
+}
+
+/*
+ * j L / bz rX,L / bnz rX,L where L labels the next instruction
+ */
+bool PeepholeOptimizer::jumpToNext(Instructions& text, const Index& i)
+{
+    const auto& in = text[i];
+
+    if (in.op != "j" && in.op != "bz" && in.op != "bnz") {
+        return false;
+    }
+
+    const auto& target = in.operands.back();
+
+    for (Index j = i + 1; j < text.size(); ++j) {
+        if (removed_[j] || text[j].isComment()) {
+            continue;
+        }
+
+        if (text[j].label == target) {
+            remove(text, i);
+            hit("jump to next");
+            return true;
+        }
+
+        // a run of labels all name the same instruction
+        if (text[j].label.empty() || !text[j].op.empty()) {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * sw K(rB),rA / lw rA,K(rB) followed by lw rC,K(rB) or sw K(rB),rA
+ */
+bool PeepholeOptimizer::redundantMemory(Instructions& text, const Index& i)
+{
+    const auto& in = text[i];
+    bool load = in.op == "lw";
+
+    if (!load && in.op != "sw") {
+        return false;
+    }
+
+    const auto value = in.operands[load ? 0 : 1];
+    int offset;
+    std::string base;
+
+    if (!MoonInstruction::parseMemory(in.operands[load ? 1 : 0], offset, base) || (load && value == base)) {
+        return false;
+    }
+
+    for (auto j : following(text, i)) {
+        auto& next = text[j];
+        int nextOffset;
+        std::string nextBase;
+
+        if (next.op == "lw" && MoonInstruction::parseMemory(next.operands[1], nextOffset, nextBase)
+            && nextOffset == offset && nextBase == base) {
+            // the value is still in a register
+            if (next.operands[0] == value) {
+                remove(text, j);
+            } else {
+                next.op = "add";
+                next.operands = {next.operands[0], value, ZR};
+            }
+
+            hit("redundant load");
+            return true;
+        }
+
+        if (next.op == "sw" && MoonInstruction::parseMemory(next.operands[0], nextOffset, nextBase)
+            && nextOffset == offset && nextBase == base && next.operands[1] == value) {
+            // the memory already holds the value
+            remove(text, j);
+            hit("redundant store");
+            return true;
+        }
+
+        auto writes = next.writes();
+
+        if (contains(writes, value) || contains(writes, base)) {
+            return false;
+        }
+
+        // stores through another base register might alias
+        if (next.op == "sw" || next.op == "sb") {
+            if (!MoonInstruction::parseMemory(next.operands[0], nextOffset, nextBase) || nextBase != base
+                || std::abs(nextOffset - offset) < 4) {
+                return false;
+            }
+        }
+    }
+
+    return false;
+}
+
+/*
+ * addi r14,r14,A ... addi r14,r14,B, moving the first adjustment into the second one
+ */
+bool PeepholeOptimizer::stackAdjustment(Instructions& text, const Index& i)
+{
+    const auto& in = text[i];
+    int amount;
+
+    if ((in.op != "addi" && in.op != "subi") || in.operands[0] != SP || in.operands[1] != SP
+        || !MoonInstruction::parseInt(in.operands[2], amount)) {
+        return false;
+    }
+
+    if (in.op == "subi") {
+        amount = -amount;
+    }
+
+    // instructions in between keep addressing the same memory relative to the unadjusted stack pointer
+    std::vector<std::pair<Index, int>> adjusted;
+
+    for (auto j : following(text, i)) {
+        const auto& next = text[j];
+        int value;
+
+        if ((next.op == "addi" || next.op == "subi") && next.operands[0] == SP && next.operands[1] == SP
+            && MoonInstruction::parseInt(next.operands[2], value)) {
+            long long total = amount + static_cast<long long>(next.op == "subi" ? -value : value);
+
+            if (!fits(total)) {
+                return false;
+            }
+
+            for (const auto& a : adjusted) {
+                auto& instruction = text[a.first];
+
+                if (instruction.op == "addi") {
+                    instruction.operands[2] = std::to_string(a.second);
+                } else {
+                    auto& operand = instruction.operands[instruction.op == "lw" || instruction.op == "lb" ? 1 : 0];
+                    operand = MoonInstruction::memory(a.second, SP);
+                }
+            }
+
+            if (total == 0) {
+                remove(text, j);
+            } else {
+                text[j].op = "addi";
+                text[j].operands[2] = std::to_string(total);
+            }
+
+            remove(text, i);
+            hit("stack adjustment");
+            return true;
+        }
+
+        if (contains(next.writes(), SP)) {
+            return false;
+        }
+
+        int offset;
+        std::string base;
+        bool load = next.op == "lw" || next.op == "lb";
+        bool store = next.op == "sw" || next.op == "sb";
+
+        if ((load || store) && MoonInstruction::parseMemory(next.operands[load ? 1 : 0], offset, base) && base == SP
+            && (load || next.operands[1] != SP)) {
+            if (!fits(static_cast<long long>(offset) + amount)) {
+                return false;
+            }
+
+            adjusted.emplace_back(j, offset + amount);
+        } else if (next.op == "addi" && next.operands[1] == SP && MoonInstruction::parseInt(next.operands[2], offset)) {
+            if (!fits(static_cast<long long>(offset) + amount)) {
+                return false;
+            }
+
+            adjusted.emplace_back(j, offset + amount);
+        } else if (contains(next.reads(), SP)) {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * rX := rA + K (addi, subi or a copy), forwarded into the instructions reading rX, and removed once rX is
+ * overwritten without being read
+ */
+bool PeepholeOptimizer::forward(Instructions& text, const Index& i)
+{
+    const auto& in = text[i];
+    std::string reg;
+    std::string base;
+    int offset = 0;
+
+    if ((in.op == "addi" || in.op == "subi") && MoonInstruction::parseInt(in.operands[2], offset)) {
+        reg = in.operands[0];
+        base = in.operands[1];
+        offset = in.op == "subi" ? -offset : offset;
+    } else if (in.op == "add" && in.operands[2] == ZR) {
+        reg = in.operands[0];
+        base = in.operands[1];
+    } else if (in.op == "add" && in.operands[1] == ZR) {
+        reg = in.operands[0];
+        base = in.operands[2];
+    } else {
+        return false;
+    }
+
+    if (reg == base || reg == ZR || reg == SP || !fits(offset)) {
+        return false;
+    }
+
+    bool changed = false;
+
+    for (auto j : following(text, i)) {
+        auto& next = text[j];
+
+        if (contains(next.reads(), reg)) {
+            if (!fold(next, reg, base, offset)) {
+                return changed;
+            }
+
+            changed = true;
+
+            if (contains(next.reads(), reg)) {
+                return changed;
+            }
+        }
+
+        auto writes = next.writes();
+
+        if (contains(writes, reg)) {
+            remove(text, i);
+            hit("dead definition");
+            return true;
+        }
+
+        if (contains(writes, base)) {
+            return changed;
+        }
+    }
+
+    return changed;
+}
+
+bool PeepholeOptimizer::fold(MoonInstruction& in, const std::string& reg, const std::string& base, const int& offset)
+{
+    static const std::map<std::string, std::string> swapped = {
+        {"add", "addi"}, {"mul", "muli"}, {"ceq", "ceqi"}, {"cne", "cnei"},
+        {"clt", "cgti"}, {"cle", "cgei"}, {"cgt", "clti"}, {"cge", "clei"},
+    };
+
+    static const std::vector<std::string> arithmetic = {
+        "add", "sub", "mul", "div", "ceq", "cne", "clt", "cle", "cgt", "cge",
+    };
+
+    int value;
+
+    if (offset == 0) {
+        in.replaceReads(reg, base);
+        hit("copy propagation");
+        return true;
+    }
+
+    if ((in.op == "addi" || in.op == "subi") && in.operands[1] == reg && MoonInstruction::parseInt(in.operands[2], value)) {
+        long long total = offset + static_cast<long long>(in.op == "subi" ? -value : value);
+
+        if (!fits(total)) {
+            return false;
+        }
+
+        in.op = "addi";
+        in.operands = {in.operands[0], base, std::to_string(total)};
+        hit("immediate chain");
+        return true;
+    }
+
+    bool load = in.op == "lw" || in.op == "lb";
+    bool store = in.op == "sw" || in.op == "sb";
+    std::string memoryBase;
+
+    if ((load || store) && MoonInstruction::parseMemory(in.operands[load ? 1 : 0], value, memoryBase)
+        && memoryBase == reg && (load || in.operands[1] != reg)) {
+        long long total = offset + static_cast<long long>(value);
+
+        if (!fits(total)) {
+            return false;
+        }
+
+        in.operands[load ? 1 : 0] = MoonInstruction::memory(static_cast<int>(total), base);
+        hit("immediate chain");
+        return true;
+    }
+
+    // the rest needs reg to hold a constant
+    if (base != ZR) {
+        return false;
+    }
+
+    long long result;
+    const auto op = in.op.size() > 1 && in.op.back() == 'i' ? in.op.substr(0, in.op.size() - 1) : in.op;
+
+    if (op != in.op && in.operands[1] == reg && MoonInstruction::parseInt(in.operands[2], value)) {
+        if (!evaluate(op, offset, value, result) || !fits(result)) {
+            return false;
+        }
+
+        in.op = "addi";
+        in.operands = {in.operands[0], ZR, std::to_string(result)};
+        hit("immediate fold");
+        return true;
+    }
+
+    if (std::find(arithmetic.begin(), arithmetic.end(), in.op) == arithmetic.end()) {
+        return false;
+    }
+
+    if (in.operands[1] == reg && in.operands[2] == reg) {
+        if (!evaluate(in.op, offset, offset, result) || !fits(result)) {
+            return false;
+        }
+
+        in.op = "addi";
+        in.operands = {in.operands[0], ZR, std::to_string(result)};
+    } else if (in.operands[2] == reg) {
+        in.op += 'i';
+        in.operands[2] = std::to_string(offset);
+    } else if (swapped.count(in.op)) {
+        in.op = swapped.at(in.op);
+        in.operands = {in.operands[0], in.operands[2], std::to_string(offset)};
+    } else {
+        return false;
+    }
+
+    hit("immediate fold");
+    return true;
+}
+
+std::vector<PeepholeOptimizer::Index> PeepholeOptimizer::following(const Instructions& text, const Index& i) const
+{
+    std::vector<Index> result;
+
+    for (Index j = i + 1; j < text.size() && result.size() < window_; ++j) {
+        if (removed_[j] || text[j].isComment()) {
+            continue;
+        }
+
+        if (!text[j].label.empty() || text[j].isControl() || text[j].isDirective()) {
+            break;
+        }
+
+        result.push_back(j);
+    }
+
+    return result;
+}
+
+void PeepholeOptimizer::remove(Instructions& text, const Index& i)
+{
+    // keep labels around, something may jump to them
+    if (text[i].label.empty()) {
+        removed_[i] = true;
+    } else {
+        text[i].op.clear();
+        text[i].operands.clear();
+    }
+}
+
+void PeepholeOptimizer::hit(const std::string& rule)
+{
+    ++hits_[rule];
+}
+
+bool PeepholeOptimizer::fits(const long long& value)
+{
+    return MoonInstruction::fitsImmediate(value);
+}
+
+bool PeepholeOptimizer::evaluate(const std::string& op, const long long& a, const long long& b, long long& result)
+{
+    if (op == "add") {
+        result = a + b;
+    } else if (op == "sub") {
+        result = a - b;
+    } else if (op == "mul") {
+        result = a * b;
+    } else if (op == "div" && b != 0) {
+        result = a / b;
+    } else if (op == "ceq") {
+        result = a == b;
+    } else if (op == "cne") {
+        result = a != b;
+    } else if (op == "clt") {
+        result = a < b;
+    } else if (op == "cle") {
+        result = a <= b;
+    } else if (op == "cgt") {
+        result = a > b;
+    } else if (op == "cge") {
+        result = a >= b;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+bool PeepholeOptimizer::contains(const std::vector<std::string>& registers, const std::string& reg)
+{
+    return std::find(registers.begin(), registers.end(), reg) != registers.end();
+}
+
+}}
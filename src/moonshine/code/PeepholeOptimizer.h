@@ -0,0 +1,65 @@
+#pragma once
+
+#include "moonshine/code/MoonCode.h"
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace moonshine { namespace code {
+
+/**
+ * Rewrites short sequences of Moon instructions into cheaper ones.
+ *
+ * Every rule starts at one instruction and looks at most `window` instructions past it, never beyond a label or
+ * an instruction that transfers control, so no knowledge of the control flow is needed. Passes are repeated
+ * until no rule applies any more.
+ */
+class PeepholeOptimizer
+{
+public:
+    explicit PeepholeOptimizer(const unsigned int& window = 8);
+
+    void optimize(MoonCode& code);
+
+    unsigned int window() const;
+
+    // number of rewrites made by each rule, over every call to optimize
+    const std::map<std::string, unsigned int>& hits() const;
+    void printHits(std::ostream& s) const;
+private:
+    typedef std::vector<MoonInstruction> Instructions;
+    typedef Instructions::size_type Index;
+
+    const std::string ZR = "r0";
+    const std::string SP = "r14";
+
+    unsigned int window_;
+    std::map<std::string, unsigned int> hits_;
+
+    // instructions removed during the current pass
+    std::vector<bool> removed_;
+
+    bool pass(Instructions& text);
+
+    // rules
+    bool selfMove(Instructions& text, const Index& i);
+    bool jumpToNext(Instructions& text, const Index& i);
+    bool redundantMemory(Instructions& text, const Index& i);
+    bool stackAdjustment(Instructions& text, const Index& i);
+    bool forward(Instructions& text, const Index& i);
+    bool fold(MoonInstruction& instruction, const std::string& reg, const std::string& base, const int& offset);
+
+    // the instructions after i within the window, up to the next label or control transfer
+    std::vector<Index> following(const Instructions& text, const Index& i) const;
+
+    void remove(Instructions& text, const Index& i);
+    void hit(const std::string& rule);
+
+    static bool fits(const long long& value);
+    static bool evaluate(const std::string& op, const long long& a, const long long& b, long long& result);
+    static bool contains(const std::vector<std::string>& registers, const std::string& reg);
+};
+
+}}
@@ -106,7 +106,7 @@ void StackCodeGeneratorVisitor::visit(ast::var* node)
 
     // if the first child is a dataMember, we should see where to initially set our pointer to
     if (dynamic_cast<ast::dataMember*>(node->child())) {
-        if (node->child()->symbolTableEntry()->parentTable() == table.get()) {
+        if (node->child()->symbolTableEntry()->parentTable() == table) {
             // within our own symbol table
             // initialize offset var to current stack pointer
             text() << "% var: initial offset for own var" << endl;
@@ -116,7 +116,7 @@ void StackCodeGeneratorVisitor::visit(ast::var* node)
             // initialize offset var to the top address of the dataMember's data
             text() << "% var: initial offset for member var" << endl;
 
-            auto currTable = table.get();
+            auto currTable = table;
             auto thisVar = currTable->get("_this");
             int offset = 0;
 
@@ -138,7 +138,7 @@ void StackCodeGeneratorVisitor::visit(ast::var* node)
 
         // if the first child is a fCall, we should carry over our this ptr if we have one
 
-        auto currTable = table.get();
+        auto currTable = table;
         auto thisVar = currTable->get("_this");
         int offset = 0;
 
@@ -165,7 +165,7 @@ void StackCodeGeneratorVisitor::visit(ast::var* node)
     if (dynamic_cast<ast::dataMember*>(node->rightmostChild())) {
         text() << "% var: adjust offset" << endl;
 
-        auto type = dynamic_cast<semantic::VariableType*>(node->rightmostChild()->symbolTableEntry()->type());
+        auto type = dynamic_cast<const semantic::VariableType*>(node->rightmostChild()->symbolTableEntry()->type());
         int size = node->rightmostChild()->symbolTableEntry()->size();
         for (const auto& i : type->indices) {
             size /= i;
@@ -278,50 +278,10 @@ void StackCodeGeneratorVisitor::visit(ast::relOp* node)
            << node->child(0)->symbolTableEntry()->name() << ' ' << node->token()->value << ' ' << node->child(1)->symbolTableEntry()->name() << endl;
 
     auto r1 = reg();
-    auto r2 = reg();
-    auto r3 = reg();
-
-    // load data from lhs and rhs
-    lw(r1, -node->child(0)->symbolTableEntry()->offset(), SP);
-    if (dynamic_cast<ast::var*>(node->child(0))) {
-        // indirect
-        lw(r1, 0, r1);
-    }
-
-    lw(r2, -node->child(1)->symbolTableEntry()->offset(), SP);
-    if (dynamic_cast<ast::var*>(node->child(1))) {
-        // indirect
-        lw(r2, 0, r2);
-    }
-
-    // add and store
-    switch (node->token()->type) {
-        case TokenType::T_IS_SMALLER:
-            clt(r3, r1, r2);
-            break;
-        case TokenType::T_IS_SMALLER_OR_EQUAL:
-            cle(r3, r1, r2);
-            break;
-        case TokenType::T_IS_GREATER:
-            cgt(r3, r1, r2);
-            break;
-        case TokenType::T_IS_GREATER_OR_EQUAL:
-            cge(r3, r1, r2);
-            break;
-        case TokenType::T_IS_EQUAL:
-            ceq(r3, r1, r2);
-            break;
-        case TokenType::T_IS_NOT_EQUAL:
-            cne(r3, r1, r2);
-            break;
-        default:
-            break;
-    }
 
-    sw(-node->symbolTableEntry()->offset(), SP, r3);
+    compare(node, r1);
+    sw(-node->symbolTableEntry()->offset(), SP, r1);
 
-    regPush(r3);
-    regPush(r2);
     regPush(r1);
 }
 
@@ -367,7 +327,7 @@ void StackCodeGeneratorVisitor::visit(ast::assignStat* node)
 
     if (dynamic_cast<ast::var*>(node->child(1))) {
         // indirect
-        auto type = dynamic_cast<semantic::VariableType*>(node->child(0)->rightmostChild()->symbolTableEntry()->type());
+        auto type = dynamic_cast<const semantic::VariableType*>(node->child(0)->rightmostChild()->symbolTableEntry()->type());
         int size = node->child(0)->rightmostChild()->symbolTableEntry()->size();
         for (const auto& i : type->indices) {
             size /= i;
@@ -473,7 +433,7 @@ void StackCodeGeneratorVisitor::visit(ast::returnStat* node)
     if (dynamic_cast<ast::var*>(node->child())) {
         // indirect
         //lw(r1, 0, r1);
-        auto type = dynamic_cast<semantic::VariableType*>(node->child()->rightmostChild()->symbolTableEntry()->type());
+        auto type = dynamic_cast<const semantic::VariableType*>(node->child()->rightmostChild()->symbolTableEntry()->type());
         int size = node->child()->rightmostChild()->symbolTableEntry()->size();
         for (const auto& i : type->indices) {
             size /= i;
@@ -500,7 +460,7 @@ void StackCodeGeneratorVisitor::visit(ast::funcDef* node)
         return;
     }
 
-    auto type = dynamic_cast<semantic::FunctionType*>(function->type());
+    auto type = dynamic_cast<const semantic::FunctionType*>(function->type());
     bool isFreeFunction = !function->parentTable()->parentEntry();
     std::string prefix;
 
@@ -511,8 +471,8 @@ void StackCodeGeneratorVisitor::visit(ast::funcDef* node)
 
     int returnSize = 0;
 
-    if (type->returnType.type == semantic::Type::CLASS) {
-        auto classEntry = (*table)[type->returnType.className];
+    if (type->returnType->type == semantic::Type::CLASS) {
+        auto classEntry = (*table)[type->returnType->className];
         returnSize = classEntry->size();
     } else {
         returnSize = 4;
@@ -555,8 +515,8 @@ void StackCodeGeneratorVisitor::visit(ast::dataMember* node)
     addi(r1, r1, -entry->offset() + entry->size());
 
     // if the previous dataMember refers to a class, we need to check if we should adjust the offset for inheritance
-    if (previous && dynamic_cast<semantic::VariableType*>(previous->symbolTableEntry()->type())->type == semantic::Type::CLASS) {
-        auto classEntry = (*table)[dynamic_cast<semantic::VariableType*>(previous->symbolTableEntry()->type())->className];
+    if (previous && dynamic_cast<const semantic::VariableType*>(previous->symbolTableEntry()->type())->type == semantic::Type::CLASS) {
+        auto classEntry = (*table)[dynamic_cast<const semantic::VariableType*>(previous->symbolTableEntry()->type())->className];
         auto link = classEntry->link();
 
         // first, check if this dataMember's entry is in the class' own symbol table
@@ -592,7 +552,7 @@ void StackCodeGeneratorVisitor::visit(ast::dataMember* node)
     // for indices, we calculate an offset amount to move down from the top of the data
     if (node->child(1)->child()) {
         int size = node->parent()->symbolTableEntry()->size();
-        auto type = dynamic_cast<semantic::VariableType*>(entry->type());
+        auto type = dynamic_cast<const semantic::VariableType*>(entry->type());
         std::vector<unsigned int>::size_type i = 0;
 
         for (auto index = node->child(1)->child(); index != nullptr; index = index->next(), ++i) {
@@ -705,14 +665,8 @@ void StackCodeGeneratorVisitor::visit(ast::ifStat* node)
     auto elseLabel = label("else");
     auto endifLabel = label("endif");
 
-    // condition: call visitor on 1st child node (expression)
-    node->child(0)->accept(this);
-
-    // evaluate: if false, jump to else. if true, carry on
-    auto r1 = reg();
-    lw(r1, -node->child(0)->symbolTableEntry()->offset(), SP);
-    bz(r1, elseLabel);
-    regPush(r1);
+    // condition: if false, jump to else. if true, carry on
+    condition(node->child(0), elseLabel, false);
 
     // then: call visitor on then statBlock
     text() << "% ifStat: then" << endl;
@@ -748,11 +702,7 @@ void StackCodeGeneratorVisitor::visit(ast::forStat* node)
 
     // condition
     text(forcondLabel) << "% forStat: condition" << endl;
-    node->child(3)->accept(this);
-    r1 = reg();
-    lw(r1, -node->child(3)->symbolTableEntry()->offset(), SP);
-    bz(r1, endforLabel);
-    regPush(r1);
+    condition(node->child(3), endforLabel, false);
 
     // body
     text() << "% forStat: body" << endl;
@@ -771,6 +721,108 @@ void StackCodeGeneratorVisitor::visit(ast::forStat* node)
     subi(SP, SP, -parentTable->size());
 }
 
+void StackCodeGeneratorVisitor::condition(ast::Node* node, const std::string& target, const bool& onTrue)
+{
+    auto multOp = dynamic_cast<ast::multOp*>(node);
+    auto addOp = dynamic_cast<ast::addOp*>(node);
+
+    // and/or chains short-circuit: the right hand side is skipped once the left hand side decides the outcome
+    if ((multOp && multOp->token()->type == TokenType::T_AND) || (addOp && addOp->token()->type == TokenType::T_OR)) {
+        bool isAnd = multOp != nullptr;
+
+        if (onTrue != isAnd) {
+            // a false lhs of an and (or true lhs of an or) already decides it
+            condition(node->child(0), target, onTrue);
+            condition(node->child(1), target, onTrue);
+        } else {
+            auto skipLabel = label(isAnd ? "and" : "or");
+            condition(node->child(0), skipLabel, !onTrue);
+            condition(node->child(1), target, onTrue);
+            text(skipLabel) << "% " << (isAnd ? "and" : "or") << ": end" << endl;
+        }
+
+        return;
+    }
+
+    if (dynamic_cast<ast::notFactor*>(node)) {
+        condition(node->child(), target, !onTrue);
+        return;
+    }
+
+    auto r1 = reg();
+
+    if (auto relOp = dynamic_cast<ast::relOp*>(node)) {
+        // compare straight into a register instead of going through the relOp's tempvar
+        relOp->child(0)->accept(this);
+        relOp->child(1)->accept(this);
+
+        text() << "% condition: " << relOp->child(0)->symbolTableEntry()->name() << ' ' << relOp->token()->value << ' '
+               << relOp->child(1)->symbolTableEntry()->name() << endl;
+
+        compare(relOp, r1);
+    } else {
+        node->accept(this);
+        lw(r1, -node->symbolTableEntry()->offset(), SP);
+        if (dynamic_cast<ast::var*>(node)) {
+            // indirect
+            lw(r1, 0, r1);
+        }
+    }
+
+    if (onTrue) {
+        bnz(r1, target);
+    } else {
+        bz(r1, target);
+    }
+
+    regPush(r1);
+}
+
+void StackCodeGeneratorVisitor::compare(ast::relOp* node, const std::string& dest)
+{
+    auto r1 = reg();
+    auto r2 = reg();
+
+    // load data from lhs and rhs
+    lw(r1, -node->child(0)->symbolTableEntry()->offset(), SP);
+    if (dynamic_cast<ast::var*>(node->child(0))) {
+        // indirect
+        lw(r1, 0, r1);
+    }
+
+    lw(r2, -node->child(1)->symbolTableEntry()->offset(), SP);
+    if (dynamic_cast<ast::var*>(node->child(1))) {
+        // indirect
+        lw(r2, 0, r2);
+    }
+
+    switch (node->token()->type) {
+        case TokenType::T_IS_SMALLER:
+            clt(dest, r1, r2);
+            break;
+        case TokenType::T_IS_SMALLER_OR_EQUAL:
+            cle(dest, r1, r2);
+            break;
+        case TokenType::T_IS_GREATER:
+            cgt(dest, r1, r2);
+            break;
+        case TokenType::T_IS_GREATER_OR_EQUAL:
+            cge(dest, r1, r2);
+            break;
+        case TokenType::T_IS_EQUAL:
+            ceq(dest, r1, r2);
+            break;
+        case TokenType::T_IS_NOT_EQUAL:
+            cne(dest, r1, r2);
+            break;
+        default:
+            break;
+    }
+
+    regPush(r2);
+    regPush(r1);
+}
+
 std::string StackCodeGeneratorVisitor::reg()
 {
     auto r = registers_.top();
@@ -64,6 +64,10 @@ private:
 
     std::string label(const std::string& label);
 
+    // jump to target if the condition evaluates to onTrue, fall through otherwise
+    void condition(ast::Node* node, const std::string& target, const bool& onTrue);
+    void compare(ast::relOp* node, const std::string& dest);
+
     // instructions
     void add(const std::string& dest, const std::string& op1, const std::string& op2);
     void addi(const std::string& dest, const std::string& op1, const std::string& op2);
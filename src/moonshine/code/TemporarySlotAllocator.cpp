@@ -0,0 +1,88 @@
+#include "moonshine/code/TemporarySlotAllocator.h"
+
+#include <algorithm>
+
+namespace moonshine { namespace code {
+
+using namespace semantic;
+
+TemporarySlotAllocator::TemporarySlotAllocator(SymbolTable* table)
+    : table_(table)
+{
+}
+
+int TemporarySlotAllocator::allocate(ast::Node* scope, const int& base)
+{
+    base_ = base;
+    cursor_ = 0;
+    size_ = 0;
+    allocated_.clear();
+
+    allocateRegions(scope);
+
+    // anything we didn't come across while walking the scope gets a slot of its own
+    for (const auto& entry : table_->temporaries()) {
+        if (allocated_.find(entry) == allocated_.end()) {
+            beginRegion();
+            allocateSlot(entry);
+        }
+    }
+
+    return size_;
+}
+
+void TemporarySlotAllocator::allocateRegions(ast::Node* scope)
+{
+    for (auto n = scope->child(); n != nullptr; n = n->next()) {
+        if (isScope(n)) {
+            // nested for statements lay out their own symbol table
+            if (!n->symbolTable() || n->symbolTable() == table_) {
+                allocateRegions(n);
+            }
+        } else {
+            // every statement or condition starts with all temporary slots free
+            beginRegion();
+            allocateRegion(n);
+        }
+    }
+}
+
+void TemporarySlotAllocator::allocateRegion(ast::Node* node)
+{
+    for (auto n = node->child(); n != nullptr; n = n->next()) {
+        allocateRegion(n);
+    }
+
+    auto entry = node->symbolTableEntry();
+
+    if (entry && entry->parentTable() == table_
+        && (entry->kind() == SymbolTableEntryKind::TEMPVAR || entry->kind() == SymbolTableEntryKind::LITERAL)) {
+        allocateSlot(entry);
+    }
+}
+
+void TemporarySlotAllocator::allocateSlot(SymbolTableEntry* entry)
+{
+    if (!allocated_.insert(entry).second) {
+        return;
+    }
+
+    cursor_ += entry->size();
+    entry->setOffset(base_ + cursor_);
+    size_ = std::max(size_, cursor_);
+}
+
+void TemporarySlotAllocator::beginRegion()
+{
+    cursor_ = 0;
+}
+
+bool TemporarySlotAllocator::isScope(ast::Node* node)
+{
+    return dynamic_cast<ast::statBlock*>(node)
+           || dynamic_cast<ast::ifStat*>(node)
+           || dynamic_cast<ast::forStat*>(node)
+           || dynamic_cast<ast::funcDef*>(node);
+}
+
+}}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "moonshine/syntax/Node.h"
+#include "moonshine/semantic/SymbolTable.h"
+
+#include <unordered_set>
+
+namespace moonshine { namespace code {
+
+/**
+ * Assigns stack frame slots to the temporaries of a symbol table.
+ *
+ * A temporary is dead once the statement (or if/for condition) that computes it has executed, so the
+ * temporaries of different statements share the same slots. The temporary area of the frame only needs
+ * to be as large as the statement with the most temporary data.
+ */
+class TemporarySlotAllocator
+{
+public:
+    explicit TemporarySlotAllocator(semantic::SymbolTable* table);
+
+    /**
+     * Lays out the temporaries found under scope right after base bytes of the frame.
+     * Returns the size of the temporary area.
+     */
+    int allocate(ast::Node* scope, const int& base);
+private:
+    semantic::SymbolTable* table_;
+    std::unordered_set<semantic::SymbolTableEntry*> allocated_;
+    int base_ = 0;
+    int cursor_ = 0;
+    int size_ = 0;
+
+    void allocateRegions(ast::Node* scope);
+    void allocateRegion(ast::Node* node);
+    void allocateSlot(semantic::SymbolTableEntry* entry);
+    void beginRegion();
+
+    static bool isScope(ast::Node* node);
+};
+
+}}
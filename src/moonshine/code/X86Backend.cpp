@@ -0,0 +1,430 @@
+#include "moonshine/code/X86Backend.h"
+
+#include <stdexcept>
+#include <unordered_map>
+
+namespace moonshine { namespace code {
+
+using namespace ir;
+
+X86Backend::X86Backend(std::ostream& s)
+    : s_(s), allocator_({"%ecx", "%esi", "%edi", "%r8d", "%r9d", "%r10d", "%ebp", "%r13d", "%r14d", "%r15d"})
+{
+}
+
+void X86Backend::emit(const Program& program)
+{
+    s_ << "\t.text" << std::endl;
+
+    for (const auto& function : program.functions()) {
+        emit(*function);
+    }
+
+    // the stack doesn't need to be executable
+    s_ << "\t.section .note.GNU-stack,\"\",@progbits" << std::endl;
+}
+
+void X86Backend::emit(const Function& function)
+{
+    function_ = &function;
+    allocate(function);
+
+    s_ << std::endl;
+
+    if (function.isProgram()) {
+        s_ << "\t.globl moon_main" << std::endl;
+        label("moon_main");
+
+        for (const auto& reg : SAVED) {
+            text("pushq", {reg});
+        }
+
+        text("leaq", {"moon_memory(%rip)", BASE});
+        text("movl", {"moon_memory_size(%rip)", SP + 'd'});
+        comment("program body begin");
+    } else {
+        label(functionLabel(function.label()));
+        comment("funcDef: " + function.label());
+    }
+
+    const auto& blocks = function.blocks();
+
+    for (auto it = blocks.begin(); it != blocks.end(); ++it) {
+        const BasicBlock* next = it + 1 != blocks.end() ? (it + 1)->get() : nullptr;
+
+        if (it != blocks.begin()) {
+            label(blockLabel(it->get()));
+        }
+
+        for (const auto& instruction : (*it)->instructions()) {
+            emit(instruction, next);
+        }
+    }
+}
+
+void X86Backend::emit(const Instruction& i, const BasicBlock* next)
+{
+    if (!i.comment.empty()) {
+        comment(i.comment);
+    }
+
+    switch (i.op) {
+        case Opcode::ADD:
+            binary("addl", i);
+            break;
+        case Opcode::SUB:
+            binary("subl", i);
+            break;
+        case Opcode::MUL:
+            binary("imull", i);
+            break;
+        case Opcode::DIV:
+            text("movl", {value(i.a), "%eax"});
+            text("cltd");
+
+            // idiv takes no immediate, and the scratch registers hold the dividend
+            if (i.b.isImmediate()) {
+                text("movl", {value(i.b), "%r11d"});
+                text("idivl", {"%r11d"});
+            } else {
+                text("idivl", {value(i.b)});
+            }
+
+            commit(i.dst);
+            break;
+        case Opcode::AND:
+        case Opcode::OR:
+            // logical: both sides are turned into 0 or 1 first
+            text("movl", {value(i.a), "%eax"});
+            text("testl", {"%eax", "%eax"});
+            text("setne", {"%al"});
+            text("movl", {value(i.b), "%edx"});
+            text("testl", {"%edx", "%edx"});
+            text("setne", {"%dl"});
+            text(i.op == Opcode::AND ? "andb" : "orb", {"%dl", "%al"});
+            text("movzbl", {"%al", "%eax"});
+            commit(i.dst);
+            break;
+        case Opcode::CEQ:
+            compare("sete", i);
+            break;
+        case Opcode::CNE:
+            compare("setne", i);
+            break;
+        case Opcode::CLT:
+            compare("setl", i);
+            break;
+        case Opcode::CLE:
+            compare("setle", i);
+            break;
+        case Opcode::CGT:
+            compare("setg", i);
+            break;
+        case Opcode::CGE:
+            compare("setge", i);
+            break;
+        case Opcode::NOT:
+            text("movl", {value(i.a), "%eax"});
+            text("testl", {"%eax", "%eax"});
+            text("sete", {"%al"});
+            text("movzbl", {"%al", "%eax"});
+            commit(i.dst);
+            break;
+        case Opcode::MOVE:
+            move(value(i.a), i.dst);
+            break;
+        case Opcode::ADDRESS:
+            switch (i.address.base) {
+                case Address::Base::FRAME:
+                    text("leal", {std::to_string(i.address.offset) + '(' + SP + ')', "%eax"});
+                    break;
+                case Address::Base::OUTGOING:
+                    text("leal", {std::to_string(i.address.offset - frameSize_) + '(' + SP + ')', "%eax"});
+                    break;
+                case Address::Base::REGISTER:
+                    text("movl", {value(Operand::reg(i.address.reg)), "%eax"});
+
+                    if (i.address.offset != 0) {
+                        text("addl", {'$' + std::to_string(i.address.offset), "%eax"});
+                    }
+                    break;
+            }
+
+            commit(i.dst);
+            break;
+        case Opcode::LOAD:
+            move(memory(i.address), i.dst);
+            break;
+        case Opcode::STORE: {
+            auto location = memory(i.address);
+
+            if (inRegister(i.a) || i.a.isImmediate()) {
+                text("movl", {value(i.a), location});
+            } else {
+                text("movl", {value(i.a), "%eax"});
+                text("movl", {"%eax", location});
+            }
+            break;
+        }
+        case Opcode::PARAM:
+            // parameters are taken out of the argument registers before anything else uses them
+            move(ARGS.at(i.a.value), i.dst);
+            break;
+        case Opcode::CALL:
+            save(i);
+
+            if (i.arguments.size() > ARGS.size()) {
+                throw std::logic_error("X86Backend::emit: Too many arguments passed in registers");
+            }
+
+            // arguments are never in scratch registers, so they can't overwrite each other
+            for (std::size_t k = 0; k < i.arguments.size(); ++k) {
+                text("movl", {value(i.arguments[k]), ARGS[k]});
+            }
+
+            // make the stack frame pointer point to the called function's stack frame and back
+            text("subl", {'$' + std::to_string(frameSize_), SP + 'd'});
+            text("call", {functionLabel(i.callee)});
+            text("addl", {'$' + std::to_string(frameSize_), SP + 'd'});
+
+            restore(i);
+
+            if (i.dst.isRegister()) {
+                commit(i.dst);
+            }
+            break;
+        case Opcode::READ:
+            save(i);
+            runtime("moon_get");
+            restore(i);
+            commit(i.dst);
+            break;
+        case Opcode::WRITE:
+            save(i);
+            text("movl", {value(i.a), "%edi"});
+            runtime("moon_put");
+            restore(i);
+            break;
+        case Opcode::JUMP:
+            if (i.targets[0] != next) {
+                text("jmp", {blockLabel(i.targets[0])});
+            }
+            break;
+        case Opcode::BRANCH:
+            if (i.a.isImmediate()) {
+                auto target = i.targets[i.a.value != 0 ? 0 : 1];
+
+                if (target != next) {
+                    text("jmp", {blockLabel(target)});
+                }
+                break;
+            }
+
+            text("cmpl", {"$0", value(i.a)});
+
+            if (i.targets[1] == next) {
+                text("jne", {blockLabel(i.targets[0])});
+            } else if (i.targets[0] == next) {
+                text("je", {blockLabel(i.targets[1])});
+            } else {
+                text("jne", {blockLabel(i.targets[0])});
+                text("jmp", {blockLabel(i.targets[1])});
+            }
+            break;
+        case Opcode::RETURN:
+            if (!i.a.isNone()) {
+                text("movl", {value(i.a), RV});
+            }
+
+            text("ret");
+            break;
+        case Opcode::HALT:
+            comment("program body end");
+
+            for (auto reg = SAVED.rbegin(); reg != SAVED.rend(); ++reg) {
+                text("popq", {*reg});
+            }
+
+            text("xorl", {"%eax", "%eax"});
+            text("ret");
+            break;
+        case Opcode::TAILCALL:
+            // the called function reuses this frame and returns straight to our caller
+            text("jmp", {functionLabel(i.callee)});
+            break;
+    }
+}
+
+void X86Backend::allocate(const Function& function)
+{
+    allocator_.allocate(function);
+
+    // spill slots go right after the symbol table frame
+    frameSize_ = function.frameSize() + 4 * allocator_.slotCount();
+}
+
+void X86Backend::save(const Instruction& instruction)
+{
+    for (auto v : allocator_.savedAcross(&instruction)) {
+        text("movl", {allocator_.location(v), slot(v)});
+    }
+}
+
+void X86Backend::restore(const Instruction& instruction)
+{
+    for (auto v : allocator_.savedAcross(&instruction)) {
+        text("movl", {slot(v), allocator_.location(v)});
+    }
+}
+
+std::string X86Backend::value(const Operand& operand) const
+{
+    if (operand.isImmediate()) {
+        return '$' + std::to_string(operand.value);
+    }
+
+    if (!operand.isRegister()) {
+        throw std::logic_error("X86Backend::value: Operand has no value");
+    }
+
+    return allocator_.inRegister(operand.value) ? allocator_.location(operand.value) : slot(operand.value);
+}
+
+std::string X86Backend::slot(const int& reg) const
+{
+    auto offset = -(function_->frameSize() + 4 * (allocator_.slot(reg) + 1));
+    return std::to_string(offset) + '(' + BASE + ',' + SP + ')';
+}
+
+bool X86Backend::inRegister(const Operand& operand) const
+{
+    return operand.isRegister() && allocator_.inRegister(operand.value);
+}
+
+std::string X86Backend::memory(const Address& address)
+{
+    switch (address.base) {
+        case Address::Base::FRAME:
+            return std::to_string(address.offset) + '(' + BASE + ',' + SP + ')';
+        case Address::Base::OUTGOING:
+            return std::to_string(address.offset - frameSize_) + '(' + BASE + ',' + SP + ')';
+        case Address::Base::REGISTER: {
+            // 32 bit operations clear the upper half, so the wide register holds the same offset
+            auto base = Operand::reg(address.reg);
+
+            if (inRegister(base)) {
+                return std::to_string(address.offset) + '(' + BASE + ',' + wide(value(base)) + ')';
+            }
+
+            text("movl", {value(base), "%edx"});
+            return std::to_string(address.offset) + '(' + BASE + ",%rdx)";
+        }
+    }
+
+    throw std::logic_error("X86Backend::memory: Invalid address base");
+}
+
+void X86Backend::binary(const std::string& op, const Instruction& i)
+{
+    // straight into the destination register when the right hand side doesn't live there
+    if (inRegister(i.dst) && !(inRegister(i.b) && value(i.b) == value(i.dst))) {
+        auto rd = value(i.dst);
+
+        if (value(i.a) != rd) {
+            text("movl", {value(i.a), rd});
+        }
+
+        text(op, {value(i.b), rd});
+        return;
+    }
+
+    text("movl", {value(i.a), "%eax"});
+    text(op, {value(i.b), "%eax"});
+    commit(i.dst);
+}
+
+void X86Backend::compare(const std::string& set, const Instruction& i)
+{
+    text("movl", {value(i.a), "%eax"});
+    text("cmpl", {value(i.b), "%eax"});
+    text(set, {"%al"});
+    text("movzbl", {"%al", "%eax"});
+    commit(i.dst);
+}
+
+void X86Backend::commit(const Operand& operand)
+{
+    text("movl", {"%eax", value(operand)});
+}
+
+void X86Backend::move(const std::string& source, const Operand& operand)
+{
+    auto destination = value(operand);
+
+    if (source == destination) {
+        return;
+    }
+
+    // at most one side can be in memory
+    if (inRegister(operand) || source[0] == '$' || source[0] == '%') {
+        text("movl", {source, destination});
+    } else {
+        text("movl", {source, "%eax"});
+        text("movl", {"%eax", destination});
+    }
+}
+
+void X86Backend::runtime(const std::string& function)
+{
+    // keep the current stack pointer twice, one of the copies is right above the aligned stack pointer
+    text("pushq", {"%rsp"});
+    text("pushq", {"(%rsp)"});
+    text("andq", {"$-16", "%rsp"});
+    text("call", {function});
+    text("movq", {"8(%rsp)", "%rsp"});
+}
+
+std::string X86Backend::wide(const std::string& reg)
+{
+    static const std::unordered_map<std::string, std::string> table = {
+        {"%eax", "%rax"}, {"%ecx", "%rcx"}, {"%edx", "%rdx"}, {"%esi", "%rsi"}, {"%edi", "%rdi"}, {"%ebp", "%rbp"},
+        {"%r8d", "%r8"}, {"%r9d", "%r9"}, {"%r10d", "%r10"}, {"%r11d", "%r11"},
+        {"%r13d", "%r13"}, {"%r14d", "%r14"}, {"%r15d", "%r15"},
+    };
+
+    return table.at(reg);
+}
+
+std::string X86Backend::functionLabel(const std::string& label) const
+{
+    return "moon_" + label;
+}
+
+std::string X86Backend::blockLabel(const BasicBlock* block) const
+{
+    // local to the assembly file
+    return ".L" + block->label();
+}
+
+void X86Backend::text(const std::string& op, const std::vector<std::string>& operands)
+{
+    s_ << '\t' << op;
+
+    for (std::size_t k = 0; k < operands.size(); ++k) {
+        s_ << (k == 0 ? "\t" : ", ") << operands[k];
+    }
+
+    s_ << std::endl;
+}
+
+void X86Backend::label(const std::string& label)
+{
+    s_ << label << ':' << std::endl;
+}
+
+void X86Backend::comment(const std::string& comment)
+{
+    s_ << "\t# " << comment << std::endl;
+}
+
+}}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "moonshine/ir/Program.h"
+#include "moonshine/code/LinearScanAllocator.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace moonshine { namespace code {
+
+/**
+ * Generates x86-64 GNU assembly (AT&T syntax) from three-address code, to be linked with the C runtime in
+ * res/moon_runtime.c, which provides main, console i/o and memory: `cc program.s moon_runtime.c`.
+ *
+ * The program keeps the memory layout of the Moon target: stack frames, objects and arrays live in a byte
+ * array of the runtime, addressed by 32 bit offsets from its start (kept in %rbx), so that addresses still fit
+ * in a word. %r12 is the stack frame pointer, as an offset into that array. Return addresses go on the native
+ * stack with call and ret instead of into the frame.
+ *
+ * Virtual registers are assigned by a LinearScanAllocator; spilled ones stay in their frame slot and are used
+ * straight from memory where an instruction allows it. %eax, %edx and %r11d are scratch registers, which also
+ * carry the arguments passed in registers, and results come back in %eax. Console i/o calls into the
+ * runtime following the System V calling convention.
+ */
+class X86Backend
+{
+public:
+    explicit X86Backend(std::ostream& s);
+
+    void emit(const ir::Program& program);
+private:
+    const std::string BASE = "%rbx";
+    const std::string SP = "%r12";
+    const std::string RV = "%eax";
+
+    // registers holding arguments passed in registers, the result comes back in RV
+    const std::vector<std::string> ARGS = {"%eax", "%edx", "%r11d"};
+
+    // callee saved registers, which the program saves for the runtime
+    const std::vector<std::string> SAVED = {"%rbx", "%rbp", "%r12", "%r13", "%r14", "%r15"};
+
+    std::ostream& s_;
+
+    LinearScanAllocator allocator_;
+
+    // per function state
+    const ir::Function* function_ = nullptr;
+    int frameSize_ = 0;
+
+    void emit(const ir::Function& function);
+    void emit(const ir::Instruction& instruction, const ir::BasicBlock* next);
+
+    void allocate(const ir::Function& function);
+    void save(const ir::Instruction& instruction);
+    void restore(const ir::Instruction& instruction);
+
+    // an operand as an immediate, a register or its spill slot
+    std::string value(const ir::Operand& operand) const;
+    std::string slot(const int& reg) const;
+    bool inRegister(const ir::Operand& operand) const;
+
+    // a memory location, loading a spilled base address into %rdx
+    std::string memory(const ir::Address& address);
+
+    // computes into %eax and moves the result into the operand, or straight into its register
+    void binary(const std::string& op, const ir::Instruction& instruction);
+    void compare(const std::string& set, const ir::Instruction& instruction);
+    void commit(const ir::Operand& operand);
+    void move(const std::string& source, const ir::Operand& operand);
+
+    // calls into the runtime with a 16 byte aligned stack
+    void runtime(const std::string& function);
+
+    static std::string wide(const std::string& reg);
+    std::string functionLabel(const std::string& label) const;
+    std::string blockLabel(const ir::BasicBlock* block) const;
+
+    void text(const std::string& op, const std::vector<std::string>& operands = {});
+    void label(const std::string& label);
+    void comment(const std::string& comment);
+};
+
+}}
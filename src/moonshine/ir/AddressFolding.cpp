@@ -0,0 +1,119 @@
+#include "moonshine/ir/AddressFolding.h"
+
+namespace moonshine { namespace ir {
+
+void AddressFolding::run(Program& program)
+{
+    for (auto& function : program.functions()) {
+        run(*function);
+    }
+}
+
+void AddressFolding::run(Function& function)
+{
+    for (auto& block : function.blocks()) {
+        known_.clear();
+
+        for (auto& instruction : block->instructions()) {
+            if (instruction.hasAddress() && instruction.address.base == Address::Base::REGISTER) {
+                auto address = resolve(instruction.address);
+
+                if (address != instruction.address) {
+                    instruction.address = address;
+                    ++folded_;
+                }
+            }
+
+            auto def = instruction.def();
+
+            if (def < 0) {
+                continue;
+            }
+
+            Address address;
+            bool isAddress = compute(instruction, address);
+
+            define(def);
+
+            // an address relative to the register being written is gone with its old value
+            if (isAddress && !(address.base == Address::Base::REGISTER && address.reg == def)) {
+                known_[def] = address;
+
+                // arithmetic that collapses to a frame location doesn't need its operands any more
+                if (instruction.op != Opcode::ADDRESS && address.base != Address::Base::REGISTER) {
+                    instruction.op = Opcode::ADDRESS;
+                    instruction.address = address;
+                    instruction.a = Operand();
+                    instruction.b = Operand();
+                    ++folded_;
+                }
+            }
+        }
+    }
+}
+
+unsigned int AddressFolding::folded() const
+{
+    return folded_;
+}
+
+Address AddressFolding::resolve(const Address& address) const
+{
+    if (address.base != Address::Base::REGISTER) {
+        return address;
+    }
+
+    auto known = known_.find(address.reg);
+    return known == known_.end() ? address : known->second + address.offset;
+}
+
+bool AddressFolding::compute(const Instruction& instruction, Address& address) const
+{
+    const auto& a = instruction.a;
+    const auto& b = instruction.b;
+
+    switch (instruction.op) {
+        case Opcode::ADDRESS:
+            address = resolve(instruction.address);
+            return true;
+        case Opcode::MOVE:
+            if (a.isRegister()) {
+                address = resolve(Address::indirect(a.value));
+                return true;
+            }
+            return false;
+        case Opcode::ADD:
+            if (a.isRegister() && b.isImmediate()) {
+                address = resolve(Address::indirect(a.value, b.value));
+                return true;
+            }
+            if (a.isImmediate() && b.isRegister()) {
+                address = resolve(Address::indirect(b.value, a.value));
+                return true;
+            }
+            return false;
+        case Opcode::SUB:
+            if (a.isRegister() && b.isImmediate()) {
+                address = resolve(Address::indirect(a.value, -b.value));
+                return true;
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+void AddressFolding::define(const int& reg)
+{
+    known_.erase(reg);
+
+    for (auto it = known_.begin(); it != known_.end();) {
+        if (it->second.base == Address::Base::REGISTER && it->second.reg == reg) {
+            it = known_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+}}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "moonshine/ir/Program.h"
+
+#include <map>
+
+namespace moonshine { namespace ir {
+
+/**
+ * Folds address arithmetic with constant displacements into the addresses of loads and stores.
+ *
+ * Within a block, registers holding an address plus a constant (ADDRESS, add or sub of an immediate, or a
+ * copy) are tracked back to a frame location or another register, so `%2 = add %1, 8; load [%2]` with
+ * `%1 = address [frame-20]` becomes `load [frame-12]`. Constant array indices end up costing nothing once
+ * ConstantPropagation has turned them into immediates. The arithmetic left unused is removed by
+ * DeadCodeElimination.
+ */
+class AddressFolding
+{
+public:
+    void run(Program& program);
+    void run(Function& function);
+
+    // over every run
+    unsigned int folded() const;
+private:
+    unsigned int folded_ = 0;
+
+    // the address each register is known to hold in the current block
+    std::map<int, Address> known_;
+
+    Address resolve(const Address& address) const;
+    bool compute(const Instruction& instruction, Address& address) const;
+    void define(const int& reg);
+};
+
+}}
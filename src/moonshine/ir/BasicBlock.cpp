@@ -0,0 +1,60 @@
+#include "moonshine/ir/BasicBlock.h"
+
+namespace moonshine { namespace ir {
+
+BasicBlock::BasicBlock(const unsigned int& id, const std::string& label)
+    : id_(id), label_(label)
+{
+}
+
+unsigned int BasicBlock::id() const
+{
+    return id_;
+}
+
+const std::string& BasicBlock::label() const
+{
+    return label_;
+}
+
+std::vector<Instruction>& BasicBlock::instructions()
+{
+    return instructions_;
+}
+
+const std::vector<Instruction>& BasicBlock::instructions() const
+{
+    return instructions_;
+}
+
+Instruction& BasicBlock::append(const Instruction& instruction)
+{
+    instructions_.push_back(instruction);
+    return instructions_.back();
+}
+
+bool BasicBlock::isTerminated() const
+{
+    return terminator() != nullptr;
+}
+
+const Instruction* BasicBlock::terminator() const
+{
+    if (instructions_.empty() || !instructions_.back().isTerminator()) {
+        return nullptr;
+    }
+
+    return &instructions_.back();
+}
+
+const std::vector<BasicBlock*>& BasicBlock::successors() const
+{
+    return successors_;
+}
+
+const std::vector<BasicBlock*>& BasicBlock::predecessors() const
+{
+    return predecessors_;
+}
+
+}}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "moonshine/ir/Instruction.h"
+
+#include <string>
+#include <vector>
+
+namespace moonshine { namespace ir {
+
+/**
+ * A straight-line sequence of instructions that ends with a single terminator.
+ */
+class BasicBlock
+{
+public:
+    BasicBlock(const unsigned int& id, const std::string& label);
+
+    unsigned int id() const;
+    const std::string& label() const;
+
+    std::vector<Instruction>& instructions();
+    const std::vector<Instruction>& instructions() const;
+    Instruction& append(const Instruction& instruction);
+
+    bool isTerminated() const;
+    const Instruction* terminator() const;
+
+    // set by Function::buildCFG()
+    const std::vector<BasicBlock*>& successors() const;
+    const std::vector<BasicBlock*>& predecessors() const;
+private:
+    friend class Function;
+
+    unsigned int id_;
+    std::string label_;
+    std::vector<Instruction> instructions_;
+    std::vector<BasicBlock*> successors_;
+    std::vector<BasicBlock*> predecessors_;
+};
+
+}}
@@ -0,0 +1,360 @@
+#include "moonshine/ir/ConstantPropagation.h"
+
+namespace moonshine { namespace ir {
+
+ConstantPropagation::Value ConstantPropagation::Value::makeConstant(const int& value)
+{
+    Value v;
+    v.state = State::CONSTANT;
+    v.constant = value;
+    return v;
+}
+
+ConstantPropagation::Value ConstantPropagation::Value::makeVarying()
+{
+    Value v;
+    v.state = State::VARYING;
+    return v;
+}
+
+void ConstantPropagation::Value::meet(const Value& other)
+{
+    if (state == State::UNDEFINED) {
+        *this = other;
+    } else if (other.state == State::VARYING || (other.isConstant() && isConstant() && other.constant != constant)) {
+        state = State::VARYING;
+    }
+}
+
+bool ConstantPropagation::Value::operator!=(const Value& rhs) const
+{
+    return state != rhs.state || (state == State::CONSTANT && constant != rhs.constant);
+}
+
+void ConstantPropagation::run(Program& program)
+{
+    for (auto& function : program.functions()) {
+        run(*function);
+    }
+}
+
+void ConstantPropagation::run(Function& function)
+{
+    out_.clear();
+    edges_.clear();
+
+    // iterate until neither the values nor the set of executable edges change
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+
+        for (const auto& block : function.blocks()) {
+            if (!isExecutable(function, block.get())) {
+                continue;
+            }
+
+            auto state = in(function, block.get());
+
+            for (const auto& instruction : block->instructions()) {
+                transfer(instruction, state);
+            }
+
+            auto& out = out_[block.get()];
+
+            if (out.size() != state.size()) {
+                out = state;
+                changed = true;
+            } else {
+                for (State::size_type v = 0; v < state.size(); ++v) {
+                    if (out[v] != state[v]) {
+                        out = state;
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+
+            for (auto successor : successors(*block->terminator(), state)) {
+                if (edges_.emplace(block.get(), successor).second) {
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    for (auto& block : function.blocks()) {
+        if (!isExecutable(function, block.get())) {
+            continue;
+        }
+
+        auto state = in(function, block.get());
+
+        for (auto& instruction : block->instructions()) {
+            rewrite(instruction, state);
+            transfer(instruction, state);
+        }
+    }
+
+    // blocks behind pruned branches are gone
+    function.buildCFG();
+}
+
+unsigned int ConstantPropagation::foldedInstructions() const
+{
+    return foldedInstructions_;
+}
+
+unsigned int ConstantPropagation::foldedOperands() const
+{
+    return foldedOperands_;
+}
+
+unsigned int ConstantPropagation::prunedBranches() const
+{
+    return prunedBranches_;
+}
+
+bool ConstantPropagation::isExecutable(const Function& function, const BasicBlock* block) const
+{
+    if (block == function.entry()) {
+        return true;
+    }
+
+    for (auto predecessor : block->predecessors()) {
+        if (edges_.count(std::make_pair(predecessor, block))) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+ConstantPropagation::State ConstantPropagation::in(const Function& function, const BasicBlock* block) const
+{
+    auto count = static_cast<State::size_type>(function.registerCount());
+
+    // nothing is known about registers on entry
+    if (block == function.entry()) {
+        return State(count, Value::makeVarying());
+    }
+
+    State state(count);
+
+    for (auto predecessor : block->predecessors()) {
+        auto out = out_.find(predecessor);
+
+        if (out == out_.end() || !edges_.count(std::make_pair(predecessor, block))) {
+            continue;
+        }
+
+        for (State::size_type v = 0; v < count; ++v) {
+            state[v].meet(out->second[v]);
+        }
+    }
+
+    return state;
+}
+
+void ConstantPropagation::transfer(const Instruction& instruction, State& state) const
+{
+    auto def = instruction.def();
+
+    if (def < 0) {
+        return;
+    }
+
+    auto a = value(instruction.a, state);
+    auto b = value(instruction.b, state);
+    Value result;
+
+    switch (instruction.op) {
+        case Opcode::MOVE:
+            result = a;
+            break;
+        case Opcode::NOT:
+            if (a.isConstant()) {
+                result = Value::makeConstant(a.constant == 0);
+            } else {
+                result = a;
+            }
+            break;
+        case Opcode::ADD:
+        case Opcode::SUB:
+        case Opcode::MUL:
+        case Opcode::DIV:
+        case Opcode::AND:
+        case Opcode::OR:
+        case Opcode::CEQ:
+        case Opcode::CNE:
+        case Opcode::CLT:
+        case Opcode::CLE:
+        case Opcode::CGT:
+        case Opcode::CGE: {
+            int constant;
+
+            // one side is enough to know the result
+            if ((instruction.op == Opcode::MUL || instruction.op == Opcode::AND)
+                && ((a.isConstant() && a.constant == 0) || (b.isConstant() && b.constant == 0))) {
+                result = Value::makeConstant(0);
+            } else if (instruction.op == Opcode::OR
+                       && ((a.isConstant() && a.constant != 0) || (b.isConstant() && b.constant != 0))) {
+                result = Value::makeConstant(1);
+            } else if (a.isConstant() && b.isConstant()) {
+                result = evaluate(instruction.op, a.constant, b.constant, constant) ? Value::makeConstant(constant)
+                                                                                    : Value::makeVarying();
+            } else if (a.state == Value::State::VARYING || b.state == Value::State::VARYING) {
+                result = Value::makeVarying();
+            }
+            break;
+        }
+        default:
+            // loads, addresses and input
+            result = Value::makeVarying();
+            break;
+    }
+
+    state[def] = result;
+}
+
+ConstantPropagation::Value ConstantPropagation::value(const Operand& operand, const State& state) const
+{
+    if (operand.isImmediate()) {
+        return Value::makeConstant(operand.value);
+    }
+
+    if (operand.isRegister()) {
+        return state[operand.value];
+    }
+
+    return Value();
+}
+
+std::vector<BasicBlock*> ConstantPropagation::successors(const Instruction& terminator, const State& state) const
+{
+    if (terminator.op == Opcode::BRANCH) {
+        auto condition = value(terminator.a, state);
+
+        if (condition.isConstant()) {
+            return {terminator.targets[condition.constant != 0 ? 0 : 1]};
+        }
+
+        // nothing is known yet, so neither side is taken yet
+        if (condition.state == Value::State::UNDEFINED) {
+            return {};
+        }
+    }
+
+    std::vector<BasicBlock*> targets;
+
+    for (auto target : terminator.targets) {
+        if (target) {
+            targets.push_back(target);
+        }
+    }
+
+    return targets;
+}
+
+void ConstantPropagation::rewrite(Instruction& instruction, const State& state)
+{
+    if (instruction.op == Opcode::BRANCH) {
+        auto condition = value(instruction.a, state);
+
+        if (condition.isConstant()) {
+            auto target = instruction.targets[condition.constant != 0 ? 0 : 1];
+
+            instruction.op = Opcode::JUMP;
+            instruction.a = Operand();
+            instruction.targets[0] = target;
+            instruction.targets[1] = nullptr;
+            ++prunedBranches_;
+        }
+
+        return;
+    }
+
+    auto def = instruction.def();
+
+    if (def >= 0 && instruction.op != Opcode::LOAD && instruction.op != Opcode::ADDRESS && instruction.op != Opcode::READ) {
+        State after = state;
+        transfer(instruction, after);
+
+        if (after[def].isConstant()) {
+            if (instruction.op != Opcode::MOVE || !instruction.a.isImmediate()) {
+                instruction.op = Opcode::MOVE;
+                instruction.a = Operand::imm(after[def].constant);
+                instruction.b = Operand();
+                ++foldedInstructions_;
+            }
+
+            return;
+        }
+    }
+
+    for (auto operand : {&instruction.a, &instruction.b}) {
+        auto v = value(*operand, state);
+
+        if (operand->isRegister() && v.isConstant()) {
+            *operand = Operand::imm(v.constant);
+            ++foldedOperands_;
+        }
+    }
+
+    // x + 0, x - 0, x * 1 and x / 1 are just x
+    auto isImmediate = [](const Operand& operand, const int& value) {
+        return operand.isImmediate() && operand.value == value;
+    };
+
+    Operand same;
+
+    if (((instruction.op == Opcode::ADD || instruction.op == Opcode::SUB) && isImmediate(instruction.b, 0))
+        || ((instruction.op == Opcode::MUL || instruction.op == Opcode::DIV) && isImmediate(instruction.b, 1))) {
+        same = instruction.a;
+    } else if ((instruction.op == Opcode::ADD && isImmediate(instruction.a, 0))
+               || (instruction.op == Opcode::MUL && isImmediate(instruction.a, 1))) {
+        same = instruction.b;
+    }
+
+    if (!same.isNone()) {
+        instruction.op = Opcode::MOVE;
+        instruction.a = same;
+        instruction.b = Operand();
+        ++foldedInstructions_;
+    }
+}
+
+bool ConstantPropagation::evaluate(const Opcode& op, const int& a, const int& b, int& result)
+{
+    // arithmetic wraps around like it does on the target
+    auto x = static_cast<long long>(a);
+    auto y = static_cast<long long>(b);
+    long long r;
+
+    switch (op) {
+        case Opcode::ADD: r = x + y; break;
+        case Opcode::SUB: r = x - y; break;
+        case Opcode::MUL: r = x * y; break;
+        case Opcode::DIV:
+            if (y == 0) {
+                return false;
+            }
+            r = x / y;
+            break;
+        case Opcode::AND: r = x != 0 && y != 0; break;
+        case Opcode::OR: r = x != 0 || y != 0; break;
+        case Opcode::CEQ: r = x == y; break;
+        case Opcode::CNE: r = x != y; break;
+        case Opcode::CLT: r = x < y; break;
+        case Opcode::CLE: r = x <= y; break;
+        case Opcode::CGT: r = x > y; break;
+        case Opcode::CGE: r = x >= y; break;
+        default:
+            return false;
+    }
+
+    result = static_cast<int>(static_cast<unsigned int>(r & 0xffffffffLL));
+    return true;
+}
+
+}}
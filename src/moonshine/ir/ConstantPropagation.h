@@ -0,0 +1,74 @@
+#pragma once
+
+#include "moonshine/ir/Program.h"
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace moonshine { namespace ir {
+
+/**
+ * Finds the virtual registers that hold the same constant on every path reaching an instruction, only
+ * following branches that can actually be taken given what is already known (conditional constant
+ * propagation).
+ *
+ * Instructions computing a constant become moves of an immediate, constant operands become immediates and
+ * branches on a constant become jumps, leaving the other side unreachable. Local scalar variables live in
+ * registers, so known-constant locals are propagated too. Run DeadCodeElimination afterwards to drop what is
+ * no longer used.
+ */
+class ConstantPropagation
+{
+public:
+    void run(Program& program);
+    void run(Function& function);
+
+    // over every run
+    unsigned int foldedInstructions() const;
+    unsigned int foldedOperands() const;
+    unsigned int prunedBranches() const;
+private:
+    struct Value
+    {
+        enum class State
+        {
+            UNDEFINED,
+            CONSTANT,
+            VARYING,
+        };
+
+        State state = State::UNDEFINED;
+        int constant = 0;
+
+        static Value makeConstant(const int& value);
+        static Value makeVarying();
+
+        inline bool isConstant() const { return state == State::CONSTANT; }
+
+        // the value on a path merge
+        void meet(const Value& other);
+        bool operator!=(const Value& rhs) const;
+    };
+
+    typedef std::vector<Value> State;
+
+    unsigned int foldedInstructions_ = 0;
+    unsigned int foldedOperands_ = 0;
+    unsigned int prunedBranches_ = 0;
+
+    std::map<const BasicBlock*, State> out_;
+    std::set<std::pair<const BasicBlock*, const BasicBlock*>> edges_;
+
+    bool isExecutable(const Function& function, const BasicBlock* block) const;
+    State in(const Function& function, const BasicBlock* block) const;
+    void transfer(const Instruction& instruction, State& state) const;
+    Value value(const Operand& operand, const State& state) const;
+    std::vector<BasicBlock*> successors(const Instruction& terminator, const State& state) const;
+    void rewrite(Instruction& instruction, const State& state);
+
+    static bool evaluate(const Opcode& op, const int& a, const int& b, int& result);
+};
+
+}}
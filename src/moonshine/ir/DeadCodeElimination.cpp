@@ -0,0 +1,73 @@
+#include "moonshine/ir/DeadCodeElimination.h"
+#include "moonshine/ir/Liveness.h"
+
+namespace moonshine { namespace ir {
+
+void DeadCodeElimination::run(Program& program)
+{
+    for (auto& function : program.functions()) {
+        run(*function);
+    }
+}
+
+void DeadCodeElimination::run(Function& function)
+{
+    bool changed = true;
+
+    // removing an instruction can make the ones feeding it dead, in other blocks too
+    while (changed) {
+        changed = false;
+
+        Liveness liveness(function);
+
+        for (auto& block : function.blocks()) {
+            auto live = liveness.liveOut(block.get());
+            auto& instructions = block->instructions();
+
+            for (auto i = instructions.size(); i-- > 0;) {
+                const auto& instruction = instructions[i];
+                auto def = instruction.def();
+
+                if (def >= 0 && !live[def] && !hasSideEffects(instruction)) {
+                    instructions.erase(instructions.begin() + i);
+                    ++removed_;
+                    changed = true;
+                    continue;
+                }
+
+                if (def >= 0) {
+                    live[def] = false;
+                }
+
+                for (auto v : instruction.uses()) {
+                    live[v] = true;
+                }
+            }
+        }
+    }
+}
+
+unsigned int DeadCodeElimination::removed() const
+{
+    return removed_;
+}
+
+bool DeadCodeElimination::hasSideEffects(const Instruction& instruction)
+{
+    switch (instruction.op) {
+        case Opcode::STORE:
+        case Opcode::CALL:
+        case Opcode::READ:
+        case Opcode::WRITE:
+        case Opcode::JUMP:
+        case Opcode::BRANCH:
+        case Opcode::RETURN:
+        case Opcode::HALT:
+        case Opcode::TAILCALL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+}}
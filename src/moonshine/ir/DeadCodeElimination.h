@@ -0,0 +1,24 @@
+#pragma once
+
+#include "moonshine/ir/Program.h"
+
+namespace moonshine { namespace ir {
+
+/**
+ * Removes instructions without side effects whose result is never read, until none are left.
+ */
+class DeadCodeElimination
+{
+public:
+    void run(Program& program);
+    void run(Function& function);
+
+    // over every run
+    unsigned int removed() const;
+private:
+    unsigned int removed_ = 0;
+
+    static bool hasSideEffects(const Instruction& instruction);
+};
+
+}}
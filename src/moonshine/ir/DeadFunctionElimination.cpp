@@ -0,0 +1,57 @@
+#include "moonshine/ir/DeadFunctionElimination.h"
+
+#include <set>
+#include <vector>
+
+namespace moonshine { namespace ir {
+
+void DeadFunctionElimination::run(Program& program)
+{
+    std::set<const Function*> reachable;
+    std::vector<const Function*> work;
+
+    for (const auto& function : program.functions()) {
+        if (function->isProgram()) {
+            reachable.insert(function.get());
+            work.push_back(function.get());
+        }
+    }
+
+    // walk the call graph from the main program
+    while (!work.empty()) {
+        auto function = work.back();
+        work.pop_back();
+
+        for (const auto& block : function->blocks()) {
+            for (const auto& instruction : block->instructions()) {
+                if (instruction.op != Opcode::CALL && instruction.op != Opcode::TAILCALL) {
+                    continue;
+                }
+
+                auto callee = program.function(instruction.callee);
+
+                if (callee && reachable.insert(callee).second) {
+                    work.push_back(callee);
+                }
+            }
+        }
+    }
+
+    auto& functions = program.functions();
+
+    for (auto it = functions.begin(); it != functions.end();) {
+        if (reachable.count(it->get())) {
+            ++it;
+        } else {
+            it = functions.erase(it);
+            ++removed_;
+        }
+    }
+}
+
+unsigned int DeadFunctionElimination::removed() const
+{
+    return removed_;
+}
+
+}}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "moonshine/ir/Program.h"
+
+namespace moonshine { namespace ir {
+
+/**
+ * Removes the functions that can't be reached from the main program through calls.
+ *
+ * Member functions are called by their label like any other function, so the members of a class whose
+ * functions are never called, or only called from dead code, go as well. Run it after inlining and branch
+ * pruning, which both remove calls.
+ */
+class DeadFunctionElimination
+{
+public:
+    void run(Program& program);
+
+    // over every run
+    unsigned int removed() const;
+private:
+    unsigned int removed_ = 0;
+};
+
+}}
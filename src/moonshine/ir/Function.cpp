@@ -0,0 +1,200 @@
+#include "moonshine/ir/Function.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace moonshine { namespace ir {
+
+Function::Function(const std::string& name, const std::string& label, const bool& isProgram)
+    : name_(name), label_(label), isProgram_(isProgram)
+{
+}
+
+const std::string& Function::name() const
+{
+    return name_;
+}
+
+const std::string& Function::label() const
+{
+    return label_;
+}
+
+bool Function::isProgram() const
+{
+    return isProgram_;
+}
+
+int Function::frameSize() const
+{
+    return frameSize_;
+}
+
+void Function::setFrameSize(const int& size)
+{
+    frameSize_ = size;
+}
+
+int Function::returnSize() const
+{
+    return returnSize_;
+}
+
+void Function::setReturnSize(const int& size)
+{
+    returnSize_ = size;
+}
+
+int Function::returnAddressOffset() const
+{
+    return -returnSize_ - 4;
+}
+
+const std::vector<int>& Function::scalarParameters() const
+{
+    return scalarParameters_;
+}
+
+void Function::addScalarParameter(const int& offset)
+{
+    scalarParameters_.push_back(offset);
+}
+
+BasicBlock* Function::createBlock(const std::string& label)
+{
+    blocks_.emplace_back(new BasicBlock(nextBlockId_++, label));
+    return blocks_.back().get();
+}
+
+void Function::moveToEnd(BasicBlock* block)
+{
+    auto it = std::find_if(blocks_.begin(), blocks_.end(), [block](const std::unique_ptr<BasicBlock>& b) {
+        return b.get() == block;
+    });
+
+    if (it != blocks_.end()) {
+        std::rotate(it, it + 1, blocks_.end());
+    }
+}
+
+void Function::moveAfter(BasicBlock* block, const BasicBlock* position)
+{
+    auto find = [this](const BasicBlock* block) {
+        return std::find_if(blocks_.begin(), blocks_.end(), [block](const std::unique_ptr<BasicBlock>& b) {
+            return b.get() == block;
+        });
+    };
+
+    auto it = find(block);
+
+    if (it == blocks_.end() || find(position) == blocks_.end()) {
+        return;
+    }
+
+    auto moved = std::move(*it);
+    blocks_.erase(it);
+    blocks_.insert(find(position) + 1, std::move(moved));
+}
+
+BasicBlock* Function::entry() const
+{
+    return blocks_.empty() ? nullptr : blocks_.front().get();
+}
+
+std::vector<std::unique_ptr<BasicBlock>>& Function::blocks()
+{
+    return blocks_;
+}
+
+const std::vector<std::unique_ptr<BasicBlock>>& Function::blocks() const
+{
+    return blocks_;
+}
+
+int Function::createRegister()
+{
+    return registers_++;
+}
+
+int Function::registerCount() const
+{
+    return registers_;
+}
+
+void Function::buildCFG()
+{
+    for (auto& block : blocks_) {
+        block->successors_.clear();
+        block->predecessors_.clear();
+
+        auto terminator = block->terminator();
+
+        if (!terminator) {
+            throw std::logic_error("Function::buildCFG: block " + block->label() + " has no terminator");
+        }
+
+        for (auto target : terminator->targets) {
+            if (target && std::find(block->successors_.begin(), block->successors_.end(), target) == block->successors_.end()) {
+                block->successors_.push_back(target);
+            }
+        }
+    }
+
+    // mark everything reachable from the entry block
+    std::vector<bool> reachable(nextBlockId_, false);
+    std::vector<BasicBlock*> work;
+
+    if (entry()) {
+        reachable[entry()->id()] = true;
+        work.push_back(entry());
+    }
+
+    while (!work.empty()) {
+        auto block = work.back();
+        work.pop_back();
+
+        for (auto successor : block->successors_) {
+            if (!reachable[successor->id()]) {
+                reachable[successor->id()] = true;
+                work.push_back(successor);
+            }
+        }
+    }
+
+    blocks_.erase(std::remove_if(blocks_.begin(), blocks_.end(), [&reachable](const std::unique_ptr<BasicBlock>& block) {
+        return !reachable[block->id()];
+    }), blocks_.end());
+
+    for (auto& block : blocks_) {
+        for (auto successor : block->successors_) {
+            successor->predecessors_.push_back(block.get());
+        }
+    }
+}
+
+void Function::print(std::ostream& s) const
+{
+    s << (isProgram_ ? "program" : "function") << ' ' << label_
+      << " (frame " << frameSize_ << ", return " << returnSize_ << ")" << std::endl;
+
+    for (const auto& block : blocks_) {
+        s << block->label() << ':';
+
+        if (!block->predecessors().empty()) {
+            s << " ; from";
+            for (auto predecessor : block->predecessors()) {
+                s << ' ' << predecessor->label();
+            }
+        }
+
+        s << std::endl;
+
+        for (const auto& instruction : block->instructions()) {
+            s << "    ";
+            instruction.print(s);
+            s << std::endl;
+        }
+    }
+}
+
+}}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "moonshine/ir/BasicBlock.h"
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace moonshine { namespace ir {
+
+/**
+ * A function (or the main program) as a control flow graph of basic blocks. The first block is the entry.
+ *
+ * The stack frame layout is the one computed by the MemorySizeComputerVisitor: the return value sits at the
+ * top of the frame, followed by the return address, then parameters, locals and temporaries.
+ */
+class Function
+{
+public:
+    Function(const std::string& name, const std::string& label, const bool& isProgram);
+
+    const std::string& name() const;
+    const std::string& label() const;
+    bool isProgram() const;
+
+    int frameSize() const;
+    void setFrameSize(const int& size);
+    int returnSize() const;
+    void setReturnSize(const int& size);
+    int returnAddressOffset() const;
+
+    // frame offsets of the scalar parameters, which the entry block loads into registers first
+    const std::vector<int>& scalarParameters() const;
+    void addScalarParameter(const int& offset);
+
+    BasicBlock* createBlock(const std::string& label);
+
+    // blocks are laid out in the order of the list, moving a block to the end lets it follow the code emitted so far
+    void moveToEnd(BasicBlock* block);
+    void moveAfter(BasicBlock* block, const BasicBlock* position);
+    BasicBlock* entry() const;
+    std::vector<std::unique_ptr<BasicBlock>>& blocks();
+    const std::vector<std::unique_ptr<BasicBlock>>& blocks() const;
+
+    int createRegister();
+    int registerCount() const;
+
+    // link up block successors and predecessors, dropping blocks that can't be reached from the entry
+    void buildCFG();
+
+    void print(std::ostream& s) const;
+private:
+    std::string name_;
+    std::string label_;
+    bool isProgram_;
+    int frameSize_ = 0;
+    int returnSize_ = 0;
+    std::vector<int> scalarParameters_;
+    int registers_ = 0;
+    unsigned int nextBlockId_ = 0;
+    std::vector<std::unique_ptr<BasicBlock>> blocks_;
+};
+
+}}
@@ -0,0 +1,703 @@
+#include "moonshine/ir/IRBuilderVisitor.h"
+
+#include "moonshine/lexer/TokenType.h"
+#include "moonshine/semantic/Type.h"
+
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace moonshine { namespace ir {
+
+using namespace semantic;
+
+IRBuilderVisitor::IRBuilderVisitor(Program& program)
+    : program_(program)
+{
+}
+
+void IRBuilderVisitor::visit(ast::prog* node)
+{
+    // functions first, then the main program
+    node->child(1)->accept(this);
+
+    auto body = node->child(2);
+    auto function = program_.createFunction("program", "program", true);
+    function->setFrameSize(body->symbolTable()->size());
+
+    functionEntry_ = nullptr;
+    beginFunction(function);
+    body->accept(this);
+
+    if (!block_->isTerminated()) {
+        emit(Instruction(Opcode::HALT));
+    }
+
+    function->buildCFG();
+}
+
+void IRBuilderVisitor::visit(ast::funcDef* node)
+{
+    auto entry = node->symbolTableEntry();
+
+    if (!entry) {
+        return;
+    }
+
+    auto table = node->symbolTable();
+    auto type = dynamic_cast<const FunctionType*>(entry->type());
+    auto function = program_.createFunction(entry->name(), functionLabel(entry));
+
+    function->setFrameSize(table->size());
+    function->setReturnSize(typeSize(table, type->returnType));
+
+    functionEntry_ = entry;
+    beginFunction(function);
+    node->child(4)->accept(this);
+
+    if (!block_->isTerminated()) {
+        emit(Instruction(Opcode::RETURN));
+    }
+
+    function->buildCFG();
+}
+
+void IRBuilderVisitor::visit(ast::num* node)
+{
+    Value value;
+
+    // floats are not supported by the target, only their integral part is kept
+    value.scalar = Operand::imm(std::stoi(node->token()->value));
+    values_[node] = value;
+}
+
+void IRBuilderVisitor::visit(ast::sign* node)
+{
+    Value value;
+
+    switch (node->token()->type) {
+        case TokenType::T_MINUS:
+            value.scalar = binary(Opcode::SUB, Operand::imm(0), rvalue(node->child()));
+            break;
+        default:
+            value.scalar = rvalue(node->child());
+            break;
+    }
+
+    values_[node] = value;
+}
+
+void IRBuilderVisitor::visit(ast::var* node)
+{
+    auto table = node->closestSymbolTable();
+
+    Value value;
+
+    // class of the data the chain is currently at, if any
+    SymbolTableEntry* cls = nullptr;
+
+    for (auto child = node->child(); child != nullptr; child = child->next()) {
+        bool first = child == node->child();
+
+        if (auto member = dynamic_cast<ast::dataMember*>(child)) {
+            auto entry = member->symbolTableEntry();
+            auto owner = classOf(entry);
+            auto type = dynamic_cast<const VariableType*>(entry->type());
+            Address location;
+
+            if (!first) {
+                // members are placed from the top of the object down, supers below the class' own members
+                int offset = 0;
+                subobjectOffset(cls, owner, offset);
+                location = value.address + (cls->size() - offset - entry->offset());
+            } else if (owner) {
+                // a member of the class this function belongs to
+                location = Address::indirect(thisPointer(owner).value, -entry->offset());
+            } else if (variable(entry) >= 0) {
+                value = Value();
+                value.variable = variable(entry);
+                value.scalar = Operand::reg(value.variable);
+                continue;
+            } else {
+                location = Address::frame(frameDisplacement(entry->parentTable()) - entry->offset());
+            }
+
+            // one cell is an object of the element class, or a scalar
+            int cellSize = entry->size();
+
+            if (type->type == Type::CLASS) {
+                cellSize = (*table)[type->className]->size();
+            } else {
+                for (const auto& i : type->indices) {
+                    cellSize /= i;
+                }
+            }
+
+            // array cells are laid out in row-major order from the start of the array
+            if (member->child(1)->child()) {
+                Operand index;
+                std::vector<unsigned int>::size_type i = 0;
+
+                for (auto n = member->child(1)->child(); n != nullptr; n = n->next(), ++i) {
+                    auto v = rvalue(n);
+                    index = i == 0 ? v : binary(Opcode::ADD, binary(Opcode::MUL, index, Operand::imm(type->indices[i])), v);
+                }
+
+                auto offset = binary(Opcode::MUL, index, Operand::imm(cellSize));
+                location = Address::indirect(binary(Opcode::ADD, address(location), offset).value);
+            }
+
+            value = Value();
+            value.address = location;
+            value.inMemory = true;
+            value.size = cellSize;
+
+            cls = type->type == Type::CLASS ? (*table)[type->className] : nullptr;
+        } else if (auto fCall = dynamic_cast<ast::fCall*>(child)) {
+            value = call(fCall, first ? nullptr : cls, first ? nullptr : &value);
+
+            auto type = dynamic_cast<const FunctionType*>(fCall->symbolTableEntry()->type());
+            cls = type->returnType->type == Type::CLASS ? (*table)[type->returnType->className] : nullptr;
+        }
+    }
+
+    values_[node] = value;
+}
+
+void IRBuilderVisitor::visit(ast::addOp* node)
+{
+    auto a = rvalue(node->child(0));
+    auto b = rvalue(node->child(1));
+
+    Value value;
+
+    switch (node->token()->type) {
+        case TokenType::T_PLUS:
+            value.scalar = binary(Opcode::ADD, a, b);
+            break;
+        case TokenType::T_MINUS:
+            value.scalar = binary(Opcode::SUB, a, b);
+            break;
+        case TokenType::T_OR:
+            value.scalar = binary(Opcode::OR, a, b);
+            break;
+        default:
+            throw std::runtime_error("IRBuilderVisitor::visit(addOp): Invalid operator");
+    }
+
+    values_[node] = value;
+}
+
+void IRBuilderVisitor::visit(ast::multOp* node)
+{
+    auto a = rvalue(node->child(0));
+    auto b = rvalue(node->child(1));
+
+    Value value;
+
+    switch (node->token()->type) {
+        case TokenType::T_MUL:
+            value.scalar = binary(Opcode::MUL, a, b);
+            break;
+        case TokenType::T_DIV:
+            value.scalar = binary(Opcode::DIV, a, b);
+            break;
+        case TokenType::T_AND:
+            value.scalar = binary(Opcode::AND, a, b);
+            break;
+        default:
+            throw std::runtime_error("IRBuilderVisitor::visit(multOp): Invalid operator");
+    }
+
+    values_[node] = value;
+}
+
+void IRBuilderVisitor::visit(ast::relOp* node)
+{
+    auto a = rvalue(node->child(0));
+    auto b = rvalue(node->child(1));
+
+    Value value;
+
+    switch (node->token()->type) {
+        case TokenType::T_IS_SMALLER:
+            value.scalar = binary(Opcode::CLT, a, b);
+            break;
+        case TokenType::T_IS_SMALLER_OR_EQUAL:
+            value.scalar = binary(Opcode::CLE, a, b);
+            break;
+        case TokenType::T_IS_GREATER:
+            value.scalar = binary(Opcode::CGT, a, b);
+            break;
+        case TokenType::T_IS_GREATER_OR_EQUAL:
+            value.scalar = binary(Opcode::CGE, a, b);
+            break;
+        case TokenType::T_IS_EQUAL:
+            value.scalar = binary(Opcode::CEQ, a, b);
+            break;
+        case TokenType::T_IS_NOT_EQUAL:
+            value.scalar = binary(Opcode::CNE, a, b);
+            break;
+        default:
+            throw std::runtime_error("IRBuilderVisitor::visit(relOp): Invalid operator");
+    }
+
+    values_[node] = value;
+}
+
+void IRBuilderVisitor::visit(ast::notFactor* node)
+{
+    Instruction i(Opcode::NOT);
+    i.a = rvalue(node->child());
+    i.dst = Operand::reg(function_->createRegister());
+    emit(i);
+
+    Value value;
+    value.scalar = i.dst;
+    values_[node] = value;
+}
+
+void IRBuilderVisitor::visit(ast::assignStat* node)
+{
+    auto lhs = evaluate(node->child(0));
+    auto type = dynamic_cast<const VariableType*>(node->child(1)->type());
+
+    if (type && type->type == Type::CLASS) {
+        auto rhs = evaluate(node->child(1));
+        copy(lhs.address, rhs.address, lhs.size);
+    } else {
+        assign(lhs, rvalue(node->child(1)), "assignStat");
+    }
+}
+
+void IRBuilderVisitor::visit(ast::putStat* node)
+{
+    Instruction i(Opcode::WRITE);
+    i.a = rvalue(node->child());
+    i.comment = "putStat";
+    emit(i);
+}
+
+void IRBuilderVisitor::visit(ast::getStat* node)
+{
+    auto target = evaluate(node->child());
+
+    Instruction i(Opcode::READ);
+    i.dst = Operand::reg(function_->createRegister());
+    i.comment = "getStat";
+    emit(i);
+
+    assign(target, i.dst);
+}
+
+void IRBuilderVisitor::visit(ast::returnStat* node)
+{
+    auto type = dynamic_cast<const VariableType*>(node->child()->type());
+    auto result = Address::frame(-function_->returnSize());
+
+    if (type && type->type == Type::CLASS) {
+        auto value = evaluate(node->child());
+        copy(result, value.address, function_->returnSize());
+    } else {
+        store(result, rvalue(node->child()), "returnStat");
+    }
+
+    emit(Instruction(Opcode::RETURN));
+
+    // anything after the return is unreachable, and dropped once the CFG is built
+    setBlock(function_->createBlock(program_.label("dead")));
+}
+
+void IRBuilderVisitor::visit(ast::ifStat* node)
+{
+    auto thenBlock = function_->createBlock(program_.label("then"));
+    auto elseBlock = function_->createBlock(program_.label("else"));
+    auto endifBlock = function_->createBlock(program_.label("endif"));
+
+    condition(node->child(0), thenBlock, elseBlock);
+
+    setBlock(thenBlock);
+    node->child(1)->accept(this);
+    jump(endifBlock);
+
+    setBlock(elseBlock);
+    node->child(2)->accept(this);
+    jump(endifBlock);
+
+    setBlock(endifBlock);
+}
+
+void IRBuilderVisitor::visit(ast::forStat* node)
+{
+    auto table = node->symbolTable();
+    auto entry = table->get(dynamic_cast<ast::id*>(node->child(1))->token()->value);
+
+    Value target;
+    target.address = Address::frame(frameDisplacement(table) - entry->offset());
+    target.inMemory = true;
+    target.variable = variable(entry);
+
+    auto condBlock = function_->createBlock(program_.label("forcond"));
+    auto bodyBlock = function_->createBlock(program_.label("forbody"));
+    auto endforBlock = function_->createBlock(program_.label("endfor"));
+
+    // initialization
+    assign(target, rvalue(node->child(2)), "forStat: " + entry->name());
+    jump(condBlock);
+
+    // condition
+    setBlock(condBlock);
+    condition(node->child(3), bodyBlock, endforBlock);
+
+    // body and post
+    setBlock(bodyBlock);
+    node->child(5)->accept(this);
+    node->child(4)->accept(this);
+    jump(condBlock);
+
+    setBlock(endforBlock);
+}
+
+Instruction& IRBuilderVisitor::emit(const Instruction& instruction)
+{
+    return block_->append(instruction);
+}
+
+Operand IRBuilderVisitor::binary(const Opcode& op, const Operand& a, const Operand& b, const std::string& comment)
+{
+    Instruction i(op);
+    i.dst = Operand::reg(function_->createRegister());
+    i.a = a;
+    i.b = b;
+    i.comment = comment;
+    return emit(i).dst;
+}
+
+Operand IRBuilderVisitor::address(const Address& address)
+{
+    Instruction i(Opcode::ADDRESS);
+    i.dst = Operand::reg(function_->createRegister());
+    i.address = address;
+    return emit(i).dst;
+}
+
+Operand IRBuilderVisitor::load(const Address& address, const std::string& comment)
+{
+    Instruction i(Opcode::LOAD);
+    i.dst = Operand::reg(function_->createRegister());
+    i.address = address;
+    i.comment = comment;
+    return emit(i).dst;
+}
+
+void IRBuilderVisitor::store(const Address& address, const Operand& value, const std::string& comment)
+{
+    Instruction i(Opcode::STORE);
+    i.address = address;
+    i.a = value;
+    i.comment = comment;
+    emit(i);
+}
+
+void IRBuilderVisitor::copy(const Address& to, const Address& from, const int& size)
+{
+    for (int i = 0; i < size; i += 4) {
+        store(to + i, load(from + i));
+    }
+}
+
+void IRBuilderVisitor::assign(const Value& target, const Operand& value, const std::string& comment)
+{
+    if (target.variable < 0) {
+        store(target.address, value, comment);
+        return;
+    }
+
+    // write the result of the last instruction straight into the variable when it's a temporary
+    auto& instructions = block_->instructions();
+
+    if (value.isRegister() && !variableRegisters_.count(value.value)
+        && !instructions.empty() && instructions.back().def() == value.value) {
+        instructions.back().dst = Operand::reg(target.variable);
+
+        if (instructions.back().comment.empty()) {
+            instructions.back().comment = comment;
+        }
+
+        return;
+    }
+
+    Instruction i(Opcode::MOVE);
+    i.dst = Operand::reg(target.variable);
+    i.a = value;
+    i.comment = comment;
+    emit(i);
+}
+
+void IRBuilderVisitor::jump(BasicBlock* target)
+{
+    Instruction i(Opcode::JUMP);
+    i.targets[0] = target;
+    emit(i);
+}
+
+void IRBuilderVisitor::branch(const Operand& condition, BasicBlock* then, BasicBlock* otherwise)
+{
+    Instruction i(Opcode::BRANCH);
+    i.a = condition;
+    i.targets[0] = then;
+    i.targets[1] = otherwise;
+    emit(i);
+}
+
+void IRBuilderVisitor::setBlock(BasicBlock* block)
+{
+    function_->moveToEnd(block);
+    block_ = block;
+}
+
+const IRBuilderVisitor::Value& IRBuilderVisitor::evaluate(ast::Node* node)
+{
+    node->accept(this);
+
+    auto value = values_.find(node);
+
+    if (value == values_.end()) {
+        throw std::runtime_error("IRBuilderVisitor::evaluate: Node has no value");
+    }
+
+    return value->second;
+}
+
+Operand IRBuilderVisitor::rvalue(ast::Node* node)
+{
+    auto value = evaluate(node);
+    return value.inMemory ? load(value.address) : value.scalar;
+}
+
+void IRBuilderVisitor::condition(ast::Node* node, BasicBlock* then, BasicBlock* otherwise)
+{
+    // and, or and not become control flow, the right hand side is only evaluated when it decides the outcome
+    auto multOp = dynamic_cast<ast::multOp*>(node);
+    auto addOp = dynamic_cast<ast::addOp*>(node);
+
+    if (multOp && multOp->token()->type == TokenType::T_AND) {
+        auto rhs = function_->createBlock(program_.label("and"));
+        condition(node->child(0), rhs, otherwise);
+        setBlock(rhs);
+        condition(node->child(1), then, otherwise);
+    } else if (addOp && addOp->token()->type == TokenType::T_OR) {
+        auto rhs = function_->createBlock(program_.label("or"));
+        condition(node->child(0), then, rhs);
+        setBlock(rhs);
+        condition(node->child(1), then, otherwise);
+    } else if (dynamic_cast<ast::notFactor*>(node)) {
+        condition(node->child(), otherwise, then);
+    } else {
+        branch(rvalue(node), then, otherwise);
+    }
+}
+
+IRBuilderVisitor::Value IRBuilderVisitor::call(ast::fCall* node, SymbolTableEntry* objectClass, const Value* object)
+{
+    auto entry = node->symbolTableEntry();
+    auto owner = classOf(entry);
+    auto table = node->closestSymbolTable();
+    auto type = dynamic_cast<const FunctionType*>(entry->type());
+    auto label = functionLabel(entry);
+
+    // evaluate every argument before writing any of them, since they may contain calls themselves
+    std::vector<std::pair<SymbolTableEntry*, Value>> arguments;
+    auto parameter = entry->parameters().begin();
+
+    for (auto aParam = node->child(1)->child(); aParam != nullptr; aParam = aParam->next(), ++parameter) {
+        auto parameterType = dynamic_cast<const VariableType*>((*parameter)->type());
+        Value value = evaluate(aParam);
+
+        if (parameterType->type != Type::CLASS && value.inMemory) {
+            value.scalar = load(value.address);
+            value.inMemory = false;
+        }
+
+        arguments.emplace_back(*parameter, value);
+    }
+
+    for (const auto& argument : arguments) {
+        auto location = Address::outgoing(-argument.first->offset());
+
+        if (argument.second.inMemory) {
+            copy(location, argument.second.address, argument.first->size());
+        } else {
+            store(location, argument.second.scalar);
+        }
+    }
+
+    // member functions get a pointer to the top of the object they are called on
+    if (owner) {
+        Operand self;
+
+        if (object) {
+            int offset = 0;
+            subobjectOffset(objectClass, owner, offset);
+            self = address(object->address + (objectClass->size() - offset));
+        } else {
+            self = thisPointer(owner);
+        }
+
+        store(Address::outgoing(-entry->link()->get("_this")->offset()), self);
+    }
+
+    Instruction i(Opcode::CALL);
+    i.callee = label;
+    i.comment = "fCall: " + label;
+    emit(i);
+
+    // copy the result out of the called function's frame before anything else overwrites it
+    Value result;
+    int returnSize = typeSize(table, type->returnType);
+    auto returnLocation = Address::outgoing(-returnSize);
+
+    if (type->returnType->type == Type::CLASS) {
+        auto temporary = node->child(1)->symbolTableEntry();
+        result.address = Address::frame(frameDisplacement(temporary->parentTable()) - temporary->offset());
+        result.inMemory = true;
+        result.size = returnSize;
+        copy(result.address, returnLocation, returnSize);
+    } else {
+        result.scalar = load(returnLocation);
+    }
+
+    return result;
+}
+
+Operand IRBuilderVisitor::thisPointer(SymbolTableEntry* definingClass)
+{
+    auto self = Operand::reg(variable(functionEntry_->link()->get("_this")));
+
+    int offset = 0;
+    subobjectOffset(classOf(functionEntry_), definingClass, offset);
+
+    return offset == 0 ? self : binary(Opcode::SUB, self, Operand::imm(offset));
+}
+
+int IRBuilderVisitor::variable(SymbolTableEntry* entry)
+{
+    auto it = variables_.find(entry);
+
+    if (it != variables_.end()) {
+        return it->second;
+    }
+
+    // only scalars local to a function can't be referred to by address
+    auto type = dynamic_cast<const VariableType*>(entry->type());
+    bool scalar = entry->kind() == SymbolTableEntryKind::THIS
+                  || ((entry->kind() == SymbolTableEntryKind::VARIABLE || entry->kind() == SymbolTableEntryKind::PARAMETER)
+                      && type && type->type != Type::CLASS && type->indices.empty() && !classOf(entry));
+
+    int reg = scalar ? function_->createRegister() : -1;
+    variables_[entry] = reg;
+
+    if (scalar) {
+        variableRegisters_.insert(reg);
+    }
+
+    return reg;
+}
+
+void IRBuilderVisitor::beginFunction(Function* function)
+{
+    function_ = function;
+    values_.clear();
+    variables_.clear();
+    variableRegisters_.clear();
+    setBlock(function->createBlock(function->label()));
+
+    if (!functionEntry_) {
+        return;
+    }
+
+    // parameters and the this pointer are passed in the frame, load them into their registers
+    auto table = functionEntry_->link();
+    std::vector<SymbolTableEntry*> parameters(functionEntry_->parameters());
+
+    if (classOf(functionEntry_)) {
+        parameters.push_back(table->get("_this"));
+    }
+
+    for (auto parameter : parameters) {
+        auto reg = variable(parameter);
+
+        if (reg >= 0) {
+            Instruction i(Opcode::LOAD);
+            i.dst = Operand::reg(reg);
+            i.address = Address::frame(-parameter->offset());
+            i.comment = parameter->name();
+            emit(i);
+
+            function->addScalarParameter(-parameter->offset());
+        }
+    }
+}
+
+int IRBuilderVisitor::frameDisplacement(SymbolTable* table) const
+{
+    // for scopes are laid out within the block entry of their enclosing scope
+    auto parent = table->parentEntry();
+
+    if (parent && parent->kind() == SymbolTableEntryKind::BLOCK) {
+        return frameDisplacement(parent->parentTable()) - parent->offset() + parent->size();
+    }
+
+    return 0;
+}
+
+SymbolTableEntry* IRBuilderVisitor::classOf(SymbolTableEntry* entry) const
+{
+    auto parent = entry->parentTable()->parentEntry();
+    return parent && parent->kind() == SymbolTableEntryKind::CLASS ? parent : nullptr;
+}
+
+int IRBuilderVisitor::typeSize(SymbolTable* table, const VariableType* type) const
+{
+    switch (type->type) {
+        case Type::CLASS:
+            return (*table)[type->className]->size();
+        case Type::FLOAT:
+            return 8;
+        default:
+            return 4;
+    }
+}
+
+bool IRBuilderVisitor::subobjectOffset(SymbolTableEntry* cls, SymbolTableEntry* super, int& offset) const
+{
+    if (cls == super) {
+        offset = 0;
+        return true;
+    }
+
+    // the class' own members come first, followed by each super in declaration order
+    int below = cls->link()->size();
+
+    for (const auto& s : cls->supers()) {
+        int o = 0;
+
+        if (subobjectOffset(s, super, o)) {
+            offset = below + o;
+            return true;
+        }
+
+        below += s->size();
+    }
+
+    return false;
+}
+
+std::string IRBuilderVisitor::functionLabel(SymbolTableEntry* function) const
+{
+    // member functions are prefixed with their class name
+    auto cls = classOf(function);
+    return cls ? cls->name() + function->name() : function->name();
+}
+
+}}
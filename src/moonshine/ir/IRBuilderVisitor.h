@@ -0,0 +1,98 @@
+#pragma once
+
+#include "moonshine/Visitor.h"
+#include "moonshine/syntax/Node.h"
+#include "moonshine/semantic/SymbolTable.h"
+#include "moonshine/ir/Program.h"
+
+#include <map>
+#include <set>
+#include <string>
+
+namespace moonshine { namespace ir {
+
+/**
+ * Lowers a type checked and sized AST (see MemorySizeComputerVisitor) to three-address code.
+ *
+ * Expression values live in virtual registers instead of stack frame temporaries, and so do local scalar
+ * variables since nothing can refer to them by address. Arrays, objects, members, aggregate function results
+ * and call arguments go through memory.
+ */
+class IRBuilderVisitor : public Visitor
+{
+public:
+    inline VisitorOrder order() override
+    {
+        return VisitorOrder::NONE;
+    };
+
+    explicit IRBuilderVisitor(Program& program);
+
+    void visit(ast::prog* node) override;
+    void visit(ast::funcDef* node) override;
+    void visit(ast::num* node) override;
+    void visit(ast::sign* node) override;
+    void visit(ast::var* node) override;
+    void visit(ast::addOp* node) override;
+    void visit(ast::multOp* node) override;
+    void visit(ast::relOp* node) override;
+    void visit(ast::notFactor* node) override;
+    void visit(ast::assignStat* node) override;
+    void visit(ast::putStat* node) override;
+    void visit(ast::getStat* node) override;
+    void visit(ast::returnStat* node) override;
+    void visit(ast::ifStat* node) override;
+    void visit(ast::forStat* node) override;
+private:
+    /**
+     * The result of an expression: a scalar in a register (or an immediate), or data in memory.
+     */
+    struct Value
+    {
+        Operand scalar;
+        Address address;
+        bool inMemory = false;
+        int size = 4;
+
+        // register of a variable kept in a register, for assignments
+        int variable = -1;
+    };
+
+    Program& program_;
+    Function* function_ = nullptr;
+    semantic::SymbolTableEntry* functionEntry_ = nullptr;
+    BasicBlock* block_ = nullptr;
+    std::map<ast::Node*, Value> values_;
+    std::map<semantic::SymbolTableEntry*, int> variables_;
+    std::set<int> variableRegisters_;
+
+    // instruction emission
+    Instruction& emit(const Instruction& instruction);
+    Operand binary(const Opcode& op, const Operand& a, const Operand& b, const std::string& comment = "");
+    Operand address(const Address& address);
+    Operand load(const Address& address, const std::string& comment = "");
+    void store(const Address& address, const Operand& value, const std::string& comment = "");
+    void copy(const Address& to, const Address& from, const int& size);
+    void assign(const Value& target, const Operand& value, const std::string& comment = "");
+    void jump(BasicBlock* target);
+    void branch(const Operand& condition, BasicBlock* then, BasicBlock* otherwise);
+    void setBlock(BasicBlock* block);
+
+    // expressions
+    const Value& evaluate(ast::Node* node);
+    Operand rvalue(ast::Node* node);
+    void condition(ast::Node* node, BasicBlock* then, BasicBlock* otherwise);
+    Value call(ast::fCall* node, semantic::SymbolTableEntry* objectClass, const Value* object);
+    Operand thisPointer(semantic::SymbolTableEntry* definingClass);
+    int variable(semantic::SymbolTableEntry* entry);
+
+    // layout
+    void beginFunction(Function* function);
+    int frameDisplacement(semantic::SymbolTable* table) const;
+    semantic::SymbolTableEntry* classOf(semantic::SymbolTableEntry* entry) const;
+    int typeSize(semantic::SymbolTable* table, const semantic::VariableType* type) const;
+    bool subobjectOffset(semantic::SymbolTableEntry* cls, semantic::SymbolTableEntry* super, int& offset) const;
+    std::string functionLabel(semantic::SymbolTableEntry* function) const;
+};
+
+}}
@@ -0,0 +1,281 @@
+#include "moonshine/ir/Inliner.h"
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+namespace moonshine { namespace ir {
+
+Inliner::Inliner(const unsigned int& maxSize)
+    : maxSize_(maxSize)
+{
+}
+
+void Inliner::run(Program& program)
+{
+    bool changed = true;
+
+    // inlining can leave a function without calls, which makes it a candidate for its own callers
+    while (changed) {
+        changed = false;
+
+        for (auto& caller : program.functions()) {
+            bool modified = false;
+
+            // blocks split off while inlining follow the current one and are scanned next
+            for (std::size_t b = 0; b < caller->blocks().size(); ++b) {
+                auto block = caller->blocks()[b].get();
+                const auto& instructions = block->instructions();
+
+                for (std::size_t i = 0; i < instructions.size(); ++i) {
+                    if (instructions[i].op != Opcode::CALL) {
+                        continue;
+                    }
+
+                    auto callee = program.function(instructions[i].callee);
+
+                    if (callee && callee != caller.get() && isCandidate(*callee)
+                        && inlineCall(program, *caller, block, i, *callee)) {
+                        modified = true;
+                        break;
+                    }
+                }
+            }
+
+            if (modified) {
+                caller->buildCFG();
+                changed = true;
+            }
+        }
+    }
+}
+
+unsigned int Inliner::inlined() const
+{
+    return inlined_;
+}
+
+bool Inliner::isCandidate(const Function& function) const
+{
+    if (function.isProgram()) {
+        return false;
+    }
+
+    unsigned int size = 0;
+
+    for (const auto& block : function.blocks()) {
+        for (const auto& instruction : block->instructions()) {
+            switch (instruction.op) {
+                case Opcode::CALL:
+                case Opcode::TAILCALL:
+                case Opcode::READ:
+                case Opcode::WRITE:
+                case Opcode::HALT:
+                    return false;
+                case Opcode::JUMP:
+                    break;
+                default:
+                    ++size;
+                    break;
+            }
+        }
+    }
+
+    return size <= maxSize_;
+}
+
+bool Inliner::inlineCall(Program& program, Function& caller, BasicBlock* block, const std::size_t& index, const Function& callee)
+{
+    auto& instructions = block->instructions();
+
+    // the arguments are stored into the outgoing area after the previous call, if any
+    std::map<int, std::size_t> arguments;
+
+    for (auto k = index; k-- > 0;) {
+        const auto& i = instructions[k];
+
+        if (i.op == Opcode::CALL || i.op == Opcode::READ || i.op == Opcode::WRITE) {
+            break;
+        }
+
+        if (i.op == Opcode::STORE && i.address.base == Address::Base::OUTGOING) {
+            arguments.emplace(i.address.offset, k);
+        }
+    }
+
+    // a scalar result is passed in a register if every return stores it right before returning
+    const auto resultAddress = Address::outgoing(-callee.returnSize());
+    bool forwardResult = callee.returnSize() == 4 && index + 1 < instructions.size()
+                         && instructions[index + 1].op == Opcode::LOAD && instructions[index + 1].address == resultAddress;
+    std::vector<const Instruction*> resultStores;
+
+    for (const auto& b : callee.blocks()) {
+        const auto& is = b->instructions();
+
+        if (is.back().op != Opcode::RETURN) {
+            continue;
+        }
+
+        if (is.size() < 2 || is[is.size() - 2].op != Opcode::STORE || is[is.size() - 2].address != Address::frame(-4)) {
+            forwardResult = false;
+        } else {
+            resultStores.push_back(&is[is.size() - 2]);
+        }
+    }
+
+    forwardResult = forwardResult && !touchesFrame(callee, -4, 4, resultStores);
+    auto result = forwardResult ? instructions[index + 1].dst : Operand();
+
+    // the copy of the callee, then the rest of the block
+    std::map<const BasicBlock*, BasicBlock*> blocks;
+    const BasicBlock* position = block;
+
+    for (const auto& b : callee.blocks()) {
+        auto copy = caller.createBlock(program.label("inline"));
+        caller.moveAfter(copy, position);
+        blocks[b.get()] = copy;
+        position = copy;
+    }
+
+    auto continuation = caller.createBlock(program.label("endinline"));
+    caller.moveAfter(continuation, position);
+
+    std::map<int, int> registers;
+
+    auto reg = [&caller, &registers](Operand& operand) {
+        if (operand.isRegister()) {
+            auto it = registers.find(operand.value);
+
+            if (it == registers.end()) {
+                it = registers.emplace(operand.value, caller.createRegister()).first;
+            }
+
+            operand.value = it->second;
+        }
+    };
+
+    std::set<std::size_t> forwardedArguments;
+
+    for (const auto& b : callee.blocks()) {
+        auto copy = blocks[b.get()];
+
+        for (const auto& original : b->instructions()) {
+            Instruction i = original;
+
+            // parameters are loaded from the frame on entry, take them from the caller's registers instead
+            auto argument = arguments.end();
+
+            if (b.get() == callee.entry() && i.op == Opcode::LOAD && i.address.base == Address::Base::FRAME) {
+                argument = arguments.find(i.address.offset);
+            }
+
+            if (argument != arguments.end() && !touchesFrame(callee, i.address.offset, 4, {&original})) {
+                const auto& value = instructions[argument->second].a;
+                bool unchanged = true;
+
+                for (auto k = argument->second + 1; k < index; ++k) {
+                    unchanged = unchanged && !(value.isRegister() && instructions[k].def() == value.value);
+                }
+
+                if (unchanged) {
+                    i = Instruction(Opcode::MOVE);
+                    i.dst = original.dst;
+                    i.a = value;
+                    i.comment = original.comment;
+                    reg(i.dst);
+                    copy->append(i);
+                    forwardedArguments.insert(argument->second);
+                    continue;
+                }
+            }
+
+            if (forwardResult && std::find(resultStores.begin(), resultStores.end(), &original) != resultStores.end()) {
+                i = Instruction(Opcode::MOVE);
+                i.dst = result;
+                i.a = original.a;
+                i.comment = "return: " + callee.label();
+                reg(i.a);
+                copy->append(i);
+                continue;
+            }
+
+            reg(i.dst);
+            reg(i.a);
+            reg(i.b);
+
+            // the callee's frame is the caller's outgoing area
+            if (i.hasAddress()) {
+                if (i.address.base == Address::Base::FRAME) {
+                    i.address.base = Address::Base::OUTGOING;
+                } else if (i.address.base == Address::Base::REGISTER) {
+                    Operand base = Operand::reg(i.address.reg);
+                    reg(base);
+                    i.address.reg = base.value;
+                }
+            }
+
+            for (auto& target : i.targets) {
+                if (target) {
+                    target = blocks[target];
+                }
+            }
+
+            if (i.op == Opcode::RETURN) {
+                i = Instruction(Opcode::JUMP);
+                i.targets[0] = continuation;
+            }
+
+            copy->append(i);
+        }
+    }
+
+    // split the block at the call
+    auto rest = index + (forwardResult ? 2 : 1);
+
+    for (auto k = rest; k < instructions.size(); ++k) {
+        continuation->append(instructions[k]);
+    }
+
+    std::vector<Instruction> before;
+
+    for (std::size_t k = 0; k < index; ++k) {
+        if (!forwardedArguments.count(k)) {
+            before.push_back(instructions[k]);
+        }
+    }
+
+    Instruction jump(Opcode::JUMP);
+    jump.targets[0] = blocks[callee.entry()];
+    jump.comment = "inline: " + callee.label();
+    before.push_back(jump);
+
+    instructions = before;
+    ++inlined_;
+
+    return true;
+}
+
+bool Inliner::touchesFrame(const Function& function, const int& offset, const int& size, const std::vector<const Instruction*>& except)
+{
+    for (const auto& block : function.blocks()) {
+        for (const auto& instruction : block->instructions()) {
+            if (!instruction.hasAddress() || instruction.address.base != Address::Base::FRAME
+                || std::find(except.begin(), except.end(), &instruction) != except.end()) {
+                continue;
+            }
+
+            // an address taken into the frame could point anywhere in it
+            if (instruction.op == Opcode::ADDRESS) {
+                return true;
+            }
+
+            if (instruction.address.offset < offset + size && offset < instruction.address.offset + 4) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+}}
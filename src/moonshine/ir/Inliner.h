@@ -0,0 +1,40 @@
+#pragma once
+
+#include "moonshine/ir/Program.h"
+
+#include <map>
+#include <vector>
+
+namespace moonshine { namespace ir {
+
+/**
+ * Replaces calls to small functions with a copy of their body.
+ *
+ * Only leaf functions are inlined, ones that neither call anything nor use the console (which goes through
+ * library calls), with at most `maxSize` instructions. Their frame then sits where the frame of a called
+ * function would, in the outgoing area of the caller, which nothing else uses while they run. Scalar arguments
+ * and results are passed in registers instead of through that frame. Functions left without calls after
+ * inlining are candidates in turn, so chains of small functions collapse bottom-up.
+ */
+class Inliner
+{
+public:
+    explicit Inliner(const unsigned int& maxSize = 16);
+
+    void run(Program& program);
+
+    // number of calls replaced, over every run
+    unsigned int inlined() const;
+private:
+    unsigned int maxSize_;
+    unsigned int inlined_ = 0;
+
+    bool isCandidate(const Function& function) const;
+    bool inlineCall(Program& program, Function& caller, BasicBlock* block, const std::size_t& index, const Function& callee);
+
+    // whether the function touches its frame at [offset, offset + size) other than with the given instruction
+    static bool touchesFrame(const Function& function, const int& offset, const int& size,
+                             const std::vector<const Instruction*>& except);
+};
+
+}}
@@ -0,0 +1,244 @@
+#include "moonshine/ir/Instruction.h"
+#include "moonshine/ir/BasicBlock.h"
+
+namespace moonshine { namespace ir {
+
+Operand Operand::reg(const int& reg)
+{
+    Operand o;
+    o.kind = Kind::REGISTER;
+    o.value = reg;
+    return o;
+}
+
+Operand Operand::imm(const int& value)
+{
+    Operand o;
+    o.kind = Kind::IMMEDIATE;
+    o.value = value;
+    return o;
+}
+
+bool Operand::operator==(const Operand& rhs) const
+{
+    return kind == rhs.kind && (kind == Kind::NONE || value == rhs.value);
+}
+
+bool Operand::operator!=(const Operand& rhs) const
+{
+    return !(*this == rhs);
+}
+
+Address Address::frame(const int& offset)
+{
+    Address a;
+    a.base = Base::FRAME;
+    a.offset = offset;
+    return a;
+}
+
+Address Address::outgoing(const int& offset)
+{
+    Address a;
+    a.base = Base::OUTGOING;
+    a.offset = offset;
+    return a;
+}
+
+Address Address::indirect(const int& reg, const int& offset)
+{
+    Address a;
+    a.base = Base::REGISTER;
+    a.reg = reg;
+    a.offset = offset;
+    return a;
+}
+
+Address Address::operator+(const int& offset) const
+{
+    Address a = *this;
+    a.offset += offset;
+    return a;
+}
+
+bool Address::operator==(const Address& rhs) const
+{
+    return base == rhs.base && offset == rhs.offset && (base != Base::REGISTER || reg == rhs.reg);
+}
+
+bool Address::operator!=(const Address& rhs) const
+{
+    return !(*this == rhs);
+}
+
+Instruction::Instruction(const Opcode& op)
+    : op(op)
+{
+}
+
+bool Instruction::isTerminator() const
+{
+    switch (op) {
+        case Opcode::JUMP:
+        case Opcode::BRANCH:
+        case Opcode::RETURN:
+        case Opcode::HALT:
+        case Opcode::TAILCALL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool Instruction::hasAddress() const
+{
+    return op == Opcode::ADDRESS || op == Opcode::LOAD || op == Opcode::STORE;
+}
+
+std::vector<int> Instruction::uses() const
+{
+    std::vector<int> regs;
+
+    if (a.isRegister()) {
+        regs.push_back(a.value);
+    }
+
+    if (b.isRegister()) {
+        regs.push_back(b.value);
+    }
+
+    if (hasAddress() && address.base == Address::Base::REGISTER) {
+        regs.push_back(address.reg);
+    }
+
+    for (const auto& argument : arguments) {
+        if (argument.isRegister()) {
+            regs.push_back(argument.value);
+        }
+    }
+
+    return regs;
+}
+
+int Instruction::def() const
+{
+    return dst.isRegister() ? dst.value : -1;
+}
+
+void Instruction::print(std::ostream& s) const
+{
+    if (!dst.isNone()) {
+        s << dst << " = ";
+    }
+
+    s << opcodeName(op);
+
+    switch (op) {
+        case Opcode::ADDRESS:
+        case Opcode::LOAD:
+            s << ' ' << address;
+            break;
+        case Opcode::STORE:
+            s << ' ' << address << ", " << a;
+            break;
+        case Opcode::CALL:
+        case Opcode::TAILCALL:
+            s << ' ' << callee;
+
+            for (auto it = arguments.begin(); it != arguments.end(); ++it) {
+                s << (it == arguments.begin() ? " (" : ", ") << *it << (it + 1 == arguments.end() ? ")" : "");
+            }
+            break;
+        case Opcode::JUMP:
+            s << ' ' << targets[0]->label();
+            break;
+        case Opcode::BRANCH:
+            s << ' ' << a << ", " << targets[0]->label() << ", " << targets[1]->label();
+            break;
+        default:
+            if (!a.isNone()) {
+                s << ' ' << a;
+            }
+            if (!b.isNone()) {
+                s << ", " << b;
+            }
+            break;
+    }
+
+    if (!comment.empty()) {
+        s << " ; " << comment;
+    }
+}
+
+const char* opcodeName(const Opcode& op)
+{
+    switch (op) {
+        case Opcode::ADD: return "add";
+        case Opcode::SUB: return "sub";
+        case Opcode::MUL: return "mul";
+        case Opcode::DIV: return "div";
+        case Opcode::AND: return "and";
+        case Opcode::OR: return "or";
+        case Opcode::CEQ: return "ceq";
+        case Opcode::CNE: return "cne";
+        case Opcode::CLT: return "clt";
+        case Opcode::CLE: return "cle";
+        case Opcode::CGT: return "cgt";
+        case Opcode::CGE: return "cge";
+        case Opcode::NOT: return "not";
+        case Opcode::MOVE: return "move";
+        case Opcode::ADDRESS: return "address";
+        case Opcode::PARAM: return "param";
+        case Opcode::LOAD: return "load";
+        case Opcode::STORE: return "store";
+        case Opcode::CALL: return "call";
+        case Opcode::READ: return "read";
+        case Opcode::WRITE: return "write";
+        case Opcode::JUMP: return "jump";
+        case Opcode::BRANCH: return "branch";
+        case Opcode::RETURN: return "return";
+        case Opcode::HALT: return "halt";
+        case Opcode::TAILCALL: return "tailcall";
+    }
+
+    return "?";
+}
+
+std::ostream& operator<<(std::ostream& s, const Operand& operand)
+{
+    switch (operand.kind) {
+        case Operand::Kind::REGISTER:
+            return s << '%' << operand.value;
+        case Operand::Kind::IMMEDIATE:
+            return s << operand.value;
+        default:
+            return s << "_";
+    }
+}
+
+std::ostream& operator<<(std::ostream& s, const Address& address)
+{
+    s << '[';
+
+    switch (address.base) {
+        case Address::Base::FRAME:
+            s << "frame";
+            break;
+        case Address::Base::OUTGOING:
+            s << "out";
+            break;
+        case Address::Base::REGISTER:
+            s << '%' << address.reg;
+            break;
+    }
+
+    if (address.offset > 0) {
+        s << '+' << address.offset;
+    } else if (address.offset < 0) {
+        s << address.offset;
+    }
+
+    return s << ']';
+}
+
+}}
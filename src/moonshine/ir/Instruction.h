@@ -0,0 +1,150 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace moonshine { namespace ir {
+
+class BasicBlock;
+
+enum class Opcode
+{
+    // dst := a op b
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    AND,
+    OR,
+    CEQ,
+    CNE,
+    CLT,
+    CLE,
+    CGT,
+    CGE,
+
+    // dst := op a
+    NOT,
+    MOVE,
+
+    // dst := the address of a memory location
+    ADDRESS,
+
+    // dst := the a-th argument passed in a register, only at the start of the entry block
+    PARAM,
+
+    // dst := [address], [address] := a
+    LOAD,
+    STORE,
+
+    // calls and console i/o
+    CALL,
+    READ,
+    WRITE,
+
+    // block terminators
+    JUMP,
+    BRANCH,
+    RETURN,
+    HALT,
+
+    // jump to a function that returns straight to the caller of the current one, with its arguments already
+    // written over the current frame
+    TAILCALL,
+};
+
+/**
+ * An instruction operand: either a virtual register or an immediate value.
+ */
+struct Operand
+{
+    enum class Kind
+    {
+        NONE,
+        REGISTER,
+        IMMEDIATE,
+    };
+
+    Kind kind = Kind::NONE;
+    int value = 0;
+
+    static Operand reg(const int& reg);
+    static Operand imm(const int& value);
+
+    inline bool isNone() const { return kind == Kind::NONE; }
+    inline bool isRegister() const { return kind == Kind::REGISTER; }
+    inline bool isImmediate() const { return kind == Kind::IMMEDIATE; }
+
+    bool operator==(const Operand& rhs) const;
+    bool operator!=(const Operand& rhs) const;
+};
+
+/**
+ * A memory location, as a byte displacement from a base:
+ *  - FRAME: the current function's stack frame pointer
+ *  - OUTGOING: the stack frame of the functions it calls, which sits right below its own frame.
+ *    The backend resolves this once it knows the final size of the frame.
+ *  - REGISTER: an address held in a virtual register
+ */
+struct Address
+{
+    enum class Base
+    {
+        FRAME,
+        OUTGOING,
+        REGISTER,
+    };
+
+    Base base = Base::FRAME;
+    int reg = -1;
+    int offset = 0;
+
+    static Address frame(const int& offset);
+    static Address outgoing(const int& offset);
+    static Address indirect(const int& reg, const int& offset = 0);
+
+    Address operator+(const int& offset) const;
+    bool operator==(const Address& rhs) const;
+    bool operator!=(const Address& rhs) const;
+};
+
+struct Instruction
+{
+    Opcode op;
+    Operand dst;
+    Operand a;
+    Operand b;
+    Address address;
+
+    // CALL, TAILCALL: label of the called function
+    std::string callee;
+
+    // CALL: arguments passed in registers, in order
+    std::vector<Operand> arguments;
+
+    // JUMP: targets[0], BRANCH: targets[0] if a is not 0, targets[1] otherwise
+    BasicBlock* targets[2] = {nullptr, nullptr};
+
+    // carried over to the generated code
+    std::string comment;
+
+    explicit Instruction(const Opcode& op);
+
+    bool isTerminator() const;
+    bool hasAddress() const;
+
+    // virtual registers read by this instruction
+    std::vector<int> uses() const;
+
+    // virtual register written by this instruction, or -1
+    int def() const;
+
+    void print(std::ostream& s) const;
+};
+
+const char* opcodeName(const Opcode& op);
+std::ostream& operator<<(std::ostream& s, const Operand& operand);
+std::ostream& operator<<(std::ostream& s, const Address& address);
+
+}}
@@ -0,0 +1,65 @@
+#include "moonshine/ir/Liveness.h"
+
+namespace moonshine { namespace ir {
+
+Liveness::Liveness(const Function& function)
+{
+    auto count = static_cast<set_type::size_type>(function.registerCount());
+    const auto& blocks = function.blocks();
+
+    for (const auto& block : blocks) {
+        in_[block.get()] = set_type(count, false);
+        out_[block.get()] = set_type(count, false);
+    }
+
+    // iterate backwards until nothing changes, which takes few passes when blocks are in program order
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+
+        for (auto it = blocks.rbegin(); it != blocks.rend(); ++it) {
+            auto block = it->get();
+            auto& out = out_[block];
+
+            for (auto successor : block->successors()) {
+                const auto& in = in_[successor];
+
+                for (set_type::size_type v = 0; v < count; ++v) {
+                    if (in[v]) {
+                        out[v] = true;
+                    }
+                }
+            }
+
+            set_type live = out;
+
+            for (auto i = block->instructions().rbegin(); i != block->instructions().rend(); ++i) {
+                if (i->def() >= 0) {
+                    live[i->def()] = false;
+                }
+
+                for (auto v : i->uses()) {
+                    live[v] = true;
+                }
+            }
+
+            if (live != in_[block]) {
+                in_[block] = live;
+                changed = true;
+            }
+        }
+    }
+}
+
+const Liveness::set_type& Liveness::liveIn(const BasicBlock* block) const
+{
+    return in_.at(block);
+}
+
+const Liveness::set_type& Liveness::liveOut(const BasicBlock* block) const
+{
+    return out_.at(block);
+}
+
+}}
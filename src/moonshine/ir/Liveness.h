@@ -0,0 +1,27 @@
+#pragma once
+
+#include "moonshine/ir/Function.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace moonshine { namespace ir {
+
+/**
+ * The virtual registers live on entry to and exit from each basic block of a function.
+ */
+class Liveness
+{
+public:
+    typedef std::vector<bool> set_type;
+
+    explicit Liveness(const Function& function);
+
+    const set_type& liveIn(const BasicBlock* block) const;
+    const set_type& liveOut(const BasicBlock* block) const;
+private:
+    std::unordered_map<const BasicBlock*, set_type> in_;
+    std::unordered_map<const BasicBlock*, set_type> out_;
+};
+
+}}
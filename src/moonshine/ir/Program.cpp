@@ -0,0 +1,61 @@
+#include "moonshine/ir/Program.h"
+
+namespace moonshine { namespace ir {
+
+Function* Program::createFunction(const std::string& name, const std::string& label, const bool& isProgram)
+{
+    functions_.emplace_back(new Function(name, label, isProgram));
+    return functions_.back().get();
+}
+
+std::vector<std::unique_ptr<Function>>& Program::functions()
+{
+    return functions_;
+}
+
+const std::vector<std::unique_ptr<Function>>& Program::functions() const
+{
+    return functions_;
+}
+
+Function* Program::function(const std::string& label) const
+{
+    for (const auto& function : functions_) {
+        if (function->label() == label) {
+            return function.get();
+        }
+    }
+
+    return nullptr;
+}
+
+std::size_t Program::instructionCount() const
+{
+    std::size_t count = 0;
+
+    for (const auto& function : functions_) {
+        for (const auto& block : function->blocks()) {
+            count += block->instructions().size();
+        }
+    }
+
+    return count;
+}
+
+std::string Program::label(const std::string& prefix)
+{
+    return prefix + std::to_string(labels_[prefix]++);
+}
+
+void Program::print(std::ostream& s) const
+{
+    for (auto it = functions_.begin(); it != functions_.end(); ++it) {
+        (*it)->print(s);
+
+        if (it + 1 != functions_.end()) {
+            s << std::endl;
+        }
+    }
+}
+
+}}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "moonshine/ir/Function.h"
+
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace moonshine { namespace ir {
+
+/**
+ * All the functions of a program, the main program being the last one.
+ */
+class Program
+{
+public:
+    Function* createFunction(const std::string& name, const std::string& label, const bool& isProgram = false);
+    std::vector<std::unique_ptr<Function>>& functions();
+    const std::vector<std::unique_ptr<Function>>& functions() const;
+    Function* function(const std::string& label) const;
+
+    // over every block of every function
+    std::size_t instructionCount() const;
+
+    // labels are unique over the whole program
+    std::string label(const std::string& prefix);
+
+    void print(std::ostream& s) const;
+private:
+    std::vector<std::unique_ptr<Function>> functions_;
+    std::map<std::string, int> labels_;
+};
+
+}}
@@ -0,0 +1,231 @@
+#include "moonshine/ir/RegisterCallingConvention.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+
+namespace moonshine { namespace ir {
+
+RegisterCallingConvention::RegisterCallingConvention(const unsigned int& registers)
+    : registers_(registers)
+{
+}
+
+void RegisterCallingConvention::run(Program& program)
+{
+    // a tail call leaves its arguments and result in the frame
+    std::set<std::string> tailCallers;
+    std::set<std::string> tailCallees;
+
+    for (const auto& function : program.functions()) {
+        for (const auto& block : function->blocks()) {
+            for (const auto& instruction : block->instructions()) {
+                if (instruction.op == Opcode::TAILCALL) {
+                    tailCallers.insert(function->label());
+                    tailCallees.insert(instruction.callee);
+                }
+            }
+        }
+    }
+
+    for (auto& function : program.functions()) {
+        if (!function->isProgram() && !tailCallees.count(function->label())) {
+            convert(program, *function, !tailCallers.count(function->label()) && returnsInRegister(*function));
+        }
+    }
+}
+
+unsigned int RegisterCallingConvention::parameters() const
+{
+    return parameters_;
+}
+
+unsigned int RegisterCallingConvention::results() const
+{
+    return results_;
+}
+
+void RegisterCallingConvention::convert(Program& program, Function& function, const bool& result)
+{
+    auto offsets = scalarParameters(function);
+
+    if (offsets.size() > registers_) {
+        offsets.resize(registers_);
+    }
+
+    if (offsets.empty() && !result) {
+        return;
+    }
+
+    // the arguments are stored into the outgoing area after the previous call, if any
+    auto arguments = [](const std::vector<Instruction>& is, const std::size_t& call) {
+        std::map<int, std::size_t> stores;
+
+        for (auto k = call; k-- > 0;) {
+            if (is[k].op == Opcode::CALL || is[k].op == Opcode::READ || is[k].op == Opcode::WRITE) {
+                break;
+            }
+
+            if (is[k].op == Opcode::STORE && is[k].address.base == Address::Base::OUTGOING) {
+                stores.emplace(is[k].address.offset, k);
+            }
+        }
+
+        return stores;
+    };
+
+    // every call has to pass the arguments the usual way first
+    for (const auto& caller : program.functions()) {
+        for (const auto& block : caller->blocks()) {
+            const auto& is = block->instructions();
+
+            for (std::size_t i = 0; i < is.size(); ++i) {
+                if (is[i].op != Opcode::CALL || is[i].callee != function.label()) {
+                    continue;
+                }
+
+                auto stores = arguments(is, i);
+
+                for (auto offset : offsets) {
+                    if (!stores.count(offset)) {
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    for (const auto& caller : program.functions()) {
+        for (const auto& block : caller->blocks()) {
+            auto& is = block->instructions();
+
+            // from the end, so removing instructions doesn't move the calls still to be converted
+            for (auto i = is.size(); i-- > 0;) {
+                if (is[i].op != Opcode::CALL || is[i].callee != function.label()) {
+                    continue;
+                }
+
+                if (result && i + 1 < is.size() && is[i + 1].op == Opcode::LOAD && is[i + 1].address == Address::outgoing(-4)) {
+                    is[i].dst = is[i + 1].dst;
+                    is.erase(is.begin() + i + 1);
+                }
+
+                auto stores = arguments(is, i);
+                std::vector<std::size_t> removed;
+
+                for (auto offset : offsets) {
+                    is[i].arguments.push_back(is[stores[offset]].a);
+                    removed.push_back(stores[offset]);
+                }
+
+                std::sort(removed.rbegin(), removed.rend());
+
+                for (auto k : removed) {
+                    is.erase(is.begin() + k);
+                    --i;
+                }
+            }
+        }
+    }
+
+    // parameters come first, before anything can use the argument registers as scratch registers
+    auto& entry = function.entry()->instructions();
+    std::vector<Instruction> params;
+
+    for (std::size_t k = 0; k < offsets.size(); ++k) {
+        auto load = std::find_if(entry.begin(), entry.end(), [&offsets, &k](const Instruction& i) {
+            return i.op == Opcode::LOAD && i.address == Address::frame(offsets[k]);
+        });
+
+        Instruction param(Opcode::PARAM);
+        param.dst = load->dst;
+        param.a = Operand::imm(static_cast<int>(k));
+        param.comment = load->comment;
+        params.push_back(param);
+
+        entry.erase(load);
+        ++parameters_;
+    }
+
+    entry.insert(entry.begin(), params.begin(), params.end());
+
+    if (result) {
+        for (auto& block : function.blocks()) {
+            auto& is = block->instructions();
+
+            if (is.back().op == Opcode::RETURN) {
+                is.back().a = is[is.size() - 2].a;
+                is.erase(is.end() - 2);
+            }
+        }
+
+        ++results_;
+    }
+}
+
+std::vector<int> RegisterCallingConvention::scalarParameters(const Function& function)
+{
+    std::vector<int> offsets;
+    const auto& entry = function.entry()->instructions();
+
+    for (auto offset : function.scalarParameters()) {
+        auto load = std::find_if(entry.begin(), entry.end(), [&offset](const Instruction& i) {
+            return i.op == Opcode::LOAD && i.address == Address::frame(offset);
+        });
+
+        if (load != entry.end() && !touchesFrame(function, offset, &*load)) {
+            offsets.push_back(offset);
+        }
+    }
+
+    return offsets;
+}
+
+bool RegisterCallingConvention::returnsInRegister(const Function& function)
+{
+    if (function.returnSize() != 4) {
+        return false;
+    }
+
+    std::vector<const Instruction*> stores;
+
+    for (const auto& block : function.blocks()) {
+        const auto& is = block->instructions();
+
+        if (is.back().op != Opcode::RETURN) {
+            continue;
+        }
+
+        if (is.size() < 2 || is[is.size() - 2].op != Opcode::STORE || is[is.size() - 2].address != Address::frame(-4)) {
+            return false;
+        }
+
+        stores.push_back(&is[is.size() - 2]);
+    }
+
+    for (const auto& block : function.blocks()) {
+        for (const auto& i : block->instructions()) {
+            if (i.hasAddress() && i.address == Address::frame(-4) && std::find(stores.begin(), stores.end(), &i) == stores.end()) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool RegisterCallingConvention::touchesFrame(const Function& function, const int& offset, const Instruction* except)
+{
+    for (const auto& block : function.blocks()) {
+        for (const auto& i : block->instructions()) {
+            if (&i != except && i.hasAddress() && i.address == Address::frame(offset)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+}}
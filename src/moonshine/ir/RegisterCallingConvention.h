@@ -0,0 +1,46 @@
+#pragma once
+
+#include "moonshine/ir/Program.h"
+
+#include <vector>
+
+namespace moonshine { namespace ir {
+
+/**
+ * Passes the first scalar parameters of functions and their scalar results in registers instead of through the
+ * stack frame.
+ *
+ * A parameter moves to a register when it is loaded into a register on entry and its frame slot isn't used
+ * otherwise; its store at every call site becomes an argument of the CALL, and its load a PARAM. A result moves
+ * when every return stores it right before returning; the return then carries it and the load after every call
+ * becomes the destination of the CALL. Objects keep going through memory, and so do functions taking part in a
+ * TAILCALL, which hands over a frame as is.
+ *
+ * This changes what functions expect from their callers, so it has to run once every other pass is done, and
+ * hand written code calling the generated functions has to follow the same convention. Console i/o keeps using
+ * the stack based convention of the Moon util library.
+ */
+class RegisterCallingConvention
+{
+public:
+    explicit RegisterCallingConvention(const unsigned int& registers = 3);
+
+    void run(Program& program);
+
+    // over every run
+    unsigned int parameters() const;
+    unsigned int results() const;
+private:
+    unsigned int registers_;
+    unsigned int parameters_ = 0;
+    unsigned int results_ = 0;
+
+    void convert(Program& program, Function& function, const bool& result);
+
+    // frame offsets of the scalar parameters only read once, when the entry block loads them
+    static std::vector<int> scalarParameters(const Function& function);
+    static bool returnsInRegister(const Function& function);
+    static bool touchesFrame(const Function& function, const int& offset, const Instruction* except);
+};
+
+}}
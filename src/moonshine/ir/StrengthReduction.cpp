@@ -0,0 +1,427 @@
+#include "moonshine/ir/StrengthReduction.h"
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <tuple>
+
+namespace moonshine { namespace ir {
+
+void StrengthReduction::run(Program& program)
+{
+    for (auto& function : program.functions()) {
+        run(*function);
+    }
+}
+
+void StrengthReduction::run(Function& function)
+{
+    for (const auto& loop : loops(function)) {
+        reduce(function, loop);
+    }
+}
+
+unsigned int StrengthReduction::reduced() const
+{
+    return reduced_;
+}
+
+std::vector<StrengthReduction::Loop> StrengthReduction::loops(Function& function) const
+{
+    std::map<const BasicBlock*, std::vector<BasicBlock*>::size_type> position;
+    std::map<BasicBlock*, Loop> loops;
+
+    for (const auto& block : function.blocks()) {
+        auto index = position.size();
+        position[block.get()] = index;
+    }
+
+    // a branch back to a block laid out earlier closes a loop, which is every block reaching it from there
+    for (const auto& block : function.blocks()) {
+        for (auto header : block->successors()) {
+            if (position[header] > position[block.get()]) {
+                continue;
+            }
+
+            auto& loop = loops[header];
+            loop.header = header;
+            loop.blocks.insert(header);
+
+            std::vector<const BasicBlock*> work = {block.get()};
+
+            while (!work.empty()) {
+                auto b = work.back();
+                work.pop_back();
+
+                if (loop.blocks.insert(b).second) {
+                    for (auto predecessor : b->predecessors()) {
+                        work.push_back(predecessor);
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<Loop> result;
+
+    for (auto& entry : loops) {
+        auto& loop = entry.second;
+        bool single = true;
+
+        // code is set up on the only way into the loop
+        for (auto predecessor : loop.header->predecessors()) {
+            if (loop.blocks.count(predecessor)) {
+                continue;
+            }
+
+            single = single && !loop.preheader;
+            loop.preheader = predecessor;
+        }
+
+        for (auto block : loop.blocks) {
+            for (auto predecessor : block->predecessors()) {
+                single = single && (block == loop.header || loop.blocks.count(predecessor));
+            }
+        }
+
+        if (single && loop.preheader && loop.preheader->terminator()->op == Opcode::JUMP) {
+            result.push_back(loop);
+        }
+    }
+
+    // inner loops first, they run the most
+    std::sort(result.begin(), result.end(), [&position](const Loop& a, const Loop& b) {
+        return a.blocks.size() < b.blocks.size()
+               || (a.blocks.size() == b.blocks.size() && position[a.header] < position[b.header]);
+    });
+
+    return result;
+}
+
+void StrengthReduction::reduce(Function& function, const Loop& loop)
+{
+    typedef std::vector<Instruction>::size_type Index;
+
+    std::vector<BasicBlock*> blocks;
+
+    for (const auto& block : function.blocks()) {
+        if (loop.blocks.count(block.get())) {
+            blocks.push_back(block.get());
+        }
+    }
+
+    std::map<int, int> definitions;
+
+    for (auto block : blocks) {
+        for (const auto& instruction : block->instructions()) {
+            if (instruction.def() >= 0) {
+                ++definitions[instruction.def()];
+            }
+        }
+    }
+
+    // basic induction variables, with where and by how much they are stepped
+    struct Step
+    {
+        BasicBlock* block;
+        Index index;
+        int step;
+    };
+
+    std::map<int, Step> inductions;
+
+    for (auto block : blocks) {
+        const auto& instructions = block->instructions();
+
+        for (Index k = 0; k < instructions.size(); ++k) {
+            const auto& i = instructions[k];
+            auto self = Operand::reg(i.def());
+
+            if (i.def() < 0 || definitions[i.def()] != 1) {
+                continue;
+            }
+
+            if (i.op == Opcode::ADD && i.a == self && i.b.isImmediate()) {
+                inductions[i.def()] = {block, k, i.b.value};
+            } else if (i.op == Opcode::ADD && i.b == self && i.a.isImmediate()) {
+                inductions[i.def()] = {block, k, i.a.value};
+            } else if (i.op == Opcode::SUB && i.a == self && i.b.isImmediate()) {
+                inductions[i.def()] = {block, k, -i.b.value};
+            }
+        }
+    }
+
+    if (inductions.empty()) {
+        return;
+    }
+
+    struct Rewrite
+    {
+        BasicBlock* block;
+        Index index;
+        std::vector<Family>::size_type family;
+        int constant;
+    };
+
+    // whether every path from the header to a block goes through one of the given ones
+    auto covered = [&loop](const std::set<const BasicBlock*>& through, const BasicBlock* block) {
+        std::set<const BasicBlock*> reached;
+        std::vector<const BasicBlock*> work;
+
+        if (!through.count(loop.header)) {
+            work.push_back(loop.header);
+        }
+
+        while (!work.empty()) {
+            auto b = work.back();
+            work.pop_back();
+
+            if (!reached.insert(b).second) {
+                continue;
+            }
+
+            for (auto successor : b->successors()) {
+                if (!through.count(successor) && loop.blocks.count(successor)) {
+                    work.push_back(successor);
+                }
+            }
+        }
+
+        return !reached.count(block);
+    };
+
+    std::vector<Family> families;
+    std::vector<Rewrite> rewrites;
+
+    for (auto block : blocks) {
+        // what the registers computed so far in this block hold
+        std::map<int, Affine> affine;
+        std::map<int, Address> bases;
+
+        auto affineOf = [&inductions, &affine](const Operand& operand, Affine& result) {
+            if (!operand.isRegister()) {
+                return false;
+            }
+
+            if (inductions.count(operand.value)) {
+                result = {operand.value, 1, 0};
+                return true;
+            }
+
+            auto known = affine.find(operand.value);
+
+            if (known == affine.end()) {
+                return false;
+            }
+
+            result = known->second;
+            return true;
+        };
+
+        auto baseOf = [&bases](const Operand& operand, Address& result) {
+            auto known = operand.isRegister() ? bases.find(operand.value) : bases.end();
+
+            if (known == bases.end()) {
+                return false;
+            }
+
+            result = known->second;
+            return true;
+        };
+
+        const auto& instructions = block->instructions();
+
+        for (Index k = 0; k < instructions.size(); ++k) {
+            const auto& i = instructions[k];
+            auto def = i.def();
+
+            if (def < 0) {
+                continue;
+            }
+
+            Affine x;
+            Affine result;
+            Address base;
+            bool isAffine = false;
+            bool isBase = false;
+
+            switch (i.op) {
+                case Opcode::ADD:
+                    if (affineOf(i.a, x) && i.b.isImmediate()) {
+                        result = {x.induction, x.scale, x.constant + i.b.value};
+                        isAffine = true;
+                    } else if (affineOf(i.b, x) && i.a.isImmediate()) {
+                        result = {x.induction, x.scale, x.constant + i.a.value};
+                        isAffine = true;
+                    } else if ((baseOf(i.a, base) && affineOf(i.b, x)) || (baseOf(i.b, base) && affineOf(i.a, x))) {
+                        if (x.scale == 0 || !fits(x.constant)
+                            || !fits(static_cast<long long>(x.scale) * inductions[x.induction].step)) {
+                            break;
+                        }
+
+                        auto family = std::find_if(families.begin(), families.end(), [&base, &x](const Family& f) {
+                            return f.base == base && f.induction == x.induction && f.scale == x.scale;
+                        });
+
+                        if (family == families.end()) {
+                            families.push_back({base, x.induction, x.scale, -1});
+                            family = families.end() - 1;
+                        }
+
+                        rewrites.push_back({block, k, static_cast<std::vector<Family>::size_type>(family - families.begin()), x.constant});
+                    }
+                    break;
+                case Opcode::SUB:
+                    if (affineOf(i.a, x) && i.b.isImmediate()) {
+                        result = {x.induction, x.scale, x.constant - i.b.value};
+                        isAffine = true;
+                    }
+                    break;
+                case Opcode::MUL:
+                    if (affineOf(i.a, x) && i.b.isImmediate()) {
+                        result = {x.induction, x.scale * i.b.value, x.constant * i.b.value};
+                        isAffine = true;
+                    } else if (affineOf(i.b, x) && i.a.isImmediate()) {
+                        result = {x.induction, x.scale * i.a.value, x.constant * i.a.value};
+                        isAffine = true;
+                    }
+                    break;
+                case Opcode::MOVE:
+                    isAffine = affineOf(i.a, result);
+                    isBase = baseOf(i.a, base);
+                    break;
+                case Opcode::ADDRESS:
+                    // the same on every iteration
+                    base = i.address;
+                    isBase = base.base != Address::Base::REGISTER || !definitions.count(base.reg);
+                    break;
+                default:
+                    break;
+            }
+
+            affine.erase(def);
+            bases.erase(def);
+
+            // values computed from an induction variable are stale once it is stepped
+            if (inductions.count(def)) {
+                for (auto it = affine.begin(); it != affine.end();) {
+                    it = it->second.induction == def ? affine.erase(it) : std::next(it);
+                }
+            }
+
+            if (isAffine && !inductions.count(def)) {
+                affine[def] = result;
+            }
+
+            if (isBase) {
+                bases[def] = base;
+            }
+        }
+    }
+
+    // stepping a pointer only pays off when it is used on every iteration, and not just on some of them
+    std::vector<bool> used(families.size(), false);
+
+    for (std::vector<Family>::size_type f = 0; f < families.size(); ++f) {
+        std::set<const BasicBlock*> through;
+
+        for (const auto& rewrite : rewrites) {
+            if (rewrite.family == f) {
+                through.insert(rewrite.block);
+            }
+        }
+
+        used[f] = covered(through, inductions[families[f].induction].block);
+    }
+
+    rewrites.erase(std::remove_if(rewrites.begin(), rewrites.end(), [&used](const Rewrite& rewrite) {
+        return !used[rewrite.family];
+    }), rewrites.end());
+
+    if (rewrites.empty()) {
+        return;
+    }
+
+    // pointer = base + scale * induction, before the loop
+    auto& preheader = loop.preheader->instructions();
+
+    for (std::vector<Family>::size_type f = 0; f < families.size(); ++f) {
+        auto& family = families[f];
+
+        if (!used[f]) {
+            continue;
+        }
+
+        family.pointer = function.createRegister();
+
+        Instruction address(Opcode::ADDRESS);
+        address.dst = Operand::reg(function.createRegister());
+        address.address = family.base;
+
+        Instruction offset(Opcode::MUL);
+        offset.dst = Operand::reg(function.createRegister());
+        offset.a = Operand::reg(family.induction);
+        offset.b = Operand::imm(family.scale);
+
+        Instruction pointer(Opcode::ADD);
+        pointer.dst = Operand::reg(family.pointer);
+        pointer.a = address.dst;
+        pointer.b = offset.dst;
+        pointer.comment = "strength reduction";
+
+        preheader.insert(preheader.end() - 1, {address, offset, pointer});
+    }
+
+    for (const auto& rewrite : rewrites) {
+        auto& i = rewrite.block->instructions()[rewrite.index];
+        auto pointer = Operand::reg(families[rewrite.family].pointer);
+
+        if (rewrite.constant == 0) {
+            i.op = Opcode::MOVE;
+            i.a = pointer;
+            i.b = Operand();
+        } else {
+            i.op = Opcode::ADD;
+            i.a = pointer;
+            i.b = Operand::imm(rewrite.constant);
+        }
+
+        ++reduced_;
+    }
+
+    // step the pointers right after their induction variable, from the back so indices stay valid
+    std::vector<std::tuple<BasicBlock*, Index, const Family*>> steps;
+
+    for (const auto& family : families) {
+        if (family.pointer < 0) {
+            continue;
+        }
+
+        const auto& step = inductions[family.induction];
+        steps.emplace_back(step.block, step.index, &family);
+    }
+
+    std::sort(steps.begin(), steps.end(), [](const std::tuple<BasicBlock*, Index, const Family*>& a,
+                                             const std::tuple<BasicBlock*, Index, const Family*>& b) {
+        return std::get<1>(a) > std::get<1>(b);
+    });
+
+    for (const auto& step : steps) {
+        auto family = std::get<2>(step);
+
+        Instruction i(Opcode::ADD);
+        i.dst = Operand::reg(family->pointer);
+        i.a = i.dst;
+        i.b = Operand::imm(family->scale * inductions[family->induction].step);
+
+        auto& instructions = std::get<0>(step)->instructions();
+        instructions.insert(instructions.begin() + std::get<1>(step) + 1, i);
+    }
+}
+
+bool StrengthReduction::fits(const long long& value)
+{
+    return value >= -32768 && value <= 32767;
+}
+
+}}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "moonshine/ir/Program.h"
+
+#include <set>
+#include <vector>
+
+namespace moonshine { namespace ir {
+
+/**
+ * Replaces array addressing driven by a loop induction variable with a pointer stepped along with it.
+ *
+ * A basic induction variable is a register whose only definition inside the loop adds a constant to itself,
+ * like the counter of a forStat. An address computed as `base + (i * scale + constant)`, with base the same on
+ * every iteration, is then `p + constant` with `p = base + i * scale` set up before the loop and moved by
+ * `step * scale` right after i is. The multiplications go away; AddressFolding then puts the constant into
+ * the load or store itself.
+ */
+class StrengthReduction
+{
+public:
+    void run(Program& program);
+    void run(Function& function);
+
+    // number of addresses rewritten, over every run
+    unsigned int reduced() const;
+private:
+    struct Loop
+    {
+        BasicBlock* header = nullptr;
+        BasicBlock* preheader = nullptr;
+        std::set<const BasicBlock*> blocks;
+    };
+
+    // reg = scale * induction + constant
+    struct Affine
+    {
+        int induction;
+        int scale;
+        int constant;
+    };
+
+    // pointer = base + scale * induction
+    struct Family
+    {
+        Address base;
+        int induction;
+        int scale;
+        int pointer;
+    };
+
+    unsigned int reduced_ = 0;
+
+    std::vector<Loop> loops(Function& function) const;
+    void reduce(Function& function, const Loop& loop);
+
+    static bool fits(const long long& value);
+};
+
+}}
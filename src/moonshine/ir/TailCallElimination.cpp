@@ -0,0 +1,438 @@
+#include "moonshine/ir/TailCallElimination.h"
+
+#include <algorithm>
+
+namespace moonshine { namespace ir {
+
+void TailCallElimination::run(Program& program)
+{
+    for (auto& function : program.functions()) {
+        if (!function->isProgram() && function->returnSize() == 4) {
+            run(program, *function);
+        }
+    }
+}
+
+unsigned int TailCallElimination::loops() const
+{
+    return loops_;
+}
+
+unsigned int TailCallElimination::tailCalls() const
+{
+    return tailCalls_;
+}
+
+void TailCallElimination::run(Program& program, Function& function)
+{
+    auto sites = find(function);
+
+    if (sites.empty()) {
+        return;
+    }
+
+    // recursion can only be folded into one kind of accumulator
+    auto op = Opcode::MOVE;
+    bool recursive = false;
+
+    for (const auto& site : sites) {
+        if (site.block->instructions()[site.call].callee != function.label()) {
+            continue;
+        }
+
+        recursive = true;
+
+        if (site.op != Opcode::MOVE) {
+            if (op != Opcode::MOVE && op != site.op) {
+                recursive = false;
+                break;
+            }
+
+            op = site.op;
+        }
+    }
+
+    bool looped = recursive && loop(program, function, sites, op);
+
+    // an accumulator is combined with every other return, calls included
+    if (!looped || op == Opcode::MOVE) {
+        for (const auto& site : sites) {
+            bool self = site.block->instructions()[site.call].callee == function.label();
+
+            if (site.op == Opcode::MOVE && !(self && looped)) {
+                tailCall(program, function, site);
+            }
+        }
+    }
+
+    function.buildCFG();
+}
+
+std::vector<TailCallElimination::Site> TailCallElimination::find(Function& function)
+{
+    std::vector<Site> sites;
+
+    for (auto& block : function.blocks()) {
+        const auto& is = block->instructions();
+        auto n = is.size();
+
+        // call, load the result, maybe add or multiply it, store it as the return value, return
+        if (n < 4 || is[n - 1].op != Opcode::RETURN || is[n - 2].op != Opcode::STORE
+            || is[n - 2].address != Address::frame(-4) || !is[n - 2].a.isRegister()) {
+            continue;
+        }
+
+        Site site;
+        site.block = block.get();
+        site.op = Opcode::MOVE;
+
+        auto result = is[n - 2].a;
+        auto load = n - 3;
+        const auto& combine = is[n - 3];
+
+        if ((combine.op == Opcode::ADD || combine.op == Opcode::MUL) && combine.dst == result && n >= 5) {
+            site.op = combine.op;
+            load = n - 4;
+            result = is[load].dst;
+
+            if (combine.a == result && combine.b != result) {
+                site.factor = combine.b;
+            } else if (combine.b == result && combine.a != result) {
+                site.factor = combine.a;
+            } else {
+                continue;
+            }
+        }
+
+        if (load == 0 || is[load].op != Opcode::LOAD || is[load].address != Address::outgoing(-4)
+            || is[load].dst != result || is[load - 1].op != Opcode::CALL) {
+            continue;
+        }
+
+        site.call = load - 1;
+        sites.push_back(site);
+    }
+
+    return sites;
+}
+
+bool TailCallElimination::loop(Program& program, Function& function, std::vector<Site>& sites, const Opcode& op)
+{
+    auto entry = function.entry();
+    std::size_t loads = 0;
+    auto params = parameters(function, loads);
+
+    // the parameters must only be read through their registers, since the loop doesn't reload them
+    for (const auto& block : function.blocks()) {
+        const auto& is = block->instructions();
+
+        for (std::size_t k = block.get() == entry ? loads : 0; k < is.size(); ++k) {
+            if ((is[k].op == Opcode::LOAD || is[k].op == Opcode::STORE) && is[k].address.base == Address::Base::FRAME
+                && params.count(is[k].address.offset)) {
+                return false;
+            }
+        }
+    }
+
+    for (const auto& site : sites) {
+        if (site.block->instructions()[site.call].callee != function.label()) {
+            continue;
+        }
+
+        auto args = arguments(site.block, site.call);
+
+        if (args.size() != params.size()) {
+            return false;
+        }
+
+        for (const auto& arg : args) {
+            std::set<int> visited;
+
+            if (!params.count(arg.first) || pointsIntoFrame(function, site.block->instructions()[arg.second].a, visited)) {
+                return false;
+            }
+        }
+    }
+
+    // every other return must have a result to combine the accumulator with
+    if (op != Opcode::MOVE) {
+        for (const auto& block : function.blocks()) {
+            const auto& is = block->instructions();
+            bool site = std::find_if(sites.begin(), sites.end(), [&block](const Site& s) { return s.block == block.get(); }) != sites.end();
+
+            if (!site && is.back().op == Opcode::RETURN
+                && (is.size() < 2 || is[is.size() - 2].op != Opcode::STORE || is[is.size() - 2].address != Address::frame(-4))) {
+                return false;
+            }
+        }
+    }
+
+    // split the entry right after the parameters are loaded, that's where the loop goes back to
+    auto header = function.createBlock(program.label("tailrec"));
+    function.moveAfter(header, entry);
+
+    auto& entryInstructions = entry->instructions();
+
+    for (auto k = loads; k < entryInstructions.size(); ++k) {
+        header->append(entryInstructions[k]);
+    }
+
+    entryInstructions.erase(entryInstructions.begin() + loads, entryInstructions.end());
+
+    for (auto& site : sites) {
+        if (site.block == entry) {
+            site.block = header;
+            site.call -= loads;
+        }
+    }
+
+    Operand accumulator;
+
+    if (op != Opcode::MOVE) {
+        accumulator = Operand::reg(function.createRegister());
+
+        Instruction i(Opcode::MOVE);
+        i.dst = accumulator;
+        i.a = Operand::imm(op == Opcode::MUL ? 1 : 0);
+        i.comment = "accumulator";
+        entry->append(i);
+    }
+
+    Instruction jump(Opcode::JUMP);
+    jump.targets[0] = header;
+    entry->append(jump);
+
+    std::set<int> paramRegisters;
+
+    for (const auto& param : params) {
+        if (param.second >= 0) {
+            paramRegisters.insert(param.second);
+        }
+    }
+
+    for (const auto& site : sites) {
+        auto& is = site.block->instructions();
+
+        if (is[site.call].callee != function.label()) {
+            continue;
+        }
+
+        auto args = arguments(site.block, site.call);
+        std::vector<Instruction> before;
+
+        for (std::size_t k = 0; k < site.call; ++k) {
+            if (std::find_if(args.begin(), args.end(), [&k](const std::pair<const int, std::size_t>& arg) { return arg.second == k; }) == args.end()) {
+                before.push_back(is[k]);
+            }
+        }
+
+        if (site.op != Opcode::MOVE) {
+            Instruction i(site.op);
+            i.dst = accumulator;
+            i.a = accumulator;
+            i.b = site.factor;
+            before.push_back(i);
+        }
+
+        // parameters passed on to other parameters are copied first, the moves happen all at once
+        std::map<int, Operand> values;
+
+        for (const auto& arg : args) {
+            auto value = is[arg.second].a;
+
+            if (value.isRegister() && paramRegisters.count(value.value) && value.value != params[arg.first]) {
+                Instruction i(Opcode::MOVE);
+                i.dst = Operand::reg(function.createRegister());
+                i.a = value;
+                before.push_back(i);
+                value = i.dst;
+            }
+
+            values[arg.first] = value;
+        }
+
+        for (const auto& value : values) {
+            // unused parameters aren't loaded at all
+            if (params[value.first] >= 0 && value.second != Operand::reg(params[value.first])) {
+                Instruction i(Opcode::MOVE);
+                i.dst = Operand::reg(params[value.first]);
+                i.a = value.second;
+                before.push_back(i);
+            }
+        }
+
+        Instruction back(Opcode::JUMP);
+        back.targets[0] = header;
+        back.comment = "tail call: " + function.label();
+        before.push_back(back);
+
+        is = before;
+        ++loops_;
+    }
+
+    // what is left returns from the last iteration
+    if (op != Opcode::MOVE) {
+        for (auto& block : function.blocks()) {
+            auto& is = block->instructions();
+
+            if (is.back().op != Opcode::RETURN) {
+                continue;
+            }
+
+            Instruction i(op);
+            i.dst = Operand::reg(function.createRegister());
+            i.a = accumulator;
+            i.b = is[is.size() - 2].a;
+            is[is.size() - 2].a = i.dst;
+            is.insert(is.end() - 2, i);
+        }
+    }
+
+    return true;
+}
+
+bool TailCallElimination::tailCall(const Program& program, Function& function, const Site& site)
+{
+    auto& is = site.block->instructions();
+    auto callee = program.function(is[site.call].callee);
+
+    // the result has to land where our own caller expects it
+    if (!callee || callee->returnSize() != 4) {
+        return false;
+    }
+
+    auto args = arguments(site.block, site.call);
+    auto first = site.call;
+
+    for (const auto& arg : args) {
+        std::set<int> visited;
+
+        if (pointsIntoFrame(function, is[arg.second].a, visited)) {
+            return false;
+        }
+
+        first = std::min(first, arg.second);
+    }
+
+    // the arguments can go straight into the frame if they are all in registers by the time they are stored,
+    // and don't overlap the spill slots that follow the frame
+    bool direct = true;
+
+    for (auto k = first; k < site.call; ++k) {
+        direct = direct && is[k].op != Opcode::LOAD;
+    }
+
+    for (const auto& arg : args) {
+        direct = direct && arg.first >= -function.frameSize();
+    }
+
+    is.erase(is.begin() + site.call + 1, is.end());
+
+    Instruction call = is.back();
+    is.pop_back();
+
+    if (direct) {
+        for (const auto& arg : args) {
+            is[arg.second].address.base = Address::Base::FRAME;
+        }
+    } else {
+        // copy them from the outgoing area over the frame, from the top down since the two may overlap
+        for (auto arg = args.rbegin(); arg != args.rend(); ++arg) {
+            Instruction load(Opcode::LOAD);
+            load.dst = Operand::reg(function.createRegister());
+            load.address = Address::outgoing(arg->first);
+            is.push_back(load);
+
+            Instruction store(Opcode::STORE);
+            store.a = load.dst;
+            store.address = Address::frame(arg->first);
+            is.push_back(store);
+        }
+    }
+
+    call.op = Opcode::TAILCALL;
+    is.push_back(call);
+    ++tailCalls_;
+
+    return true;
+}
+
+std::map<int, int> TailCallElimination::parameters(const Function& function, std::size_t& loads)
+{
+    std::map<int, int> params;
+
+    for (auto offset : function.scalarParameters()) {
+        params[offset] = -1;
+    }
+
+    const auto& entry = function.entry()->instructions();
+
+    for (loads = 0; loads < entry.size(); ++loads) {
+        const auto& i = entry[loads];
+
+        if (i.op != Opcode::LOAD || i.address.base != Address::Base::FRAME || !params.count(i.address.offset)) {
+            break;
+        }
+
+        params[i.address.offset] = i.dst.value;
+    }
+
+    return params;
+}
+
+std::map<int, std::size_t> TailCallElimination::arguments(const BasicBlock* block, const std::size_t& call)
+{
+    const auto& is = block->instructions();
+
+    // the arguments are stored into the outgoing area after the previous call, if any
+    std::map<int, std::size_t> args;
+
+    for (auto k = call; k-- > 0;) {
+        if (is[k].op == Opcode::CALL || is[k].op == Opcode::READ || is[k].op == Opcode::WRITE) {
+            break;
+        }
+
+        if (is[k].op == Opcode::STORE && is[k].address.base == Address::Base::OUTGOING) {
+            args.emplace(is[k].address.offset, k);
+        }
+    }
+
+    return args;
+}
+
+bool TailCallElimination::pointsIntoFrame(const Function& function, const Operand& operand, std::set<int>& visited)
+{
+    if (!operand.isRegister() || !visited.insert(operand.value).second) {
+        return false;
+    }
+
+    for (const auto& block : function.blocks()) {
+        for (const auto& i : block->instructions()) {
+            if (i.def() != operand.value) {
+                continue;
+            }
+
+            switch (i.op) {
+                case Opcode::ADDRESS:
+                    if (i.address.base != Address::Base::REGISTER
+                        || pointsIntoFrame(function, Operand::reg(i.address.reg), visited)) {
+                        return true;
+                    }
+                    break;
+                case Opcode::ADD:
+                case Opcode::SUB:
+                case Opcode::MOVE:
+                    if (pointsIntoFrame(function, i.a, visited) || pointsIntoFrame(function, i.b, visited)) {
+                        return true;
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    return false;
+}
+
+}}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "moonshine/ir/Program.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace moonshine { namespace ir {
+
+/**
+ * Turns calls whose result is returned right away into jumps, so they no longer need a stack frame of their own.
+ *
+ * A function calling itself this way becomes a loop: the arguments are moved into the parameter registers and
+ * control goes back to right after the parameters are loaded. A result combined with the call's result by an
+ * addition or a multiplication (`return (n * factorial(n - 1));`) is folded into an accumulator instead, which
+ * every other return combines with its own result. Other tail calls become TAILCALL, which places the arguments
+ * over the current frame and lets the called function return to the current function's caller.
+ */
+class TailCallElimination
+{
+public:
+    void run(Program& program);
+
+    // over every run
+    unsigned int loops() const;
+    unsigned int tailCalls() const;
+private:
+    // a call followed by nothing but the return of its result
+    struct Site
+    {
+        BasicBlock* block;
+        std::size_t call;
+
+        // ADD or MUL when the result is combined with `factor`, MOVE when it is returned as is
+        Opcode op;
+        Operand factor;
+    };
+
+    unsigned int loops_ = 0;
+    unsigned int tailCalls_ = 0;
+
+    void run(Program& program, Function& function);
+
+    static std::vector<Site> find(Function& function);
+    bool loop(Program& program, Function& function, std::vector<Site>& sites, const Opcode& op);
+    bool tailCall(const Program& program, Function& function, const Site& site);
+
+    // scalar parameter frame offsets to the registers the entry block loads them into first (-1 if it doesn't),
+    // and the number of those loads
+    static std::map<int, int> parameters(const Function& function, std::size_t& loads);
+
+    // the outgoing area offsets stored to for a call, to the index of the store
+    static std::map<int, std::size_t> arguments(const BasicBlock* block, const std::size_t& call);
+
+    // whether a register may hold an address within the current frame, which a reused frame would overwrite
+    static bool pointsIntoFrame(const Function& function, const Operand& operand, std::set<int>& visited);
+};
+
+}}
@@ -101,10 +101,12 @@ void Lexer::startLexing(std::istream* stream, std::ostream* output)
 {
     stream_ = stream;
     output_ = output;
+    buffer_.clear();
 
     dfa_->reset();
 
     position_ = static_cast<unsigned long>(-1);
+    tokens_ = 0;
     errors_ = std::vector<ParseError>();
 }
 
@@ -243,6 +245,10 @@ Token* Lexer::getNextToken()
         errors_.emplace_back(ParseErrorType::E_INVALID_CHARACTERS, value, errorStart);
     }
 
+    if (token) {
+        ++tokens_;
+    }
+
     if (token && output_) {
         if (atocc) {
             *output_ << token->name() << ' ';
@@ -286,6 +292,11 @@ const std::vector<ParseError>& Lexer::getErrors() const
     return errors_;
 }
 
+unsigned long Lexer::tokenCount() const
+{
+    return tokens_;
+}
+
 bool Lexer::readUntil(const char& c)
 {
     bool ret;
@@ -20,6 +20,9 @@ public:
     void startLexing(std::istream* stream, std::ostream* output);
     Token* getNextToken();
     const std::vector<ParseError>& getErrors() const;
+
+    // tokens returned since lexing started
+    unsigned long tokenCount() const;
     bool atocc = false;
 private:
     char character_;
@@ -28,6 +31,7 @@ private:
     std::ostream* output_;
     std::string buffer_;
     unsigned long position_;
+    unsigned long tokens_ = 0;
     std::vector<ParseError> errors_;
 
     bool readNextChar();
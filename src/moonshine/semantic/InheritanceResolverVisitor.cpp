@@ -23,7 +23,7 @@ void InheritanceResolverVisitor::visit(ast::classList* node)
      */
 
     for (auto it = table->begin(); it != table->end(); ++it) {
-        std::shared_ptr<SymbolTableEntry> classEntry = it->second;
+        auto classEntry = it->second;
 
         if (classEntry->kind() != SymbolTableEntryKind::CLASS) {
             continue;
@@ -88,14 +88,14 @@ void InheritanceResolverVisitor::visit(ast::classList* node)
      */
 
     for (auto it = table->begin(); it != table->end(); ++it) {
-        std::shared_ptr<SymbolTableEntry> classEntry = it->second;
+        auto classEntry = it->second;
 
         if (classEntry->kind() != SymbolTableEntryKind::CLASS) {
             continue;
         }
 
         for (const auto& entry : *classEntry->link()) {
-            auto type = dynamic_cast<VariableType*>(entry.second->type());
+            auto type = dynamic_cast<const VariableType*>(entry.second->type());
 
             if (entry.second->kind() != SymbolTableEntryKind::VARIABLE || type->type != Type::CLASS) {
                 continue;
@@ -110,7 +110,7 @@ void InheritanceResolverVisitor::visit(ast::classList* node)
                 auto currentMember = members[i];
 
                 for (const auto& e : *(*table)[currentMember]->link()) {
-                    auto memberType = dynamic_cast<VariableType*>(e.second->type());
+                    auto memberType = dynamic_cast<const VariableType*>(e.second->type());
 
                     if (e.second->kind() != SymbolTableEntryKind::VARIABLE || memberType->type != Type::CLASS) {
                         continue;
@@ -180,7 +180,7 @@ void InheritanceResolverVisitor::visit(ast::inherList* node)
         }
 
         // check that this isn't a duplicate entry in the super list
-        auto nt = std::find_if(classEntry->supers().begin(), classEntry->supers().end(), [&entry](const std::shared_ptr<SymbolTableEntry>& super) {
+        auto nt = std::find_if(classEntry->supers().begin(), classEntry->supers().end(), [&entry](const SymbolTableEntry* super) {
             return super->name() == entry->name();
         });
 
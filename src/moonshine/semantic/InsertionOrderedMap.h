@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace moonshine { namespace semantic {
+
+/**
+ * A map that iterates in insertion order.
+ *
+ * The key/value pairs are kept in a vector, in the order they were first inserted, and a hash index maps
+ * each key to its position. Lookups cost a hash probe and iteration is a linear walk over contiguous
+ * memory that gives the same order on every run. Replacing the value of an existing key keeps its position.
+ */
+template <typename Key, typename Value>
+class InsertionOrderedMap
+{
+public:
+    typedef std::pair<Key, Value> value_type;
+    typedef typename std::vector<value_type>::iterator iterator;
+    typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+    iterator begin() { return values_.begin(); }
+    iterator end() { return values_.end(); }
+    const_iterator begin() const { return values_.begin(); }
+    const_iterator end() const { return values_.end(); }
+
+    std::size_t size() const { return values_.size(); }
+    bool empty() const { return values_.empty(); }
+
+    iterator find(const Key& key)
+    {
+        auto it = index_.find(key);
+        return it != index_.end() ? values_.begin() + it->second : values_.end();
+    }
+
+    const_iterator find(const Key& key) const
+    {
+        auto it = index_.find(key);
+        return it != index_.end() ? values_.begin() + it->second : values_.end();
+    }
+
+    Value& operator[](const Key& key)
+    {
+        auto it = index_.find(key);
+
+        if (it != index_.end()) {
+            return values_[it->second].second;
+        }
+
+        index_.emplace(key, values_.size());
+        values_.emplace_back(key, Value());
+        return values_.back().second;
+    }
+
+    void erase(const_iterator position)
+    {
+        auto i = static_cast<std::size_t>(position - values_.begin());
+
+        index_.erase(position->first);
+        values_.erase(values_.begin() + i);
+
+        // everything after the erased pair moved down by one
+        for (; i < values_.size(); ++i) {
+            index_[values_[i].first] = i;
+        }
+    }
+
+    void clear()
+    {
+        values_.clear();
+        index_.clear();
+    }
+private:
+    std::vector<value_type> values_;
+    std::unordered_map<Key, std::size_t> index_;
+};
+
+}}
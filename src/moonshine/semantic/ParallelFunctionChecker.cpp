@@ -0,0 +1,129 @@
+#include "moonshine/semantic/ParallelFunctionChecker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace moonshine { namespace semantic {
+
+ParallelFunctionChecker::ParallelFunctionChecker(const unsigned int& threads)
+    : threads_(threads > 0 ? threads : 1)
+{
+}
+
+void ParallelFunctionChecker::addVisitor(const ParallelFunctionChecker::factory_type& factory)
+{
+    factories_.push_back(factory);
+}
+
+void ParallelFunctionChecker::check(ast::Node* root, std::vector<SemanticError>& errors)
+{
+    if (!dynamic_cast<ast::prog*>(root)) {
+        throw std::invalid_argument("ParallelFunctionChecker::check: root must be a prog node");
+    }
+
+    std::vector<ast::Node*> functions;
+
+    // what comes before the function definitions, and after them
+    std::vector<ast::Node*> before;
+    std::vector<ast::Node*> after;
+
+    for (auto n = root->child(); n != nullptr; n = n->next()) {
+        if (dynamic_cast<ast::funcDefList*>(n)) {
+            for (auto funcDef = n->child(); funcDef != nullptr; funcDef = funcDef->next()) {
+                functions.push_back(funcDef);
+            }
+        } else {
+            (functions.empty() ? before : after).push_back(n);
+        }
+    }
+
+    // check everything but the function definitions on this thread, one visitor at a time
+    std::vector<std::vector<SemanticError>> beforeErrors(factories_.size());
+    std::vector<std::vector<SemanticError>> afterErrors(factories_.size());
+
+    for (std::size_t v = 0; v < factories_.size(); ++v) {
+        auto visitor = factories_[v]();
+        visitor->setErrorContainer(&beforeErrors[v]);
+
+        for (auto n : before) {
+            n->accept(visitor.get());
+        }
+
+        visitor->setErrorContainer(&afterErrors[v]);
+
+        for (auto n : after) {
+            n->accept(visitor.get());
+        }
+    }
+
+    // each function gets an error container per visitor, merged afterwards
+    std::vector<std::vector<std::vector<SemanticError>>> functionErrors(functions.size());
+    std::vector<std::exception_ptr> failures(functions.size());
+    std::atomic<std::size_t> nextFunction(0);
+
+    auto worker = [&]() {
+        std::size_t i;
+
+        while ((i = nextFunction++) < functions.size()) {
+            try {
+                checkFunction(functions[i], functionErrors[i]);
+            } catch (...) {
+                failures[i] = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    auto poolSize = std::min<std::size_t>(threads_, functions.size());
+
+    // the calling thread takes part in the work, so only spawn the remaining workers
+    for (std::size_t t = 1; t < poolSize; ++t) {
+        pool.emplace_back(worker);
+    }
+
+    worker();
+
+    for (auto& t : pool) {
+        t.join();
+    }
+
+    for (const auto& failure : failures) {
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+    }
+
+    // the order in which the visitors would have found them going over the whole tree one after the other
+    auto append = [&errors](std::vector<SemanticError>& from) {
+        std::move(from.begin(), from.end(), std::back_inserter(errors));
+    };
+
+    for (std::size_t v = 0; v < factories_.size(); ++v) {
+        append(beforeErrors[v]);
+
+        for (auto& function : functionErrors) {
+            append(function[v]);
+        }
+
+        append(afterErrors[v]);
+    }
+}
+
+void ParallelFunctionChecker::checkFunction(ast::Node* funcDef, std::vector<std::vector<SemanticError>>& errors) const
+{
+    errors.resize(factories_.size());
+
+    // visitors keep per-run state (eg. tempvar counters), so every function gets fresh instances
+    for (std::size_t v = 0; v < factories_.size(); ++v) {
+        auto visitor = factories_[v]();
+        visitor->setErrorContainer(&errors[v]);
+        funcDef->accept(visitor.get());
+    }
+}
+
+}}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "moonshine/Visitor.h"
+#include "moonshine/syntax/Node.h"
+#include "moonshine/semantic/SemanticError.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace moonshine { namespace semantic {
+
+/**
+ * Runs function-local check visitors over every funcDef body on a pool of worker threads.
+ *
+ * This is only valid once the global, class and function symbol tables have been linked: function bodies
+ * then only read shared tables and write to their own. Every other part of the tree (class declarations,
+ * the program body) is checked on the calling thread first. Errors found in each function go into their
+ * own container per visitor and are merged into the order in which running each visitor over the whole
+ * tree would have found them, so the output does not depend on scheduling or on the number of threads.
+ */
+class ParallelFunctionChecker
+{
+public:
+    typedef std::function<std::unique_ptr<Visitor>()> factory_type;
+
+    explicit ParallelFunctionChecker(const unsigned int& threads);
+
+    void addVisitor(const factory_type& factory);
+    void check(ast::Node* root, std::vector<SemanticError>& errors);
+private:
+    unsigned int threads_;
+    std::vector<factory_type> factories_;
+
+    // the errors of each visitor
+    void checkFunction(ast::Node* funcDef, std::vector<std::vector<SemanticError>>& errors) const;
+};
+
+}}
@@ -0,0 +1,77 @@
+#include "moonshine/semantic/SymbolArena.h"
+
+#include <limits>
+#include <stdexcept>
+
+namespace moonshine { namespace semantic {
+
+const SymbolArena::handle_type SymbolArena::CHUNK_SIZE;
+
+SymbolTableEntry* SymbolArena::createEntry()
+{
+    return createEntry(range_);
+}
+
+SymbolTableEntry* SymbolArena::createEntry(SymbolRange& range)
+{
+    if (!range.entries || range.entries->size() == CHUNK_SIZE) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (chunks_.size() >= std::numeric_limits<handle_type>::max() / CHUNK_SIZE) {
+            throw std::length_error("SymbolArena::createEntry: too many symbol table entries");
+        }
+
+        range.first = (handle_type) (chunks_.size() * CHUNK_SIZE);
+        chunks_.emplace_back();
+        range.entries = &chunks_.back();
+
+        // reserved up front, so that entries never move
+        range.entries->reserve(CHUNK_SIZE);
+    }
+
+    range.entries->emplace_back((handle_type) (range.first + range.entries->size()));
+    return &range.entries->back();
+}
+
+SymbolTable* SymbolArena::createTable()
+{
+    if (tables_.size() == std::numeric_limits<handle_type>::max()) {
+        throw std::length_error("SymbolArena::createTable: too many symbol tables");
+    }
+
+    tables_.emplace_back(this, (handle_type) tables_.size());
+    return &tables_.back();
+}
+
+SymbolTableEntry* SymbolArena::entry(const SymbolArena::handle_type& handle)
+{
+    return &chunks_.at(handle / CHUNK_SIZE).at(handle % CHUNK_SIZE);
+}
+
+SymbolTable* SymbolArena::table(const SymbolArena::handle_type& handle)
+{
+    return &tables_.at(handle);
+}
+
+std::size_t SymbolArena::entryCount()
+{
+    std::size_t count = 0;
+
+    for (const auto& chunk : chunks_) {
+        count += chunk.size();
+    }
+
+    return count;
+}
+
+std::size_t SymbolArena::tableCount()
+{
+    return tables_.size();
+}
+
+TypeContext& SymbolArena::types()
+{
+    return types_;
+}
+
+}}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "moonshine/semantic/SymbolTable.h"
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace moonshine { namespace semantic {
+
+/**
+ * Owns every symbol table and symbol table entry of a program, and the types they refer to.
+ *
+ * Tables and entries are stored in chunked contiguous storage and never move once created, so the rest of
+ * the compiler refers to them through plain pointers. Each one also gets a 32-bit handle (its index in the
+ * arena), which identifies it independently of where it lives in memory.
+ *
+ * Entries are stored in chunks of CHUNK_SIZE, each filled by a single creator through a SymbolRange: the
+ * arena itself while the tables are built and linked, or a table while its function body is checked,
+ * possibly in parallel with others (see SymbolTable::createEntry). Only reserving a chunk locks. Looking up
+ * by handle and counting must wait until nothing is created anymore.
+ */
+class SymbolArena
+{
+public:
+    typedef std::uint32_t handle_type;
+
+    static const handle_type CHUNK_SIZE = 64;
+
+    SymbolArena() = default;
+    SymbolArena(const SymbolArena&) = delete;
+    SymbolArena& operator=(const SymbolArena&) = delete;
+
+    SymbolTableEntry* createEntry();
+    SymbolTable* createTable();
+
+    // an entry in the given range, which gets a new chunk when it is full
+    SymbolTableEntry* createEntry(SymbolRange& range);
+
+    SymbolTableEntry* entry(const handle_type& handle);
+    SymbolTable* table(const handle_type& handle);
+
+    std::size_t entryCount();
+    std::size_t tableCount();
+
+    // types live as long as the program's tables, not the process
+    TypeContext& types();
+private:
+    std::mutex mutex_;
+    std::deque<std::vector<SymbolTableEntry>> chunks_;
+    SymbolRange range_;
+    std::deque<SymbolTable> tables_;
+    TypeContext types_;
+};
+
+}}
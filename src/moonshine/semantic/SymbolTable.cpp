@@ -1,4 +1,5 @@
 #include "SymbolTable.h"
+#include "SymbolArena.h"
 
 #include <exception>
 #include <algorithm>
@@ -8,6 +9,36 @@
 
 namespace moonshine { namespace semantic {
 
+SymbolTableEntry::SymbolTableEntry(const SymbolTableEntry::handle_type& handle)
+    : handle_(handle)
+{
+}
+
+SymbolTableEntry::handle_type SymbolTableEntry::handle() const
+{
+    return handle_;
+}
+
+SymbolTable::SymbolTable(SymbolArena* arena, const SymbolTable::handle_type& handle)
+    : arena_(arena), handle_(handle)
+{
+}
+
+SymbolArena& SymbolTable::arena() const
+{
+    return *arena_;
+}
+
+SymbolTable::handle_type SymbolTable::handle() const
+{
+    return handle_;
+}
+
+SymbolTable::entry_type SymbolTable::createEntry()
+{
+    return arena_->createEntry(range_);
+}
+
 SymbolTableEntry* SymbolTable::parentEntry() const
 {
     return parent_;
@@ -15,17 +46,32 @@ SymbolTableEntry* SymbolTable::parentEntry() const
 
 SymbolTableEntry::key_type SymbolTableEntry::name() const
 {
+    // temporaries are only identified by their id, so their name is made up on demand
+    if (name_.empty() && id_ != 0) {
+        return "_t" + std::to_string(id_);
+    }
+
     return name_;
 }
 
+unsigned int SymbolTableEntry::id() const
+{
+    return id_;
+}
+
+void SymbolTableEntry::setId(const unsigned int& id)
+{
+    id_ = id;
+}
+
 SymbolTableEntryKind SymbolTableEntry::kind() const
 {
     return kind_;
 }
 
-SymbolTableEntry::weak_type_type SymbolTableEntry::type() const
+SymbolTableEntry::type_type SymbolTableEntry::type() const
 {
-    return type_.get();
+    return type_;
 }
 
 SymbolTableEntry::table_type SymbolTableEntry::link() const
@@ -45,7 +91,7 @@ void SymbolTableEntry::setKind(const SymbolTableEntryKind& kind)
 
 void SymbolTableEntry::setType(SymbolTableEntry::type_type type)
 {
-    type_ = std::move(type);
+    type_ = type;
 }
 
 void SymbolTableEntry::setLink(const SymbolTableEntry::table_type& link)
@@ -98,6 +144,17 @@ void SymbolTable::addEntry(const SymbolTable::entry_type& entry)
     entry->setParent(this);
 }
 
+void SymbolTable::addTemporary(const SymbolTable::entry_type& entry)
+{
+    temporaries_.push_back(entry);
+    entry->setParent(this);
+}
+
+const std::vector<SymbolTable::entry_type>& SymbolTable::temporaries() const
+{
+    return temporaries_;
+}
+
 void SymbolTable::removeEntry(const SymbolTableEntry::key_type& name)
 {
     auto entry = entries_.find(name);
@@ -120,19 +177,26 @@ void SymbolTable::print(std::ostream& s, std::string pad) const
     std::string::size_type sizeColLen = 4 + 1;
     std::string::size_type offsetColLen = 6 + 1;
 
+    // named entries first, then temporaries
+    std::vector<entry_type> rows;
     for (const auto& it : entries_) {
-        nameColLen = std::max(nameColLen, it.second->name().size() + 1);
+        rows.push_back(it.second);
+    }
+    rows.insert(rows.end(), temporaries_.begin(), temporaries_.end());
 
-        if (it.second->type()) {
-            typeColLen = std::max(typeColLen, it.second->type()->str().size() + 1);
+    for (const auto& entry : rows) {
+        nameColLen = std::max(nameColLen, entry->name().size() + 1);
+
+        if (entry->type()) {
+            typeColLen = std::max(typeColLen, entry->type()->str().size() + 1);
         }
     }
 
-    for (const auto& it : entries_) {
+    for (const auto& entry : rows) {
         std::string::size_type len = 0;
-        for (auto sit = it.second->supers().begin(); sit != it.second->supers().end(); ++sit) {
+        for (auto sit = entry->supers().begin(); sit != entry->supers().end(); ++sit) {
             len += (*sit)->name().size();
-            if (sit + 1 != it.second->supers().end()) {
+            if (sit + 1 != entry->supers().end()) {
                 len += 2;
             }
         }
@@ -182,8 +246,7 @@ void SymbolTable::print(std::ostream& s, std::string pad) const
     s << "┤" << std::endl;
 
     // entries
-    for (const auto& it : entries_) {
-        std::shared_ptr<SymbolTableEntry> entry = it.second;
+    for (const auto& entry : rows) {
         s << pad << "│";
 
         // name
@@ -294,7 +357,7 @@ void SymbolTable::setParentEntry(SymbolTable::weak_entry_type parent)
     parent_ = parent;
 }
 
-std::shared_ptr<SymbolTableEntry> SymbolTable::get(const SymbolTableEntry::key_type& name)
+SymbolTable::entry_type SymbolTable::get(const SymbolTableEntry::key_type& name)
 {
     auto entry = entries_.find(name);
 
@@ -337,19 +400,19 @@ void SymbolTableEntry::setHasReturn(const bool& hasReturn)
     hasReturn_ = hasReturn;
 }
 
-void SymbolTableEntry::addSuper(const std::shared_ptr<SymbolTableEntry>& super)
+void SymbolTableEntry::addSuper(SymbolTableEntry* super)
 {
     supers_.push_back(super);
 }
 
-const std::vector<std::shared_ptr<SymbolTableEntry>>& SymbolTableEntry::supers() const
+const std::vector<SymbolTableEntry*>& SymbolTableEntry::supers() const
 {
     return supers_;
 }
 
 void SymbolTableEntry::removeSuper(const std::string& super)
 {
-    auto it = std::find_if(supers_.begin(), supers_.end(), [&super](const std::shared_ptr<SymbolTableEntry>& entry) {
+    auto it = std::find_if(supers_.begin(), supers_.end(), [&super](const SymbolTableEntry* entry) {
         return entry->name() == super;
     });
 
@@ -378,12 +441,12 @@ void SymbolTableEntry::setOffset(const int& offset)
     offset_ = offset;
 }
 
-const std::vector<std::shared_ptr<SymbolTableEntry>>& SymbolTableEntry::parameters() const
+const std::vector<SymbolTableEntry*>& SymbolTableEntry::parameters() const
 {
     return parameters_;
 }
 
-void SymbolTableEntry::addParameter(const std::shared_ptr<SymbolTableEntry>& parameter)
+void SymbolTableEntry::addParameter(SymbolTableEntry* parameter)
 {
     parameters_.emplace_back(parameter);
 }
@@ -1,11 +1,11 @@
 #pragma once
 
 #include "moonshine/semantic/Type.h"
+#include "moonshine/semantic/InsertionOrderedMap.h"
 
+#include <cstdint>
 #include <string>
 #include <vector>
-#include <unordered_map>
-#include <memory>
 #include <ostream>
 
 namespace moonshine { namespace semantic {
@@ -23,65 +23,93 @@ enum class SymbolTableEntryKind
 };
 
 class SymbolTable;
+class SymbolArena;
 
 class SymbolTableEntry
 {
 public:
     typedef std::string key_type;
-    typedef std::unique_ptr<SymbolType> type_type;
-    typedef SymbolType* weak_type_type;
-    typedef std::shared_ptr<SymbolTable> table_type;
+    typedef const SymbolType* type_type;
+    typedef SymbolTable* table_type;
     typedef SymbolTable* weak_table_type;
+    typedef std::uint32_t handle_type;
 
+    explicit SymbolTableEntry(const handle_type& handle);
+
+    handle_type handle() const;
     weak_table_type parentTable() const;
     key_type name() const;
+    unsigned int id() const;
     SymbolTableEntryKind kind() const;
-    weak_type_type type() const;
+    type_type type() const;
     table_type link() const;
-    const std::vector<std::shared_ptr<SymbolTableEntry>>& supers() const;
-    const std::vector<std::shared_ptr<SymbolTableEntry>>& parameters() const;
+    const std::vector<SymbolTableEntry*>& supers() const;
+    const std::vector<SymbolTableEntry*>& parameters() const;
     bool hasReturn() const;
     void setName(const key_type& name);
+    void setId(const unsigned int& id);
     void setKind(const SymbolTableEntryKind& kind);
     void setType(type_type type);
     void setLink(const table_type& link);
     void setParent(SymbolTable* parent);
     void setHasReturn(const bool& hasReturn);
-    void addSuper(const std::shared_ptr<SymbolTableEntry>& super);
+    void addSuper(SymbolTableEntry* super);
     void removeSuper(const std::string& super);
-    void addParameter(const std::shared_ptr<SymbolTableEntry>& parameter);
+    void addParameter(SymbolTableEntry* parameter);
 
     int size();
     int offset();
     void setSize(const int& size);
     void setOffset(const int& offset);
 private:
+    handle_type handle_;
     key_type name_;
-    SymbolTableEntryKind kind_;
-    type_type type_;
-    table_type link_;
+    unsigned int id_ = 0;
+    SymbolTableEntryKind kind_ = SymbolTableEntryKind::VARIABLE;
+    type_type type_ = nullptr;
+    table_type link_ = nullptr;
     weak_table_type parent_ = nullptr;
     bool hasReturn_ = false;
-    std::vector<std::shared_ptr<SymbolTableEntry>> supers_;
-    std::vector<std::shared_ptr<SymbolTableEntry>> parameters_;
+    std::vector<SymbolTableEntry*> supers_;
+    std::vector<SymbolTableEntry*> parameters_;
 
-    int size_;
-    int offset_;
+    int size_ = 0;
+    int offset_ = 0;
+};
+
+// a run of consecutive handles reserved in a SymbolArena for one creator of entries, and the chunk of
+// contiguous storage that holds their entries
+struct SymbolRange
+{
+    std::vector<SymbolTableEntry>* entries = nullptr;
+    SymbolTableEntry::handle_type first = 0;
 };
 
 class SymbolTable
 {
 public:
-    typedef std::shared_ptr<SymbolTableEntry> entry_type;
+    typedef SymbolTableEntry* entry_type;
     typedef SymbolTableEntry* weak_entry_type;
-    typedef std::unordered_map<SymbolTableEntry::key_type, entry_type> map_type;
+    typedef InsertionOrderedMap<SymbolTableEntry::key_type, entry_type> map_type;
+    typedef std::uint32_t handle_type;
+
+    SymbolTable(SymbolArena* arena, const handle_type& handle);
+
+    SymbolArena& arena() const;
+    handle_type handle() const;
+
+    // an entry in a range of the arena reserved for this table; checking a function body only creates entries
+    // in the tables of its own scopes, so no two threads fill the same range
+    entry_type createEntry();
 
     weak_entry_type parentEntry() const;
     void setParentEntry(weak_entry_type parent);
-    std::shared_ptr<SymbolTableEntry> operator[](const SymbolTableEntry::key_type& name);
-    std::shared_ptr<SymbolTableEntry> get(const SymbolTableEntry::key_type& name);
+    entry_type operator[](const SymbolTableEntry::key_type& name);
+    entry_type get(const SymbolTableEntry::key_type& name);
     void addEntry(const entry_type& entry);
+    void addTemporary(const entry_type& entry);
     void removeEntry(const SymbolTableEntry::key_type& name);
+    const std::vector<entry_type>& temporaries() const;
 
     int size();
     void setSize(const int& size);
@@ -91,11 +119,18 @@ public:
 
     void print(std::ostream& s, std::string pad) const;
 private:
-    // TODO: unordered_multimap?
+    SymbolArena* arena_;
+    handle_type handle_;
+    SymbolRange range_;
+
+    // iterated in declaration order, so frame layout and printing don't depend on hashing
     map_type entries_;
+
+    // temporaries can't be looked up by name, so they are kept out of the map
+    std::vector<entry_type> temporaries_;
     weak_entry_type parent_ = nullptr;
     int forCount_ = 0;
-    int size_;
+    int size_ = 0;
 };
 
 }}
@@ -14,41 +14,53 @@ void SymbolTableCreatorVisitor::visit(ast::prog* node)
     Visitor::visit(node);
 
     // create global symbol table
-    auto table = node->symbolTable() = std::make_shared<SymbolTable>();
+    auto table = node->symbolTable() = arena().createTable();
 
     // create entry for program function, using its symbol table
-    auto program = std::make_shared<SymbolTableEntry>();
+    auto program = arena().createEntry();
     program->setName("program");
     program->setKind(SymbolTableEntryKind::FUNCTION);
-    auto programTable = node->child(2)->symbolTable() = std::make_shared<SymbolTable>();
+    auto programTable = node->child(2)->symbolTable() = arena().createTable();
     program->setLink(programTable);
-    node->symbolTable()->addEntry(program);
+    table->addEntry(program);
+
+    // the tree now owns every table and entry we created
+    node->symbolArena() = std::move(arena_);
+}
+
+SymbolArena& SymbolTableCreatorVisitor::arena()
+{
+    if (!arena_) {
+        arena_.reset(new SymbolArena());
+    }
+
+    return *arena_;
 }
 
 void SymbolTableCreatorVisitor::visit(ast::varDecl* node)
 {
     Visitor::visit(node);
 
-    node->symbolTableEntry() = std::make_shared<SymbolTableEntry>();
+    node->symbolTableEntry() = arena().createEntry();
     node->symbolTableEntry()->setName(dynamic_cast<ast::Leaf*>(node->child(1))->token()->value);
     node->symbolTableEntry()->setKind(SymbolTableEntryKind::VARIABLE);
 
-    std::unique_ptr<VariableType> type(new VariableType());
-    nodeToVariableType(*type, node);
-    node->symbolTableEntry()->setType(std::move(type));
+    VariableType type;
+    nodeToVariableType(type, node);
+    node->symbolTableEntry()->setType(arena().types().intern(type));
 }
 
 void SymbolTableCreatorVisitor::visit(ast::funcDecl* node)
 {
     Visitor::visit(node);
 
-    node->symbolTableEntry() = std::make_shared<SymbolTableEntry>();
+    node->symbolTableEntry() = arena().createEntry();
     node->symbolTableEntry()->setName(dynamic_cast<ast::Leaf*>(node->child(1))->token()->value);
     node->symbolTableEntry()->setKind(SymbolTableEntryKind::FUNCTION);
 
-    std::unique_ptr<FunctionType> type(new FunctionType());
-    funcDeclToFunctionType(*type, node);
-    node->symbolTableEntry()->setType(std::move(type));
+    FunctionType type;
+    funcDeclToFunctionType(type, node);
+    node->symbolTableEntry()->setType(arena().types().intern(type));
 }
 
 void SymbolTableCreatorVisitor::visit(ast::classDecl* node)
@@ -56,12 +68,12 @@ void SymbolTableCreatorVisitor::visit(ast::classDecl* node)
     Visitor::visit(node);
 
     // populate the symbol table entry for the class
-    auto entry = node->symbolTableEntry() = std::make_shared<SymbolTableEntry>();
+    auto entry = node->symbolTableEntry() = arena().createEntry();
     entry->setName(dynamic_cast<ast::Leaf*>(node->child(0))->token()->value);
     entry->setKind(SymbolTableEntryKind::CLASS);
 
     // create the class' own symbol table
-    auto table = node->symbolTable() = std::make_shared<SymbolTable>();
+    auto table = node->symbolTable() = arena().createTable();
     entry->setLink(table);
 }
 
@@ -70,7 +82,7 @@ void SymbolTableCreatorVisitor::visit(ast::funcDef* node)
     Visitor::visit(node);
 
     // populate the symbol table entry for the function
-    auto entry = node->symbolTableEntry() = std::make_shared<SymbolTableEntry>();
+    auto entry = node->symbolTableEntry() = arena().createEntry();
 
     // if the 3rd child is not nul, we know the 2nd child is a scope
     auto nameNode = dynamic_cast<ast::Leaf*>(node->child(2))
@@ -80,12 +92,12 @@ void SymbolTableCreatorVisitor::visit(ast::funcDef* node)
     entry->setKind(SymbolTableEntryKind::FUNCTION);
 
     // set the function's type in the entry
-    std::unique_ptr<FunctionType> type(new FunctionType());
-    funcDefToFunctionType(*type, node);
-    entry->setType(std::move(type));
+    FunctionType type;
+    funcDefToFunctionType(type, node);
+    entry->setType(arena().types().intern(type));
 
     // create the function symbol table
-    auto table = node->symbolTable() = std::make_shared<SymbolTable>();
+    auto table = node->symbolTable() = arena().createTable();
     entry->setLink(table);
 }
 
@@ -123,7 +135,7 @@ void SymbolTableCreatorVisitor::nodeToVariableType(VariableType& type, const ast
     }
 }
 
-void SymbolTableCreatorVisitor::funcDeclToFunctionType(FunctionType& type, const ast::Node* node) const
+void SymbolTableCreatorVisitor::funcDeclToFunctionType(FunctionType& type, const ast::Node* node)
 {
     if (node == nullptr) {
         throw std::invalid_argument("SymbolTableCreatorVisitor::funcDeclToFunctionType: node cannot be nullptr");
@@ -135,21 +147,25 @@ void SymbolTableCreatorVisitor::funcDeclToFunctionType(FunctionType& type, const
         throw std::runtime_error("SymbolTableCreatorVisitor::funcDeclToFunctionType: First child is not a leaf node");
     }
 
+    VariableType returnType;
+
     switch (typeNode->token()->type) {
         case TokenType::T_INT:
-            type.returnType.type = Type::INT;
+            returnType.type = Type::INT;
             break;
         case TokenType::T_FLOAT:
-            type.returnType.type = Type::FLOAT;
+            returnType.type = Type::FLOAT;
             break;
         case TokenType::T_IDENTIFIER:
-            type.returnType.type = Type::CLASS;
-            type.returnType.className = typeNode->token()->value;
+            returnType.type = Type::CLASS;
+            returnType.className = typeNode->token()->value;
             break;
         default:
             throw std::runtime_error("SymbolTableCreatorVisitor::funcDeclToFunctionType: Invalid AST type node");
     }
 
+    type.returnType = arena().types().intern(returnType);
+
     // fparam
     for (auto fparam = dynamic_cast<const ast::fparam*>(node->child(2)->child()); fparam != nullptr; fparam = dynamic_cast<const ast::fparam*>(fparam->next())) {
         typeNode = dynamic_cast<ast::Leaf*>(fparam->child(0));
@@ -175,11 +191,11 @@ void SymbolTableCreatorVisitor::funcDeclToFunctionType(FunctionType& type, const
             parameterType.indices.emplace_back(std::stoi(num->token()->value));
         }
 
-        type.parameterTypes.emplace_back(parameterType);
+        type.parameterTypes.emplace_back(arena().types().intern(parameterType));
     }
 }
 
-void SymbolTableCreatorVisitor::funcDefToFunctionType(FunctionType& type, const ast::Node* node) const
+void SymbolTableCreatorVisitor::funcDefToFunctionType(FunctionType& type, const ast::Node* node)
 {
     if (node == nullptr) {
         throw std::invalid_argument("SymbolTableCreatorVisitor::funcDefToFunctionType: node cannot be nullptr");
@@ -191,21 +207,25 @@ void SymbolTableCreatorVisitor::funcDefToFunctionType(FunctionType& type, const
         throw std::runtime_error("SymbolTableCreatorVisitor::funcDefToFunctionType: First child is not a leaf node");
     }
 
+    VariableType returnType;
+
     switch (typeNode->token()->type) {
         case TokenType::T_INT:
-            type.returnType.type = Type::INT;
+            returnType.type = Type::INT;
             break;
         case TokenType::T_FLOAT:
-            type.returnType.type = Type::FLOAT;
+            returnType.type = Type::FLOAT;
             break;
         case TokenType::T_IDENTIFIER:
-            type.returnType.type = Type::CLASS;
-            type.returnType.className = typeNode->token()->value;
+            returnType.type = Type::CLASS;
+            returnType.className = typeNode->token()->value;
             break;
         default:
             throw std::runtime_error("SymbolTableCreatorVisitor::funcDefToFunctionType: Invalid AST type node");
     }
 
+    type.returnType = arena().types().intern(returnType);
+
     // scope
     // if the 3rd child is not nul, we know the 2nd child is a scope
     if (!dynamic_cast<ast::nul*>(node->child(2))) {
@@ -238,7 +258,7 @@ void SymbolTableCreatorVisitor::funcDefToFunctionType(FunctionType& type, const
             parameterType.indices.emplace_back(std::stoi(num->token()->value));
         }
 
-        type.parameterTypes.emplace_back(parameterType);
+        type.parameterTypes.emplace_back(arena().types().intern(parameterType));
     }
 }
 
@@ -246,25 +266,25 @@ void SymbolTableCreatorVisitor::visit(ast::fparam* node)
 {
     Visitor::visit(node);
 
-    node->symbolTableEntry() = std::make_shared<SymbolTableEntry>();
+    node->symbolTableEntry() = arena().createEntry();
     node->symbolTableEntry()->setName(dynamic_cast<ast::Leaf*>(node->child(1))->token()->value);
     node->symbolTableEntry()->setKind(SymbolTableEntryKind::PARAMETER);
 
-    std::unique_ptr<VariableType> type(new VariableType());
-    nodeToVariableType(*type, node);
-    node->symbolTableEntry()->setType(std::move(type));
+    VariableType type;
+    nodeToVariableType(type, node);
+    node->symbolTableEntry()->setType(arena().types().intern(type));
 }
 
 void SymbolTableCreatorVisitor::visit(ast::forStat* node)
 {
     Visitor::visit(node);
 
-    auto entry = node->symbolTableEntry() = std::make_shared<SymbolTableEntry>();
+    auto entry = node->symbolTableEntry() = arena().createEntry();
     //node->symbolTableEntry()->setName(dynamic_cast<ast::Leaf*>(node->child(1))->token()->value);
     entry->setKind(SymbolTableEntryKind::BLOCK);
 
     // create a symbol table for this for statement
-    auto table = node->symbolTable() = std::make_shared<SymbolTable>();
+    auto table = node->symbolTable() = arena().createTable();
     entry->setLink(table);
 }
 
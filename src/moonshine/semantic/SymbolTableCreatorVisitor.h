@@ -3,6 +3,9 @@
 #include "moonshine/Visitor.h"
 #include "moonshine/syntax/Node.h"
 #include "moonshine/semantic/Type.h"
+#include "moonshine/semantic/SymbolArena.h"
+
+#include <memory>
 
 namespace moonshine { namespace semantic {
 
@@ -17,9 +20,13 @@ public:
     void visit(ast::fparam* node) override;
     void visit(ast::forStat* node) override;
 private:
+    // handed over to the prog node once the whole tree has been visited
+    std::unique_ptr<SymbolArena> arena_;
+
+    SymbolArena& arena();
     void nodeToVariableType(VariableType& type, const ast::Node* node) const;
-    void funcDeclToFunctionType(FunctionType& type, const ast::Node* node) const;
-    void funcDefToFunctionType(FunctionType& type, const ast::Node* node) const;
+    void funcDeclToFunctionType(FunctionType& type, const ast::Node* node);
+    void funcDefToFunctionType(FunctionType& type, const ast::Node* node);
 };
 
 }}
@@ -28,7 +28,7 @@ void SymbolTableLinkerVisitor::visit(ast::varDecl* node)
             node->marked = true;
             errors_->emplace_back(SemanticErrorType::REDECLARED_SYMBOL, dynamic_cast<ast::id*>(node->child(1))->token());
         } else {
-            auto type = dynamic_cast<VariableType*>(entry->type());
+            auto type = dynamic_cast<const VariableType*>(entry->type());
 
             // if the type is a class, we should check that the class exists
             if (type->type == Type::CLASS && !(*table)[type->className]) {
@@ -54,13 +54,13 @@ void SymbolTableLinkerVisitor::visit(ast::forStat* node)
     node->parent()->closestSymbolTable()->addEntry(node->symbolTableEntry());
 
     // create a new entry for the built-in for variable declaration
-    auto varDecl = std::make_shared<SymbolTableEntry>();
+    auto varDecl = node->symbolTable()->arena().createEntry();
     varDecl->setName(dynamic_cast<ast::Leaf*>(node->child(1))->token()->value);
     varDecl->setKind(SymbolTableEntryKind::VARIABLE);
 
-    std::unique_ptr<VariableType> type(new VariableType());
-    nodeToVariableType(*type, node);
-    varDecl->setType(std::move(type));
+    VariableType type;
+    nodeToVariableType(type, node);
+    varDecl->setType(node->symbolTable()->arena().types().intern(type));
 
     // add the variable to the forStat's symbol table
     table->addEntry(varDecl);
@@ -132,7 +132,7 @@ void SymbolTableLinkerVisitor::visit(ast::funcDef* node)
         throw std::runtime_error("SymbolTableLinkerVisitor::visit(funcDef): No symbol table exists");
     }
 
-    auto type = dynamic_cast<FunctionType*>(node->symbolTableEntry()->type());
+    auto type = dynamic_cast<const FunctionType*>(node->symbolTableEntry()->type());
 
     if (type->scope.empty()) {
         // this function definition is a free function in the global symbol table
@@ -155,7 +155,8 @@ void SymbolTableLinkerVisitor::visit(ast::funcDef* node)
             if (entry->link()) {
                 // if it does, this is a redefinition
                 errors_->emplace_back(SemanticErrorType::REDEFINED_FUNCTION, dynamic_cast<ast::id*>(node->child(2))->token());
-            } else if (*type != *entry->type()) {
+            } else if (!dynamic_cast<const FunctionType*>(entry->type())
+                       || !type->hasSameSignature(*dynamic_cast<const FunctionType*>(entry->type()))) {
                 // the function exists, but the definition differs from the declaration
                 errors_->emplace_back(SemanticErrorType::INCORRECT_TYPE_IN_FUNCTION_DEFINITION, dynamic_cast<ast::id*>(node->child(2))->token());
             } else {
@@ -181,7 +182,7 @@ void SymbolTableLinkerVisitor::visit(ast::returnStat* node)
     Visitor::visit(node);
 
     // find the symbol table for the function we're in
-    auto table = node->closestSymbolTable().get();
+    auto table = node->closestSymbolTable();
     while (table && table->parentEntry()->kind() != SymbolTableEntryKind::FUNCTION) {
         table = table->parentEntry()->parentTable();
     }
@@ -205,7 +206,7 @@ void SymbolTableLinkerVisitor::fparamListToSymbolTable(SymbolTable& table, ast::
             if (table[entry->name()]) {
                 errors_->emplace_back(SemanticErrorType::REDECLARED_SYMBOL, dynamic_cast<ast::id*>(n->child(1))->token());
             } else {
-                auto type = dynamic_cast<VariableType*>(entry->type());
+                auto type = dynamic_cast<const VariableType*>(entry->type());
 
                 // if the type is a class, we should check that the class exists
                 if (type->type == Type::CLASS && !table[type->className]) {
@@ -1,18 +1,10 @@
 #include "moonshine/semantic/Type.h"
 
 #include <sstream>
+#include <stdexcept>
 
 namespace moonshine { namespace semantic {
 
-bool VariableType::compare(const SymbolType& rhs) const
-{
-    if (auto p = dynamic_cast<const VariableType*>(&rhs)) {
-        return type == p->type && indices == p->indices;
-    }
-
-    return false;
-}
-
 std::string VariableType::str() const
 {
     std::stringstream s;
@@ -39,23 +31,14 @@ std::string VariableType::str() const
     return s.str();
 }
 
-bool FunctionType::compare(const SymbolType& rhs) const
-{
-    if (auto p = dynamic_cast<const FunctionType*>(&rhs)) {
-        return returnType == p->returnType && parameterTypes == p->parameterTypes;
-    }
-
-    return false;
-}
-
 std::string FunctionType::str() const
 {
     std::stringstream s;
 
-    s << returnType.str() <<  " : ";
+    s << returnType->str() <<  " : ";
 
     for (auto it = parameterTypes.begin(); it != parameterTypes.end(); ++it) {
-        s << it->str();
+        s << (*it)->str();
         if (it + 1 != parameterTypes.end()) {
             s << ", ";
         }
@@ -68,4 +51,63 @@ std::string FunctionType::str() const
     return s.str();
 }
 
-}}
\ No newline at end of file
+TypeContext::TypeContext()
+{
+    intType_ = get(Type::INT, "", {});
+    floatType_ = get(Type::FLOAT, "", {});
+    errorType_ = get(Type::ERROR, "", {});
+}
+
+const VariableType* TypeContext::get(const Type& type)
+{
+    switch (type) {
+        case Type::INT:
+            return intType_;
+        case Type::FLOAT:
+            return floatType_;
+        case Type::ERROR:
+            return errorType_;
+        default:
+            throw std::invalid_argument("TypeContext::get: Class types need a class name");
+    }
+}
+
+const VariableType* TypeContext::get(const Type& type, const std::string& className, const std::vector<unsigned int>& indices)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto& canonical = variableTypes_[variable_key_type(type, className, indices)];
+
+    if (!canonical) {
+        canonical.reset(new VariableType());
+        canonical->type = type;
+        canonical->className = className;
+        canonical->indices = indices;
+    }
+
+    return canonical.get();
+}
+
+const VariableType* TypeContext::intern(const VariableType& type)
+{
+    if (type.indices.empty() && type.type != Type::CLASS) {
+        return get(type.type);
+    }
+
+    return get(type.type, type.className, type.indices);
+}
+
+const FunctionType* TypeContext::intern(const FunctionType& type)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto& canonical = functionTypes_[function_key_type(type.returnType, type.parameterTypes, type.scope)];
+
+    if (!canonical) {
+        canonical.reset(new FunctionType(type));
+    }
+
+    return canonical.get();
+}
+
+}}
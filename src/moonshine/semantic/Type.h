@@ -2,6 +2,10 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <tuple>
+#include <memory>
+#include <mutex>
 
 namespace moonshine { namespace semantic {
 
@@ -15,20 +19,15 @@ enum class Type
 
 struct SymbolType
 {
-    virtual std::string str() const = 0;
-
-    friend bool operator==(const SymbolType& lhs, const SymbolType& rhs) {
-        return lhs.compare(rhs);
-    }
-
-    friend bool operator!=(const SymbolType& lhs, const SymbolType& rhs) {
-        return !(lhs == rhs);
-    }
+    virtual ~SymbolType() = default;
 
-protected:
-    virtual bool compare(const SymbolType& rhs) const = 0;
+    virtual std::string str() const = 0;
 };
 
+/**
+ * Types handed out by a TypeContext are canonical: two variable types are equal if and only if
+ * they are the same instance, so they should be compared by pointer.
+ */
 struct VariableType : public SymbolType
 {
     Type type;
@@ -44,20 +43,45 @@ struct VariableType : public SymbolType
     inline bool isNotError() const {
         return !isError();
     }
-
-protected:
-    bool compare(const SymbolType& rhs) const override;
 };
 
 struct FunctionType : public SymbolType
 {
-    VariableType returnType;
-    std::vector<VariableType> parameterTypes;
+    const VariableType* returnType = nullptr;
+    std::vector<const VariableType*> parameterTypes;
     std::string scope;
 
     std::string str() const override;
-protected:
-    bool compare(const SymbolType& rhs) const override;
+
+    // the scope is not part of a function's signature
+    inline bool hasSameSignature(const FunctionType& rhs) const {
+        return returnType == rhs.returnType && parameterTypes == rhs.parameterTypes;
+    }
+};
+
+class TypeContext
+{
+public:
+    TypeContext();
+    TypeContext(const TypeContext&) = delete;
+    TypeContext& operator=(const TypeContext&) = delete;
+
+    const VariableType* get(const Type& type);
+    const VariableType* get(const Type& type, const std::string& className, const std::vector<unsigned int>& indices);
+    const VariableType* intern(const VariableType& type);
+    const FunctionType* intern(const FunctionType& type);
+private:
+    typedef std::tuple<Type, std::string, std::vector<unsigned int>> variable_key_type;
+    typedef std::tuple<const VariableType*, std::vector<const VariableType*>, std::string> function_key_type;
+
+    std::mutex mutex_;
+    std::map<variable_key_type, std::unique_ptr<VariableType>> variableTypes_;
+    std::map<function_key_type, std::unique_ptr<FunctionType>> functionTypes_;
+
+    // scalar primitives are by far the most common, so they are resolved without locking
+    const VariableType* intType_;
+    const VariableType* floatType_;
+    const VariableType* errorType_;
 };
 
 }}
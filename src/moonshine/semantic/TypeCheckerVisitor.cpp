@@ -17,7 +17,7 @@ void TypeCheckerVisitor::visit(ast::assignStat* node)
 
     // ensure that lhs and rhs share the same type
     // only report an error if the types aren't errors themselves to prevent error spam
-    if (*node->child(0)->type() != *node->child(1)->type()
+    if (node->child(0)->type() != node->child(1)->type()
         && node->child(0)->type()->isNotError()
         && node->child(1)->type()->isNotError()) {
         errors_->emplace_back(SemanticErrorType::INCOMPATIBLE_TYPE, node->token());
@@ -29,7 +29,7 @@ void TypeCheckerVisitor::visit(ast::returnStat* node)
     Visitor::visit(node);
 
     // find the symbol table for the function we're in
-    auto table = node->closestSymbolTable().get();
+    auto table = node->closestSymbolTable();
     while (table && table->parentEntry()->kind() != SymbolTableEntryKind::FUNCTION) {
         table = table->parentEntry()->parentTable();
     }
@@ -39,7 +39,7 @@ void TypeCheckerVisitor::visit(ast::returnStat* node)
     }
 
     // get the function's type
-    auto type = dynamic_cast<FunctionType*>(table->parentEntry()->type());
+    auto type = dynamic_cast<const FunctionType*>(table->parentEntry()->type());
 
     //if (!type) {
     //    throw std::runtime_error("TypeCheckerVisitor::visit(returnStat): Invalid function type");
@@ -47,7 +47,7 @@ void TypeCheckerVisitor::visit(ast::returnStat* node)
 
     // check that the return type matches the function's expected return type
     // only emit an error if the child is not already an error
-    if (type && *node->child()->type() != type->returnType && node->child()->type()->isNotError()) {
+    if (type && node->child()->type() != type->returnType && node->child()->type()->isNotError()) {
         errors_->emplace_back(SemanticErrorType::INCOMPATIBLE_RETURN_TYPE, node->token());
     }
 }
@@ -57,20 +57,16 @@ void TypeCheckerVisitor::visit(ast::relOp* node)
     Visitor::visit(node);
 
     // if lhs and rhs are not of the same type, error
-    if (*node->child(0)->type() == *node->child(1)->type()) {
+    if (node->child(0)->type() == node->child(1)->type()) {
         auto table = node->closestSymbolTable();
-        node->symbolTableEntry() = std::make_shared<SymbolTableEntry>();
-        node->symbolTableEntry()->setName(nextTempVar());
+        node->symbolTableEntry() = table->createEntry();
+        node->symbolTableEntry()->setId(nextTempId());
         node->symbolTableEntry()->setKind(SymbolTableEntryKind::TEMPVAR);
-        std::unique_ptr<VariableType> type(new VariableType());
-        type->type = Type::INT;
-        node->setType(std::unique_ptr<VariableType>(new VariableType(*type)));
-        node->symbolTableEntry()->setType(std::move(type));
-        table->addEntry(node->symbolTableEntry());
+        node->setType(typeContext(node).get(Type::INT));
+        node->symbolTableEntry()->setType(node->type());
+        table->addTemporary(node->symbolTableEntry());
     } else {
-        std::unique_ptr<VariableType> type(new VariableType());
-        type->type = Type::ERROR;
-        node->setType(std::move(type));
+        node->setType(typeContext(node).get(Type::ERROR));
 
         // only report an error if the types aren't errors themselves to prevent error spam
         if (node->child(0)->type()->isNotError() && node->child(1)->type()->isNotError()) {
@@ -83,21 +79,19 @@ void TypeCheckerVisitor::visit(ast::addOp* node)
 {
     Visitor::visit(node);
 
-    if (*node->child(0)->type() == *node->child(1)->type()) {
+    if (node->child(0)->type() == node->child(1)->type()) {
         // if lhs and rhs are of the same type, set the op's type to the same one
-        node->setType(std::unique_ptr<VariableType>(new VariableType(*node->child(0)->type())));
+        node->setType(node->child(0)->type());
 
         auto table = node->closestSymbolTable();
-        node->symbolTableEntry() = std::make_shared<SymbolTableEntry>();
-        node->symbolTableEntry()->setName(nextTempVar());
+        node->symbolTableEntry() = table->createEntry();
+        node->symbolTableEntry()->setId(nextTempId());
         node->symbolTableEntry()->setKind(SymbolTableEntryKind::TEMPVAR);
-        node->symbolTableEntry()->setType(std::unique_ptr<VariableType>(new VariableType(*node->type())));
-        table->addEntry(node->symbolTableEntry());
+        node->symbolTableEntry()->setType(node->type());
+        table->addTemporary(node->symbolTableEntry());
     } else {
         // else, set it to error
-        std::unique_ptr<VariableType> type(new VariableType());
-        type->type = Type::ERROR;
-        node->setType(std::move(type));
+        node->setType(typeContext(node).get(Type::ERROR));
 
         // only report an error if the types aren't errors themselves to prevent error spam
         if (node->child(0)->type()->isNotError() && node->child(1)->type()->isNotError()) {
@@ -110,20 +104,18 @@ void TypeCheckerVisitor::visit(ast::multOp* node)
 {
     Visitor::visit(node);
 
-    if (*node->child(0)->type() == *node->child(1)->type()) {
+    if (node->child(0)->type() == node->child(1)->type()) {
         // if lhs and rhs are of the same type, set the op's type to the same one
-        node->setType(std::unique_ptr<VariableType>(new VariableType(*node->child(0)->type())));
+        node->setType(node->child(0)->type());
 
         auto table = node->closestSymbolTable();
-        node->symbolTableEntry() = std::make_shared<SymbolTableEntry>();
-        node->symbolTableEntry()->setName(nextTempVar());
+        node->symbolTableEntry() = table->createEntry();
+        node->symbolTableEntry()->setId(nextTempId());
         node->symbolTableEntry()->setKind(SymbolTableEntryKind::TEMPVAR);
-        node->symbolTableEntry()->setType(std::unique_ptr<VariableType>(new VariableType(*node->type())));
-        table->addEntry(node->symbolTableEntry());
+        node->symbolTableEntry()->setType(node->type());
+        table->addTemporary(node->symbolTableEntry());
     } else {
-        std::unique_ptr<VariableType> type(new VariableType());
-        type->type = Type::ERROR;
-        node->setType(std::move(type));
+        node->setType(typeContext(node).get(Type::ERROR));
 
         if (!node->child(0)->type() || !node->child(1)->type()) {
             node->marked = true;
@@ -140,30 +132,26 @@ void TypeCheckerVisitor::visit(ast::num* node)
 {
     Visitor::visit(node);
 
-    std::unique_ptr<VariableType> type(new VariableType());
-
     // type
     switch (node->token()->type) {
         case TokenType::T_INTEGER_LITERAL:
-            type->type = Type::INT;
+            node->setType(typeContext(node).get(Type::INT));
             break;
         case TokenType::T_FLOAT_LITERAL:
-            type->type = Type::FLOAT;
+            node->setType(typeContext(node).get(Type::FLOAT));
             break;
         default:
             throw std::runtime_error("TypeCheckerVisitor::visit(num): Invalid AST num node");
     }
 
-    node->setType(std::move(type));
-
     // for literals, we create a tempvar
     if (!dynamic_cast<ast::dimList*>(node->parent())) {
         auto table = node->closestSymbolTable();
-        node->symbolTableEntry() = std::make_shared<SymbolTableEntry>();
-        node->symbolTableEntry()->setName(nextTempVar());
+        node->symbolTableEntry() = table->createEntry();
+        node->symbolTableEntry()->setId(nextTempId());
         node->symbolTableEntry()->setKind(SymbolTableEntryKind::LITERAL);
-        node->symbolTableEntry()->setType(std::unique_ptr<VariableType>(new VariableType(*node->type())));
-        table->addEntry(node->symbolTableEntry());
+        node->symbolTableEntry()->setType(node->type());
+        table->addTemporary(node->symbolTableEntry());
     }
 }
 
@@ -188,14 +176,12 @@ void TypeCheckerVisitor::visit(ast::notFactor* node)
     //node->setType(std::move(type));
 
     auto table = node->closestSymbolTable();
-    node->symbolTableEntry() = std::make_shared<SymbolTableEntry>();
-    node->symbolTableEntry()->setName(nextTempVar());
+    node->symbolTableEntry() = table->createEntry();
+    node->symbolTableEntry()->setId(nextTempId());
     node->symbolTableEntry()->setKind(SymbolTableEntryKind::TEMPVAR);
-    std::unique_ptr<VariableType> type(new VariableType());
-    type->type = Type::INT;
-    node->setType(std::unique_ptr<VariableType>(new VariableType(*type)));
-    node->symbolTableEntry()->setType(std::move(type));
-    table->addEntry(node->symbolTableEntry());
+    node->setType(typeContext(node).get(Type::INT));
+    node->symbolTableEntry()->setType(node->type());
+    table->addTemporary(node->symbolTableEntry());
 }
 
 void TypeCheckerVisitor::visit(ast::sign* node)
@@ -205,15 +191,14 @@ void TypeCheckerVisitor::visit(ast::sign* node)
     // TODO: sign can only be used on numerics
 
     // bubble up child type
-    std::unique_ptr<VariableType> type(new VariableType(*node->child()->type()));
-    node->setType(std::unique_ptr<VariableType>(new VariableType(*type)));
+    node->setType(node->child()->type());
 
     auto table = node->closestSymbolTable();
-    node->symbolTableEntry() = std::make_shared<SymbolTableEntry>();
-    node->symbolTableEntry()->setName(nextTempVar());
+    node->symbolTableEntry() = table->createEntry();
+    node->symbolTableEntry()->setId(nextTempId());
     node->symbolTableEntry()->setKind(SymbolTableEntryKind::TEMPVAR);
-    node->symbolTableEntry()->setType(std::move(type));
-    table->addEntry(node->symbolTableEntry());
+    node->symbolTableEntry()->setType(node->type());
+    table->addTemporary(node->symbolTableEntry());
 }
 
 void TypeCheckerVisitor::visit(ast::funcDecl* node)
@@ -239,12 +224,12 @@ void TypeCheckerVisitor::visit(ast::funcDef* node)
     // ensure the function has a return if it needs one, and doesn't have a return if it can't have one
 
     auto entry = node->symbolTableEntry();
-    auto type = dynamic_cast<FunctionType*>(entry->type());
+    auto type = dynamic_cast<const FunctionType*>(entry->type());
     auto idNode = dynamic_cast<ast::nul*>(node->child(2))
                   ? dynamic_cast<ast::id*>(node->child(1))
                   : dynamic_cast<ast::id*>(node->child(2));
 
-    if (type != nullptr && type->returnType.isNotError() && !entry->hasReturn()) {
+    if (type != nullptr && type->returnType->isNotError() && !entry->hasReturn()) {
         // this function needs a return and does not have one
         errors_->emplace_back(SemanticErrorType::MISSING_RETURN, idNode->token());
     } else if (type == nullptr && entry->hasReturn()) {
@@ -254,12 +239,10 @@ void TypeCheckerVisitor::visit(ast::funcDef* node)
 
     // create an entry for the this pointer
     auto table = node->symbolTable();
-    auto thisVar = std::make_shared<SymbolTableEntry>();
+    auto thisVar = table->createEntry();
     thisVar->setName("_this");
     thisVar->setKind(SymbolTableEntryKind::THIS);
-    std::unique_ptr<VariableType> thisType(new VariableType());
-    thisType->type = Type::INT;
-    thisVar->setType(std::move(thisType));
+    thisVar->setType(typeContext(node).get(Type::INT));
     thisVar->setSize(4);
     table->addEntry(thisVar);
 }
@@ -286,39 +269,32 @@ void TypeCheckerVisitor::visit(ast::dataMember* node)
         if (auto entry = (*table)[idNode->token()->value]) {
 
             // find the var's type after this dataMember is applied
-            if (auto t = dynamic_cast<VariableType*>(entry->type())) {
-                // if we find it, set our type to a copy of its type
-                std::unique_ptr<VariableType> type(new VariableType());
+            if (auto t = dynamic_cast<const VariableType*>(entry->type())) {
+                // if we find it, set our type to its type with the indices applied
                 auto indiceCount = indexListNode->childCount();
 
                 // check that the number of indices matches the dimension of the original type
                 if (t->indices.size() != indiceCount) {
                     // if not, this is an error
-                    type->type = Type::ERROR;
+                    varNode->setType(typeContext(node).get(Type::ERROR));
                     errors_->emplace_back(SemanticErrorType::INVALID_DIMENSION_COUNT, idNode->token());
                 } else {
-                    type->type = t->type;
-                    type->className = t->className;
+                    // scalars are resolved without going through the context's lock
+                    auto& types = typeContext(node);
+                    varNode->setType(t->type == Type::CLASS ? types.get(t->type, t->className, {}) : types.get(t->type));
 
                     // for code generation, set the dataMember's entry to where the data resides
                     node->symbolTableEntry() = entry;
                 }
-
-                //node->setType(std::unique_ptr<VariableType>(new VariableType(*type)));
-                varNode->setType(std::move(type));
             } else {
                 // the symbol exists, but is not a variable
-                std::unique_ptr<VariableType> type(new VariableType());
-                type->type = Type::ERROR;
-                varNode->setType(std::move(type));
+                varNode->setType(typeContext(node).get(Type::ERROR));
                 errors_->emplace_back(SemanticErrorType::INVALID_VARIABLE, idNode->token());
             }
 
         } else {
             // the id was not found in the symbol table
-            std::unique_ptr<VariableType> type(new VariableType());
-            type->type = Type::ERROR;
-            varNode->setType(std::move(type));
+            varNode->setType(typeContext(node).get(Type::ERROR));
             errors_->emplace_back(SemanticErrorType::UNDECLARED_VARIABLE, idNode->token());
         }
 
@@ -332,35 +308,29 @@ void TypeCheckerVisitor::visit(ast::dataMember* node)
 
         if (!member) {
             // the class is valid, but the member doesn't exist
-            std::unique_ptr<VariableType> type(new VariableType());
-            type->type = Type::ERROR;
-            varNode->setType(std::move(type));
+            varNode->setType(typeContext(node).get(Type::ERROR));
             errors_->emplace_back(SemanticErrorType::UNDECLARED_MEMBER_VARIABLE, idNode->token());
-        } else if (auto t = dynamic_cast<VariableType*>(member->type())) {
+        } else if (auto t = dynamic_cast<const VariableType*>(member->type())) {
             // the member exists and is a variable
-            // set our type to a copy of its type
-            std::unique_ptr<VariableType> type(new VariableType());
+            // set our type to its type with the indices applied
             auto indiceCount = indexListNode->childCount();
 
             // check that the number of indices matches the dimension of the original type
             if (t->indices.size() != indiceCount) {
                 // if not, this is an error
-                type->type = Type::ERROR;
+                varNode->setType(typeContext(node).get(Type::ERROR));
                 errors_->emplace_back(SemanticErrorType::INVALID_DIMENSION_COUNT, idNode->token());
             } else {
-                type->type = t->type;
-                type->className = t->className;
+                // scalars are resolved without going through the context's lock
+                auto& types = typeContext(node);
+                varNode->setType(t->type == Type::CLASS ? types.get(t->type, t->className, {}) : types.get(t->type));
 
                 // for code generation, set the dataMember's entry to where the data resides
                 node->symbolTableEntry() = member;
             }
-
-            varNode->setType(std::move(type));
         } else {
             // the member exists, but is not a variable (ie. it is a function)
-            std::unique_ptr<VariableType> type(new VariableType());
-            type->type = Type::ERROR;
-            varNode->setType(std::move(type));
+            varNode->setType(typeContext(node).get(Type::ERROR));
             errors_->emplace_back(SemanticErrorType::INVALID_VARIABLE, idNode->token());
         }
 
@@ -368,9 +338,7 @@ void TypeCheckerVisitor::visit(ast::dataMember* node)
         // don't process errors
     } else {
         // an int or float terminates the chain, therefore this data member is invalid
-        std::unique_ptr<VariableType> type(new VariableType());
-        type->type = Type::ERROR;
-        varNode->setType(std::move(type));
+        varNode->setType(typeContext(node).get(Type::ERROR));
         errors_->emplace_back(SemanticErrorType::INVALID_VARIABLE, idNode->token());
     }
 }
@@ -390,7 +358,7 @@ void TypeCheckerVisitor::visit(ast::fCall* node)
     auto idNode = dynamic_cast<ast::id*>(node->child(0));
     auto aParamsNode = dynamic_cast<ast::aParams*>(node->child(1));
 
-    std::vector<VariableType> paramType;
+    std::vector<const VariableType*> paramType;
     aParamsToVariableTypes(paramType, aParamsNode);
 
     if (!varNode->type()) {
@@ -400,45 +368,38 @@ void TypeCheckerVisitor::visit(ast::fCall* node)
         if (auto entry = (*table)[idNode->token()->value]) {
 
             // find the var's type after this fCall is applied
-            if (auto t = dynamic_cast<FunctionType*>(entry->type())) {
+            if (auto t = dynamic_cast<const FunctionType*>(entry->type())) {
 
                 // check that the parameters used match the function declaration
                 if (paramType == t->parameterTypes) {
                     // set our type to the function's return type
-                    std::unique_ptr<VariableType> type(new VariableType(t->returnType));
-                    node->setType(std::unique_ptr<VariableType>(new VariableType(*type)));
-                    varNode->setType(std::move(type));
+                    node->setType(t->returnType);
+                    varNode->setType(t->returnType);
 
                     // hack: make aParams hold a tempvar for the result of this function call
-                    node->child(1)->symbolTableEntry() = std::make_shared<SymbolTableEntry>();
-                    node->child(1)->symbolTableEntry()->setName(nextTempVar());
+                    node->child(1)->symbolTableEntry() = table->createEntry();
+                    node->child(1)->symbolTableEntry()->setId(nextTempId());
                     node->child(1)->symbolTableEntry()->setKind(SymbolTableEntryKind::TEMPVAR);
-                    node->child(1)->symbolTableEntry()->setType(std::unique_ptr<VariableType>(new VariableType(*node->type())));
-                    table->addEntry(node->child(1)->symbolTableEntry());
+                    node->child(1)->symbolTableEntry()->setType(node->type());
+                    table->addTemporary(node->child(1)->symbolTableEntry());
 
                     // for code generation, set the dataMember's entry to where the data resides
                     node->symbolTableEntry() = entry;
                 } else {
                     // there is a parameter mismatch
-                    std::unique_ptr<VariableType> type(new VariableType());
-                    type->type = Type::ERROR;
-                    varNode->setType(std::move(type));
+                    varNode->setType(typeContext(node).get(Type::ERROR));
                     errors_->emplace_back(SemanticErrorType::INCORRECT_TYPE_IN_FUNCTION_CALL, idNode->token());
                 }
 
             } else {
                 // the symbol exists, but is not a function
-                std::unique_ptr<VariableType> type(new VariableType());
-                type->type = Type::ERROR;
-                varNode->setType(std::move(type));
+                varNode->setType(typeContext(node).get(Type::ERROR));
                 errors_->emplace_back(SemanticErrorType::INVALID_FUNCTION, idNode->token());
             }
 
         } else {
             // the id was not found in the symbol table
-            std::unique_ptr<VariableType> type(new VariableType());
-            type->type = Type::ERROR;
-            varNode->setType(std::move(type));
+            varNode->setType(typeContext(node).get(Type::ERROR));
             errors_->emplace_back(SemanticErrorType::UNDECLARED_FUNCTION, idNode->token());
         }
 
@@ -452,39 +413,32 @@ void TypeCheckerVisitor::visit(ast::fCall* node)
 
         if (!member || !member->parentTable()->parentEntry()) {
             // the class is valid, but the function doesn't exist in the class
-            std::unique_ptr<VariableType> type(new VariableType());
-            type->type = Type::ERROR;
-            varNode->setType(std::move(type));
+            varNode->setType(typeContext(node).get(Type::ERROR));
             errors_->emplace_back(SemanticErrorType::UNDECLARED_MEMBER_FUNCTION, idNode->token());
-        } else if (auto t = dynamic_cast<FunctionType*>(member->type())) {
+        } else if (auto t = dynamic_cast<const FunctionType*>(member->type())) {
             // check that the parameters used match the function declaration
             if (paramType == t->parameterTypes) {
                 // the member exists, is a function and the params match--OK!
                 // set our type to its return type
-                std::unique_ptr<VariableType> type(new VariableType(t->returnType));
-                varNode->setType(std::move(type));
+                varNode->setType(t->returnType);
 
                 // hack: make aParams hold a tempvar for the result of this function call
-                node->child(1)->symbolTableEntry() = std::make_shared<SymbolTableEntry>();
-                node->child(1)->symbolTableEntry()->setName(nextTempVar());
+                node->child(1)->symbolTableEntry() = table->createEntry();
+                node->child(1)->symbolTableEntry()->setId(nextTempId());
                 node->child(1)->symbolTableEntry()->setKind(SymbolTableEntryKind::TEMPVAR);
-                node->child(1)->symbolTableEntry()->setType(std::unique_ptr<VariableType>(new VariableType(*varNode->type())));
-                table->addEntry(node->child(1)->symbolTableEntry());
+                node->child(1)->symbolTableEntry()->setType(varNode->type());
+                table->addTemporary(node->child(1)->symbolTableEntry());
 
                 // for code generation, set the dataMember's entry to where the data resides
                 node->symbolTableEntry() = member;
             } else {
                 // there is a parameter mismatch
-                std::unique_ptr<VariableType> type(new VariableType());
-                type->type = Type::ERROR;
-                varNode->setType(std::move(type));
+                varNode->setType(typeContext(node).get(Type::ERROR));
                 errors_->emplace_back(SemanticErrorType::INCORRECT_TYPE_IN_FUNCTION_CALL, idNode->token());
             }
         } else {
             // the member exists, but is not a function (ie. it is a variable)
-            std::unique_ptr<VariableType> type(new VariableType());
-            type->type = Type::ERROR;
-            varNode->setType(std::move(type));
+            varNode->setType(typeContext(node).get(Type::ERROR));
             errors_->emplace_back(SemanticErrorType::INVALID_FUNCTION, idNode->token());
         }
 
@@ -492,9 +446,7 @@ void TypeCheckerVisitor::visit(ast::fCall* node)
         // don't process errors
     } else {
         // an int or float terminates the chain, therefore this data member is invalid
-        std::unique_ptr<VariableType> type(new VariableType());
-        type->type = Type::ERROR;
-        varNode->setType(std::move(type));
+        varNode->setType(typeContext(node).get(Type::ERROR));
         errors_->emplace_back(SemanticErrorType::INVALID_FUNCTION, idNode->token());
     }
 }
@@ -505,19 +457,16 @@ void TypeCheckerVisitor::visit(ast::var* node)
 
     auto table = node->closestSymbolTable();
 
-    node->symbolTableEntry() = std::make_shared<SymbolTableEntry>();
-    node->symbolTableEntry()->setName(nextTempVar());
+    node->symbolTableEntry() = table->createEntry();
+    node->symbolTableEntry()->setId(nextTempId());
     node->symbolTableEntry()->setKind(SymbolTableEntryKind::TEMPVAR);
-    //node->symbolTableEntry()->setType(std::unique_ptr<VariableType>(new VariableType(*node->type())));
-    std::unique_ptr<VariableType> type(new VariableType());
-    type->type = Type::INT;
-    node->symbolTableEntry()->setType(std::move(type));
-    table->addEntry(node->symbolTableEntry());
+    node->symbolTableEntry()->setType(typeContext(node).get(Type::INT));
+    table->addTemporary(node->symbolTableEntry());
 
     // TODO: merge this into TypeCheckerVisitor::visit(dataMember)?
 }
 
-void TypeCheckerVisitor::aParamsToVariableTypes(std::vector<VariableType>& types, const ast::aParams* node) const
+void TypeCheckerVisitor::aParamsToVariableTypes(std::vector<const VariableType*>& types, const ast::aParams* node) const
 {
     // loop over aParams and add their types to our types list
     for (auto aParam = node->child(); aParam != nullptr; aParam = aParam->next()) {
@@ -525,13 +474,22 @@ void TypeCheckerVisitor::aParamsToVariableTypes(std::vector<VariableType>& types
             throw std::runtime_error("TypeCheckerVisitor::aParamsToVariableTypes: aParam does not have a type");
         }
 
-        types.emplace_back(*aParam->type());
+        types.emplace_back(aParam->type());
     }
 }
 
-std::string TypeCheckerVisitor::nextTempVar()
+unsigned int TypeCheckerVisitor::nextTempId()
 {
-    return "_t" + std::to_string(currentTempVar_++);
+    return currentTempVar_++;
+}
+
+TypeContext& TypeCheckerVisitor::typeContext(ast::Node* node)
+{
+    if (!types_) {
+        types_ = &node->closestSymbolTable()->arena().types();
+    }
+
+    return *types_;
 }
 
 }}
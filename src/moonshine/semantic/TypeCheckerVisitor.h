@@ -28,10 +28,14 @@ public:
     void visit(ast::fCall* node) override;
     void visit(ast::var* node) override;
 private:
-    int currentTempVar_ = 1;
+    unsigned int currentTempVar_ = 1;
+    TypeContext* types_ = nullptr;
 
-    void aParamsToVariableTypes(std::vector<VariableType>& types, const ast::aParams* node) const;
-    std::string nextTempVar();
+    void aParamsToVariableTypes(std::vector<const VariableType*>& types, const ast::aParams* node) const;
+    unsigned int nextTempId();
+
+    // the types of the program the node belongs to
+    TypeContext& typeContext(ast::Node* node);
 };
 
 }}
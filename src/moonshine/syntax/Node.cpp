@@ -61,11 +61,13 @@ std::unique_ptr<Node> Node::makeNode(const std::string& name, std::shared_ptr<To
     // lazy man's factory construction feat. macro abuse
     #define AST(NAME) if (name == #NAME) { node = new ast::NAME(); goto found; }
     #define AST_LEAF(NAME) if (name == #NAME) { node = new ast::NAME(op); goto found; }
+    #define AST_ROOT(NAME) AST(NAME)
 
     #include "ast_nodes.h"
 
     #undef AST
     #undef AST_LEAF
+    #undef AST_ROOT
 
     throw std::runtime_error(std::string("Unexpected token encountered while creating AST node: ") + name);
 
@@ -120,6 +122,17 @@ unsigned int Node::childCount() const
     return count;
 }
 
+std::size_t Node::nodeCount() const
+{
+    std::size_t count = 1;
+
+    for (Node* xsibs = child(); xsibs != nullptr; xsibs = xsibs->next()) {
+        count += xsibs->nodeCount();
+    }
+
+    return count;
+}
+
 Node* Node::next() const
 {
     return rightSib_.get();
@@ -214,27 +227,27 @@ bool Node::isLeaf() const
     return false;
 }
 
-std::shared_ptr<semantic::SymbolTable>& Node::symbolTable()
+semantic::SymbolTable*& Node::symbolTable()
 {
     return symbolTable_;
 }
 
-std::shared_ptr<semantic::SymbolTableEntry>& Node::symbolTableEntry()
+semantic::SymbolTableEntry*& Node::symbolTableEntry()
 {
     return symbolTableEntry_;
 }
 
-semantic::VariableType* Node::type() const
+const semantic::VariableType* Node::type() const
 {
-    return type_.get();
+    return type_;
 }
 
-void Node::setType(std::unique_ptr<semantic::VariableType> type)
+void Node::setType(const semantic::VariableType* type)
 {
-    type_ = std::move(type);
+    type_ = type;
 }
 
-std::shared_ptr<semantic::SymbolTable> Node::closestSymbolTable()
+semantic::SymbolTable* Node::closestSymbolTable()
 {
     Node* curNode = this;
 
@@ -246,12 +259,12 @@ std::shared_ptr<semantic::SymbolTable> Node::closestSymbolTable()
     return curNode != nullptr ? curNode->symbolTable() : nullptr;
 }
 
-const std::shared_ptr<semantic::SymbolTableEntry>& Node::symbolTableEntry() const
+semantic::SymbolTableEntry* Node::symbolTableEntry() const
 {
     return symbolTableEntry_;
 }
 
-const std::shared_ptr<semantic::SymbolTable>& Node::symbolTable() const
+semantic::SymbolTable* Node::symbolTable() const
 {
     return symbolTable_;
 }
@@ -354,9 +367,17 @@ void NAME::accept(Visitor* visitor)                      \
     }                                                    \
 }
 
+#define AST_ROOT(NAME) AST(NAME)
+
 #include "ast_nodes.h"
 
+std::unique_ptr<semantic::SymbolArena>& prog::symbolArena()
+{
+    return symbolArena_;
+}
+
 #undef AST
 #undef AST_LEAF
+#undef AST_ROOT
 
 }}
\ No newline at end of file
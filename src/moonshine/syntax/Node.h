@@ -2,8 +2,10 @@
 
 #include "moonshine/lexer/Token.h"
 #include "moonshine/semantic/SymbolTable.h"
+#include "moonshine/semantic/SymbolArena.h"
 #include "moonshine/semantic/Type.h"
 
+#include <cstddef>
 #include <memory>
 #include <ostream>
 
@@ -28,18 +30,19 @@ public:
     Node* child(const unsigned int& index) const;
     Node* rightmostChild() const;
     unsigned int childCount() const;
+    std::size_t nodeCount() const; // this node and all of its descendants
     Node* next() const;
     Node* previous() const;
     virtual bool isLeaf() const;
 
     virtual void accept(Visitor* visitor) = 0; // TODO: make const param
-    std::shared_ptr<semantic::SymbolTable>& symbolTable();
-    const std::shared_ptr<semantic::SymbolTable>& symbolTable() const;
-    std::shared_ptr<semantic::SymbolTable> closestSymbolTable();
-    const std::shared_ptr<semantic::SymbolTableEntry>& symbolTableEntry() const;
-    std::shared_ptr<semantic::SymbolTableEntry>& symbolTableEntry();
-    semantic::VariableType* type() const;
-    void setType(std::unique_ptr<semantic::VariableType> type);
+    semantic::SymbolTable*& symbolTable();
+    semantic::SymbolTable* symbolTable() const;
+    semantic::SymbolTable* closestSymbolTable();
+    semantic::SymbolTableEntry* symbolTableEntry() const;
+    semantic::SymbolTableEntry*& symbolTableEntry();
+    const semantic::VariableType* type() const;
+    void setType(const semantic::VariableType* type);
 
     virtual void print(std::ostream* s) const;
     void graphviz(std::ostream& s) const;
@@ -57,12 +60,12 @@ protected:
     // children
     std::unique_ptr<Node> leftmostChild_ = nullptr;
 
-    // symbol table entries
-    std::shared_ptr<semantic::SymbolTable> symbolTable_;
-    std::shared_ptr<semantic::SymbolTableEntry> symbolTableEntry_;
+    // symbol table entries (owned by the symbol arena)
+    semantic::SymbolTable* symbolTable_ = nullptr;
+    semantic::SymbolTableEntry* symbolTableEntry_ = nullptr;
 
-    // type checking
-    std::unique_ptr<semantic::VariableType> type_ = nullptr;
+    // type checking (canonical type owned by a semantic::TypeContext)
+    const semantic::VariableType* type_ = nullptr;
 };
 
 class Leaf : public Node
@@ -103,9 +106,22 @@ public:                                                                      \
     void accept(Visitor* visitor) override; \
 };
 
+// the root owns the symbol tables of the whole tree
+#define AST_ROOT(NAME)                                                       \
+class NAME : public Node                                                     \
+{                                                                            \
+public:                                                                      \
+    inline const char* name() const override { return #NAME; };              \
+    void accept(Visitor* visitor) override; \
+    std::unique_ptr<semantic::SymbolArena>& symbolArena(); \
+private: \
+    std::unique_ptr<semantic::SymbolArena> symbolArena_; \
+};
+
 #include "ast_nodes.h"
 
 #undef AST
 #undef AST_LEAF
+#undef AST_ROOT
 
 }}
\ No newline at end of file
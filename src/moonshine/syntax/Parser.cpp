@@ -14,6 +14,11 @@ std::unique_ptr<ast::Node> Parser::parse(Lexer* lex, std::ostream* output)
 {
     bool error = false;
 
+    stack_.clear();
+    semanticStack_.clear();
+    parsedTokens_.clear();
+    errors_.clear();
+
     stack_.emplace_back(GrammarTokenType::END, 0);
     stack_.push_back(grammar_.startToken());
 
@@ -15,13 +15,16 @@ namespace moonshine { namespace syntax {
 class Parser
 {
 public:
+    // the grammar is shared, and has to outlive the parser
     explicit Parser(const Grammar& grammar);
 
+    // one program after the other
+
     std::unique_ptr<ast::Node> parse(Lexer* lex, std::ostream* output);
     const std::vector<ParseError>& getErrors() const;
     void setAnsi(const bool& ansi);
 private:
-    const Grammar grammar_;
+    const Grammar& grammar_;
     std::vector<GrammarToken> stack_;
     std::vector<std::unique_ptr<ast::Node>> semanticStack_;
     std::vector<std::shared_ptr<Token>> parsedTokens_;
@@ -14,7 +14,7 @@ AST(notFactor)
 AST(ifStat)
 AST_LEAF(assignStat)
 AST(statBlock)
-AST(prog)
+AST_ROOT(prog)
 AST(classList)
 AST(funcDefList)
 AST(classDecl)
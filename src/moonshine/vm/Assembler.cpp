@@ -0,0 +1,433 @@
+#include "moonshine/vm/Assembler.h"
+
+#include <cctype>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+namespace moonshine { namespace vm {
+
+namespace {
+
+enum class Format
+{
+    NONE,       // hlt
+    R,          // add r1,r2,r3
+    I,          // addi r1,r2,K
+    RR,         // not r1,r2 / jlr r1,r2
+    LOAD,       // lw r1,K(r2)
+    STORE,      // sw K(r2),r1
+    R1,         // getc r1 / jr r1
+    BRANCH,     // bz r1,K / jl r1,K
+    K,          // j K
+};
+
+struct Mnemonic
+{
+    Opcode op;
+    Format format;
+};
+
+const std::unordered_map<std::string, Mnemonic>& mnemonics()
+{
+    static const std::unordered_map<std::string, Mnemonic> table = {
+        {"add", {Opcode::ADD, Format::R}}, {"sub", {Opcode::SUB, Format::R}}, {"mul", {Opcode::MUL, Format::R}},
+        {"div", {Opcode::DIV, Format::R}}, {"mod", {Opcode::MOD, Format::R}}, {"and", {Opcode::AND, Format::R}},
+        {"or", {Opcode::OR, Format::R}}, {"ceq", {Opcode::CEQ, Format::R}}, {"cne", {Opcode::CNE, Format::R}},
+        {"clt", {Opcode::CLT, Format::R}}, {"cle", {Opcode::CLE, Format::R}}, {"cgt", {Opcode::CGT, Format::R}},
+        {"cge", {Opcode::CGE, Format::R}},
+        {"addi", {Opcode::ADDI, Format::I}}, {"subi", {Opcode::SUBI, Format::I}}, {"muli", {Opcode::MULI, Format::I}},
+        {"divi", {Opcode::DIVI, Format::I}}, {"modi", {Opcode::MODI, Format::I}}, {"andi", {Opcode::ANDI, Format::I}},
+        {"ori", {Opcode::ORI, Format::I}}, {"ceqi", {Opcode::CEQI, Format::I}}, {"cnei", {Opcode::CNEI, Format::I}},
+        {"clti", {Opcode::CLTI, Format::I}}, {"clei", {Opcode::CLEI, Format::I}}, {"cgti", {Opcode::CGTI, Format::I}},
+        {"cgei", {Opcode::CGEI, Format::I}}, {"sl", {Opcode::SL, Format::I}}, {"sr", {Opcode::SR, Format::I}},
+        {"not", {Opcode::NOT, Format::RR}}, {"jlr", {Opcode::JLR, Format::RR}},
+        {"lw", {Opcode::LW, Format::LOAD}}, {"lb", {Opcode::LB, Format::LOAD}},
+        {"sw", {Opcode::SW, Format::STORE}}, {"sb", {Opcode::SB, Format::STORE}},
+        {"getc", {Opcode::GETC, Format::R1}}, {"putc", {Opcode::PUTC, Format::R1}}, {"jr", {Opcode::JR, Format::R1}},
+        {"bz", {Opcode::BZ, Format::BRANCH}}, {"bnz", {Opcode::BNZ, Format::BRANCH}},
+        {"jl", {Opcode::JL, Format::BRANCH}},
+        {"j", {Opcode::J, Format::K}},
+        {"nop", {Opcode::NOP, Format::NONE}}, {"hlt", {Opcode::HLT, Format::NONE}},
+    };
+
+    return table;
+}
+
+std::string trim(const std::string& s)
+{
+    auto b = s.find_first_not_of(" \t\r");
+
+    if (b == std::string::npos) {
+        return "";
+    }
+
+    return s.substr(b, s.find_last_not_of(" \t\r") - b + 1);
+}
+
+std::int32_t align(const std::int32_t& address)
+{
+    return (address + 3) & ~3;
+}
+
+bool isString(const std::string& operand)
+{
+    return operand.size() >= 2 && operand.front() == '"' && operand.back() == '"';
+}
+
+/**
+ * Lays out and encodes the lines of a program into an image, in two passes: the first one assigns addresses
+ * and collects labels, the second one resolves operands.
+ */
+class Encoder
+{
+public:
+    Encoder(const std::vector<code::MoonInstruction>& lines, const std::size_t& memorySize)
+        : lines_(lines), addresses_(lines.size(), 0), memorySize_(memorySize)
+    {}
+
+    Image encode()
+    {
+        layout();
+
+        image_.memory.assign(memorySize_, 0);
+        image_.code.assign(static_cast<std::size_t>(image_.size) / 4, Instruction());
+
+        for (std::size_t i = 0; i < lines_.size(); ++i) {
+            encode(i);
+        }
+
+        for (const auto& routine : routines_) {
+            auto& call = image_.code[routine.first / 4];
+            call.op = Opcode::NATIVE;
+            call.k = static_cast<std::int32_t>(routine.second);
+
+            auto& ret = image_.code[routine.first / 4 + 1];
+            ret.op = Opcode::JR;
+            ret.ri = 15;
+        }
+
+        image_.lines = lines_;
+        image_.addresses = addresses_;
+
+        return std::move(image_);
+    }
+private:
+    const std::vector<code::MoonInstruction>& lines_;
+    std::vector<std::int32_t> addresses_;
+    std::size_t memorySize_;
+    std::vector<std::pair<std::int32_t, Routine>> routines_;
+    Image image_;
+
+    static unsigned int number(const std::size_t& index)
+    {
+        return static_cast<unsigned int>(index + 1);
+    }
+
+    void layout()
+    {
+        std::int32_t address = 0;
+        bool entry = false;
+
+        for (std::size_t i = 0; i < lines_.size(); ++i) {
+            const auto& line = lines_[i];
+            const auto& op = line.op;
+            bool instruction = !op.empty() && !line.isDirective();
+
+            if (!op.empty() && !instruction && !code::MoonInstruction::isMnemonic(op)) {
+                throw AssemblyError(number(i), "unknown instruction '" + op + "'");
+            }
+
+            if (instruction && !mnemonics().count(op)) {
+                throw AssemblyError(number(i), "unknown instruction '" + op + "'");
+            }
+
+            if (op == "org") {
+                address = constant(operand(i, 0), i);
+            } else if (instruction || op == "align" || op == "dw") {
+                address = align(address);
+            }
+
+            addresses_[i] = address;
+
+            if (!line.label.empty() && !image_.symbols.emplace(line.label, address).second) {
+                throw AssemblyError(number(i), "duplicate label '" + line.label + "'");
+            }
+
+            if (op == "entry") {
+                entry = true;
+            } else if (op == "res") {
+                address += constant(operand(i, 0), i);
+            } else if (op == "dw") {
+                address += 4 * static_cast<std::int32_t>(line.operands.size());
+            } else if (op == "db") {
+                for (const auto& o : line.operands) {
+                    address += isString(o) ? static_cast<std::int32_t>(o.size()) - 2 : 1;
+                }
+            } else if (instruction) {
+                if (entry) {
+                    image_.entry = address;
+                    entry = false;
+                }
+
+                address += 4;
+            }
+        }
+
+        // the util library routines the program doesn't define itself go right after it
+        address = align(address);
+
+        for (const auto& routine : {std::make_pair("getstr", Routine::GETSTR), std::make_pair("putstr", Routine::PUTSTR),
+                                    std::make_pair("intstr", Routine::INTSTR), std::make_pair("strint", Routine::STRINT)}) {
+            if (image_.symbols.emplace(routine.first, address).second) {
+                routines_.emplace_back(address, routine.second);
+                address += 8;
+            }
+        }
+
+        image_.symbols.emplace("topaddr", static_cast<std::int32_t>(memorySize_));
+
+        if (static_cast<std::size_t>(address) > memorySize_) {
+            throw AssemblyError(0, "program does not fit in memory");
+        }
+
+        image_.size = address;
+    }
+
+    const std::string& operand(const std::size_t& index, const std::size_t& position) const
+    {
+        const auto& line = lines_[index];
+
+        if (position >= line.operands.size()) {
+            throw AssemblyError(number(index), "'" + line.op + "' is missing an operand");
+        }
+
+        return line.operands[position];
+    }
+
+    // a number, or a label (which must have been laid out already)
+    std::int32_t constant(const std::string& s, const std::size_t& index) const
+    {
+        if (s.empty()) {
+            throw AssemblyError(number(index), "missing operand");
+        }
+
+        if (std::isdigit(static_cast<unsigned char>(s[0])) || s[0] == '-' || s[0] == '+') {
+            try {
+                std::size_t end;
+                auto value = std::stol(s, &end, 0);
+
+                if (end == s.size()) {
+                    return static_cast<std::int32_t>(value);
+                }
+            } catch (const std::exception&) {
+            }
+
+            throw AssemblyError(number(index), "invalid number '" + s + "'");
+        }
+
+        auto symbol = image_.symbols.find(s);
+
+        if (symbol == image_.symbols.end()) {
+            throw AssemblyError(number(index), "undefined symbol '" + s + "'");
+        }
+
+        return symbol->second;
+    }
+
+    // the K field of an instruction; numbers must fit its 16 bits, labels are addresses in our larger memory
+    std::int32_t immediate(const std::string& s, const std::size_t& index) const
+    {
+        auto value = constant(s, index);
+
+        if (image_.symbols.find(s) == image_.symbols.end() && !code::MoonInstruction::fitsImmediate(value)) {
+            throw AssemblyError(number(index), "immediate '" + s + "' does not fit in 16 bits");
+        }
+
+        return value;
+    }
+
+    std::uint8_t reg(const std::string& s, const std::size_t& index) const
+    {
+        if (!code::MoonInstruction::isRegister(s)) {
+            throw AssemblyError(number(index), "invalid register '" + s + "'");
+        }
+
+        return static_cast<std::uint8_t>(std::stoi(s.substr(1)));
+    }
+
+    // K(Rj)
+    void memory(const std::string& s, const std::size_t& index, Instruction& instruction) const
+    {
+        auto open = s.find('(');
+
+        if (open == std::string::npos || s.back() != ')') {
+            throw AssemblyError(number(index), "invalid memory operand '" + s + "'");
+        }
+
+        instruction.k = immediate(trim(s.substr(0, open)), index);
+        instruction.rj = reg(trim(s.substr(open + 1, s.size() - open - 2)), index);
+    }
+
+    void expect(const std::size_t& index, const std::size_t& count) const
+    {
+        const auto& line = lines_[index];
+
+        if (line.operands.size() != count) {
+            throw AssemblyError(number(index), "'" + line.op + "' expects " + std::to_string(count) + " operands");
+        }
+    }
+
+    void place(const std::int32_t& address, const std::size_t& size, const std::size_t& index) const
+    {
+        if (address < 0 || static_cast<std::size_t>(address) + size > memorySize_) {
+            throw AssemblyError(number(index), "address out of memory");
+        }
+    }
+
+    void encode(const std::size_t& index)
+    {
+        const auto& line = lines_[index];
+        const auto& op = line.op;
+        const auto& o = line.operands;
+        auto address = addresses_[index];
+
+        if (op == "db") {
+            for (const auto& operand : o) {
+                if (isString(operand)) {
+                    auto s = operand.substr(1, operand.size() - 2);
+                    place(address, s.size(), index);
+                    std::memcpy(&image_.memory[address], s.data(), s.size());
+                    address += static_cast<std::int32_t>(s.size());
+                } else {
+                    place(address, 1, index);
+                    image_.memory[address++] = static_cast<std::uint8_t>(constant(operand, index));
+                }
+            }
+
+            return;
+        }
+
+        if (op == "dw") {
+            for (const auto& operand : o) {
+                place(address, 4, index);
+                auto value = constant(operand, index);
+                std::memcpy(&image_.memory[address], &value, 4);
+                address += 4;
+            }
+
+            return;
+        }
+
+        if (op == "res") {
+            place(address, static_cast<std::size_t>(constant(operand(index, 0), index)), index);
+            return;
+        }
+
+        if (op.empty() || line.isDirective()) {
+            return;
+        }
+
+        place(address, 4, index);
+
+        const auto& mnemonic = mnemonics().at(op);
+        Instruction instruction;
+        instruction.op = mnemonic.op;
+        instruction.line = number(index);
+
+        switch (mnemonic.format) {
+            case Format::NONE:
+                expect(index, 0);
+                break;
+            case Format::R:
+                expect(index, 3);
+                instruction.ri = reg(o[0], index);
+                instruction.rj = reg(o[1], index);
+                instruction.rk = reg(o[2], index);
+                break;
+            case Format::I:
+                expect(index, 3);
+                instruction.ri = reg(o[0], index);
+                instruction.rj = reg(o[1], index);
+                instruction.k = immediate(o[2], index);
+                break;
+            case Format::RR:
+                expect(index, 2);
+                instruction.ri = reg(o[0], index);
+                instruction.rj = reg(o[1], index);
+                break;
+            case Format::LOAD:
+                expect(index, 2);
+                instruction.ri = reg(o[0], index);
+                memory(o[1], index, instruction);
+                break;
+            case Format::STORE:
+                expect(index, 2);
+                memory(o[0], index, instruction);
+                instruction.ri = reg(o[1], index);
+                break;
+            case Format::R1:
+                expect(index, 1);
+                instruction.ri = reg(o[0], index);
+                break;
+            case Format::BRANCH:
+                expect(index, 2);
+                instruction.ri = reg(o[0], index);
+                instruction.k = immediate(o[1], index);
+                break;
+            case Format::K:
+                expect(index, 1);
+                instruction.k = immediate(o[0], index);
+                break;
+        }
+
+        image_.code[address / 4] = instruction;
+    }
+};
+
+}
+
+AssemblyError::AssemblyError(const unsigned int& line, const std::string& message)
+    : std::runtime_error(line > 0 ? "line " + std::to_string(line) + ": " + message : message), line_(line)
+{
+}
+
+unsigned int AssemblyError::line() const
+{
+    return line_;
+}
+
+Assembler::Assembler(const std::size_t& memorySize)
+    : memorySize_(memorySize)
+{
+}
+
+Image Assembler::assemble(std::istream& source) const
+{
+    // blank lines are kept so that line numbers match the source
+    std::vector<code::MoonInstruction> lines;
+    std::string line;
+
+    while (std::getline(source, line)) {
+        lines.push_back(code::MoonInstruction::parse(line));
+    }
+
+    return assemble(lines);
+}
+
+Image Assembler::assemble(const std::vector<code::MoonInstruction>& lines) const
+{
+    return Encoder(lines, memorySize_).encode();
+}
+
+Image Assembler::assemble(const code::MoonCode& code) const
+{
+    std::vector<code::MoonInstruction> lines;
+    lines.reserve(code.text().size() + code.data().size());
+    lines.insert(lines.end(), code.text().begin(), code.text().end());
+    lines.insert(lines.end(), code.data().begin(), code.data().end());
+
+    return assemble(lines);
+}
+
+}}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "moonshine/code/MoonCode.h"
+#include "moonshine/vm/Instruction.h"
+
+#include <cstddef>
+#include <istream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace moonshine { namespace vm {
+
+class AssemblyError : public std::runtime_error
+{
+public:
+    AssemblyError(const unsigned int& line, const std::string& message);
+
+    // 0 when the error isn't about a particular line
+    unsigned int line() const;
+private:
+    unsigned int line_;
+};
+
+/**
+ * Assembles Moon assembly text, as written by the code generators, into an image for the Machine.
+ *
+ * Every directive of the Moon assembler is supported (entry, align, org, dw, db, res). Instructions are
+ * word aligned and the program is laid out from address 0; `topaddr` is the end of memory. The util library
+ * routines (getstr, putstr, intstr, strint) are provided natively, unless the program defines them itself.
+ * Numbers in the K field of an instruction must fit its 16 bits, as on the real Moon; labels may address
+ * all of our memory.
+ */
+class Assembler
+{
+public:
+    explicit Assembler(const std::size_t& memorySize = 1 << 20);
+
+    Image assemble(std::istream& source) const;
+
+    // one instruction per line, for lines that were already parsed
+    Image assemble(const std::vector<code::MoonInstruction>& lines) const;
+
+    // generated code as it is, text followed by data, without printing and parsing it again
+    Image assemble(const code::MoonCode& code) const;
+private:
+    std::size_t memorySize_;
+};
+
+}}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "moonshine/code/MoonCode.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace moonshine { namespace vm {
+
+enum class Opcode : std::uint8_t
+{
+    // register/register
+    ADD, SUB, MUL, DIV, MOD, AND, OR, CEQ, CNE, CLT, CLE, CGT, CGE,
+
+    // register/immediate
+    ADDI, SUBI, MULI, DIVI, MODI, ANDI, ORI, CEQI, CNEI, CLTI, CLEI, CGTI, CGEI, SL, SR,
+    NOT,
+
+    // memory
+    LW, LB, SW, SB,
+
+    // console
+    GETC, PUTC,
+
+    // control
+    BZ, BNZ, J, JR, JL, JLR,
+    NOP, HLT,
+
+    // a util library routine run by the machine itself, always followed by a jr r15
+    NATIVE,
+
+    // anything that isn't an instruction: data, or memory nothing was assembled into
+    TRAP,
+};
+
+// the util library routines the machine provides natively, the argument of NATIVE
+enum class Routine : std::int32_t
+{
+    GETSTR,
+    PUTSTR,
+    INTSTR,
+    STRINT,
+};
+
+/**
+ * A decoded Moon instruction. `k` is the immediate operand, the memory offset or the jump target, with every
+ * symbol already resolved; `line` is the line of the source it was assembled from.
+ */
+struct Instruction
+{
+    Opcode op = Opcode::TRAP;
+    std::uint8_t ri = 0;
+    std::uint8_t rj = 0;
+    std::uint8_t rk = 0;
+    std::int32_t k = 0;
+    unsigned int line = 0;
+};
+
+/**
+ * An assembled program, ready to be loaded: the initial contents of memory, and the instructions in it
+ * decoded, one for every word up to the end of the program (TRAP where there is data). The source lines are
+ * kept along with where they were placed, to map addresses back to the code that generated them.
+ */
+struct Image
+{
+    std::vector<std::uint8_t> memory;
+
+    // indexed by address / 4
+    std::vector<Instruction> code;
+
+    std::map<std::string, std::int32_t> symbols;
+    std::int32_t entry = 0;
+
+    // address right after the program
+    std::int32_t size = 0;
+
+    // line n of the source is at n - 1
+    std::vector<code::MoonInstruction> lines;
+    std::vector<std::int32_t> addresses;
+};
+
+}}
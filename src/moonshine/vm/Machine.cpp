@@ -0,0 +1,481 @@
+#include "moonshine/vm/Machine.h"
+
+#include <cstring>
+#include <utility>
+
+// GCC and clang can jump straight to the next handler through a table of label addresses, which saves the
+// bounds check and the single, hard to predict indirect branch of a switch
+#if defined(__GNUC__) && !defined(MOONSHINE_VM_NO_THREADING)
+#define MOONSHINE_VM_THREADED
+
+// label addresses and computed gotos are a GNU extension
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+namespace moonshine { namespace vm {
+
+namespace {
+
+// an instruction as the interpreter loop sees it
+struct Decoded
+{
+#ifdef MOONSHINE_VM_THREADED
+    const void* handler;
+#else
+    Opcode op;
+#endif
+    std::uint8_t ri;
+    std::uint8_t rj;
+    std::uint8_t rk;
+    std::int32_t k;
+};
+
+// wrapping arithmetic, like the hardware would do it
+std::int32_t wrap(const std::uint32_t& value)
+{
+    return static_cast<std::int32_t>(value);
+}
+
+}
+
+RuntimeError::RuntimeError(const std::int32_t& address, const unsigned int& line, const std::string& message)
+    : std::runtime_error(message), address_(address), line_(line)
+{
+}
+
+std::int32_t RuntimeError::address() const
+{
+    return address_;
+}
+
+unsigned int RuntimeError::line() const
+{
+    return line_;
+}
+
+Machine::Machine(Image image, std::istream& input, std::ostream& output)
+    : image_(std::move(image)), input_(input), output_(output)
+{
+}
+
+std::int32_t Machine::reg(const unsigned int& r) const
+{
+    return registers_[r];
+}
+
+const std::vector<std::uint8_t>& Machine::memory() const
+{
+    return image_.memory;
+}
+
+std::uint64_t Machine::steps() const
+{
+    return steps_;
+}
+
+std::int32_t Machine::loadWord(const std::int32_t& address) const
+{
+    std::int32_t value;
+    std::memcpy(&value, &image_.memory[address], 4);
+    return value;
+}
+
+void Machine::storeWord(const std::int32_t& address, const std::int32_t& value)
+{
+    std::memcpy(&image_.memory[address], &value, 4);
+}
+
+void Machine::native(const Routine& routine)
+{
+    auto& memory = image_.memory;
+    auto sp = registers_[14];
+
+    auto address = [&memory](const std::int32_t& a) {
+        if (a < 0 || static_cast<std::size_t>(a) >= memory.size()) {
+            throw std::out_of_range("invalid access to " + std::to_string(a));
+        }
+
+        return a;
+    };
+
+    auto word = [&](const std::int32_t& a) {
+        address(a + 3);
+        return loadWord(address(a));
+    };
+
+    // the arguments are on the stack, in the frame of the routine, which starts at r14
+    switch (routine) {
+        case Routine::GETSTR: {
+            auto buffer = word(sp - 8);
+            std::string s;
+            std::getline(input_, s);
+
+            if (!s.empty() && s.back() == '\r') {
+                s.pop_back();
+            }
+
+            for (auto c : s) {
+                memory[address(buffer++)] = static_cast<std::uint8_t>(c);
+            }
+
+            memory[address(buffer)] = 0;
+            break;
+        }
+        case Routine::PUTSTR: {
+            for (auto a = address(word(sp - 8)); memory[a] != 0; a = address(a + 1)) {
+                output_.put(static_cast<char>(memory[a]));
+            }
+
+            break;
+        }
+        case Routine::INTSTR: {
+            auto value = word(sp - 8);
+            auto buffer = word(sp - 12);
+            auto s = std::to_string(value);
+
+            address(buffer + static_cast<std::int32_t>(s.size()));
+            std::memcpy(&memory[address(buffer)], s.c_str(), s.size() + 1);
+            registers_[13] = buffer;
+            break;
+        }
+        case Routine::STRINT: {
+            auto a = address(word(sp - 8));
+            bool negative = false;
+            std::int32_t value = 0;
+
+            while (memory[a] == ' ') {
+                a = address(a + 1);
+            }
+
+            if (memory[a] == '-' || memory[a] == '+') {
+                negative = memory[a] == '-';
+                a = address(a + 1);
+            }
+
+            while (memory[a] >= '0' && memory[a] <= '9') {
+                value = wrap(static_cast<std::uint32_t>(value) * 10 + (memory[a] - '0'));
+                a = address(a + 1);
+            }
+
+            registers_[13] = negative ? wrap(0u - static_cast<std::uint32_t>(value)) : value;
+            break;
+        }
+    }
+}
+
+void Machine::run()
+{
+    execute<false>(nullptr);
+}
+
+void Machine::run(Profile& profile)
+{
+    if (profile.executed_.size() != image_.code.size() + 1) {
+        throw std::invalid_argument("Machine::run: The profile is for another program");
+    }
+
+    execute<true>(&profile);
+}
+
+template <bool Profiling>
+void Machine::execute(Profile* profile)
+{
+    const auto& code = image_.code;
+    auto& memory = image_.memory;
+    auto* r = registers_;
+    const auto memorySize = static_cast<std::int64_t>(memory.size());
+
+#ifdef MOONSHINE_VM_THREADED
+    // in the same order as Opcode
+    static const void* const handlers[] = {
+        &&op_ADD, &&op_SUB, &&op_MUL, &&op_DIV, &&op_MOD, &&op_AND, &&op_OR,
+        &&op_CEQ, &&op_CNE, &&op_CLT, &&op_CLE, &&op_CGT, &&op_CGE,
+        &&op_ADDI, &&op_SUBI, &&op_MULI, &&op_DIVI, &&op_MODI, &&op_ANDI, &&op_ORI,
+        &&op_CEQI, &&op_CNEI, &&op_CLTI, &&op_CLEI, &&op_CGTI, &&op_CGEI, &&op_SL, &&op_SR,
+        &&op_NOT,
+        &&op_LW, &&op_LB, &&op_SW, &&op_SB,
+        &&op_GETC, &&op_PUTC,
+        &&op_BZ, &&op_BNZ, &&op_J, &&op_JR, &&op_JL, &&op_JLR,
+        &&op_NOP, &&op_HLT,
+        &&op_NATIVE,
+        &&op_TRAP,
+    };
+    static_assert(sizeof(handlers) / sizeof(handlers[0]) == static_cast<std::size_t>(Opcode::TRAP) + 1,
+                  "every opcode needs a handler");
+#endif
+
+    // one past the end traps, so falling off the program is caught like any other bad jump
+    std::vector<Decoded> program(code.size() + 1);
+
+    for (std::size_t i = 0; i <= code.size(); ++i) {
+        auto instruction = i < code.size() ? code[i] : Instruction();
+        auto& d = program[i];
+#ifdef MOONSHINE_VM_THREADED
+        d.handler = handlers[static_cast<std::size_t>(instruction.op)];
+#else
+        d.op = instruction.op;
+#endif
+        d.ri = instruction.ri;
+        d.rj = instruction.rj;
+        d.rk = instruction.rk;
+        d.k = instruction.k;
+    }
+
+    const Decoded* const begin = program.data();
+    const Decoded* const end = begin + code.size();
+    const Decoded* pc = begin;
+    std::uint64_t steps = 0;
+    std::int32_t a = 0;
+
+    // only touched when profiling
+    std::uint64_t* const executed = Profiling ? profile->executed_.data() : nullptr;
+    std::uint64_t* const loads = Profiling ? profile->loads_.data() : nullptr;
+    std::uint64_t* const stores = Profiling ? profile->stores_.data() : nullptr;
+    Costs costs;
+
+    auto now = [&]() {
+        costs.instructions = steps;
+        return costs;
+    };
+
+    auto fail = [&](const std::string& message) {
+        steps_ += steps;
+
+        if (Profiling) {
+            profile->finish(now());
+        }
+
+        auto index = static_cast<std::size_t>(pc - begin);
+        auto line = index < code.size() ? code[index].line : 0;
+        auto address = static_cast<std::int32_t>(index * 4);
+        throw RuntimeError(address, line, message + " at address " + std::to_string(address));
+    };
+
+    auto target = [&](const std::int32_t& address) -> const Decoded* {
+        if (address < 0 || address % 4 != 0 || address / 4 >= static_cast<std::int64_t>(code.size())) {
+            fail("jump to invalid address " + std::to_string(address));
+        }
+
+        return begin + address / 4;
+    };
+
+    auto word = [&](const std::int64_t& address) -> std::int32_t {
+        if (address < 0 || address + 4 > memorySize || address % 4 != 0) {
+            fail("invalid word access to " + std::to_string(address));
+        }
+
+        return static_cast<std::int32_t>(address);
+    };
+
+    auto byte = [&](const std::int64_t& address) -> std::int32_t {
+        if (address < 0 || address >= memorySize) {
+            fail("invalid byte access to " + std::to_string(address));
+        }
+
+        return static_cast<std::int32_t>(address);
+    };
+
+    pc = target(image_.entry);
+
+#ifdef MOONSHINE_VM_THREADED
+#define VM_CASE(op) op_##op:
+#define VM_DISPATCH() do { if (Profiling) { ++executed[pc - begin]; } goto *pc->handler; } while (0)
+#else
+#define VM_CASE(op) case Opcode::op:
+#define VM_DISPATCH() goto dispatch
+#endif
+#define VM_LOAD() do { if (Profiling) { ++loads[pc - begin]; ++costs.loads; } } while (0)
+#define VM_STORE() do { if (Profiling) { ++stores[pc - begin]; ++costs.stores; } } while (0)
+#define VM_NEXT() do { ++pc; ++steps; VM_DISPATCH(); } while (0)
+#define VM_JUMP(address) do { pc = target(address); ++steps; VM_DISPATCH(); } while (0)
+#define VM_SET(value) do { r[pc->ri] = (value); r[0] = 0; VM_NEXT(); } while (0)
+#define VM_RRR(op, expr) VM_CASE(op) { auto x = r[pc->rj]; auto y = r[pc->rk]; VM_SET(expr); }
+#define VM_RRK(op, expr) VM_CASE(op) { auto x = r[pc->rj]; auto y = pc->k; VM_SET(expr); }
+#define VM_U(x) static_cast<std::uint32_t>(x)
+
+#ifdef MOONSHINE_VM_THREADED
+    VM_DISPATCH();
+#else
+dispatch:
+    if (Profiling) {
+        ++executed[pc - begin];
+    }
+
+    switch (pc->op) {
+#endif
+    VM_RRR(ADD, wrap(VM_U(x) + VM_U(y)))
+    VM_RRR(SUB, wrap(VM_U(x) - VM_U(y)))
+    VM_RRR(MUL, wrap(VM_U(x) * VM_U(y)))
+    VM_CASE(DIV) {
+        if (r[pc->rk] == 0) {
+            fail("division by zero");
+        }
+
+        VM_SET(r[pc->rk] == -1 ? wrap(0u - VM_U(r[pc->rj])) : r[pc->rj] / r[pc->rk]);
+    }
+    VM_CASE(MOD) {
+        if (r[pc->rk] == 0) {
+            fail("division by zero");
+        }
+
+        VM_SET(r[pc->rk] == -1 ? 0 : r[pc->rj] % r[pc->rk]);
+    }
+    // and, or and not are logical: their result is always 0 or 1
+    VM_RRR(AND, x && y)
+    VM_RRR(OR, x || y)
+    VM_RRR(CEQ, x == y)
+    VM_RRR(CNE, x != y)
+    VM_RRR(CLT, x < y)
+    VM_RRR(CLE, x <= y)
+    VM_RRR(CGT, x > y)
+    VM_RRR(CGE, x >= y)
+    VM_RRK(ADDI, wrap(VM_U(x) + VM_U(y)))
+    VM_RRK(SUBI, wrap(VM_U(x) - VM_U(y)))
+    VM_RRK(MULI, wrap(VM_U(x) * VM_U(y)))
+    VM_CASE(DIVI) {
+        if (pc->k == 0) {
+            fail("division by zero");
+        }
+
+        VM_SET(pc->k == -1 ? wrap(0u - VM_U(r[pc->rj])) : r[pc->rj] / pc->k);
+    }
+    VM_CASE(MODI) {
+        if (pc->k == 0) {
+            fail("division by zero");
+        }
+
+        VM_SET(pc->k == -1 ? 0 : r[pc->rj] % pc->k);
+    }
+    VM_RRK(ANDI, x && y)
+    VM_RRK(ORI, x || y)
+    VM_RRK(CEQI, x == y)
+    VM_RRK(CNEI, x != y)
+    VM_RRK(CLTI, x < y)
+    VM_RRK(CLEI, x <= y)
+    VM_RRK(CGTI, x > y)
+    VM_RRK(CGEI, x >= y)
+    VM_RRK(SL, wrap(VM_U(x) << (y & 31)))
+    VM_RRK(SR, wrap(VM_U(x) >> (y & 31)))
+    VM_CASE(NOT) {
+        VM_SET(r[pc->rj] == 0);
+    }
+    VM_CASE(LW) {
+        a = word(static_cast<std::int64_t>(r[pc->rj]) + pc->k);
+        VM_LOAD();
+        VM_SET(loadWord(a));
+    }
+    VM_CASE(LB) {
+        a = byte(static_cast<std::int64_t>(r[pc->rj]) + pc->k);
+        VM_LOAD();
+        VM_SET(memory[a]);
+    }
+    VM_CASE(SW) {
+        a = word(static_cast<std::int64_t>(r[pc->rj]) + pc->k);
+        VM_STORE();
+        storeWord(a, r[pc->ri]);
+        VM_NEXT();
+    }
+    VM_CASE(SB) {
+        a = byte(static_cast<std::int64_t>(r[pc->rj]) + pc->k);
+        VM_STORE();
+        memory[a] = static_cast<std::uint8_t>(r[pc->ri]);
+        VM_NEXT();
+    }
+    VM_CASE(GETC) {
+        auto c = input_.get();
+        VM_SET(c == std::char_traits<char>::eof() ? 0 : c);
+    }
+    VM_CASE(PUTC) {
+        output_.put(static_cast<char>(r[pc->ri]));
+        VM_NEXT();
+    }
+    VM_CASE(BZ) {
+        if (r[pc->ri] == 0) {
+            VM_JUMP(pc->k);
+        }
+
+        VM_NEXT();
+    }
+    VM_CASE(BNZ) {
+        if (r[pc->ri] != 0) {
+            VM_JUMP(pc->k);
+        }
+
+        VM_NEXT();
+    }
+    VM_CASE(J) {
+        VM_JUMP(pc->k);
+    }
+    VM_CASE(JR) {
+        if (Profiling) {
+            profile->leave(r[pc->ri], now());
+        }
+
+        VM_JUMP(r[pc->ri]);
+    }
+    VM_CASE(JL) {
+        auto k = pc->k;
+        auto link = static_cast<std::int32_t>((pc - begin + 1) * 4);
+
+        if (Profiling) {
+            profile->enter(link - 4, k, link, now());
+        }
+
+        r[pc->ri] = link;
+        r[0] = 0;
+        VM_JUMP(k);
+    }
+    VM_CASE(JLR) {
+        auto j = r[pc->rj];
+        auto link = static_cast<std::int32_t>((pc - begin + 1) * 4);
+
+        if (Profiling) {
+            profile->enter(link - 4, j, link, now());
+        }
+
+        r[pc->ri] = link;
+        r[0] = 0;
+        VM_JUMP(j);
+    }
+    VM_CASE(NOP) {
+        VM_NEXT();
+    }
+    VM_CASE(NATIVE) {
+        try {
+            native(static_cast<Routine>(pc->k));
+        } catch (const std::out_of_range& e) {
+            fail(e.what());
+        }
+
+        VM_NEXT();
+    }
+    VM_CASE(HLT) {
+        ++steps;
+        steps_ += steps;
+
+        if (Profiling) {
+            profile->finish(now());
+        }
+
+        return;
+    }
+    VM_CASE(TRAP) {
+        fail(pc == end ? "ran past the end of the program" : "executed data");
+    }
+#ifndef MOONSHINE_VM_THREADED
+    }
+#endif
+
+#undef VM_CASE
+#undef VM_DISPATCH
+#undef VM_NEXT
+#undef VM_JUMP
+#undef VM_SET
+#undef VM_RRR
+#undef VM_RRK
+#undef VM_LOAD
+#undef VM_STORE
+#undef VM_U
+}
+
+}}
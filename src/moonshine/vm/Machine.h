@@ -0,0 +1,67 @@
+#pragma once
+
+#include "moonshine/vm/Instruction.h"
+#include "moonshine/vm/Profile.h"
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+namespace moonshine { namespace vm {
+
+class RuntimeError : public std::runtime_error
+{
+public:
+    RuntimeError(const std::int32_t& address, const unsigned int& line, const std::string& message);
+
+    // of the instruction that failed, and the line it was assembled from
+    std::int32_t address() const;
+    unsigned int line() const;
+private:
+    std::int32_t address_;
+    unsigned int line_;
+};
+
+/**
+ * Runs an assembled Moon program, with `getc` and `putc` reading from and writing to the given streams.
+ *
+ * The instructions are decoded once more before running into a compact array holding what executing them
+ * needs, and dispatched by jumping from one handler straight to the next (threaded code) when the compiler
+ * supports label addresses, with a switch otherwise. Memory accesses, jumps and divisions are checked, and
+ * a RuntimeError is thrown on the first one that fails, like executing data or falling off the program.
+ *
+ * A profiled run goes through a copy of the interpreter that also counts into a Profile, so that running
+ * without one costs nothing more.
+ */
+class Machine
+{
+public:
+    Machine(Image image, std::istream& input, std::ostream& output);
+
+    // until hlt
+    void run();
+    void run(Profile& profile);
+
+    std::int32_t reg(const unsigned int& r) const;
+    const std::vector<std::uint8_t>& memory() const;
+
+    // instructions executed so far
+    std::uint64_t steps() const;
+private:
+    Image image_;
+    std::istream& input_;
+    std::ostream& output_;
+    std::int32_t registers_[16] = {};
+    std::uint64_t steps_ = 0;
+
+    template <bool Profiling>
+    void execute(Profile* profile);
+
+    void native(const Routine& routine);
+    std::int32_t loadWord(const std::int32_t& address) const;
+    void storeWord(const std::int32_t& address, const std::int32_t& value);
+};
+
+}}
@@ -0,0 +1,419 @@
+#include "moonshine/vm/Profile.h"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace moonshine { namespace vm {
+
+namespace {
+
+const std::string funcDef = "% funcDef:";
+
+std::string trim(const std::string& s)
+{
+    auto b = s.find_first_not_of(" \t\r");
+
+    if (b == std::string::npos) {
+        return "";
+    }
+
+    return s.substr(b, s.find_last_not_of(" \t\r") - b + 1);
+}
+
+bool startsWith(const std::string& s, const std::string& prefix)
+{
+    return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+double percent(const std::uint64_t& part, const std::uint64_t& whole)
+{
+    return whole == 0 ? 0.0 : 100.0 * static_cast<double>(part) / static_cast<double>(whole);
+}
+
+}
+
+Costs& Costs::operator+=(const Costs& other)
+{
+    instructions += other.instructions;
+    loads += other.loads;
+    stores += other.stores;
+    return *this;
+}
+
+Costs Costs::operator-(const Costs& other) const
+{
+    Costs costs;
+    costs.instructions = instructions - other.instructions;
+    costs.loads = loads - other.loads;
+    costs.stores = stores - other.stores;
+    return costs;
+}
+
+Profile::Profile(const Image& image)
+    : executed_(image.code.size() + 1, 0), loads_(image.code.size() + 1, 0), stores_(image.code.size() + 1, 0),
+      entry_(image.entry), lines_(image.lines), addresses_(image.addresses),
+      instructionLines_(image.code.size(), 0), statements_(image.code.size(), 0)
+{
+    for (std::size_t i = 0; i < image.code.size(); ++i) {
+        instructionLines_[i] = image.code[i].line;
+
+        // native routines have no source, they go by the name they were linked under
+        if (image.code[i].op == Opcode::NATIVE) {
+            for (const auto& symbol : image.symbols) {
+                if (symbol.second == static_cast<std::int32_t>(i * 4)) {
+                    starts_[symbol.second] = std::make_pair(symbol.first, 0u);
+                }
+            }
+        }
+    }
+
+    unsigned int statement = 0;
+
+    for (std::size_t i = 0; i < lines_.size(); ++i) {
+        const auto& line = lines_[i];
+        auto number = static_cast<unsigned int>(i + 1);
+
+        if (!line.label.empty() && startsWith(line.comment, funcDef)) {
+            // instructions are word aligned, the label may not be
+            starts_[(addresses_[i] + 3) & ~3] = std::make_pair(trim(line.comment.substr(funcDef.size())), number);
+        }
+
+        // function bodies begin and end with %% comments
+        if (line.op.empty() && startsWith(line.comment, "%%")) {
+            statement = 0;
+        } else if (!line.label.empty() || (line.op.empty() && !line.comment.empty())) {
+            statement = number;
+        }
+
+        if (!line.op.empty() && !line.isDirective()) {
+            auto index = static_cast<std::size_t>(addresses_[i] / 4);
+
+            if (index < statements_.size()) {
+                statements_[index] = statement;
+            }
+        }
+    }
+
+    if (static_cast<std::size_t>(entry_ / 4) < image.code.size()) {
+        starts_.emplace(entry_, std::make_pair(std::string("program"), image.code[entry_ / 4].line));
+    }
+}
+
+Costs Profile::at(const std::int32_t& address) const
+{
+    Costs costs;
+    auto index = static_cast<std::size_t>(address / 4);
+
+    if (address >= 0 && index < executed_.size()) {
+        costs.instructions = executed_[index];
+        costs.loads = loads_[index];
+        costs.stores = stores_[index];
+    }
+
+    return costs;
+}
+
+Costs Profile::total() const
+{
+    Costs costs;
+
+    for (std::size_t i = 0; i < executed_.size(); ++i) {
+        costs += at(static_cast<std::int32_t>(i * 4));
+    }
+
+    return costs;
+}
+
+std::vector<Profile::Function> Profile::functions() const
+{
+    std::vector<Function> functions;
+    std::map<std::int32_t, std::size_t> index;
+
+    for (const auto& start : starts_) {
+        Function f;
+        f.name = start.second.first;
+        f.address = start.first;
+        f.line = start.second.second;
+
+        auto entered = entered_.find(start.first);
+
+        if (start.first == entry_) {
+            f.calls = executed_[entry_ / 4] > 0 ? 1 : 0;
+            f.inclusive = total();
+        } else if (entered != entered_.end()) {
+            f.calls = entered->second.count;
+            f.inclusive = entered->second.inclusive;
+        } else {
+            f.calls = 0;
+        }
+
+        index[f.address] = functions.size();
+        functions.push_back(f);
+    }
+
+    for (std::size_t i = 0; i < instructionLines_.size(); ++i) {
+        auto address = static_cast<std::int32_t>(i * 4);
+        auto f = function(address);
+
+        if (f < 0) {
+            continue;
+        }
+
+        functions[index.at(f)].self += at(address);
+    }
+
+    // functions only ever entered by a jump (tail calls) have nothing more than what they ran themselves
+    for (auto& f : functions) {
+        if (f.inclusive.instructions < f.self.instructions) {
+            f.inclusive = f.self;
+        }
+    }
+
+    return functions;
+}
+
+void Profile::printFlat(std::ostream& s) const
+{
+    auto all = total();
+
+    s << "Flat profile: " << all.instructions << " instructions executed, " << all.loads << " loads, "
+      << all.stores << " stores" << std::endl << std::endl;
+
+    auto functions = this->functions();
+
+    std::stable_sort(functions.begin(), functions.end(), [](const Function& a, const Function& b) {
+        return a.self.instructions > b.self.instructions;
+    });
+
+    s << std::right << std::fixed << std::setprecision(2)
+      << std::setw(8) << "% instr" << std::setw(12) << "self" << std::setw(12) << "inclusive" << std::setw(10) << "calls"
+      << std::setw(10) << "loads" << std::setw(10) << "stores" << "  function" << std::endl;
+
+    for (const auto& f : functions) {
+        if (f.self.instructions == 0 && f.calls == 0) {
+            continue;
+        }
+
+        s << std::setw(8) << percent(f.self.instructions, all.instructions) << std::setw(12) << f.self.instructions
+          << std::setw(12) << f.inclusive.instructions << std::setw(10) << f.calls << std::setw(10) << f.self.loads
+          << std::setw(10) << f.self.stores << "  " << f.name << std::endl;
+    }
+
+    // statements are identified by the line starting them, instructions outside of any by their function
+    typedef std::pair<std::int32_t, unsigned int> Statement;
+    std::map<Statement, Costs> statements;
+
+    for (std::size_t i = 0; i < statements_.size(); ++i) {
+        auto address = static_cast<std::int32_t>(i * 4);
+        auto costs = at(address);
+
+        if (costs.instructions > 0) {
+            statements[Statement(function(address), statements_[i])] += costs;
+        }
+    }
+
+    std::vector<std::pair<Statement, Costs>> sorted(statements.begin(), statements.end());
+
+    std::stable_sort(sorted.begin(), sorted.end(), [](const std::pair<Statement, Costs>& a, const std::pair<Statement, Costs>& b) {
+        return a.second.instructions > b.second.instructions;
+    });
+
+    s << std::endl << "Statements:" << std::endl << std::endl
+      << std::setw(8) << "% instr" << std::setw(12) << "instr" << std::setw(10) << "loads" << std::setw(10) << "stores"
+      << std::setw(8) << "line" << "  function: statement" << std::endl;
+
+    for (const auto& statement : sorted) {
+        const auto& costs = statement.second;
+
+        s << std::setw(8) << percent(costs.instructions, all.instructions) << std::setw(12) << costs.instructions
+          << std::setw(10) << costs.loads << std::setw(10) << costs.stores << std::setw(8) << statement.first.second
+          << "  " << name(statement.first.first) << ": " << this->statement(statement.first.second) << std::endl;
+    }
+
+    // by caller and function called, the call sites are in the callgrind output
+    std::map<std::pair<std::int32_t, std::int32_t>, Call> graph;
+
+    for (const auto& call : calls_) {
+        auto& edge = graph[std::make_pair(function(call.first.first), call.first.second)];
+        edge.count += call.second.count;
+        edge.inclusive += call.second.inclusive;
+    }
+
+    s << std::endl << "Call graph:" << std::endl << std::endl
+      << std::setw(10) << "calls" << std::setw(12) << "inclusive" << std::setw(10) << "loads" << std::setw(10) << "stores"
+      << "  caller -> function" << std::endl;
+
+    for (const auto& edge : graph) {
+        const auto& costs = edge.second.inclusive;
+
+        s << std::setw(10) << edge.second.count << std::setw(12) << costs.instructions << std::setw(10) << costs.loads
+          << std::setw(10) << costs.stores << "  " << name(edge.first.first) << " -> " << name(edge.first.second) << std::endl;
+    }
+}
+
+void Profile::printAnnotated(std::ostream& s) const
+{
+    s << std::right << std::setw(10) << "executed" << std::setw(8) << "loads" << std::setw(8) << "stores" << " |" << std::endl;
+
+    for (std::size_t i = 0; i < lines_.size(); ++i) {
+        const auto& line = lines_[i];
+
+        // printing a label leaves the stream left aligned
+        s << std::right;
+
+        if (!line.op.empty() && !line.isDirective()) {
+            auto costs = at(addresses_[i]);
+            s << std::setw(10) << costs.instructions << std::setw(8) << costs.loads << std::setw(8) << costs.stores;
+        } else {
+            s << std::string(26, ' ');
+        }
+
+        s << " |";
+        line.print(s);
+    }
+}
+
+void Profile::printCallgrind(std::ostream& s, const std::string& file) const
+{
+    auto all = total();
+
+    s << "# callgrind format" << std::endl
+      << "version: 1" << std::endl
+      << "creator: moonshine" << std::endl
+      << "cmd: " << file << std::endl
+      << "positions: line" << std::endl
+      << "events: Ir Dr Dw" << std::endl
+      << "summary: " << all.instructions << " " << all.loads << " " << all.stores << std::endl << std::endl
+      << "fl=" << file << std::endl;
+
+    for (auto start = starts_.begin(); start != starts_.end(); ++start) {
+        auto next = std::next(start);
+        auto end = next != starts_.end() ? static_cast<std::size_t>(next->first / 4) : instructionLines_.size();
+
+        s << std::endl << "fn=" << start->second.first << std::endl;
+
+        for (auto i = static_cast<std::size_t>(start->first / 4); i < end && i < instructionLines_.size(); ++i) {
+            if (executed_[i] > 0) {
+                s << instructionLines_[i] << " " << executed_[i] << " " << loads_[i] << " " << stores_[i] << std::endl;
+            }
+        }
+
+        for (const auto& call : calls_) {
+            if (function(call.first.first) != start->first) {
+                continue;
+            }
+
+            const auto& inclusive = call.second.inclusive;
+
+            s << "cfn=" << name(call.first.second) << std::endl
+              << "calls=" << call.second.count << " " << starts_.at(call.first.second).second << std::endl
+              << instructionLines_[call.first.first / 4] << " " << inclusive.instructions << " " << inclusive.loads
+              << " " << inclusive.stores << std::endl;
+        }
+    }
+}
+
+void Profile::enter(const std::int32_t& site, const std::int32_t& function, const std::int32_t& returnAddress, const Costs& now)
+{
+    // calls to code without a funcDef go by its label
+    if (!starts_.count(function)) {
+        std::string label = "?";
+        unsigned int line = 0;
+
+        for (std::size_t i = 0; i < lines_.size(); ++i) {
+            if (!lines_[i].label.empty() && addresses_[i] == function) {
+                label = lines_[i].label;
+                line = static_cast<unsigned int>(i + 1);
+                break;
+            }
+        }
+
+        starts_[function] = std::make_pair(label, line);
+    }
+
+    ++calls_[std::make_pair(site, function)].count;
+    ++entered_[function].count;
+    ++active_[function];
+
+    Frame frame;
+    frame.site = site;
+    frame.function = function;
+    frame.returnAddress = returnAddress;
+    frame.at = now;
+    frames_.push_back(frame);
+}
+
+void Profile::leave(const std::int32_t& target, const Costs& now)
+{
+    // a jr that doesn't go back to a caller is just a jump, returning further up leaves every call in between
+    auto frame = std::find_if(frames_.rbegin(), frames_.rend(), [&target](const Frame& f) { return f.returnAddress == target; });
+
+    if (frame == frames_.rend()) {
+        return;
+    }
+
+    for (auto n = frame - frames_.rbegin() + 1; n > 0; --n) {
+        pop(now);
+    }
+}
+
+void Profile::finish(const Costs& now)
+{
+    while (!frames_.empty()) {
+        pop(now);
+    }
+}
+
+void Profile::pop(const Costs& now)
+{
+    const auto& frame = frames_.back();
+    auto costs = now - frame.at;
+
+    calls_[std::make_pair(frame.site, frame.function)].inclusive += costs;
+
+    // only the outermost of recursive calls counts for the function, the others are part of it
+    if (--active_[frame.function] == 0) {
+        entered_[frame.function].inclusive += costs;
+    }
+
+    frames_.pop_back();
+}
+
+std::int32_t Profile::function(const std::int32_t& address) const
+{
+    auto it = starts_.upper_bound(address);
+
+    if (address < 0 || it == starts_.begin()) {
+        return -1;
+    }
+
+    return std::prev(it)->first;
+}
+
+std::string Profile::name(const std::int32_t& function) const
+{
+    auto it = starts_.find(function);
+
+    if (it == starts_.end()) {
+        return "?";
+    }
+
+    return it->second.first;
+}
+
+std::string Profile::statement(const unsigned int& line) const
+{
+    if (line == 0) {
+        return "-";
+    }
+
+    const auto& l = lines_[line - 1];
+
+    if (l.comment.empty()) {
+        return l.label;
+    }
+
+    return trim(l.comment.substr(1));
+}
+
+}}
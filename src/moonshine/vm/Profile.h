@@ -0,0 +1,122 @@
+#pragma once
+
+#include "moonshine/vm/Instruction.h"
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace moonshine { namespace vm {
+
+struct Costs
+{
+    std::uint64_t instructions = 0;
+    std::uint64_t loads = 0;
+    std::uint64_t stores = 0;
+
+    Costs& operator+=(const Costs& other);
+    Costs operator-(const Costs& other) const;
+};
+
+/**
+ * What a profiled run of a program spent where: how many times every instruction was executed and accessed
+ * memory, and every call made with `jl`/`jlr`, from which call site to which function, with the costs of
+ * everything executed until it returned.
+ *
+ * Addresses are mapped back to the comments the code generators write: functions start at the labels marked
+ * `% funcDef:` (and the program at its entry), and a statement runs from a comment of its own (`% fCall:`,
+ * `% assignStat`, ...) or a label to the next one. Costs are counted in executed instructions, with memory
+ * accesses of loads and stores apart; the util library routines count as the two instructions they are.
+ */
+class Profile
+{
+public:
+    struct Function
+    {
+        std::string name;
+        std::int32_t address;
+        unsigned int line;
+        std::uint64_t calls;
+        Costs self;
+
+        // including everything called, counted once for recursive calls
+        Costs inclusive;
+    };
+
+    explicit Profile(const Image& image);
+
+    Costs at(const std::int32_t& address) const;
+    Costs total() const;
+
+    // by address
+    std::vector<Function> functions() const;
+
+    // functions, statements and call graph, most expensive first
+    void printFlat(std::ostream& s) const;
+
+    // the source with the costs of every instruction in front
+    void printAnnotated(std::ostream& s) const;
+
+    // for callgrind_annotate and KCachegrind, `file` being the name of the source
+    void printCallgrind(std::ostream& s, const std::string& file) const;
+private:
+    friend class Machine;
+
+    struct Call
+    {
+        std::uint64_t count = 0;
+        Costs inclusive;
+    };
+
+    // indexed by address / 4, with one past the end for running off the program
+    std::vector<std::uint64_t> executed_;
+    std::vector<std::uint64_t> loads_;
+    std::vector<std::uint64_t> stores_;
+
+    // call site and function called
+    std::map<std::pair<std::int32_t, std::int32_t>, Call> calls_;
+
+    // by function address
+    std::map<std::int32_t, Call> entered_;
+
+    // calls that haven't returned yet, and how many of them are to every function
+    struct Frame
+    {
+        std::int32_t site;
+        std::int32_t function;
+        std::int32_t returnAddress;
+        Costs at;
+    };
+
+    std::vector<Frame> frames_;
+    std::map<std::int32_t, unsigned int> active_;
+
+    std::int32_t entry_;
+    std::vector<code::MoonInstruction> lines_;
+    std::vector<std::int32_t> addresses_;
+
+    // source line of every instruction, 0 for the native routines
+    std::vector<unsigned int> instructionLines_;
+
+    // function starts, by address
+    std::map<std::int32_t, std::pair<std::string, unsigned int>> starts_;
+
+    // the line starting the statement every instruction belongs to, 0 for none
+    std::vector<unsigned int> statements_;
+
+    // called by the Machine with the costs of the run so far, for a jl or jlr, a jr and hlt
+    void enter(const std::int32_t& site, const std::int32_t& function, const std::int32_t& returnAddress, const Costs& now);
+    void leave(const std::int32_t& target, const Costs& now);
+    void finish(const Costs& now);
+    void pop(const Costs& now);
+
+    // the address of the function an address belongs to, -1 if none
+    std::int32_t function(const std::int32_t& address) const;
+    std::string name(const std::int32_t& function) const;
+    std::string statement(const unsigned int& line) const;
+};
+
+}}
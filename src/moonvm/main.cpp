@@ -0,0 +1,105 @@
+#include <moonshine/vm/Assembler.h>
+#include <moonshine/vm/Machine.h>
+#include <moonshine/vm/Profile.h>
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <memory>
+
+using namespace moonshine;
+
+int main(int argc, const char** argv)
+{
+    // moonvm program.m [-s] [-p profile.txt] [-a annotated.txt] [-c callgrind.out]
+    //   -s  print the number of executed instructions
+    //   -p  write a flat profile: functions, statements and call graph
+    //   -a  write the program with the costs of every instruction in front
+    //   -c  write a profile for callgrind_annotate and KCachegrind
+
+    const char* usage = " program.m [-s] [-p profile.txt] [-a annotated.txt] [-c callgrind.out]";
+
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << usage << std::endl;
+        return 2;
+    }
+
+    bool printSteps = false;
+    std::string flatOutput;
+    std::string annotatedOutput;
+    std::string callgrindOutput;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string option = argv[i];
+
+        if (option == "-s") {
+            printSteps = true;
+        } else if ((option == "-p" || option == "-a" || option == "-c") && i + 1 < argc) {
+            (option == "-p" ? flatOutput : option == "-a" ? annotatedOutput : callgrindOutput) = argv[++i];
+        } else {
+            std::cerr << "usage: " << argv[0] << usage << std::endl;
+            return 2;
+        }
+    }
+
+    std::ifstream source(argv[1]);
+
+    if (!source) {
+        std::cerr << "cannot open " << argv[1] << std::endl;
+        return 2;
+    }
+
+    int status = 0;
+
+    try {
+        auto image = vm::Assembler().assemble(source);
+
+        // profiling only when some profile is asked for
+        std::unique_ptr<vm::Profile> profile;
+
+        if (!flatOutput.empty() || !annotatedOutput.empty() || !callgrindOutput.empty()) {
+            profile.reset(new vm::Profile(image));
+        }
+
+        vm::Machine machine(std::move(image), std::cin, std::cout);
+
+        try {
+            if (profile) {
+                machine.run(*profile);
+            } else {
+                machine.run();
+            }
+        } catch (const vm::RuntimeError& e) {
+            std::cout << std::flush;
+            std::cerr << argv[1] << ":" << e.line() << ": " << e.what() << std::endl;
+            status = 1;
+        }
+
+        std::cout << std::flush;
+
+        if (printSteps) {
+            std::cerr << "steps: " << machine.steps() << std::endl;
+        }
+
+        // a run that failed still has a profile up to the failure
+        if (!flatOutput.empty()) {
+            std::ofstream output(flatOutput, std::ios::trunc);
+            profile->printFlat(output);
+        }
+
+        if (!annotatedOutput.empty()) {
+            std::ofstream output(annotatedOutput, std::ios::trunc);
+            profile->printAnnotated(output);
+        }
+
+        if (!callgrindOutput.empty()) {
+            std::ofstream output(callgrindOutput, std::ios::trunc);
+            profile->printCallgrind(output, argv[1]);
+        }
+    } catch (const vm::AssemblyError& e) {
+        std::cerr << argv[1] << ": " << e.what() << std::endl;
+        return 1;
+    }
+
+    return status;
+}
@@ -0,0 +1,95 @@
+#include <catch/catch.hpp>
+
+#include <moonshine/Cache.h>
+#include <moonshine/Compiler.h>
+
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <unistd.h>
+
+using namespace moonshine;
+
+TEST_CASE("cache entries are found by their whole key and the least recently used go first", "[cache]") {
+    char directory[] = "/tmp/moonshine-cache-XXXXXX";
+    REQUIRE(::mkdtemp(directory) != nullptr);
+
+    // room for two entries
+    std::string content(1000, 'x');
+    Cache cache(directory, 2500);
+    Cache::Entry entry;
+
+    REQUIRE_FALSE(cache.load("a", entry));
+
+    REQUIRE(cache.store("a", {{"output", content}, {"status", "ok"}}));
+    REQUIRE(cache.store("b", {{"output", content}}));
+
+    REQUIRE(cache.load("a", entry));
+    REQUIRE(entry.size() == 2);
+    REQUIRE(entry["output"] == content);
+    REQUIRE(entry["status"] == "ok");
+    REQUIRE_FALSE(cache.load("ab", entry));
+
+    // a was used after b
+    REQUIRE(cache.store("c", {{"output", content}}));
+    REQUIRE(cache.load("a", entry));
+    REQUIRE(cache.load("c", entry));
+    REQUIRE_FALSE(cache.load("b", entry));
+
+    REQUIRE(Cache::hash("") == "cbf29ce484222325");
+    REQUIRE(Cache::hash("a") != Cache::hash("b"));
+
+    std::system(("rm -rf " + std::string(directory)).c_str());
+}
+
+TEST_CASE("diagnostics from the cache keep their positions", "[cache]") {
+    char directory[] = "/tmp/moonshine-cache-XXXXXX";
+    REQUIRE(::mkdtemp(directory) != nullptr);
+
+    const char* source =
+        "class A { int x; int f(int y); };"
+        "class B { int z; int g(int w); };"
+        "int B::g(int w) { int z; z = w; return (z); };"
+        "int A::f(int y) { int x; x = y; return (x); };"
+        "program { A a; int n; n = a.f(1); put(n); };";
+
+    Compiler compiler;
+    Cache cache(directory, 1 << 20);
+    std::vector<Error> diagnostics[2];
+
+    // the first compile fills the cache, the second finds it there
+    for (auto& d : diagnostics) {
+        Cache::Entry entry;
+
+        if (!cache.load(source, entry)) {
+            std::ostringstream program;
+            Compiler::Outputs outputs;
+            outputs.program = &program;
+
+            std::istringstream input(source);
+            auto result = compiler.compile(input, Compiler::Options(), outputs);
+            entry["diagnostics"] = Cache::writeDiagnostics(result.diagnostics);
+            REQUIRE(cache.store(source, entry));
+        }
+
+        d = Cache::readDiagnostics(entry["diagnostics"]);
+    }
+
+    // two shadowed variables, sorted by position, so the one in B::g first
+    REQUIRE(diagnostics[0].size() == 2);
+    REQUIRE(diagnostics[0][0].position < diagnostics[0][1].position);
+    REQUIRE(diagnostics[0][0].message.find("for z") != std::string::npos);
+
+    REQUIRE(diagnostics[1].size() == diagnostics[0].size());
+
+    for (std::size_t i = 0; i < diagnostics[0].size(); ++i) {
+        REQUIRE(diagnostics[1][i].position == diagnostics[0][i].position);
+        REQUIRE(diagnostics[1][i].message == diagnostics[0][i].message);
+    }
+
+    REQUIRE_THROWS_AS(Cache::readDiagnostics("no position\n"), const std::logic_error&);
+
+    std::system(("rm -rf " + std::string(directory)).c_str());
+}
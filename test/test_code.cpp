@@ -0,0 +1,863 @@
+#include <catch/catch.hpp>
+
+#include <moonshine/Compiler.h>
+#include <moonshine/lexer/Lexer.h>
+#include <moonshine/syntax/Parser.h>
+#include <moonshine/semantic/SymbolTableCreatorVisitor.h>
+#include <moonshine/semantic/SymbolTableLinkerVisitor.h>
+#include <moonshine/semantic/TypeCheckerVisitor.h>
+#include <moonshine/semantic/SymbolTableClassDeclLinkerVisitor.h>
+#include <moonshine/semantic/InheritanceResolverVisitor.h>
+#include <moonshine/semantic/ShadowedSymbolCheckerVisitor.h>
+#include <moonshine/code/MemorySizeComputerVisitor.h>
+#include <moonshine/ir/IRBuilderVisitor.h>
+#include <moonshine/ir/Inliner.h>
+#include <moonshine/ir/TailCallElimination.h>
+#include <moonshine/ir/ConstantPropagation.h>
+#include <moonshine/ir/DeadCodeElimination.h>
+#include <moonshine/ir/DeadFunctionElimination.h>
+#include <moonshine/ir/RegisterCallingConvention.h>
+#include <moonshine/ir/StrengthReduction.h>
+#include <moonshine/ir/AddressFolding.h>
+#include <moonshine/code/LinearScanAllocator.h>
+#include <moonshine/code/PeepholeOptimizer.h>
+#include <moonshine/code/MoonBackend.h>
+#include <moonshine/code/X86Backend.h>
+#include <moonshine/vm/Assembler.h>
+#include <moonshine/vm/Machine.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace moonshine;
+
+static std::unique_ptr<ast::Node> buildProgram(const char* input, ir::Program& program)
+{
+    Lexer lex;
+    syntax::Grammar grammar("grammar.txt",  "table.json", "first.txt", "follow.txt");
+
+    std::istringstream stream(input);
+    lex.startLexing(&stream, nullptr);
+    syntax::Parser parser(grammar);
+
+    std::unique_ptr<ast::Node> astRoot = parser.parse(&lex, nullptr);
+    REQUIRE(astRoot != nullptr);
+
+    std::vector<semantic::SemanticError> errors;
+    std::vector<std::unique_ptr<Visitor>> visitors;
+    visitors.emplace_back(new semantic::SymbolTableCreatorVisitor());
+    visitors.emplace_back(new semantic::SymbolTableClassDeclLinkerVisitor());
+    visitors.emplace_back(new semantic::SymbolTableLinkerVisitor());
+    visitors.emplace_back(new semantic::InheritanceResolverVisitor());
+    visitors.emplace_back(new semantic::ShadowedSymbolCheckerVisitor());
+    visitors.emplace_back(new semantic::TypeCheckerVisitor());
+    visitors.emplace_back(new code::MemorySizeComputerVisitor());
+    visitors.emplace_back(new ir::IRBuilderVisitor(program));
+
+    for (auto& v : visitors) {
+        v->setErrorContainer(&errors);
+        astRoot->accept(v.get());
+    }
+
+    REQUIRE(errors.empty());
+    return astRoot;
+}
+
+// the temporaries of a table used under a node, in evaluation order
+static void collectTemporaries(ast::Node* node, semantic::SymbolTable* table,
+                               std::vector<semantic::SymbolTableEntry*>& temporaries)
+{
+    for (auto n = node->child(); n != nullptr; n = n->next()) {
+        collectTemporaries(n, table, temporaries);
+    }
+
+    auto entry = node->symbolTableEntry();
+
+    if (entry && entry->parentTable() == table
+        && (entry->kind() == semantic::SymbolTableEntryKind::TEMPVAR
+            || entry->kind() == semantic::SymbolTableEntryKind::LITERAL)) {
+        temporaries.push_back(entry);
+    }
+}
+
+// the size of the named entries of a table, which come before its temporaries
+static int namedSize(semantic::SymbolTable* table)
+{
+    int size = 0;
+
+    for (const auto& entry : *table) {
+        size += entry.second->size();
+    }
+
+    return size;
+}
+
+template<typename T>
+static T* findNode(ast::Node* node)
+{
+    if (auto found = dynamic_cast<T*>(node)) {
+        return found;
+    }
+
+    for (auto n = node->child(); n != nullptr; n = n->next()) {
+        if (auto found = findNode<T>(n)) {
+            return found;
+        }
+    }
+
+    return nullptr;
+}
+
+// temporaries are laid out after the named entries, and the ones of one statement never overlap
+static void requireSeparateSlots(const std::vector<semantic::SymbolTableEntry*>& temporaries,
+                                 semantic::SymbolTable* table)
+{
+    for (std::size_t i = 0; i < temporaries.size(); ++i) {
+        auto a = temporaries[i];
+        REQUIRE(a->size() > 0);
+        REQUIRE(a->offset() - a->size() >= namedSize(table));
+        REQUIRE(a->offset() <= table->size());
+
+        for (std::size_t j = i + 1; j < temporaries.size(); ++j) {
+            auto b = temporaries[j];
+            REQUIRE((a->offset() <= b->offset() - b->size() || b->offset() <= a->offset() - a->size()));
+        }
+    }
+}
+
+TEST_CASE("IR builder splits control flow into basic blocks", "[code]") {
+    ir::Program program;
+    auto astRoot = buildProgram(
+        "int f(int n) { if (n < 0) then { return (0); } else { }; return (n); };"
+        "program { int s; s = 0; for (int i = 0; i < 10; i = i + 1) { s = s + f(i); }; put(s); };",
+        program);
+
+    REQUIRE(program.functions().size() == 2);
+
+    auto f = program.function("f");
+    REQUIRE(f);
+    REQUIRE(!f->isProgram());
+    REQUIRE(f->returnSize() == 4);
+
+    // the block after the first return can't be reached and is dropped
+    REQUIRE(f->blocks().size() == 4);
+    REQUIRE(f->entry()->successors().size() == 2);
+
+    for (const auto& block : f->blocks()) {
+        REQUIRE(block->isTerminated());
+
+        if (block.get() != f->entry()) {
+            REQUIRE(!block->predecessors().empty());
+        }
+    }
+
+    auto main = program.function("program");
+    REQUIRE(main);
+    REQUIRE(main->isProgram());
+    REQUIRE(main->blocks().size() == 4);
+
+    // entry -> forcond <-> forbody, forcond -> endfor
+    auto cond = main->entry()->successors().front();
+    REQUIRE(cond->successors().size() == 2);
+    REQUIRE(cond->predecessors().size() == 2);
+    REQUIRE(cond->terminator()->op == ir::Opcode::BRANCH);
+
+    auto body = cond->successors()[0];
+    REQUIRE(body->successors().front() == cond);
+
+    auto end = cond->successors()[1];
+    REQUIRE(end->terminator()->op == ir::Opcode::HALT);
+}
+
+TEST_CASE("linear scan only spills under register pressure", "[code]") {
+    ir::Program program;
+    auto astRoot = buildProgram(
+        "program { int s; int t; s = 0; t = 1;"
+        "for (int i = 0; i < 10; i = i + 1) { s = s + i * t; t = t + s; }; put(s + t); };",
+        program);
+
+    auto main = program.function("program");
+    REQUIRE(main);
+
+    code::LinearScanAllocator enough({"r4", "r5", "r6", "r7", "r8", "r9", "r10", "r11", "r12"});
+    enough.allocate(*main);
+
+    // s, t, i and the expression temporaries all fit
+    REQUIRE(enough.slotCount() == 0);
+
+    code::LinearScanAllocator few({"r4", "r5"});
+    few.allocate(*main);
+
+    REQUIRE(few.slotCount() > 0);
+
+    for (const auto& block : main->blocks()) {
+        for (const auto& instruction : block->instructions()) {
+            for (auto v : instruction.uses()) {
+                REQUIRE((few.inRegister(v) || few.slot(v) >= 0));
+            }
+        }
+    }
+}
+
+TEST_CASE("constant propagation folds literals and prunes constant branches", "[code]") {
+    ir::Program program;
+    auto astRoot = buildProgram(
+        "program { int n; int k; n = 3 * 4 + 2; k = n - 10;"
+        "if (k > 3) then { put(k * 2); } else { put(0); }; put(n); };",
+        program);
+
+    auto main = program.function("program");
+    REQUIRE(main);
+
+    ir::ConstantPropagation propagation;
+    propagation.run(program);
+    ir::DeadCodeElimination().run(program);
+
+    REQUIRE(propagation.prunedBranches() == 1);
+
+    // only the writes of constants are left
+    std::vector<int> written;
+
+    for (const auto& block : main->blocks()) {
+        for (const auto& instruction : block->instructions()) {
+            REQUIRE(instruction.op != ir::Opcode::BRANCH);
+            REQUIRE(instruction.op != ir::Opcode::ADD);
+            REQUIRE(instruction.op != ir::Opcode::MUL);
+
+            if (instruction.op == ir::Opcode::WRITE) {
+                REQUIRE(instruction.a.isImmediate());
+                written.push_back(instruction.a.value);
+            }
+        }
+    }
+
+    REQUIRE(written == std::vector<int>({8, 14}));
+}
+
+TEST_CASE("constant propagation folds values beyond 16 bits and wraps around", "[code]") {
+    ir::Program program;
+    buildProgram(
+        "program { int n; int k; n = 40000 * 3; k = n * 20000;"
+        "if (n > 100000) then { put(n + 70000); } else { put(0); }; put(k); };",
+        program);
+
+    auto main = program.function("program");
+    REQUIRE(main);
+
+    ir::ConstantPropagation propagation;
+    propagation.run(program);
+    ir::DeadCodeElimination().run(program);
+
+    REQUIRE(propagation.prunedBranches() == 1);
+
+    std::vector<int> written;
+
+    for (const auto& block : main->blocks()) {
+        for (const auto& instruction : block->instructions()) {
+            REQUIRE(instruction.op != ir::Opcode::BRANCH);
+            REQUIRE(instruction.op != ir::Opcode::MUL);
+
+            if (instruction.op == ir::Opcode::WRITE) {
+                REQUIRE(instruction.a.isImmediate());
+                written.push_back(instruction.a.value);
+            }
+        }
+    }
+
+    // 120000 * 20000 wraps around like it does on the target
+    REQUIRE(written == std::vector<int>({190000, static_cast<int>(2400000000u)}));
+
+    code::MoonCode moonCode;
+    code::MoonBackend(moonCode).emit(program);
+
+    std::istringstream input;
+    std::ostringstream output;
+    vm::Machine machine(vm::Assembler().assemble(moonCode), input, output);
+    machine.run();
+
+    REQUIRE(output.str() == "190000\r\n-1894967296\r\n");
+}
+
+TEST_CASE("array addressing folds constant indices and steps a pointer in loops", "[code]") {
+    ir::Program program;
+    auto astRoot = buildProgram(
+        "program { int a[10]; int s; s = 0; a[3] = 7;"
+        "for (int i = 0; i < 10; i = i + 1) { s = s + a[i]; }; put(s); };",
+        program);
+
+    auto main = program.function("program");
+    REQUIRE(main);
+
+    ir::ConstantPropagation().run(program);
+    ir::StrengthReduction reduction;
+    reduction.run(program);
+    ir::ConstantPropagation().run(program);
+    ir::AddressFolding().run(program);
+    ir::DeadCodeElimination().run(program);
+
+    REQUIRE(reduction.reduced() == 1);
+
+    bool constantStore = false;
+
+    for (const auto& block : main->blocks()) {
+        for (const auto& instruction : block->instructions()) {
+            // a[3] is a fixed frame location, a[i] a pointer moved by 4 each iteration
+            REQUIRE(instruction.op != ir::Opcode::MUL);
+
+            if (instruction.op == ir::Opcode::STORE && instruction.a == ir::Operand::imm(7)) {
+                REQUIRE(instruction.address.base == ir::Address::Base::FRAME);
+                constantStore = true;
+            }
+        }
+    }
+
+    REQUIRE(constantStore);
+}
+
+TEST_CASE("inliner replaces calls to small leaf functions", "[code]") {
+    ir::Program program;
+    auto astRoot = buildProgram(
+        "int add(int a, int b) { return (a + b); };"
+        "int twice(int a) { return (add(a, a)); };"
+        "int show(int a) { put(a); return (a); };"
+        "program { int x; x = twice(3); x = show(x); };",
+        program);
+
+    ir::Inliner inliner;
+    inliner.run(program);
+
+    // add goes into twice, which then has no calls left and goes into the program; show writes to the console
+    REQUIRE(inliner.inlined() == 2);
+
+    std::vector<std::string> calls;
+
+    for (const auto& block : program.function("program")->blocks()) {
+        REQUIRE(block->isTerminated());
+
+        for (const auto& instruction : block->instructions()) {
+            if (instruction.op == ir::Opcode::CALL) {
+                calls.push_back(instruction.callee);
+            }
+        }
+    }
+
+    REQUIRE(calls == std::vector<std::string>({"show"}));
+}
+
+TEST_CASE("tail calls become jumps", "[code]") {
+    ir::Program program;
+    auto astRoot = buildProgram(
+        "int factorial(int n) { if (n == 0) then return (1); else return (n * factorial(n - 1));; };"
+        "int odd(int n) { if (n == 0) then return (0); else return (factorial(n - 1));; };"
+        "program { put(odd(5)); };",
+        program);
+
+    ir::TailCallElimination tailCalls;
+    tailCalls.run(program);
+
+    // factorial multiplies an accumulator in a loop, odd leaves its frame to factorial
+    REQUIRE(tailCalls.loops() == 1);
+    REQUIRE(tailCalls.tailCalls() == 1);
+
+    for (const auto& block : program.function("factorial")->blocks()) {
+        for (const auto& instruction : block->instructions()) {
+            REQUIRE(instruction.op != ir::Opcode::CALL);
+        }
+    }
+
+    auto terminator = program.function("odd")->blocks().back()->terminator();
+    REQUIRE(terminator->op == ir::Opcode::TAILCALL);
+    REQUIRE(terminator->callee == "factorial");
+}
+
+TEST_CASE("functions unreachable from the program are removed", "[code]") {
+    ir::Program program;
+    auto astRoot = buildProgram(
+        "class Shape { int area(); int scale(int k); };"
+        "class Unused { int nothing(); };"
+        "int Shape::area() { return (scale(2)); };"
+        "int Shape::scale(int k) { return (k); };"
+        "int Unused::nothing() { return (helper()); };"
+        "int helper() { return (1); };"
+        "program { Shape s; put(s.area()); };",
+        program);
+
+    ir::DeadFunctionElimination dead;
+    dead.run(program);
+
+    REQUIRE(dead.removed() == 2);
+
+    std::vector<std::string> labels;
+
+    for (const auto& function : program.functions()) {
+        labels.push_back(function->label());
+    }
+
+    REQUIRE(labels == std::vector<std::string>({"Shapearea", "Shapescale", "program"}));
+}
+
+TEST_CASE("conditions short-circuit and and or", "[code]") {
+    ir::Program program;
+    auto astRoot = buildProgram(
+        "int f() { put(1); return (1); };"
+        "program { int a; get(a); if (a and f()) then put(2); else;; if (a or f()) then put(3); else;; };",
+        program);
+
+    auto function = program.function("program");
+
+    // f is only called on the path where a doesn't decide the outcome
+    for (const auto& instruction : function->entry()->instructions()) {
+        REQUIRE(instruction.op != ir::Opcode::CALL);
+        REQUIRE(instruction.op != ir::Opcode::AND);
+    }
+
+    unsigned int calls = 0;
+
+    for (const auto& block : function->blocks()) {
+        for (const auto& instruction : block->instructions()) {
+            REQUIRE(instruction.op != ir::Opcode::OR);
+
+            if (instruction.op == ir::Opcode::CALL) {
+                ++calls;
+                REQUIRE(block->predecessors().size() == 1);
+            }
+        }
+    }
+
+    REQUIRE(calls == 2);
+}
+
+TEST_CASE("scalar parameters and results are passed in registers", "[code]") {
+    ir::Program program;
+    auto astRoot = buildProgram(
+        "class P { int x; };"
+        "int f(int a, P p, int b) { return (a + p.x + b); };"
+        "program { P p; put(f(1, p, 2)); };",
+        program);
+
+    ir::RegisterCallingConvention convention;
+    convention.run(program);
+
+    REQUIRE(convention.parameters() == 2);
+    REQUIRE(convention.results() == 1);
+
+    // the object still goes through the frame
+    const auto& entry = program.function("f")->entry()->instructions();
+    REQUIRE(entry[0].op == ir::Opcode::PARAM);
+    REQUIRE(entry[1].op == ir::Opcode::PARAM);
+    REQUIRE(program.function("f")->blocks().back()->terminator()->a.isRegister());
+
+    for (const auto& instruction : program.function("program")->entry()->instructions()) {
+        if (instruction.op == ir::Opcode::CALL) {
+            REQUIRE(instruction.arguments == std::vector<ir::Operand>({ir::Operand::imm(1), ir::Operand::imm(2)}));
+            REQUIRE(instruction.dst.isRegister());
+        }
+
+        if (instruction.op == ir::Opcode::STORE) {
+            REQUIRE(instruction.address.base == ir::Address::Base::OUTGOING);
+            REQUIRE(instruction.a.isRegister());
+        }
+    }
+}
+
+TEST_CASE("peephole optimizer rewrites within its window", "[code]") {
+    std::istringstream input(
+        "               sw -8(r14),r3\n"
+        "               lw r1,-8(r14)\n"
+        "               add r2,r1,r4\n"
+        "               addi r1,r0,6\n"
+        "               muli r5,r1,7\n"
+        "               addi r1,r0,0\n"
+        "               addi r14,r14,-12\n"
+        "               sw -4(r14),r5\n"
+        "               subi r14,r14,-12\n"
+        " loop          addi r14,r14,12\n"
+        "               j end\n"
+        " end           hlt\n");
+
+    auto code = code::MoonCode::parse(input);
+
+    code::PeepholeOptimizer peephole(4);
+    peephole.optimize(code);
+
+    std::ostringstream output;
+    code.printText(output);
+
+    REQUIRE(output.str() ==
+        "               sw -8(r14),r3\n"
+        "               add r2,r3,r4\n"
+        "               addi r5,r0,42\n"
+        "               addi r1,r0,0\n"
+        "               sw -16(r14),r5\n"
+        " loop          addi r14,r14,12\n"
+        " end           hlt\n");
+
+    REQUIRE(peephole.hits().at("redundant load") == 1);
+    REQUIRE(peephole.hits().at("copy propagation") == 1);
+    REQUIRE(peephole.hits().at("immediate fold") == 1);
+    REQUIRE(peephole.hits().at("stack adjustment") == 1);
+    REQUIRE(peephole.hits().at("jump to next") == 1);
+
+    // with no window, nothing changes
+    std::istringstream again("               addi r1,r0,6\n               muli r5,r1,7\n");
+    auto unchanged = code::MoonCode::parse(again);
+    code::PeepholeOptimizer disabled(0);
+    disabled.optimize(unchanged);
+
+    REQUIRE(unchanged.text().size() == 2);
+}
+
+TEST_CASE("generated code runs on the vm", "[code]") {
+    ir::Program program;
+    auto astRoot = buildProgram(
+        "int fact(int n) { if (n < 2) then { return (1); } else { }; return (n * fact(n - 1)); };"
+        "int sum(int n) { int s; s = 0; for (int i = 1; i <= n; i = i + 1) { s = s + i; }; return (s); };"
+        "program { int n; get(n); put(fact(n)); put(sum(n)); put(n / 2 - 7); };",
+        program);
+
+    ir::Inliner().run(program);
+    ir::TailCallElimination().run(program);
+    ir::ConstantPropagation().run(program);
+    ir::DeadCodeElimination().run(program);
+    ir::RegisterCallingConvention().run(program);
+
+    code::MoonCode moonCode;
+    code::MoonBackend(moonCode).emit(program);
+    code::PeepholeOptimizer(4).optimize(moonCode);
+
+    std::stringstream text;
+    moonCode.printText(text);
+    moonCode.printData(text);
+
+    std::istringstream input("6\n");
+    std::ostringstream output;
+    vm::Machine machine(vm::Assembler().assemble(text), input, output);
+    machine.run();
+
+    REQUIRE(output.str() == "720\r\n21\r\n-4\r\n");
+    REQUIRE(machine.steps() > 0);
+
+    // assembled in memory, as the driver does in run mode
+    std::istringstream directInput("6\n");
+    std::ostringstream directOutput;
+    vm::Machine direct(vm::Assembler().assemble(moonCode), directInput, directOutput);
+    direct.run();
+
+    REQUIRE(directOutput.str() == output.str());
+    REQUIRE(direct.steps() == machine.steps());
+}
+
+TEST_CASE("arrays of objects are indexed by the size of their class", "[code]") {
+    ir::Program program;
+    auto astRoot = buildProgram(
+        "class Point { int x; int y; };"
+        "class Poly { int n; Point v[4]; };"
+        "program { Point ps[3]; Poly p; int k; get(k);"
+        "  ps[k].x = 5; ps[k].y = 6; ps[k + 1].x = 7;"
+        "  for (int i = 0; i < 4; i = i + 1) { p.v[i].x = i * 10; p.v[i].y = i + 1; };"
+        "  p.n = 4;"
+        "  put(ps[1].x); put(ps[1].y); put(ps[2].x); put(p.v[k].x + p.v[3].y); put(p.n); };",
+        program);
+
+    // the whole array is reserved, not one object
+    REQUIRE((*(*astRoot->symbolTable())["program"]->link())["ps"]->size() == 24);
+
+    ir::ConstantPropagation().run(program);
+    ir::DeadCodeElimination().run(program);
+
+    code::MoonCode moonCode;
+    code::MoonBackend(moonCode).emit(program);
+
+    std::istringstream input("1\n");
+    std::ostringstream output;
+    vm::Machine machine(vm::Assembler().assemble(moonCode), input, output);
+    machine.run();
+
+    REQUIRE(output.str() == "5\r\n6\r\n7\r\n14\r\n4\r\n");
+}
+
+TEST_CASE("temporaries share frame slots between statements but not within one", "[code]") {
+    ir::Program program;
+    auto astRoot = buildProgram(
+        "program { int a; int b; int c; int x; int y;"
+        "  a = 1; b = 2; c = 3;"
+        "  x = (a + b) * (b + c);"
+        "  y = -a;"
+        "  c = not b; };",
+        program);
+
+    auto table = (*astRoot->symbolTable())["program"]->link();
+    std::vector<std::vector<semantic::SymbolTableEntry*>> statements;
+    int total = 0;
+    int largest = 0;
+
+    for (auto n = astRoot->child(2)->child(); n != nullptr; n = n->next()) {
+        std::vector<semantic::SymbolTableEntry*> temporaries;
+        collectTemporaries(n, table, temporaries);
+
+        if (temporaries.empty()) {
+            continue;
+        }
+
+        requireSeparateSlots(temporaries, table);
+
+        int size = 0;
+
+        for (auto t : temporaries) {
+            size += t->size();
+        }
+
+        total += size;
+        largest = std::max(largest, size);
+        statements.push_back(temporaries);
+    }
+
+    // three literals, the expression, the sign and the not
+    REQUIRE(statements.size() == 6);
+    REQUIRE(statements[3].size() >= 3);
+
+    // the area is as big as the statement needing the most, each one starting over at its bottom
+    REQUIRE(table->size() - namedSize(table) == largest);
+    REQUIRE(largest < total);
+
+    auto bottom = namedSize(table) + statements[0].front()->size();
+
+    for (const auto& temporaries : statements) {
+        REQUIRE(temporaries.front()->offset() == bottom);
+    }
+}
+
+TEST_CASE("temporaries of a for statement are laid out in its own table", "[code]") {
+    ir::Program program;
+    auto astRoot = buildProgram(
+        "int f(int n) { int s; s = 0;"
+        "  for (int i = 0; i < n; i = i + 1) {"
+        "    for (int j = 0; j < i; j = j + 1) { s = s + (i * 2) * (j + 3); };"
+        "  };"
+        "  return (s); };"
+        "program { int s; s = f(4); put(s); };",
+        program);
+
+    auto outer = findNode<ast::forStat>(astRoot.get());
+    REQUIRE(outer);
+    auto inner = findNode<ast::forStat>(outer->child(5));
+    REQUIRE(inner);
+
+    auto function = (*astRoot->symbolTable())["f"]->link();
+    auto outerTable = outer->symbolTable();
+    auto innerTable = inner->symbolTable();
+    REQUIRE(outerTable != function);
+    REQUIRE(innerTable != outerTable);
+
+    std::vector<semantic::SymbolTableEntry*> functionTemporaries;
+    collectTemporaries(astRoot.get(), function, functionTemporaries);
+
+    std::vector<semantic::SymbolTableEntry*> outerTemporaries;
+    collectTemporaries(outer, outerTable, outerTemporaries);
+
+    std::vector<semantic::SymbolTableEntry*> innerTemporaries;
+    collectTemporaries(inner, innerTable, innerTemporaries);
+
+    // the nested statement's temporaries are not counted in the tables around it
+    REQUIRE(!innerTemporaries.empty());
+    REQUIRE(!outerTemporaries.empty());
+
+    for (auto t : innerTemporaries) {
+        REQUIRE(t->offset() > namedSize(innerTable));
+        REQUIRE(t->offset() <= innerTable->size());
+    }
+
+    for (auto t : outerTemporaries) {
+        REQUIRE(t->offset() > namedSize(outerTable));
+        REQUIRE(t->offset() <= outerTable->size());
+    }
+
+    REQUIRE(inner->symbolTableEntry()->size() == innerTable->size());
+    REQUIRE(outer->symbolTableEntry()->size() == outerTable->size());
+
+    // the body is one statement, whose temporaries are alive together
+    std::vector<semantic::SymbolTableEntry*> body;
+    collectTemporaries(inner->child(5), innerTable, body);
+    REQUIRE(body.size() >= 4);
+    requireSeparateSlots(body, innerTable);
+
+    ir::ConstantPropagation().run(program);
+    ir::DeadCodeElimination().run(program);
+
+    code::MoonCode moonCode;
+    code::MoonBackend(moonCode).emit(program);
+
+    std::istringstream input;
+    std::ostringstream output;
+    vm::Machine machine(vm::Assembler().assemble(moonCode), input, output);
+    machine.run();
+
+    // sum over 0 <= j < i < 4 of 2i(j + 3)
+    REQUIRE(output.str() == "106\r\n");
+}
+
+TEST_CASE("values and offsets beyond 16 bits are built up in registers", "[code]") {
+    const char* source =
+        "int far(int n) { int pad[9000]; int m; m = n + 50000; pad[8999] = m; return (pad[8999] * 2); };"
+        "program { int a[10000]; int k; int x; int y;"
+        "  get(k);"
+        "  x = 100000; y = k * 300000 + 123456; a[9999] = y - 1;"
+        "  put(a[9999]); put(x + 40000); put(-70000 - k); put(far(k)); put(y / 65536); };";
+
+    std::string expected = "30123455\r\n140000\r\n-70100\r\n100200\r\n459\r\n";
+
+    for (auto optimize : {false, true}) {
+        ir::Program program;
+        auto astRoot = buildProgram(source, program);
+
+        if (optimize) {
+            ir::ConstantPropagation().run(program);
+            ir::DeadCodeElimination().run(program);
+        }
+
+        code::MoonCode moonCode;
+        code::MoonBackend(moonCode).emit(program);
+
+        // the assembler rejects immediates that don't fit
+        std::istringstream input("100\n");
+        std::ostringstream output;
+        vm::Machine machine(vm::Assembler().assemble(moonCode), input, output);
+        machine.run();
+
+        REQUIRE(output.str() == expected);
+    }
+}
+
+TEST_CASE("a compiler compiles one program after the other", "[code]") {
+    const char* source =
+        "int sum(int n) { int s; s = 0; for (int i = 1; i <= n; i = i + 1) { s = s + i; }; return (s); };"
+        "program { int n; get(n); put(sum(n)); };";
+
+    Compiler compiler;
+    Compiler::Options options;
+    std::ostringstream first, second, broken;
+    Compiler::Outputs outputs;
+
+    std::istringstream firstSource(source);
+    outputs.program = &first;
+    auto result = compiler.compile(firstSource, options, outputs);
+    REQUIRE(result.generated);
+
+    // what is left of a program with errors doesn't get into the next one
+    std::istringstream brokenSource("program { int n; n = m; };");
+    outputs.program = &broken;
+    REQUIRE(compiler.compile(brokenSource, options, outputs).diagnostics.size() == 1);
+
+    std::istringstream secondSource(source);
+    outputs.program = &second;
+    REQUIRE(compiler.compile(secondSource, options, outputs).diagnostics.empty());
+    REQUIRE(second.str() == first.str());
+
+    std::istringstream input("10\n");
+    std::ostringstream output;
+    vm::Machine machine(vm::Assembler().assemble(result.code), input, output);
+    machine.run();
+
+    REQUIRE(output.str() == "55\r\n");
+}
+
+TEST_CASE("functions are generated again only when their IR changes", "[code]") {
+    const char* before =
+        "int twice(int n) { return (n + n); };"
+        "int sum(int n) { int s; s = 0; for (int i = 1; i <= n; i = i + 1) { s = s + i; }; return (s); };"
+        "program { int n; get(n); put(sum(n)); put(twice(n)); };";
+    const char* after =
+        "int twice(int n) { return (n + n); };"
+        "int sum(int n) { int s; s = 1; for (int i = 1; i <= n; i = i + 1) { s = s + i; }; return (s); };"
+        "program { int n; get(n); put(sum(n)); put(twice(n)); };";
+
+    char directory[] = "/tmp/moonshine-objects-XXXXXX";
+    REQUIRE(::mkdtemp(directory) != nullptr);
+
+    Compiler compiler;
+    Cache cache(directory, 1 << 20);
+    Compiler::Options options;
+    Compiler::Outputs outputs;
+
+    // no inlining, so that an edit stays in its function
+    options.inlineSize = 0;
+
+    auto compile = [&](const char* source, Cache* objectCache, std::vector<std::uint64_t>& counts) {
+        std::istringstream input(source);
+        std::ostringstream program;
+        Statistics stats;
+        options.objectCache = objectCache;
+        outputs.program = &program;
+        REQUIRE(compiler.compile(input, options, outputs, &stats).generated);
+
+        counts.clear();
+        for (const auto& c : stats.counts()) {
+            if (c.first == "functions reused" || c.first == "functions generated") {
+                counts.push_back(c.second);
+            }
+        }
+
+        return program.str();
+    };
+
+    std::vector<std::uint64_t> counts;
+    auto whole = compile(before, nullptr, counts);
+    REQUIRE(counts.empty());
+
+    REQUIRE(compile(before, &cache, counts) == whole);
+    REQUIRE((counts == std::vector<std::uint64_t>{0, 3}));
+
+    REQUIRE(compile(before, &cache, counts) == whole);
+    REQUIRE((counts == std::vector<std::uint64_t>{3, 0}));
+
+    // sum changed, twice and the program didn't
+    auto edited = compile(after, &cache, counts);
+    REQUIRE((counts == std::vector<std::uint64_t>{2, 1}));
+    REQUIRE(edited == compile(after, nullptr, counts));
+
+    std::system(("rm -rf " + std::string(directory)).c_str());
+}
+
+TEST_CASE("generated x86-64 code runs natively", "[code]") {
+    ir::Program program;
+    auto astRoot = buildProgram(
+        "class P { int x; int y[3]; };"
+        "int fact(int n) { if (n < 2) then { return (1); } else { }; return (n * fact(n - 1)); };"
+        "int area(P p) { return (p.x * p.y[2]); };"
+        "program { int n; P p; get(n); p.x = n; p.y[2] = 7; put(fact(n)); put(area(p)); put(n / 2 - 7); };",
+        program);
+
+    ir::Inliner().run(program);
+    ir::TailCallElimination().run(program);
+    ir::ConstantPropagation().run(program);
+    ir::DeadCodeElimination().run(program);
+    ir::RegisterCallingConvention().run(program);
+
+    std::ostringstream text;
+    code::X86Backend(text).emit(program);
+    REQUIRE(text.str().find("moon_main:") != std::string::npos);
+
+#if defined(__x86_64__) && defined(__linux__)
+    if (std::system("cc --version > /dev/null 2>&1") != 0) {
+        WARN("no C compiler to link the program with");
+        return;
+    }
+
+    std::ofstream("x86_test.s") << text.str();
+    REQUIRE(std::system("cc -o x86_test x86_test.s moon_runtime.c") == 0);
+    REQUIRE(std::system("echo 6 | ./x86_test > x86_test.txt") == 0);
+
+    std::ifstream result("x86_test.txt");
+    std::stringstream output;
+    output << result.rdbuf();
+
+    REQUIRE(output.str() == "720\n42\n-4\n");
+#endif
+}
@@ -0,0 +1,108 @@
+#include <catch/catch.hpp>
+
+#include <moonshine/CommandLine.h>
+
+#include <string>
+#include <vector>
+
+using namespace moonshine;
+
+TEST_CASE("artifacts are written to their default path or the one given", "[command line]") {
+    CommandLine commandLine;
+
+    REQUIRE(commandLine.parse({"--ir", "--native=out.s", "--tokens=-", "program.txt"}));
+    REQUIRE(commandLine.error.empty());
+
+    REQUIRE(commandLine.ir.enabled);
+    REQUIRE(commandLine.ir.path == "program.ir");
+    REQUIRE(commandLine.native.enabled);
+    REQUIRE(commandLine.native.path == "out.s");
+    REQUIRE(commandLine.tokens.enabled);
+    REQUIRE(commandLine.tokens.path == "-");
+
+    REQUIRE_FALSE(commandLine.ast.enabled);
+    REQUIRE_FALSE(commandLine.program.enabled);
+    REQUIRE(commandLine.input == "program.txt");
+
+    CommandLine output;
+    REQUIRE(output.parse({"-o", "a.m", "-"}));
+    REQUIRE(output.program.enabled);
+    REQUIRE(output.program.path == "a.m");
+    REQUIRE(output.input == "-");
+
+    CommandLine longOutput;
+    REQUIRE(longOutput.parse({"--output=-"}));
+    REQUIRE(longOutput.program.path == "-");
+}
+
+TEST_CASE("all enables every artifact but the program", "[command line]") {
+    CommandLine commandLine;
+
+    REQUIRE(commandLine.parse({"--ast=tree.dot", "--all"}));
+
+    for (auto artifact : commandLine.artifacts()) {
+        REQUIRE(artifact->enabled);
+    }
+
+    // a path given before is kept
+    REQUIRE(commandLine.ast.path == "tree.dot");
+    REQUIRE(commandLine.table.path == "table.txt");
+    REQUIRE_FALSE(commandLine.program.enabled);
+}
+
+TEST_CASE("numeric options take counts", "[command line]") {
+    CommandLine commandLine;
+
+    REQUIRE(commandLine.parse({"--threads=4", "--inline=0", "--peephole-window=32", "--cache-size=128"}));
+    REQUIRE(commandLine.options.checkThreads == 4);
+    REQUIRE(commandLine.options.inlineSize == 0);
+    REQUIRE(commandLine.options.peepholeWindow == 32);
+    REQUIRE(commandLine.cacheSize == 128);
+
+    CommandLine defaults;
+    REQUIRE(defaults.parse({}));
+    REQUIRE(defaults.options.checkThreads == 0);
+    REQUIRE(defaults.options.inlineSize == 16);
+    REQUIRE(defaults.options.peepholeWindow == 8);
+
+    // threads without a count is one per core
+    CommandLine threads;
+
+    if (threads.parse({"--threads"})) {
+        REQUIRE(threads.options.checkThreads > 0);
+    }
+
+    // what a server gets back parses to the same options
+    CommandLine request;
+    REQUIRE(request.parse(commandLine.requestArguments()));
+    REQUIRE(request.options.checkThreads == 4);
+    REQUIRE(request.options.inlineSize == 0);
+    REQUIRE(request.options.peepholeWindow == 32);
+}
+
+TEST_CASE("malformed numbers and unknown options are rejected", "[command line]") {
+    std::vector<std::string> invalid = {
+        "--threads=four", "--threads=4x", "--threads=-1", "--threads= 4", "--inline=", "--inline",
+        "--peephole-window=+8", "--peephole-window=99999999999", "--cache-size=1.5",
+        "--bogus", "-x", "--ir-file", "--run=yes", "--stack-code=1", "-o", "--output=", "--connect",
+    };
+
+    for (const auto& arg : invalid) {
+        CommandLine commandLine;
+        INFO(arg);
+        REQUIRE_FALSE(commandLine.parse({arg}));
+        REQUIRE(commandLine.error == arg);
+    }
+
+    // parsing stops at the first invalid option
+    CommandLine commandLine;
+    REQUIRE_FALSE(commandLine.parse({"--ir", "--inline=x", "--ast"}));
+    REQUIRE(commandLine.error == "--inline=x");
+    REQUIRE(commandLine.ir.enabled);
+    REQUIRE_FALSE(commandLine.ast.enabled);
+
+    // only one input
+    CommandLine inputs;
+    REQUIRE_FALSE(inputs.parse({"a.txt", "b.txt"}));
+    REQUIRE(inputs.error == "b.txt");
+}
@@ -1,14 +1,26 @@
 #include <catch/catch.hpp>
 
+#include <moonshine/Compiler.h>
 #include <moonshine/lexer/Lexer.h>
 #include <moonshine/syntax/Parser.h>
 #include <moonshine/semantic/SymbolTable.h>
+#include <moonshine/semantic/SymbolArena.h>
 #include <moonshine/semantic/SymbolTableCreatorVisitor.h>
 #include <moonshine/semantic/SymbolTableLinkerVisitor.h>
 #include <moonshine/semantic/TypeCheckerVisitor.h>
+#include <moonshine/semantic/SymbolTableClassDeclLinkerVisitor.h>
+#include <moonshine/semantic/InheritanceResolverVisitor.h>
+#include <moonshine/semantic/ShadowedSymbolCheckerVisitor.h>
+#include <moonshine/semantic/ParallelFunctionChecker.h>
 
 #include <sstream>
 #include <memory>
+#include <algorithm>
+#include <limits>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
 
 using namespace moonshine;
 
@@ -32,18 +44,239 @@ TEST_CASE(INPUT, "[syntax]") { \
 
 #define REQUIRE_FUNCTION(NAME, X) \
 { \
-    std::shared_ptr<semantic::SymbolTableEntry> entry = (*table)[#NAME]; \
+    semantic::SymbolTableEntry* entry = (*table)[#NAME]; \
     REQUIRE(entry); \
     REQUIRE(entry->kind() == semantic::SymbolTableEntryKind::FUNCTION); \
-    std::shared_ptr<semantic::SymbolTable> table = entry->link(); \
+    semantic::SymbolTable* table = entry->link(); \
     REQUIRE(table); \
     X \
 }
 
 #define REQUIRE_ENTRY(NAME) \
 { \
-    std::shared_ptr<semantic::SymbolTableEntry> entry = (*table)[#NAME]; \
+    semantic::SymbolTableEntry* entry = (*table)[#NAME]; \
     REQUIRE(entry); \
-    std::shared_ptr<semantic::SymbolTable> table = entry->link(); \
+    semantic::SymbolTable* table = entry->link(); \
     REQUIRE(table); \
 }
+
+// runs the semantic checks, the function bodies on the given number of threads or serially for 0
+static std::unique_ptr<ast::Node> checkProgram(const char* input, const unsigned int& threads,
+                                               std::vector<semantic::SemanticError>& errors)
+{
+    Lexer lex;
+    syntax::Grammar grammar("grammar.txt",  "table.json", "first.txt", "follow.txt");
+
+    std::istringstream stream(input);
+    lex.startLexing(&stream, nullptr);
+    syntax::Parser parser(grammar);
+
+    std::unique_ptr<ast::Node> astRoot = parser.parse(&lex, nullptr);
+    REQUIRE(astRoot != nullptr);
+
+    std::vector<std::unique_ptr<Visitor>> visitors;
+    visitors.emplace_back(new semantic::SymbolTableCreatorVisitor());
+    visitors.emplace_back(new semantic::SymbolTableClassDeclLinkerVisitor());
+    visitors.emplace_back(new semantic::SymbolTableLinkerVisitor());
+    visitors.emplace_back(new semantic::InheritanceResolverVisitor());
+
+    if (threads == 0) {
+        visitors.emplace_back(new semantic::ShadowedSymbolCheckerVisitor());
+        visitors.emplace_back(new semantic::TypeCheckerVisitor());
+    }
+
+    for (auto& v : visitors) {
+        v->setErrorContainer(&errors);
+        astRoot->accept(v.get());
+    }
+
+    if (threads > 0) {
+        semantic::ParallelFunctionChecker checker(threads);
+        checker.addVisitor([]() { return std::unique_ptr<Visitor>(new semantic::ShadowedSymbolCheckerVisitor()); });
+        checker.addVisitor([]() { return std::unique_ptr<Visitor>(new semantic::TypeCheckerVisitor()); });
+        checker.check(astRoot.get(), errors);
+    }
+
+    return astRoot;
+}
+
+static std::vector<std::pair<semantic::SemanticErrorType, unsigned int>> checkFunctions(const char* input, const unsigned int& threads)
+{
+    std::vector<semantic::SemanticError> errors;
+    checkProgram(input, threads, errors);
+
+    std::vector<std::pair<semantic::SemanticErrorType, unsigned int>> result;
+    for (const auto& e : errors) {
+        result.emplace_back(e.type, e.token ? e.token->position : 0);
+    }
+
+    return result;
+}
+
+TEST_CASE("parallel function checking reports the same errors as serial checking", "[semantic]") {
+    const char* input =
+        "class A { int x; B b; int f(int i); };"
+        "int A::f(int i) { int x; return (i + x); };"
+        "int g(int a) { float b; b = a; return (b); };"
+        "int h(int a) { for (int a = 0; a < 3; a = a + 1) { a = c; }; return (a); };"
+        "program { A a; int i; i = a.f(1) + g(2) + h(3); i = nope(); };";
+
+    // in the order in which the checks find them, which doesn't depend on the number of threads
+    auto serial = checkFunctions(input, 0);
+
+    REQUIRE(!serial.empty());
+    REQUIRE(checkFunctions(input, 1) == serial);
+    REQUIRE(checkFunctions(input, 4) == serial);
+
+    // the compiler reports them in source order either way
+    Compiler compiler;
+    Compiler::Outputs outputs;
+    Compiler::Options options;
+    std::vector<std::vector<Error>> diagnostics;
+
+    for (auto threads : {0u, 1u, 4u}) {
+        std::istringstream source(input);
+        options.checkThreads = threads;
+        diagnostics.push_back(compiler.compile(source, options, outputs).diagnostics);
+    }
+
+    REQUIRE(diagnostics[0].size() == serial.size());
+
+    for (std::size_t i = 1; i < diagnostics[0].size(); ++i) {
+        REQUIRE(diagnostics[0][i - 1].position <= diagnostics[0][i].position);
+    }
+
+    for (const auto& d : diagnostics) {
+        REQUIRE(d.size() == diagnostics[0].size());
+
+        for (std::size_t i = 0; i < d.size(); ++i) {
+            REQUIRE(d[i].position == diagnostics[0][i].position);
+            REQUIRE(d[i].message == diagnostics[0][i].message);
+        }
+    }
+}
+
+TEST_CASE("type context interns equal types to the same instance", "[semantic]") {
+    semantic::TypeContext types;
+
+    REQUIRE(types.get(semantic::Type::INT) == types.get(semantic::Type::INT, "", {}));
+    REQUIRE(types.get(semantic::Type::CLASS, "A", {2, 3}) == types.get(semantic::Type::CLASS, "A", {2, 3}));
+    REQUIRE(types.get(semantic::Type::CLASS, "A", {2, 3}) != types.get(semantic::Type::CLASS, "B", {2, 3}));
+    REQUIRE(types.get(semantic::Type::INT, "", {2}) != types.get(semantic::Type::INT));
+
+    semantic::FunctionType declaration;
+    declaration.returnType = types.get(semantic::Type::INT);
+    declaration.parameterTypes.push_back(types.get(semantic::Type::FLOAT));
+
+    semantic::FunctionType definition = declaration;
+    definition.scope = "A";
+
+    REQUIRE(types.intern(declaration) == types.intern(declaration));
+    REQUIRE(types.intern(declaration) != types.intern(definition));
+    REQUIRE(types.intern(declaration)->hasSameSignature(*types.intern(definition)));
+}
+
+TEST_CASE("each program owns its types", "[semantic]") {
+    const char* input =
+        "class A { int x; float y[2]; };"
+        "int f(A a) { return (a.x); };"
+        "program { A a; int i; i = f(a); };";
+
+    std::vector<semantic::SemanticError> errors;
+    auto first = checkProgram(input, 0, errors);
+    auto second = checkProgram(input, 0, errors);
+    REQUIRE(errors.empty());
+
+    auto& firstTypes = first->symbolTable()->arena().types();
+    auto& secondTypes = second->symbolTable()->arena().types();
+    REQUIRE(&firstTypes != &secondTypes);
+
+    auto firstA = (*(*first->symbolTable())["program"]->link())["a"];
+    auto secondA = (*(*second->symbolTable())["program"]->link())["a"];
+
+    // equal types of different programs are not shared, so nothing outlives the program
+    REQUIRE(firstA->type() == firstTypes.get(semantic::Type::CLASS, "A", {}));
+    REQUIRE(secondA->type() == secondTypes.get(semantic::Type::CLASS, "A", {}));
+    REQUIRE(firstA->type() != secondA->type());
+
+    auto x = (*(*first->symbolTable())["A"]->link())["x"];
+    REQUIRE(x->type() == firstTypes.get(semantic::Type::INT));
+}
+
+TEST_CASE("symbol arena addresses tables and entries by handle", "[semantic]") {
+    semantic::SymbolArena arena;
+
+    auto table = arena.createTable();
+    auto first = arena.createEntry();
+    first->setName("a");
+    table->addEntry(first);
+
+    // creating more entries must not move the ones we already have
+    for (int i = 0; i < 1000; ++i) {
+        arena.createEntry();
+    }
+
+    REQUIRE(&table->arena() == &arena);
+    REQUIRE(arena.entryCount() == 1001);
+    REQUIRE(arena.entry(first->handle()) == first);
+    REQUIRE(arena.table(table->handle()) == table);
+    REQUIRE((*table)["a"] == first);
+    REQUIRE(first->parentTable() == table);
+
+    // entries made for a scope fill chunks of their own, and every handle still names one entry
+    auto other = arena.createTable();
+    std::vector<semantic::SymbolTableEntry*> entries;
+
+    for (unsigned int i = 0; i < 3 * semantic::SymbolArena::CHUNK_SIZE; ++i) {
+        entries.push_back(i % 3 == 0 ? arena.createEntry() : i % 3 == 1 ? table->createEntry() : other->createEntry());
+    }
+
+    table->addTemporary(entries[1]);
+
+    REQUIRE(arena.entryCount() == 1001 + entries.size());
+    REQUIRE(table->temporaries().front() == entries[1]);
+    REQUIRE(entries[1]->parentTable() == table);
+
+    std::set<semantic::SymbolArena::handle_type> handles;
+
+    for (auto entry : entries) {
+        REQUIRE(handles.insert(entry->handle()).second);
+        REQUIRE(arena.entry(entry->handle()) == entry);
+    }
+
+    REQUIRE(arena.entry(first->handle()) == first);
+
+    // the entries of one table are contiguous within a chunk
+    REQUIRE(entries[4] == entries[1] + 1);
+    REQUIRE_THROWS_AS(arena.entry(std::numeric_limits<semantic::SymbolArena::handle_type>::max()), const std::out_of_range&);
+}
+
+TEST_CASE("symbol tables iterate in declaration order", "[semantic]") {
+    semantic::SymbolArena arena;
+    auto table = arena.createTable();
+    std::vector<std::string> names = {"zeta", "alpha", "mid", "beta", "omega"};
+
+    for (const auto& name : names) {
+        auto entry = arena.createEntry();
+        entry->setName(name);
+        table->addEntry(entry);
+    }
+
+    // re-adding an existing name keeps its place
+    auto replacement = arena.createEntry();
+    replacement->setName("alpha");
+    table->addEntry(replacement);
+
+    table->removeEntry("mid");
+    names.erase(names.begin() + 2);
+
+    std::vector<std::string> order;
+    for (const auto& entry : *table) {
+        order.push_back(entry.first);
+    }
+
+    REQUIRE(order == names);
+    REQUIRE((*table)["alpha"] == replacement);
+    REQUIRE((*table)["omega"]->name() == "omega");
+    REQUIRE(!(*table)["mid"]);
+}
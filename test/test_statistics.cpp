@@ -0,0 +1,83 @@
+#include <catch/catch.hpp>
+
+#include <moonshine/Statistics.h>
+
+#include <nlohmann/json.hpp>
+
+#include <sstream>
+#include <string>
+
+using namespace moonshine;
+
+TEST_CASE("statistics record nested phases and counts", "[statistics]") {
+    Statistics stats;
+
+    {
+        Statistics::Phase outer(&stats, "outer");
+
+        {
+            Statistics::Phase inner(&stats, "inner");
+        }
+
+        Statistics::Phase stopped(&stats, "stopped");
+        stopped.stop();
+    }
+
+    {
+        // without statistics, phases do nothing
+        Statistics::Phase phase(nullptr, "disabled");
+    }
+
+    stats.count("tokens", 3);
+    stats.count("nodes", 2);
+    stats.count("tokens", 4);
+
+    const auto& phases = stats.phases();
+    REQUIRE(phases.size() == 3);
+    REQUIRE(phases[0].name == "outer");
+    REQUIRE(phases[0].depth == 0);
+    REQUIRE(phases[1].name == "inner");
+    REQUIRE(phases[1].depth == 1);
+    REQUIRE(phases[2].name == "stopped");
+    REQUIRE(phases[2].depth == 1);
+    REQUIRE(phases[0].seconds >= phases[1].seconds);
+    REQUIRE(stats.seconds() == phases[0].seconds);
+
+    const auto& counts = stats.counts();
+    REQUIRE(counts.size() == 2);
+    REQUIRE(counts[0] == std::make_pair(std::string("tokens"), std::uint64_t(7)));
+    REQUIRE(counts[1] == std::make_pair(std::string("nodes"), std::uint64_t(2)));
+
+    std::ostringstream s;
+    stats.printJson(s);
+    auto json = nlohmann::json::parse(s.str());
+    REQUIRE(json["phases"].size() == 3);
+    REQUIRE(json["phases"][1]["name"] == "inner");
+    REQUIRE(json["phases"][1]["depth"] == 1);
+    REQUIRE(json["seconds"] == stats.seconds());
+    REQUIRE(json["counts"] == nlohmann::json({{"tokens", 7}, {"nodes", 2}}));
+}
+
+TEST_CASE("statistics leave allocations out unless operator new counts them", "[statistics]") {
+    // the tests don't replace operator new
+    REQUIRE_FALSE(Statistics::countsAllocations());
+
+    Statistics stats;
+
+    {
+        Statistics::Phase phase(&stats, "phase");
+        std::string allocated(1000, 'x');
+    }
+
+    std::ostringstream s;
+    stats.printJson(s);
+    auto json = nlohmann::json::parse(s.str());
+    REQUIRE(json["phases"][0]["name"] == "phase");
+    REQUIRE(json["phases"][0].count("allocations") == 0);
+    REQUIRE(json["phases"][0].count("bytes") == 0);
+
+    std::ostringstream table;
+    stats.print(table);
+    REQUIRE(table.str().find("phase") != std::string::npos);
+    REQUIRE(table.str().find("allocations") == std::string::npos);
+}
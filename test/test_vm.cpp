@@ -0,0 +1,188 @@
+#include <catch/catch.hpp>
+
+#include <moonshine/vm/Assembler.h>
+#include <moonshine/vm/Machine.h>
+#include <moonshine/vm/Profile.h>
+
+#include <sstream>
+#include <string>
+
+using namespace moonshine;
+
+static std::string run(const char* source, const std::string& input = "")
+{
+    std::istringstream text(source);
+    std::istringstream in(input);
+    std::ostringstream out;
+
+    vm::Machine machine(vm::Assembler().assemble(text), in, out);
+    machine.run();
+
+    return out.str();
+}
+
+TEST_CASE("vm runs assembled programs", "[vm]") {
+    auto output = run(
+        "             entry\n"
+        "             addi r14,r0,topaddr   % the util library takes its arguments on the stack\n"
+        "             lw r1,n(r0)\n"
+        "             addi r2,r0,1\n"
+        "loop         bz r1,done\n"
+        "             mul r2,r2,r1\n"
+        "             subi r1,r1,1\n"
+        "             j loop\n"
+        "done         sw -8(r14),r2\n"
+        "             addi r3,r0,buf\n"
+        "             sw -12(r14),r3\n"
+        "             jl r15,intstr\n"
+        "             sw -8(r14),r13\n"
+        "             jl r15,putstr\n"
+        "             lb r4,nl(r0)\n"
+        "             putc r4\n"
+        "             hlt\n"
+        "n            dw 5\n"
+        "nl           db 10\n"
+        "buf          res 20\n");
+
+    REQUIRE(output == "120\n");
+
+    // the program's own routines win over the native ones
+    REQUIRE(run(
+        "             entry\n"
+        "             jl r15,putstr\n"
+        "             hlt\n"
+        "putstr       addi r1,r0,33\n"
+        "             putc r1\n"
+        "             jr r15\n") == "!");
+
+    REQUIRE(run(
+        "             entry\n"
+        "             addi r14,r0,topaddr\n"
+        "             addi r1,r0,buf\n"
+        "             sw -8(r14),r1\n"
+        "             jl r15,getstr\n"
+        "             jl r15,strint\n"
+        "             muli r1,r13,-2\n"
+        "             getc r2\n"
+        "             add r1,r1,r2\n"
+        "             putc r1\n"
+        "             hlt\n"
+        "buf          res 20\n", "-21\n!") == "K");
+}
+
+TEST_CASE("vm reports errors with their source line", "[vm]") {
+    std::istringstream text(
+        "             entry\n"
+        "             addi r1,r0,4\n"
+        "             divi r2,r1,0\n"
+        "             hlt\n");
+    std::istringstream in;
+    std::ostringstream out;
+    vm::Machine machine(vm::Assembler().assemble(text), in, out);
+
+    try {
+        machine.run();
+        FAIL("division by zero went through");
+    } catch (const vm::RuntimeError& e) {
+        REQUIRE(e.line() == 3);
+        REQUIRE(e.address() == 4);
+    }
+
+    REQUIRE(machine.steps() == 1);
+
+    // falling off the end, executing data and stray memory accesses
+    REQUIRE_THROWS_AS(run("addi r1,r0,1\n"), const vm::RuntimeError&);
+    REQUIRE_THROWS_AS(run("j data\ndata dw 0\n"), const vm::RuntimeError&);
+    REQUIRE_THROWS_AS(run("lw r1,-4(r0)\nhlt\n"), const vm::RuntimeError&);
+    REQUIRE_THROWS_AS(run("lw r1,2(r0)\nhlt\n"), const vm::RuntimeError&);
+
+    std::istringstream unknown("hlt\nfoo r1,r2\n");
+
+    try {
+        vm::Assembler().assemble(unknown);
+        FAIL("unknown instruction went through");
+    } catch (const vm::AssemblyError& e) {
+        REQUIRE(e.line() == 2);
+    }
+
+    std::istringstream undefined("j nowhere\n");
+    REQUIRE_THROWS_AS(vm::Assembler().assemble(undefined), const vm::AssemblyError&);
+
+    // the K field is 16 bit signed
+    std::istringstream largest("addi r1,r0,32767\nsubi r1,r1,-32768\nlw r2,-32768(r14)\nhlt\n");
+    REQUIRE_NOTHROW(vm::Assembler().assemble(largest));
+
+    std::istringstream tooLarge("addi r1,r0,32768\nhlt\n");
+    REQUIRE_THROWS_AS(vm::Assembler().assemble(tooLarge), const vm::AssemblyError&);
+
+    std::istringstream tooSmall("hlt\nsw -32769(r14),r1\n");
+
+    try {
+        vm::Assembler().assemble(tooSmall);
+        FAIL("out of range offset went through");
+    } catch (const vm::AssemblyError& e) {
+        REQUIRE(e.line() == 2);
+    }
+
+    // data isn't limited
+    std::istringstream data("hlt\nbig dw 100000\n");
+    REQUIRE_NOTHROW(vm::Assembler().assemble(data));
+}
+
+TEST_CASE("vm profiles instructions, memory accesses and calls", "[vm]") {
+    std::istringstream text(
+        "twice        % funcDef: twice\n"                       // 1
+        "             sw -4(r14),r15\n"
+        "             %% function body begin\n"
+        "             add r13,r1,r1\n"
+        "             lw r15,-4(r14)\n"                         // 5
+        "             jr r15\n"
+        "             %% function body end\n"
+        "             entry\n"
+        "             addi r14,r0,topaddr\n"
+        "             %% program body begin\n"                // 10
+        "             addi r2,r0,3\n"
+        "loop         bz r2,done\n"
+        "             % fCall: twice\n"
+        "             addi r1,r2,0\n"
+        "             jl r15,twice\n"                          // 15
+        "             subi r2,r2,1\n"
+        "             j loop\n"
+        "done         hlt\n");
+    auto image = vm::Assembler().assemble(text);
+
+    vm::Profile profile(image);
+    std::istringstream in;
+    std::ostringstream out;
+    vm::Machine machine(std::move(image), in, out);
+    machine.run(profile);
+
+    REQUIRE(profile.total().instructions == machine.steps());
+    REQUIRE(profile.total().loads == 3);
+    REQUIRE(profile.total().stores == 3);
+
+    // the loop condition runs once more than its body
+    REQUIRE(profile.at(4 * 6).instructions == 4);
+    REQUIRE(profile.at(4 * 7).instructions == 3);
+
+    auto functions = profile.functions();
+    // followed by the native util library routines
+    REQUIRE(functions.size() == 6);
+    REQUIRE(functions[0].name == "twice");
+    REQUIRE(functions[0].line == 1);
+    REQUIRE(functions[0].calls == 3);
+    REQUIRE(functions[0].self.instructions == 12);
+    REQUIRE(functions[0].inclusive.instructions == 12);
+    REQUIRE(functions[1].name == "program");
+    REQUIRE(functions[1].inclusive.instructions == machine.steps());
+
+    std::ostringstream flat;
+    profile.printFlat(flat);
+    REQUIRE(flat.str().find("program: fCall: twice") != std::string::npos);
+    REQUIRE(flat.str().find("program -> twice") != std::string::npos);
+
+    std::ostringstream callgrind;
+    profile.printCallgrind(callgrind, "program.m");
+    REQUIRE(callgrind.str().find("events: Ir Dr Dw") != std::string::npos);
+    REQUIRE(callgrind.str().find("cfn=twice\ncalls=3 1\n15 12 3 3\n") != std::string::npos);
+}